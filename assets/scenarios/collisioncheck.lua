@@ -0,0 +1,24 @@
+-- Differential check of the collision code for TCollisionChecker. Start the game with the "collisioncheck" config
+-- setting pointing at this file to run it. Each round crowds up to maxBalloons balloons and maxBullets bullets round a
+-- few places, burstPercent of them already burst, and moves them for a number of frames, checking TBall::Update,
+-- TBalloonManager::TestForCollisions and TCollisionGrid against the reference every frame. Times are in milliseconds.
+collisioncheck =
+{
+	seed = 2011,
+
+	rounds = 200,
+	frames = 60,
+
+	-- Each frame lasts between half and one and a half ticks
+	tick = 16,
+
+	maxBalloons = 300,
+	maxBullets = 30,
+	clusters = 8,
+	burstPercent = 10,
+
+	-- A recording made with the "record" config setting to replay through the game as well, or "" for none
+	replayFile = "",
+
+	resultsFile = "collisioncheck.json",
+}
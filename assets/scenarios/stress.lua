@@ -0,0 +1,27 @@
+-- Stress scenario for TStressScenario. Start the game with the "scenario" config setting
+-- pointing at this file to run it. Times are in milliseconds, speeds in pixels per millisecond.
+scenario =
+{
+	seed = 2011,
+	duration = 120000,
+
+	-- Balloons added per second, ramping from spawnRateStart to spawnRateEnd over spawnRampTime
+	spawnRateStart = 50,
+	spawnRateEnd = 5000,
+	spawnRampTime = 60000,
+
+	-- Falling speed is picked between velocityMin and velocityMax, sideways speed up to velocitySpreadX either way
+	velocityMin = 0.02,
+	velocityMax = 0.2,
+	velocitySpreadX = 0.1,
+
+	numColours = 6,
+
+	-- Bullets fired per second
+	fireRate = 200,
+
+	-- Balloons and bullets in play are kept at or below this
+	maxBalls = 30000,
+
+	statsFile = "scenario.csv",
+}
@@ -0,0 +1,37 @@
+-- Parameter sweep for TDifficultyTuner. Start the game with the "tuner" config setting pointing at this
+-- file to run it. Every combination of the parameter ranges below is played gamesPerPoint times by a
+-- scripted bot. Times are in milliseconds, speeds in pixels per millisecond. A step of 0 uses just the min.
+tuner =
+{
+	seed = 2011,
+	gamesPerPoint = 200,
+
+	-- Games still going after maxGameTime are stopped and counted as timed out
+	maxGameTime = 600000,
+	tick = 16,
+
+	-- Threads to play games on, 0 for one per core
+	workers = 0,
+
+	-- The bot reloads, waits botShotInterval, then fires, missing its aim by up to botAimError pixels
+	botShotInterval = 250,
+	botAimError = 10,
+
+	balloonsBurstToLevelUpMin = 2,
+	balloonsBurstToLevelUpMax = 5,
+	balloonsBurstToLevelUpStep = 1,
+
+	waitTimeDecreaseMin = 100,
+	waitTimeDecreaseMax = 400,
+	waitTimeDecreaseStep = 100,
+
+	balloonVelocityIncreaseMin = 0.002,
+	balloonVelocityIncreaseMax = 0.006,
+	balloonVelocityIncreaseStep = 0.002,
+
+	levelsToPassForNewColourMin = 2,
+	levelsToPassForNewColourMax = 4,
+	levelsToPassForNewColourStep = 1,
+
+	resultsFile = "tuner.json",
+}
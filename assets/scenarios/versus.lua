@@ -0,0 +1,22 @@
+-- Versus game between two bots for TVersusMatch. Start the game with the "versus" config setting pointing at this
+-- file to play it. Each bot plays its own board through a rollback session, and the sessions talk over an in-process
+-- link which holds every packet back for latency plus up to jitter milliseconds and drops lossPercent of them.
+-- Times are in milliseconds.
+versus =
+{
+	seed = 2011,
+
+	-- The game is stopped after maxGameTime if neither board has reached game over
+	maxGameTime = 300000,
+	tick = 16,
+
+	latency = 80,
+	jitter = 40,
+	lossPercent = 5,
+
+	-- The bots reload, wait botShotInterval, then fire, missing their aim by up to botAimError pixels
+	botShotInterval = 250,
+	botAimError = 10,
+
+	resultsFile = "versus.json",
+}
@@ -0,0 +1,175 @@
+/**
+ *	allocationTracker.cpp - Jan van der Kamp, 2011
+ */
+#include "allocationTracker.h"
+#include "pf/debug.h"
+
+#include <cassert>
+
+#if defined(ALLOCATION_TRACKING)
+	#include <cstdlib>
+	#include <new>
+	#include "threading.h"
+#endif
+
+namespace {
+	const char* const	subsystemNames[TAllocationTracker::NUM_SUBSYSTEMS] = { "simulation", "hud", "draw", "input" };
+
+#if defined(ALLOCATION_TRACKING)
+	// Zero before any constructor runs, so allocations made during static initialisation are safe to count
+	TAtomicCounter		allocationCount;
+
+	void* CountedAlloc(size_t size)
+	{
+		allocationCount.Increment();
+		return malloc(size ? size : 1);
+	}
+#endif
+}
+
+#if defined(ALLOCATION_TRACKING)
+// Every allocation in the program goes through these, on any thread
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+	void* memory = CountedAlloc(size);
+	if(!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc)
+{
+	void* memory = CountedAlloc(size);
+	if(!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+	return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw()
+{
+	return CountedAlloc(size);
+}
+
+void operator delete(void* memory) throw()
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) throw()
+{
+	free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) throw()
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) throw()
+{
+	free(memory);
+}
+#endif
+
+
+/** @function TAllocationTracker::TAllocationTracker - Default Constructor
+ */
+TAllocationTracker::TAllocationTracker() :
+mAsserting(false),
+mSteadyState(false),
+mFrameStart(),
+mExpectedAllocations(),
+mFlaggedFrames()
+{
+	for(uint32_t s = 0; s != NUM_SUBSYSTEMS; ++s)
+		mSubsystemAllocations[s] = 0;
+}
+
+/** @function TAllocationTracker::GetAllocationCount - Gets the number of allocations made so far by the whole program. The
+ *													   count wraps around, so only the difference between two counts means anything.
+ *
+ *		@return		Number of allocations, or 0 if ALLOCATION_TRACKING isn't defined
+ */
+uint32_t TAllocationTracker::GetAllocationCount()
+{
+#if defined(ALLOCATION_TRACKING)
+	return uint32_t(allocationCount.GetValue());
+#else
+	return 0;
+#endif
+}
+
+/** @function TAllocationTracker::BeginFrame - Starts counting the allocations of a new frame
+ *		@param 		steadyState			Whether the game is in a state where frames shouldn't allocate
+ */
+void TAllocationTracker::BeginFrame(bool steadyState)
+{
+	mSteadyState = steadyState;
+	mFrameStart = GetAllocationCount();
+	for(uint32_t s = 0; s != NUM_SUBSYSTEMS; ++s)
+		mSubsystemAllocations[s] = 0;
+	mExpectedAllocations = 0;
+}
+
+/** @function TAllocationTracker::EndFrame - Finishes the frame, flagging it if it was in a steady state from start to end and
+ *											 made any allocations that weren't expected
+ *		@param 		steadyState			Whether the game is still in a state where frames shouldn't allocate
+ *
+ *		@return		false if the frame was flagged
+ */
+bool TAllocationTracker::EndFrame(bool steadyState)
+{
+	uint32_t allocations = GetFrameAllocations();
+	if(!mSteadyState || !steadyState || allocations <= mExpectedAllocations)
+		return true;
+
+	mFlaggedFrames++;
+	uint32_t accountedFor = 0;
+	for(uint32_t s = 0; s != NUM_SUBSYSTEMS; ++s) {
+		accountedFor += mSubsystemAllocations[s];
+		if(mSubsystemAllocations[s])
+			DEBUG_WRITE(("Steady-state frame allocated: %s %d", subsystemNames[s], mSubsystemAllocations[s]));
+	}
+	if(allocations > accountedFor)
+		DEBUG_WRITE(("Steady-state frame allocated: other %d", allocations - accountedFor));
+	assert(!mAsserting && "Heap allocation during a steady-state frame");
+	return false;
+}
+
+/** @function TAllocationTracker::AddAllocations - Adds allocations to a subsystem's count for this frame
+ *		@param 		subsystem			Subsystem the allocations were made by, less than NUM_SUBSYSTEMS
+ *		@param 		allocations			Number of allocations made
+ *		@param 		expected			Whether the allocations were expected, so shouldn't flag the frame
+ */
+void TAllocationTracker::AddAllocations(uint16_t subsystem, uint32_t allocations, bool expected)
+{
+	if(subsystem < NUM_SUBSYSTEMS)
+		mSubsystemAllocations[subsystem] += allocations;
+	if(expected)
+		mExpectedAllocations += allocations;
+}
+
+
+/** @function TAllocationScope::TAllocationScope - Constructor			Starts counting allocations for a subsystem
+ *		@param 		tracker				Tracker to add the allocations to
+ *		@param 		subsystem			Subsystem the allocations are made by
+ *		@param 		expected			Whether the allocations are expected, so shouldn't flag the frame
+ */
+TAllocationScope::TAllocationScope(TAllocationTracker& tracker, uint16_t subsystem, bool expected) :
+mTracker(tracker),
+mSubsystem(subsystem),
+mExpected(expected),
+mStart(TAllocationTracker::GetAllocationCount())
+{}
+
+/** @function TAllocationScope::~TAllocationScope - Destructor, adds the allocations made since construction to the tracker
+ */
+TAllocationScope::~TAllocationScope()
+{
+	mTracker.AddAllocations(mSubsystem, TAllocationTracker::GetAllocationCount() - mStart, mExpected);
+}
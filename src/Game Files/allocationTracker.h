@@ -0,0 +1,77 @@
+/**
+ *	allocationTracker.h - Jan van der Kamp, 2011
+ */
+#ifndef ALLOCATIONTRACKER_H_INCLUDED
+#define ALLOCATIONTRACKER_H_INCLUDED
+
+#include <pf/pflib.h>
+
+// Allocations are counted in debug builds, define NO_ALLOCATION_TRACKING to leave operator new alone
+#if defined(_DEBUG) && !defined(NO_ALLOCATION_TRACKING)
+	#define ALLOCATION_TRACKING
+#endif
+
+/** @class TAllocationTracker - Counts the heap allocations made during each frame, in total and for each subsystem that
+ *								wraps its work in a TAllocationScope. The counts come from a replacement global operator new,
+ *								which is only built in when ALLOCATION_TRACKING is defined; otherwise every count is 0.
+ *								Once the game has settled into playing, a frame shouldn't allocate at all, so a steady-state
+ *								frame that does is flagged with a debug message listing the subsystems responsible, and, with
+ *								asserting turned on, an assertion. Allocations made in a scope marked as expected, such as
+ *								the HUD text being rebuilt when the score changes, are counted but not flagged.
+ *	@property 	bool			mAsserting							Whether a flagged frame fails an assertion
+ *	@property 	bool			mSteadyState						Whether the current frame started in a steady state
+ *	@property 	uint32_t		mFrameStart							Allocation count when the current frame started
+ *	@property 	uint32_t		mSubsystemAllocations[NUM_SUBSYSTEMS]	Allocations made by each subsystem this frame
+ *	@property 	uint32_t		mExpectedAllocations				Allocations made this frame in scopes marked as expected
+ *	@property 	uint32_t		mFlaggedFrames						Number of steady-state frames that allocated
+ */
+class TAllocationTracker
+{
+public:
+	enum { SIMULATION = 0, HUD, DRAW, INPUT, NUM_SUBSYSTEMS };
+
+	TAllocationTracker();
+	void				SetAsserting(bool asserting)	{ mAsserting = asserting; }
+	void				BeginFrame(bool steadyState);
+	bool				EndFrame(bool steadyState);
+	void				AddAllocations(uint16_t subsystem, uint32_t allocations, bool expected);
+	uint32_t			GetFrameAllocations()	const	{ return GetAllocationCount() - mFrameStart; }
+	uint32_t			GetFlaggedFrames()		const	{ return mFlaggedFrames; }
+	static uint32_t		GetAllocationCount();
+private:
+	// copying disallowed
+	TAllocationTracker(const TAllocationTracker &tracker);
+	TAllocationTracker& operator=(const TAllocationTracker &tracker);
+
+	bool				mAsserting;
+	bool				mSteadyState;
+	uint32_t			mFrameStart;
+	uint32_t			mSubsystemAllocations[NUM_SUBSYSTEMS];
+	uint32_t			mExpectedAllocations;
+	uint32_t			mFlaggedFrames;
+};
+
+/** @class TAllocationScope - Adds the allocations made during its lifetime to one subsystem of a TAllocationTracker.
+ *							  Scopes shouldn't be nested, or the inner allocations are counted twice.
+ *	@property 	TAllocationTracker&		mTracker				Tracker to add the allocations to
+ *	@property 	uint16_t				mSubsystem				Subsystem the allocations are made by
+ *	@property 	bool					mExpected				Whether the allocations are expected, so not flagged
+ *	@property 	uint32_t				mStart					Allocation count when the scope started
+ */
+class TAllocationScope
+{
+public:
+	TAllocationScope(TAllocationTracker& tracker, uint16_t subsystem, bool expected = false);
+	~TAllocationScope();
+private:
+	// copying disallowed
+	TAllocationScope(const TAllocationScope &scope);
+	TAllocationScope& operator=(const TAllocationScope &scope);
+
+	TAllocationTracker&	mTracker;
+	uint16_t			mSubsystem;
+	bool				mExpected;
+	uint32_t			mStart;
+};
+
+#endif // ALLOCATIONTRACKER_H_INCLUDED
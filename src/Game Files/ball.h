@@ -7,58 +7,213 @@
 #include <pf/pflib.h> 
 #include <pf/vec.h>
 #include <pf/rect.h>
+#include <vector>
+#include <algorithm>
 #include "gameVariables.h"
-#include "gameObject.h"
+
+/** @struct TBalloonKind - Says at compile time that a ball is a balloon, for TBall::CollisionTest
+ */
+struct TBalloonKind
+{
+	enum { IS_BULLET = false };
+};
+
+/** @struct TBulletKind - Says at compile time that a ball is a bullet, for TBall::CollisionTest
+ */
+struct TBulletKind
+{
+	enum { IS_BULLET = true };
+};
+
+/** @struct TBallAssets - The textures balls of each colour are drawn with. One table is owned by whatever draws the game,
+ *						  and the balls and their owners only refer to it, so that the textures' reference counts aren't
+ *						  touched as balls and games are made and copied.
+ *	@property 	std::vector<TTextureRef>			mTextures				Texture of each colour of ball
+ *	@property 	std::vector<TAnimatedTextureRef>	mBurstTextures			Burst animation of each colour of ball
+ *	@property 	uint32_t							mDrawExtent				Half the width or height of the largest texture, so
+ *																				that a ball drawn at a scale of 1 lies within this
+ *																				distance of its position along either axis
+ *	@property 	uint32_t							mBurstDuration			Time in milliseconds the longest burst animation
+ *																				takes to play, which a burst ball stays on screen for
+ */
+struct TBallAssets
+{
+	TBallAssets() : mTextures(), mBurstTextures(), mDrawExtent(), mBurstDuration() {}
+	uint16_t		GetNumColours()		const	{ return uint16_t(mTextures.size()); }
+
+	std::vector<TTextureRef>			mTextures;
+	std::vector<TAnimatedTextureRef>	mBurstTextures;
+	uint32_t							mDrawExtent;
+	uint32_t							mBurstDuration;
+};
 
 /** @class TBall - This class represents any balls on screen. It can be used for both balloons which are falling and 
  *				    must be burst, and bullets which are fired by the cannon. The bool isBullet signifies which.
- *				   This class inherits from IObject for the Draw/Update interface.
- *		@property 		uint16_t				mColour					The colour of the ball
- *		@property 		TReal					mScale					The scale of the ball
- *		@property 		bool					mIsBullet				Whether the ball is a bullet
+ *				   The loops over balls always know which kind of balls they hold, so rather than TBall checking
+ *				   mIsBullet, CollisionTest is told the kinds as TBalloonKind or TBulletKind template arguments, and
+ *				   the branches that don't apply are compiled out. It and Update are defined here so that they are
+ *				   inlined into the loops of TBalloonManager, TCannon and TEntityWorld.
+ *				   Balls don't hold on to their textures or scale, the TBalloonManager or TCannon which owns them
+ *				   looks their colour up in the shared TBallAssets when drawing, and all of its balls share one scale.
+ *				   This keeps balls to a small record of plain data, so that games can be simulated without drawing, on
+ *				   any thread, and balls are cheap to copy as they are fired and kept in the arrays of a TEntityWorld,
+ *				   whose storage is reused from frame to frame.
+ *				   Burst balls are removed by the TBurstTimer their owner shares, so Update only moves balls.
  *		@property 		TVec2					mPosition				The position of the ball
  *		@property 		TVec2					mVelocity				The velocity of the ball
+ *		@property 		uint16_t				mBurstExpiry			Tick of its TBurstTimer the ball finishes bursting on, kept
+ *																		to 16 bits
  *		@property 		uint16_t				mRadius					The radius of the ball
- *		@property 		bool					mRemoveThisBall			Whether ball should be removed from game
- *		@property 		bool					mBalloonBurst			Whether the balloon has been burst
- *		@property 		static TRect			sBounds					The boundary of the playing area
- *		@property 		TTextureRef				mBalloonTexture			Texture used to display ball on screen
- *		@property 		TAnimatedSpriteRef		mBalloonBurstImage		Animated sprite for when ball has been burst
+ *		@property 		uint16_t				mId						Number the ball's owner gave it, so that it can be
+ *																		told apart from other balls from frame to frame
+ *		@property 		uint8_t					mColour					The colour of the ball
+ *		@property 		uint8_t					mFlags					BULLET, REMOVE and BURST
  */
-class TBall : public IObject
+class TBall
 {
 public:
-	TBall(const TVec2& position, const TVec2& velocity, TReal scale, uint16_t colour, 
-		  const TTextureRef& balloonTexture, const TAnimatedTextureRef& balloonBurstTexture, bool isBullet);
-	virtual	~TBall() {}
-	virtual void		Draw() const;
-	virtual void		Update(uint32_t elapsedTime);
-	bool				CollisionTest(TBall& other);
+	TBall(const TVec2& position, const TVec2& velocity, uint16_t radius, uint16_t colour, bool isBullet);
+	void				Draw(const TBallAssets& assets, TReal scale, TReal burstTime) const;
+	void				Update(double elapsedTime, const TRect& bounds);
+	template<class TKind, class TOtherKind>
+	uint32_t			CollisionTest(TBall& other, uint16_t burstExpiry);
 	uint16_t			GetColour()		const		{ return mColour; }
 	uint16_t			GetRadius()		const		{ return mRadius; }
 	const TVec2&		GetPosition()	const		{ return mPosition; }
-	bool				GetRemove()		const		{ return mRemoveThisBall; }
-	void				SetRemoveTrue()				{ mRemoveThisBall = true; }
+	const TVec2&		GetVelocity()	const		{ return mVelocity; }
+	bool				GetRemove()		const		{ return (mFlags & REMOVE) != 0; }
+	void				SetRemoveTrue()				{ mFlags |= REMOVE; }
 	void				SetPosition(TVec2 position)	{ mPosition = position; }
 	void				SetVelocity(TVec2 velocity)	{ mVelocity = velocity; }
-	void				SetToBurst()				{ mBalloonBurst = true; mVelocity = gameVars::burstBalloonVelocity; }
-	bool				IsBurst()					{ return mBalloonBurst; }
-	bool				IsBullet()					{ return mIsBullet; }
-	static void		SetBounds(const TRect& bounds)  { sBounds = bounds; }
-	static const	TRect& GetBounds()				{ return sBounds; }
+	void				SetToBurst(uint16_t burstExpiry)	{ mFlags |= BURST; mVelocity = gameVars::burstBalloonVelocity;
+															  mBurstExpiry = burstExpiry; }
+	bool				IsBurst()		const		{ return (mFlags & BURST) != 0; }
+	bool				IsBullet()		const		{ return (mFlags & BULLET) != 0; }
+	uint16_t			GetBurstExpiry()	const	{ return mBurstExpiry; }
+	void				SetBurstExpiry(uint16_t burstExpiry)	{ mBurstExpiry = burstExpiry; }
+	uint16_t			GetId()			const		{ return mId; }
+	void				SetId(uint16_t id)			{ mId = id; }
+
+	// Burst time is counted in fixed point, each frame's time rounded to the nearest tick
+	enum { BURST_TIME_SCALE = 16 };
+	static uint32_t		ToBurstTime(double milliseconds)	{ return uint32_t(milliseconds * BURST_TIME_SCALE + 0.5); }
 private:
-	TBall& operator=(const TBall &ball);
-	const uint16_t		mColour;
-	const TReal			mScale;
-	const bool			mIsBullet;
+	enum { BULLET = 1, REMOVE = 2, BURST = 4 };
+
+	// Ordered largest first with nothing left over, so that a ball has no padding and the same ball is always the same
+	// bytes when copied into a TSimulationSnapshot
 	TVec2				mPosition;
 	TVec2				mVelocity;
+	uint16_t			mBurstExpiry;
 	uint16_t			mRadius;
-	bool				mRemoveThisBall;
-	bool				mBalloonBurst;
-	static TRect		sBounds;
-	TTextureRef			mBalloonTexture;
-	TAnimatedSpriteRef	mBalloonBurstImage;
+	uint16_t			mId;
+	uint8_t				mColour;
+	uint8_t				mFlags;
 };
 
+/** @class TBallCuller - Decides which balls can't be seen, so that they aren't drawn, and counts them. A ball is taken to
+ *						 be a square around its position, which is clipped to the part of the screen the play area is
+ *						 seen through; the ball is hidden if nothing is left of it, or what's left lies behind the
+ *						 occluder, a rect drawn over balls that is opaque all over.
+ *		@property 		TRect					mVisible				Part of the screen balls can be seen in
+ *		@property 		TRect					mOccluder				Opaque rect drawn over balls, empty if there is none
+ *		@property 		uint32_t				mCulled					Number of balls found to be hidden
+ */
+class TBallCuller
+{
+public:
+	TBallCuller(const TRect& visible, const TRect& occluder) : mVisible(visible), mOccluder(occluder), mCulled() {}
+	bool				IsHidden(const TBall& ball, TReal extent);
+	uint32_t			GetCulled()		const		{ return mCulled; }
+private:
+	TRect				mVisible;
+	TRect				mOccluder;
+	uint32_t			mCulled;
+};
+
+/** @function TBall::CollisionTest - Tests for a collision with another ball and modifies each accordingly.
+ *									 If they are both balloons, they will burst regardless of colour. If one is 
+ *									 a bullet they will burst if they are the same colour, otherwise the bullet bursts
+ *									 and the balloon is knocked away from it. Balls which burst are given burstExpiry,
+ *									 and their owner should then TBurstTimer::Schedule() it.
+ *		@param 		TKind			 TBalloonKind or TBulletKind, whichever this ball is
+ *		@param 		TOtherKind		 TBalloonKind or TBulletKind, whichever other is
+ *		@param 		other			 Another ball to test against for a collision
+ *		@param 		burstExpiry		 TBurstTimer::GetExpiry(), the tick balls burst now finish bursting on
+ *
+ *		@return		Number of balls burst, 2 if they both burst
+ */
+template<class TKind, class TOtherKind>
+inline uint32_t TBall::CollisionTest(TBall& other, uint16_t burstExpiry)
+{
+	if((mFlags | other.mFlags) & BURST)
+		return 0;
+
+	// Collision has occurred between *this and other
+	if((mPosition - other.mPosition).Length() <= mRadius + other.mRadius) 
+	{
+		if(TKind::IS_BULLET && !TOtherKind::IS_BULLET && mColour != other.mColour) 
+		{
+			SetToBurst(burstExpiry);
+			other.mVelocity = (other.mPosition - mPosition).Normalize();
+			return 1;
+		} 
+		else if(!TKind::IS_BULLET && TOtherKind::IS_BULLET && mColour != other.mColour) 
+		{
+			other.SetToBurst(burstExpiry);
+			mVelocity = (mPosition - other.mPosition).Normalize();
+			return 1;
+		} 
+		else 
+		{
+			SetToBurst(burstExpiry);
+			other.SetToBurst(burstExpiry);
+			return 2;
+		}
+	}	
+	return 0;
+}
+
+/** @function TBall::Update - Updates the position of the ball and alters its velocity if has
+ *							  bounced off the side of the screen.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		bounds				The boundary of the playing area
+ */
+inline void TBall::Update(double elapsedTime, const TRect& bounds)
+{
+	mPosition += mVelocity * TReal(elapsedTime);
+
+	// multiply mRadius by 2 to ensure ball is not visible behind barriers before removing
+ 	if(mPosition.y > bounds.y2 + mRadius * 2 ||
+	   mPosition.y < -(int32_t)mRadius)	
+		mFlags |= REMOVE;
+
+	if(mPosition.x < mRadius && mVelocity.x < 0.f) 
+		mVelocity.x *= -1.f;
+	else if(mPosition.x > bounds.x2 - mRadius && mVelocity.x > 0.f) 
+			 mVelocity.x *= -1.f;
+	else if(mPosition.y < bounds.y1 + mRadius && mVelocity.y < 0.f) 
+			 mVelocity.y *= -1.f;
+}
+
+/** @function TBallCuller::IsHidden - Tests whether a ball can't be seen, counting it if so
+ *		@param 		ball				The ball
+ *		@param 		extent				Distance from the ball's position to the edge of its sprite along either axis
+ *
+ *		@return		true if the ball is hidden and needn't be drawn
+ */
+inline bool TBallCuller::IsHidden(const TBall& ball, TReal extent)
+{
+	const TVec2& position = ball.GetPosition();
+	TReal x1 = std::max(position.x - extent, TReal(mVisible.x1));
+	TReal x2 = std::min(position.x + extent, TReal(mVisible.x2));
+	TReal y1 = std::max(position.y - extent, TReal(mVisible.y1));
+	TReal y2 = std::min(position.y + extent, TReal(mVisible.y2));
+	bool hidden = (x1 >= x2 || y1 >= y2 || (x1 >= mOccluder.x1 && x2 <= mOccluder.x2 && 
+											 y1 >= mOccluder.y1 && y2 <= mOccluder.y2));
+	if(hidden)
+		mCulled++;
+	return hidden;
+}
+
 #endif
\ No newline at end of file
@@ -2,9 +2,29 @@
  *	balloonManager.cpp - Jan van der Kamp, 2011
  */
 #include "balloonManager.h"
+#include "trace.h"
 
 using std::vector;
-using std::list;
+
+/** @function TStateVariables::TStateVariables - Default Constructor	Sets up variables for the start of a game with the values 
+ *																	given in gameVariables.h
+ */
+TStateVariables::TStateVariables() :
+								 mMinWaitForBalloon(gameVars::initialMinWaitForBalloon),
+								 mMaxWaitForBalloon(gameVars::initialMaxWaitForBalloon),
+								 mCurrentWaitForBalloon((gameVars::initialMinWaitForBalloon + gameVars::initialMaxWaitForBalloon) / 2),
+								 mTimeSinceLastBalloon(),
+								 mBalloonsAddedSoFar(),
+								 mBalloonsBurstSoFar(),
+								 mBalloonsBurstToLevelUp(gameVars::balloonsBurstToLevelUp),
+								 mScore(),
+								 mLevel(1),
+								 mWaitTimeDecrease(gameVars::waitTimeDecrease),
+								 mNumColoursInPlay(gameVars::initialNumColoursInPlay),
+								 mLevelsToPassForNewColour(gameVars::levelsToPassForNewColour),
+								 mBalloonVelocity(gameVars::initialBalloonVelocity),
+								 mBalloonVelocityIncrease(gameVars::balloonVelocityIncrease)
+								 {}
 
 /** @function TStateVariables::TStateVariables - Constructor			Takes parameters to construct TStateVariables with
  *		@param 		minWaitForBalloon				Current shortest time to wait for new balloon
@@ -13,10 +33,11 @@ using std::list;
  *		@param 		balloonVelocity					Velocity of balloons
  *		@param 		balloonVelocityIncrease			Amount that mBalloonVelocity.y increases by when new level is reached
  *		@param 		numColoursInPlay				Range of colours that bullets can be
+ *		@param 		levelsToPassForNewColour		Number of levels player needs to pass before introducing a new colour
  */
 TStateVariables::TStateVariables(uint16_t minWaitForBalloon, uint16_t maxWaitForBalloon, uint16_t balloonsBurstToLevelUp, 
 								 uint16_t waitTimeDecrease, const TVec2& balloonVelocity, TReal balloonVelocityIncrease,
-								 uint16_t numColoursInPlay) :
+								 uint16_t numColoursInPlay, uint16_t levelsToPassForNewColour) :
 								 mMinWaitForBalloon(minWaitForBalloon),
 								 mMaxWaitForBalloon(maxWaitForBalloon),
 								 mCurrentWaitForBalloon((minWaitForBalloon + maxWaitForBalloon) / 2),
@@ -28,6 +49,7 @@ TStateVariables::TStateVariables(uint16_t minWaitForBalloon, uint16_t maxWaitFor
 								 mLevel(1),
 								 mWaitTimeDecrease(waitTimeDecrease),
 								 mNumColoursInPlay(numColoursInPlay),
+								 mLevelsToPassForNewColour(levelsToPassForNewColour),
 								 mBalloonVelocity(balloonVelocity),
 								 mBalloonVelocityIncrease(balloonVelocityIncrease)
 								 {}
@@ -36,61 +58,67 @@ TStateVariables::TStateVariables(uint16_t minWaitForBalloon, uint16_t maxWaitFor
 /** @function TBalloonManager::TBalloonManager - Constructor			Takes parameters to construct TBalloonManager with
  *		@param 		balloonScale				Size of the falling balloons fired
  *		@param 		stateVariables				Variables for tracking difficulty and progress
+ *		@param 		random						Random number generator used to place and colour new balloons
+ *		@param 		burstTimer					Decides when burst balloons are removed, shared with the cannon
+ *		@param 		world						Holds the balloons, shared with the cannon
  */
-TBalloonManager::TBalloonManager(TReal balloonScale, const TStateVariables& stateVariables) :
+TBalloonManager::TBalloonManager(TReal balloonScale, const TStateVariables& stateVariables, TRandom& random,
+								 TBurstTimer& burstTimer, TEntityWorld& world) :
 							     mBalloonScale(balloonScale),
 							     mBalloonRadius(),
-							     mBalloons(),
-								 mBalloonTextures(),
-								 mBalloonBurstTextures(),
-								 mVars(stateVariables)
-							     {}
+								 mWorld(world),
+								 mArchetype(world.AddArchetype(0, gameVars::balloonCapacity)),
+								 mBallAssets(NULL),
+								 mNumColours(),
+								 mVars(stateVariables),
+								 mBounds(),
+								 mRandom(random),
+								 mBurstTimer(burstTimer)
+								 {}
 
 /** @function TBalloonManager::AssignAssets - Seperate function to assign image assets to TBalloonManager. AssignAssets is used so 
  *											  that TBalloonManager's constructor can be called by TGame's default constructor, and 
  *											  AssignAssets should then be called in TGame's default constructor.
- *		@param 		balloonTextures				Textures used to display balloons on screen
- *		@param 		balloonBurstTextures		Animated textures for when bullets have been burst
+ *		@param 		ballAssets					Textures used to display balloons on screen, which must outlive this
  */
-void TBalloonManager::AssignAssets(const std::vector<TTextureRef>& balloonTextures, 
-								   const std::vector<TAnimatedTextureRef>& balloonBurstTextures)
+void TBalloonManager::AssignAssets(const TBallAssets& ballAssets)
 {
-	mBalloonTextures = balloonTextures;
-	mBalloonBurstTextures = balloonBurstTextures;
+	mBallAssets = &ballAssets;
+	mNumColours = ballAssets.GetNumColours();
 
-	mBalloonRadius = uint16_t((balloonTextures[0]->GetWidth() / 2) * mBalloonScale);
+	mBalloonRadius = uint16_t((ballAssets.mTextures[0]->GetWidth() / 2) * mBalloonScale);
 }
 
-/** @function TBalloonManager::Reset - This function resets variables in mVars and should be called any time a 
+/** @function TBalloonManager::Reset - This function resets mVars and removes all balloons, and should be called any time a 
  *									   new game is started.
- *		@param 		mMinWaitForBalloon			Current shortest time to wait for new balloon 
- *		@param		mMaxWaitForBalloon			Current longest time to wait for new balloon
- *		@param 		balloonVelocity				Velocity of balloons
- *		@param 		balloonsBurstToLevelUp		Number of balloons necessary to burst in order to level up
+ *		@param 		stateVariables				Variables for the start of the new game
  */
-void TBalloonManager::Reset(uint16_t minWaitForBalloon, uint16_t maxWaitForBalloon, const TVec2& balloonVelocity, 
-							uint16_t balloonsBurstToLevelUp)
+void TBalloonManager::Reset(const TStateVariables& stateVariables)
 {
-	mVars.mMinWaitForBalloon = minWaitForBalloon;
-	mVars.mMaxWaitForBalloon = maxWaitForBalloon;
-	mVars.mCurrentWaitForBalloon = (minWaitForBalloon + maxWaitForBalloon) / 2;
-	mVars.mTimeSinceLastBalloon = 0;
-	mVars.mBalloonVelocity = balloonVelocity;
-	mVars.mScore = 0;
-	mVars.mLevel = 1;
-	mVars.mBalloonsBurstToLevelUp = balloonsBurstToLevelUp;
-	mVars.mBalloonsBurstSoFar = 0;
-	mBalloons.clear();
+	mVars = stateVariables;
+	mWorld.Clear(mArchetype);
 }
 
-/** @function TBalloonManager::Draw - Draws the falling balloons to the screen 
+/** @function TBalloonManager::Draw - Draws the falling balloons which are on screen
 */
 void TBalloonManager::Draw() const
+{
+	TBallCuller culler(TRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT), TRect(0, 0, 0, 0));
+	Draw(culler);
+}
+
+/** @function TBalloonManager::Draw - Draws the falling balloons which can be seen
+ *		@param 		culler				Decides which balloons are hidden, and counts them
+ */
+void TBalloonManager::Draw(TBallCuller& culler) const
 {
 	// Exception could be thrown here if AssignAssets has not been called
-	for(list<TBall>::const_iterator balloon = mBalloons.begin(); 
-		balloon != mBalloons.end(); ++balloon) 
-			balloon->Draw();
+	TReal extent = mBallAssets->mDrawExtent * mBalloonScale;
+	const vector<TBall>& balloons = GetBalloons();
+	for(vector<TBall>::const_iterator balloon = balloons.begin(); 
+		balloon != balloons.end(); ++balloon) 
+			if(!culler.IsHidden(*balloon, extent))
+				balloon->Draw(*mBallAssets, mBalloonScale, mBurstTimer.GetBurstTime(*balloon));
 }
 
 /** @function TBalloonManager::Update - Calls TBall::Update on all balloons, also introduces more colours according 
@@ -98,50 +126,134 @@ void TBalloonManager::Draw() const
  *										level has been reached, and removing any balloons which are not needed any more.
  *		@param 		elapsedTime			Time in milliseconds since last frame
  */
-void TBalloonManager::Update(uint32_t elapsedTime)
+void TBalloonManager::Update(double elapsedTime)
+{
+	TRACE_SCOPE("TBalloonManager::Update");
+	MoveBalloons(0, uint32_t(GetBalloons().size()), elapsedTime);
+	UpdateContents(elapsedTime);
+}
+
+/** @function TBalloonManager::MoveBalloons - Moves a range of balloons with TEntityWorld::Update. Each balloon only touches
+ *											  itself, so separate ranges can be moved on separate threads at once.
+ *		@param 		first				Position of the first balloon to move
+ *		@param 		last				Position after the last balloon to move, past the end of the balloons if need be
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ */
+void TBalloonManager::MoveBalloons(uint32_t first, uint32_t last, double elapsedTime)
 {
-	for(list<TBall>::iterator balloon = mBalloons.begin(); 
-		balloon != mBalloons.end(); ++balloon) 
-			balloon->Update(elapsedTime);
+	mWorld.Update(mArchetype, first, last, elapsedTime, mBounds);
+}
 
-	mVars.mTimeSinceLastBalloon += elapsedTime;
+/** @function TBalloonManager::UpdateContents - The rest of Update() once the balloons have moved: introduces more colours,
+ *												adds a balloon or raises the level if it is time to, and removes balloons
+ *												which are not needed any more. The burst timer must have been advanced.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ */
+void TBalloonManager::UpdateContents(double elapsedTime)
+{
+	mVars.mTimeSinceLastBalloon += TReal(elapsedTime);
 	
 	// Introduce more colours as difficulty progresses
-	if(mVars.mNumColoursInPlay < mBalloonTextures.size()) 
+	if(mVars.mNumColoursInPlay < mNumColours) 
 		mVars.mNumColoursInPlay = gameVars::initialNumColoursInPlay + 
 								  mVars.mLevel / 
-								  gameVars::levelsToPassForNewColour;
+								  mVars.mLevelsToPassForNewColour;
 
 	// Check whether a new balloon should be added to game
 	AddBalloonCheck();
 	IncreaseLevelCheck();
+	mBurstTimer.RemoveExpired(mWorld, mArchetype);
 	CleanUpContents();
 }
 
 /** @function TBalloonManager::TestForCollisions - This function first tests for a collision between bullets and balloons,
  *												   increasing the score by 1 if one occurrs, and then tests for a collision 
  * 												   between balloons themselves, increasing the score by 2 if one occurrs.
- *		@param 		bullets			Bullets which have been fired by the cannon.
+ *												   Balls burst are scheduled with the burst timer.
+ *		@param 		bulletArchetype		Archetype of mWorld holding the bullets which have been fired by the cannon.
  */
-void TBalloonManager::TestForCollisions(std::list<TBall>& bullets)
+void TBalloonManager::TestForCollisions(uint32_t bulletArchetype)
 {
-	// First check for collisions between bullets and balloons
-	for(list<TBall>::iterator balloon = mBalloons.begin(); balloon != mBalloons.end(); ++balloon)
-		for(list<TBall>::iterator bullet = bullets.begin(); bullet != bullets.end(); ++bullet)
-			if(bullet->CollisionTest(*balloon)) {
+	TRACE_SCOPE("TBalloonManager::TestForCollisions");
+	uint16_t burstExpiry = mBurstTimer.GetExpiry();
+	vector<TBall>& balloons = mWorld.GetBalls(mArchetype);
+	vector<TBall>& bullets = mWorld.GetBalls(bulletArchetype);
+
+	// First check for collisions between bullets and balloons. The bullet bursts if there is one, and the balloon too if
+	// they are the same colour.
+	for(uint32_t balloon = 0; balloon != balloons.size(); ++balloon)
+		for(uint32_t bullet = 0; bullet != bullets.size(); ++bullet) {
+			uint32_t hit = bullets[bullet].CollisionTest<TBulletKind, TBalloonKind>(balloons[balloon], burstExpiry);
+			if(hit)
+				mBurstTimer.Schedule(mWorld.GetEntity(bulletArchetype, bullet));
+			if(hit == 2) {
+				mBurstTimer.Schedule(mWorld.GetEntity(mArchetype, balloon));
 				mVars.mScore += mVars.mLevel;
 				mVars.mBalloonsBurstSoFar++;
 			}
+		}
 	
 	// Second check for collisions between any balloons which have been sent flying
-	for(list<TBall>::iterator balloonOne = mBalloons.begin(); balloonOne != mBalloons.end(); ++balloonOne)
-		for(list<TBall>::iterator balloonTwo = mBalloons.begin(); balloonTwo != mBalloons.end(); ++balloonTwo)
-			if(balloonOne != balloonTwo && balloonOne->CollisionTest(*balloonTwo)) {
+	for(uint32_t balloonOne = 0; balloonOne != balloons.size(); ++balloonOne)
+		for(uint32_t balloonTwo = 0; balloonTwo != balloons.size(); ++balloonTwo)
+			if(balloonOne != balloonTwo &&
+			   balloons[balloonOne].CollisionTest<TBalloonKind, TBalloonKind>(balloons[balloonTwo], burstExpiry)) {
+				mBurstTimer.Schedule(mWorld.GetEntity(mArchetype, balloonOne));
+				mBurstTimer.Schedule(mWorld.GetEntity(mArchetype, balloonTwo));
 				mVars.mScore += mVars.mLevel * 2;
 				mVars.mBalloonsBurstSoFar++;
 			}
 }
 
+/** @function TBalloonManager::ResolveCollisions - Does what TestForCollisions does, but only tests the pairs of balls a
+ *												   TCollisionGrid has found touching. Its pairs are tested in the order
+ *												   TestForCollisions tests them, and every pair it leaves out would have
+ *												   been no collision, so the balls end up exactly as they would have. Bursts
+ *												   are counted up and added to the score once at the end, which comes to
+ *												   the same score as adding each one in turn, and balls burst are scheduled
+ *												   with the burst timer.
+ *		@param 		bulletArchetype		Archetype of mWorld holding the bullets which have been fired by the cannon,
+ *										which the grid was built from.
+ *		@param 		grid				Grid built from the balloons and bullets, each of whose chunks has been searched
+ */
+void TBalloonManager::ResolveCollisions(uint32_t bulletArchetype, const TCollisionGrid& grid)
+{
+	TRACE_SCOPE("TBalloonManager::ResolveCollisions");
+	uint16_t burstExpiry = mBurstTimer.GetExpiry();
+	vector<TBall>& balloons = mWorld.GetBalls(mArchetype);
+	vector<TBall>& bullets = mWorld.GetBalls(bulletArchetype);
+	uint32_t bulletBursts = 0;
+	uint32_t balloonBursts = 0;
+
+	// First the collisions between bullets and balloons
+	for(uint32_t chunk = 0; chunk != grid.GetNumChunks(); ++chunk) {
+		const vector<TCollisionPair>& pairs = grid.GetBulletPairs(chunk);
+		for(vector<TCollisionPair>::const_iterator pair = pairs.begin(); pair != pairs.end(); ++pair) {
+			uint32_t hit = bullets[pair->mOther].CollisionTest<TBulletKind, TBalloonKind>(balloons[pair->mBalloon], burstExpiry);
+			if(hit)
+				mBurstTimer.Schedule(mWorld.GetEntity(bulletArchetype, pair->mOther));
+			if(hit == 2) {
+				mBurstTimer.Schedule(mWorld.GetEntity(mArchetype, pair->mBalloon));
+				bulletBursts++;
+			}
+		}
+	}
+
+	// Then between balloons. TestForCollisions tests each pair both ways round, but the second test never does anything.
+	for(uint32_t chunk = 0; chunk != grid.GetNumChunks(); ++chunk) {
+		const vector<TCollisionPair>& pairs = grid.GetBalloonPairs(chunk);
+		for(vector<TCollisionPair>::const_iterator pair = pairs.begin(); pair != pairs.end(); ++pair)
+			if(balloons[pair->mBalloon].CollisionTest<TBalloonKind, TBalloonKind>(balloons[pair->mOther], burstExpiry)) {
+				mBurstTimer.Schedule(mWorld.GetEntity(mArchetype, pair->mBalloon));
+				mBurstTimer.Schedule(mWorld.GetEntity(mArchetype, pair->mOther));
+				balloonBursts++;
+			}
+	}
+
+	mVars.mScore = uint16_t(mVars.mScore + mVars.mLevel * (bulletBursts + balloonBursts * 2));
+	mVars.mBalloonsBurstSoFar = uint16_t(mVars.mBalloonsBurstSoFar + bulletBursts + balloonBursts);
+}
+
 /** @function TBalloonManager::AddBalloonCheck - This function checks whether enough time has passed since the last balloon
  *												 to add a new balloon. If it has, a new balloon is added at the top of the screen
  *												 with a random X value and colour. A new time to wait for the next balloon is then
@@ -150,22 +262,35 @@ void TBalloonManager::TestForCollisions(std::list<TBall>& bullets)
 void TBalloonManager::AddBalloonCheck()
 {
 	if(mVars.mTimeSinceLastBalloon >= mVars.mCurrentWaitForBalloon)	{
-		mVars.mTimeSinceLastBalloon = 0;
+		mVars.mTimeSinceLastBalloon = 0.f;
 		
 		// Determine position and color of new balloon
-		TReal xPosition = TReal(mBalloonRadius + TPlatform::GetInstance()->Rand() % (TBall::GetBounds().x2 - mBalloonRadius * 2));
-		uint16_t balloonColor = TPlatform::GetInstance()->Rand() % (mVars.mNumColoursInPlay-1);
+		TReal xPosition = TReal(mBalloonRadius + mRandom.Rand() % (mBounds.x2 - mBalloonRadius * 2));
+		uint16_t balloonColor = mRandom.Rand() % (mVars.mNumColoursInPlay-1);
 		
-		mBalloons.push_back(TBall(TVec2(xPosition, TReal(TBall::GetBounds().y1 - mBalloonRadius)), mVars.mBalloonVelocity, mBalloonScale, 
-							balloonColor, mBalloonTextures[balloonColor], mBalloonBurstTextures[balloonColor], false));
+		SpawnBalloon(xPosition, mVars.mBalloonVelocity, balloonColor);
 		
 		// Get random time to wait for next balloon within range
+		uint16_t waitRange = mVars.mMaxWaitForBalloon - mVars.mMinWaitForBalloon;
 		mVars.mCurrentWaitForBalloon = mVars.mMinWaitForBalloon + 
-									   TPlatform::GetInstance()->Rand() % (mVars.mMaxWaitForBalloon - mVars.mMinWaitForBalloon);
-		mVars.mBalloonsAddedSoFar++;
+									   (waitRange ? mRandom.Rand() % waitRange : 0);
 	}
 }
 
+/** @function TBalloonManager::SpawnBalloon - Adds a new balloon just above the top of the playing area. The balloon's id is
+ *											  the number of balloons added before it, so ids only repeat once it wraps around.
+ *		@param 		xPosition			Horizontal position of the new balloon
+ *		@param 		velocity			Velocity of the new balloon
+ *		@param 		colour				Colour of the new balloon, must be less than GetNumTextures()
+ */
+void TBalloonManager::SpawnBalloon(TReal xPosition, const TVec2& velocity, uint16_t colour)
+{
+	TEntity balloon = mWorld.Create(mArchetype, TBall(TVec2(xPosition, TReal(mBounds.y1 - mBalloonRadius)), velocity,
+													  mBalloonRadius, colour, false));
+	mWorld.GetBall(balloon).SetId(mVars.mBalloonsAddedSoFar);
+	mVars.mBalloonsAddedSoFar++;
+}
+
 /** @function TBalloonManager::IncreaseLevelCheck - This function checks whether enough balloons have been burst in order to level
  *													up, if they have, the game gets harder by adding balloons more frequently,
  *													that fall faster too.
@@ -173,24 +298,24 @@ void TBalloonManager::AddBalloonCheck()
 void TBalloonManager::IncreaseLevelCheck()
 {
 	if(mVars.mBalloonsBurstSoFar >= mVars.mBalloonsBurstToLevelUp * mVars.mLevel)	{
-		mVars.mMinWaitForBalloon -= mVars.mWaitTimeDecrease;
-		mVars.mMaxWaitForBalloon -= mVars.mWaitTimeDecrease;;
+		// The waits are unsigned, so stop them at gameVars::shortestWaitForBalloon rather than letting them wrap around
+		if(mVars.mMinWaitForBalloon >= gameVars::shortestWaitForBalloon + mVars.mWaitTimeDecrease)
+			mVars.mMinWaitForBalloon -= mVars.mWaitTimeDecrease;
+		else mVars.mMinWaitForBalloon = gameVars::shortestWaitForBalloon;
+		if(mVars.mMaxWaitForBalloon >= mVars.mMinWaitForBalloon + mVars.mWaitTimeDecrease)
+			mVars.mMaxWaitForBalloon -= mVars.mWaitTimeDecrease;
+		else mVars.mMaxWaitForBalloon = mVars.mMinWaitForBalloon;
 		mVars.mCurrentWaitForBalloon = (mVars.mMinWaitForBalloon + mVars.mMaxWaitForBalloon) / 2;
 		mVars.mBalloonVelocity.y += mVars.mBalloonVelocityIncrease;
 		mVars.mLevel++;
 	}
 }
 
-/** @function TBalloonManager::CleanUpContents - Loops through mBalloons and removes any which have mRemoveThisBall set to true,
- *												 which could be due to falling below the lower boundary or finishing bursting.
+/** @function TBalloonManager::CleanUpContents - Removes any balloons which have mRemoveThisBall set to true, which could be
+ *												 due to falling below the lower boundary or finishing bursting, with
+ *												 TEntityWorld::RemoveDead.
  */
 void TBalloonManager::CleanUpContents()
 {
-	list<TBall>::iterator balloon = mBalloons.begin();
-	while(balloon != mBalloons.end())
-	{
-		if(balloon->GetRemove()) 
-			balloon = mBalloons.erase(balloon);
-		 else ++balloon;
-	}
+	mWorld.RemoveDead(mArchetype);
 }
\ No newline at end of file
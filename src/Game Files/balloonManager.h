@@ -8,17 +8,21 @@
 #include <pf/vec.h>
 #include <pf/rect.h>
 #include <vector>
-#include <list>
 
 #include "gameVariables.h"
+#include "gameObject.h"
 #include "ball.h"
+#include "collisionGrid.h"
+#include "gameRandom.h"
+#include "burstTimer.h"
+#include "entityWorld.h"
 
 /** @struct TStateVariables - This struct contains variables for keeping track of game difficulty and player progress
  *
  *	@property 	uint16_t		mMinWaitForBalloon			Current shortest time to wait for new balloon 
  *  @property 	uint16_t		mMaxWaitForBalloon			Current longest time to wait for new balloon
  *	@property 	uint16_t		mCurrentWaitForBalloon		Actual time to wait for new balloon (random in range of min-max)
- *  @property 	uint32_t		mTimeSinceLastBalloon		Time since last balloon added to scren
+ *  @property 	TReal			mTimeSinceLastBalloon		Time in milliseconds since last balloon added to screen
  *	@property 	uint16_t		mBalloonsAddedSoFar			Number of balloons added since start
  *  @property 	uint16_t		mBalloonsBurstSoFar			Number of balloons added since start
  *	@property 	uint16_t		mBalloonsBurstToLevelUp		Number of balloons necessary to burst in order to level up
@@ -27,18 +31,20 @@
  *	@property 	uint16_t		mWaitTimeDecrease			Time in milliseconds that mMinWaitForBalloon & mMaxWaitForBalloon 
  *  														decrease by when new level is reached
  *	@property 	uint16_t		mNumColoursInPlay			Range of colours that bullets can be
+ *	@property 	uint16_t		mLevelsToPassForNewColour	Number of levels player needs to pass before introducing a new colour
  *  @property 	TVec2			mBalloonVelocity			Velocity of balloon
  *	@property 	TReal			mBalloonVelocityIncrease	Amount that mBalloonVelocity.y increases by when new level is reached
  */
 struct TStateVariables
 {
+	TStateVariables();
 	TStateVariables(uint16_t minWaitForBalloon, uint16_t maxWaitForBalloon, uint16_t balloonsBurstToLevelUp, 
 					uint16_t waitTimeDecrease, const TVec2& balloonVelocity, TReal balloonVelocityIncrease,
-					uint16_t numColoursInPlay);
+					uint16_t numColoursInPlay, uint16_t levelsToPassForNewColour);
 	uint16_t	mMinWaitForBalloon;
 	uint16_t	mMaxWaitForBalloon;
 	uint16_t	mCurrentWaitForBalloon;
-	uint32_t	mTimeSinceLastBalloon;
+	TReal		mTimeSinceLastBalloon;
 	uint16_t	mBalloonsAddedSoFar;
 	uint16_t	mBalloonsBurstSoFar;
 	uint16_t	mBalloonsBurstToLevelUp;
@@ -46,6 +52,7 @@ struct TStateVariables
 	uint16_t	mLevel;
 	uint16_t	mWaitTimeDecrease;
 	uint16_t	mNumColoursInPlay;
+	uint16_t	mLevelsToPassForNewColour;
 	TVec2		mBalloonVelocity;
 	TReal		mBalloonVelocityIncrease;
 };
@@ -57,26 +64,49 @@ struct TStateVariables
  *  							 This class inherits from IObject for the Draw/Update interface.
  *	@property 	TReal								mBalloonScale			The scale of the falling balloons 
  *  @property 	uint16_t							mBalloonRadius			The radius of the falling balloons
- *	@property 	std::list<TBall>					mBalloons				Falling balloons which must be burst
- *	@property 	std::vector<TTextureRef>			mBalloonTextures		Textures used to display balloons on screen
- *  @property 	std::vector<TAnimatedTextureRef>	mBalloonBurstTextures	Textures used for burst balloon animation
+ *	@property 	TEntityWorld&						mWorld					Holds the balloons, shared with the cannon
+ *	@property 	uint32_t							mArchetype				Archetype of mWorld holding the falling balloons which must
+ *																			be burst, with room kept for gameVars::balloonCapacity so
+ *																			that spawning doesn't allocate
+ *	@property 	const TBallAssets*					mBallAssets				Textures used to display balloons on screen, owned by the game
+ *	@property 	uint16_t							mNumColours				Number of colours there are textures for
  *	@property 	TStateVariables						mVars					Variables to keep track of game difficulty
+ *	@property 	TRect								mBounds					The boundary of the playing area
+ *	@property 	TRandom&							mRandom					Random number generator used to place and colour new balloons
+ *	@property 	TBurstTimer&						mBurstTimer				Decides when burst balloons are removed
 */
 class TBalloonManager : public IObject
 {
 public:
-	TBalloonManager(TReal balloonScale, const TStateVariables& stateVariables);
+	TBalloonManager(TReal balloonScale, const TStateVariables& stateVariables, TRandom& random, TBurstTimer& burstTimer,
+					TEntityWorld& world);
 	virtual ~TBalloonManager() {}
-	void AssignAssets(const std::vector<TTextureRef>& balloonTextures, const std::vector<TAnimatedTextureRef>& balloonBurstTextures);
-	void Reset(uint16_t minWaitForBalloon, uint16_t maxWaitForBalloon, const TVec2& balloonVelocity, 
-			   uint16_t balloonsBurstToLevelUp);
+	void AssignAssets(const TBallAssets& ballAssets);
+	void Reset(const TStateVariables& stateVariables);
 	virtual void				Draw()			const;
-	virtual void				Update(uint32_t elapsedTime);
-	void						TestForCollisions(std::list<TBall>& bullets);
-	const std::list<TBall>&		GetBalloons()	const	{ return mBalloons; }
+	void						Draw(TBallCuller& culler)	const;
+	virtual void				Update(double elapsedTime);
+	void						MoveBalloons(uint32_t first, uint32_t last, double elapsedTime);
+	void						UpdateContents(double elapsedTime);
+	void						TestForCollisions(uint32_t bulletArchetype);
+	void						ResolveCollisions(uint32_t bulletArchetype, const TCollisionGrid& grid);
+	void						SpawnBalloon(TReal xPosition, const TVec2& velocity, uint16_t colour);
+	const std::vector<TBall>&		GetBalloons()	const	{ return mWorld.GetBalls(mArchetype); }
 	uint16_t					GetScore()		const	{ return mVars.mScore; }
 	uint16_t					GetLevel()		const	{ return mVars.mLevel; }
+	uint16_t					GetBalloonRadius()	const	{ return mBalloonRadius; }
+	uint16_t					GetNumTextures()	const	{ return mNumColours; }
+	const TStateVariables&		GetStateVariables()	const	{ return mVars; }
+	const TRect&				GetBounds()		const	{ return mBounds; }
+	void						SetBounds(const TRect& bounds)	{ mBounds = bounds; }
 private: 
+	// TBenchmark times the private per-frame functions directly
+	friend class TBenchmark;
+	// TSimulationSnapshot and TStateStreamDecoder write the state of the game directly
+	friend class TSimulationSnapshot;
+	friend class TStateStreamDecoder;
+	// TCollisionChecker sets up the balls to check the collision code on directly
+	friend class TCollisionChecker;
 	// copying disallowed
 	TBalloonManager(const TBalloonManager &balloonManager);
 	TBalloonManager& operator=(const TBalloonManager &balloonManager);
@@ -86,10 +116,14 @@ private:
 
 	const TReal								mBalloonScale;
 	uint16_t								mBalloonRadius;
-	std::list<TBall>						mBalloons;
-	std::vector<TTextureRef>				mBalloonTextures;
-	std::vector<TAnimatedTextureRef>		mBalloonBurstTextures;
+	TEntityWorld&							mWorld;
+	const uint32_t							mArchetype;
+	const TBallAssets*						mBallAssets;
+	uint16_t								mNumColours;
 	TStateVariables							mVars;
+	TRect									mBounds;
+	TRandom&								mRandom;
+	TBurstTimer&							mBurstTimer;
 };
 
 
@@ -2,9 +2,9 @@
  *	barrier.cpp - Jan van der Kamp, 2011
  */
 #include "barrier.h"
+#include "trace.h"
 
 using std::vector;
-using std::list;
 
 /** @function TBarrier::TBarrier - Constructor			Takes parameters to construct TBarrier with
  *
@@ -24,7 +24,8 @@ mHeightAdjust(0.f),
 mParallaxAdjust(),
 mGameOverVisibleHeight(),
 newGame(true),
-mBarrierTextures()
+mBarrierTextures(),
+mBarrierHeights()
 {
 	mParallaxAdjust = (initialParallaxDifference / (position.y - levelHeight));
 }
@@ -37,6 +38,9 @@ mBarrierTextures()
 void TBarrier::AssignAssets(const std::vector<TTextureRef>& barrierTextures)
 {
 	mBarrierTextures = barrierTextures;
+	mBarrierHeights.clear();
+	for(vector<TTextureRef>::const_iterator texture = barrierTextures.begin(); texture != barrierTextures.end(); ++texture)
+		mBarrierHeights.push_back((*texture)->GetHeight());
 	
 	mParallaxAdjust /= mBarrierTextures.size();
 }
@@ -45,8 +49,9 @@ void TBarrier::AssignAssets(const std::vector<TTextureRef>& barrierTextures)
  *								 to an acceptable height.
  *		@param 		elapsedTime			Time in milliseconds since last frame
  */
-void TBarrier::Update(uint32_t elapsedTime)
+void TBarrier::Update(double elapsedTime)
 {
+	TRACE_SCOPE("TBarrier::Update");
 	if(newGame) 
 	{
 		mPosition.y += TReal(elapsedTime) * mRiseSpeed;
@@ -73,6 +78,7 @@ void TBarrier::DrawBackground() const
 	for(vector<TTextureRef>::size_type s = 0; s != mBarrierTextures.size() / 2; ++s) {
 		TReal heightAdjust = RelativeParallaxHeight(s);
 		mBarrierTextures[s]->DrawSprite(mPosition.x, mPosition.y + heightAdjust);
+		TRACE_DRAW_CALL();
 	}
 }
 
@@ -85,9 +91,48 @@ void TBarrier::DrawForeground() const
 		{
 			TReal heightAdjust = RelativeParallaxHeight(s);
 			mBarrierTextures[s]->DrawSprite(mPosition.x, mPosition.y + heightAdjust);
+			TRACE_DRAW_CALL();
 		}
 }
 
+/** @function TBarrier::GetOccluder - Finds the tallest part of the screen hidden by the near images' opaque bands,
+ *									   joining bands which touch or overlap
+ *
+ *		@return		The rect hidden, as wide as the narrowest near image, empty if there are no near images
+ */
+TRect TBarrier::GetOccluder() const
+{
+	const vector<TTextureRef>::size_type nearest = mBarrierTextures.size() / 2;
+	const uint32_t numBands = uint32_t(std::min(mBarrierTextures.size() - nearest, vector<TTextureRef>::size_type(3)));
+	int32_t tops[3], bottoms[3];
+	int32_t halfWidth = SCREEN_WIDTH / 2;
+	for(uint32_t b = 0; b != numBands; ++b) {
+		vector<TTextureRef>::size_type s = nearest + b;
+		halfWidth = std::min(halfWidth, int32_t(mBarrierTextures[s]->GetWidth() / 2));
+		int32_t imageTop = int32_t(mPosition.y + RelativeParallaxHeight(s)) - int32_t(mBarrierHeights[s] / 2);
+		tops[b] = imageTop + int32_t(gameVars::barrierOpaqueRows[b][0]);
+		bottoms[b] = imageTop + int32_t(gameVars::barrierOpaqueRows[b][1]) + 1;
+	}
+
+	TRect occluder(0, 0, 0, 0);
+	for(uint32_t b = 0; b != numBands; ++b) {
+		// Grow the band until no other band touches it
+		int32_t top = tops[b], bottom = bottoms[b];
+		for(bool grown = true; grown; ) {
+			grown = false;
+			for(uint32_t other = 0; other != numBands; ++other)
+				if(tops[other] <= bottom && bottoms[other] >= top && (tops[other] < top || bottoms[other] > bottom)) {
+					top = std::min(top, tops[other]);
+					bottom = std::max(bottom, bottoms[other]);
+					grown = true;
+				}
+		}
+		if(bottom - top > occluder.y2 - occluder.y1)
+			occluder = TRect(int32_t(mPosition.x) - halfWidth, top, int32_t(mPosition.x) + halfWidth, bottom);
+	}
+	return occluder;
+}
+
 /** @function TBarrier::TestForSinkingBalloons - This function tests for any balloons which have sunk below the lower boundary.
  *												 It loops through all balloons and adds together the amount that each one may 
  *												 have sunk below the lower boundary before decreasing mPosition.y by this amount.
@@ -99,7 +144,7 @@ void TBarrier::DrawForeground() const
  *
  *		@return		true if barrier has risen too far, which means game over
  */
-bool TBarrier::TestForSinkingBalloons(const std::list<TBall>& balloons)
+bool TBarrier::TestForSinkingBalloons(const std::vector<TBall>& balloons)
 {
 	// early 'out' if no balloons to test for or new game begun
 	if(balloons.size() == 0 || newGame)
@@ -110,7 +155,7 @@ bool TBarrier::TestForSinkingBalloons(const std::list<TBall>& balloons)
 
 	// Loop through all balloons on screen and if any are below mPosition, 
 	// add the difference to tempHeightAdjust
-	for(list<TBall>::const_iterator balloon = balloons.begin(); 
+	for(vector<TBall>::const_iterator balloon = balloons.begin(); 
 		balloon != balloons.end(); ++balloon) 
 		{
 			if(balloon->GetPosition().y > mPosition.y)
@@ -132,7 +177,7 @@ bool TBarrier::TestForSinkingBalloons(const std::list<TBall>& balloons)
 	// visibleHeight will give the top-most point of the first of the foreground textures
 	TReal visibleHeight = mPosition.y + 
 						  barrierOffset - 
-						  TReal(mBarrierTextures[s]->GetHeight()) / 2;
+						  TReal(mBarrierHeights[s]) / 2;
 	if(visibleHeight < mGameOverVisibleHeight)
 		return true;
 	
@@ -152,7 +197,7 @@ TReal TBarrier::RelativeParallaxHeight(vector<TTextureRef>::size_type s) const
 	TReal heightAdjust = s * mParallaxAdjust * (mPosition.y - mLevelHeight);
 
 	// Make allowance for the difference in height between this and the first element of mBarrierTextures
-	TReal temp = (mBarrierTextures[s]->GetHeight() - mBarrierTextures[0]->GetHeight()) / 2;
+	TReal temp = (mBarrierHeights[s] - mBarrierHeights[0]) / 2;
 	heightAdjust += temp;
 	return heightAdjust;
 }
\ No newline at end of file
@@ -7,9 +7,9 @@
 #include <pf/pflib.h>
 #include <pf/vec.h>
 #include <vector>
-#include <list> 
 
 #include "gameVariables.h"
+#include "gameObject.h"
 #include "ball.h"
 
 /** @class TBarrier - This class represents a pile of balloons which are at the bottom of the screen and rise when the player lets
@@ -20,6 +20,8 @@
  *					  into the middle of the pile. If the barrier gets high enough to cover the image of the cannon base, it's 
  *					  game over. This height is determined by the top of the first of the near images, ie the 4th element of
  *					  mBarrierTextures. This image should have a region in the middle at the top that has full opacity.
+ *					  Each near image is opaque across its width in a band of rows given by gameVars::barrierOpaqueRows,
+ *					  and GetOccluder() finds where these bands hide whatever is drawn behind them.
  *					  This class inherits from IObject for the Draw/Update interface.
  * 
  *	@property 	TVec2		mOriginalPosition			The overall position of the barrier when the game started
@@ -35,6 +37,8 @@
  *														the cannon.
  *	@property 	TReal		newGame						Whether a new game has just begun.
  *	@property 	TReal		mBarrierTextures			Textures to represent piles of balloons at the bottom of the screen 
+ *	@property 	uint32_t	mBarrierHeights				Heights of each of mBarrierTextures, kept so that testing for sinking
+ *														balloons doesn't touch the textures
  */
 class TBarrier : public IObject
 {
@@ -42,16 +46,20 @@ public:
 	TBarrier(const TVec2& position, TReal riseSpeed, TReal initialParallaxDifference, TReal levelHeight);
 	virtual ~TBarrier() {}
 	void AssignAssets(const std::vector<TTextureRef>& barrierTextures);
-	void Reset() { mHeightAdjust = 0.f; newGame = true; }
-	virtual void Update(uint32_t elapsedTime);
+	void Reset() { mHeightAdjust = 0.f; newGame = true; mPosition.y = mGameOverVisibleHeight; }
+	virtual void Update(double elapsedTime);
 	virtual void Draw()	const;
 	void SetGameOverHeight(TReal gameOverHeight)	{ mGameOverVisibleHeight = gameOverHeight; 
 													  mPosition.y = mGameOverVisibleHeight; }
 	void DrawBackground()	const;
 	void DrawForeground()	const;
-	bool TestForSinkingBalloons(const std::list<TBall>& balloons);
+	bool TestForSinkingBalloons(const std::vector<TBall>& balloons);
+	TRect GetOccluder()		const;
 	TVec2 GetPosition()		const		{ return mPosition; }
 private:
+	// TSimulationSnapshot and TStateStreamDecoder write the state of the game directly
+	friend class TSimulationSnapshot;
+	friend class TStateStreamDecoder;
 	// copying disallowed
 	TBarrier(const TBarrier &barrier);
 	TBarrier& operator=(const TBarrier &barrier);
@@ -67,6 +75,7 @@ private:
 	TReal						mGameOverVisibleHeight;
 	bool						newGame;
 	std::vector<TTextureRef>	mBarrierTextures;
+	std::vector<uint32_t>		mBarrierHeights;
 };
 
 #endif //BARRIER_H_INCLUDED
\ No newline at end of file
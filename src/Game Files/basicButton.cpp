@@ -1,4 +1,5 @@
 #include "basicButton.h"
+#include "trace.h"
 
 /** @function TBasicButton::TBasicButton - Constructor			Takes parameters to construct button with
  *		@param 		text				Initial text for mTextGraphic
@@ -9,8 +10,8 @@
  * 		@param 		lineHeight			Size of the text
  * 		@param 		textColour			Colour of the text
  */
-TBasicButton::TBasicButton(str text, uint32_t w, uint32_t h, uint32_t flags, 
-						   str fontFilename, uint32_t lineHeight, const TColor& textColour) :
+TBasicButton::TBasicButton(const str& text, uint32_t w, uint32_t h, uint32_t flags, 
+						   const str& fontFilename, uint32_t lineHeight, const TColor& textColour) :
 						   mTextGraphic(text, w, h, flags, fontFilename, lineHeight, textColour),
 						   mCornerBias(-TReal(w/2), -TReal(h/2)),
 						   mHeight(h)
@@ -18,16 +19,26 @@ TBasicButton::TBasicButton(str text, uint32_t w, uint32_t h, uint32_t flags,
 
 /** @function TBasicButton::Draw - Takes a position and new text and draws the button with these
  *		@param 		position			Position of the button
- *		@param 		text				New text for the button, defaults to "", so no change
+ *		@param 		text				New text for the button, only set if it is different to the current text
  */
-void TBasicButton::Draw(const TVec2& position, str text)
+void TBasicButton::Draw(const TVec2& position, const str& text)
 {
-	if(text != str(""))
+	if(text != mTextGraphic.GetText())
 		mTextGraphic.SetText(text);
 
+	Draw(position);
+}
+
+/** @function TBasicButton::Draw - Draws the button with its current text
+ *		@param 		position			Position of the button
+ */
+void TBasicButton::Draw(const TVec2& position)
+{
 	TDrawSpec drawSpec(position);
 	mImage->Draw(drawSpec);
+	TRACE_DRAW_CALL();
 	mTextGraphic.Draw(position + mCornerBias, mHeight);
+	TRACE_DRAW_CALL();
 }
 
 /** @function TBasicButton::HitTest - Takes a position and new text and draws the button with these
@@ -9,7 +9,8 @@
 
 /** @class TBasicButton - This class encapsulates functionality for a simple button, which is made up of a TSprite and
  *						  a TTextGraphic. This makes it easy to draw both a background image and a title by giving 
- *						  just one position.
+ *						  just one position. Setting the text lays it out again, so a button that shows several titles
+ *						  in turn is better off as several buttons, each keeping its own title.
  *		@property 		TTextGraphic			mTextGraphic			TTextGraphic used to draw the title of the button
  *		@property 		TSpriteRef				mImage					Background image for the button
  *		@property 		TVec2					mCornerBias				Position bias so that mTextGraphic can also be drawn by giving
@@ -19,11 +20,12 @@
 class TBasicButton
 {
 public:
-	TBasicButton(str text, uint32_t w, uint32_t h, uint32_t flags=0, str fontFilename=str(""), uint32_t lineHeight=10, const TColor& textColour=TColor(0, 0, 0, 1));
-	void Draw(const TVec2& position, str text=str(""));
+	TBasicButton(const str& text, uint32_t w, uint32_t h, uint32_t flags=0, const str& fontFilename=str(""), uint32_t lineHeight=10, const TColor& textColour=TColor(0, 0, 0, 1));
+	void Draw(const TVec2& position);
+	void Draw(const TVec2& position, const str& text);
 	bool HitTest(const TPoint& at, const TVec2& parentContext4);
 	str GetText() const { return mTextGraphic.GetText(); }
-	void SetText(str text) { return mTextGraphic.SetText(text); }
+	void SetText(const str& text) { return mTextGraphic.SetText(text); }
 	void SetImage(TSpriteRef image) { mImage=image; }
 private:
 	TTextGraphic mTextGraphic;
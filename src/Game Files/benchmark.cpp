@@ -0,0 +1,454 @@
+/**
+ *	benchmark.cpp - Jan van der Kamp, 2011
+ */
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#include "balloonManager.h"
+#include "barrier.h"
+#include "cannon.h"
+#include "snapshot.h"
+#include "timer.h"
+
+using std::vector;
+
+namespace {
+	const uint32_t	balloonCounts[] = { 10, 30, 100, 300, 1000, 3000, 10000 };
+	const uint32_t	numBalloonCounts = sizeof(balloonCounts) / sizeof(balloonCounts[0]);
+	const uint32_t	bulletCounts[] = { 1, 10, 100 };
+	const uint32_t	numBulletCounts = sizeof(bulletCounts) / sizeof(bulletCounts[0]);
+	const uint32_t	removePercents[] = { 0, 10, 50, 90, 100 };
+	const uint32_t	numRemovePercents = sizeof(removePercents) / sizeof(removePercents[0]);
+	const uint32_t	balloonsPerSpawnBatch = 1000;
+	const uint32_t	mousePositions = 1000;
+	// Time in milliseconds balls are moved on by in each frame of a benchmark
+	const uint32_t	frameTime = 16;
+	// Each benchmark is repeated until it has been timed for at least this long
+	const double	minMilliseconds = 100.0;
+	// Cheap benchmarks which don't change the balls are run in batches of about this many balls, so that the time
+	// taken to read the timer doesn't swamp the time being measured
+	const uint32_t	ballsPerBatch = 100000;
+
+}
+
+/** @function TBenchmark::TBenchmark - Constructor			Takes the game's assets so that balls can be made as they are in the game
+ *		@param 		ballAssets					Textures used for balloons and bullets
+ *		@param 		barrierTextures				Textures used for the barrier
+ *		@param 		cannonTexture				Texture used for the cannon
+ */
+TBenchmark::TBenchmark(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+					   const TTextureRef& cannonTexture) :
+mBallAssets(ballAssets),
+mBarrierTextures(barrierTextures),
+mCannonTexture(cannonTexture),
+mRandom(SEED),
+mBurstTimer(),
+mResults()
+{
+	mBurstTimer.SetDuration(mBallAssets.mBurstDuration);
+}
+
+/** @function TBenchmark::Run - Runs every benchmark over every ball count. The playing area is the full screen.
+ */
+void TBenchmark::Run()
+{
+	mResults.clear();
+
+	for(uint32_t n = 0; n != numBalloonCounts; ++n)
+		for(uint32_t b = 0; b != numBulletCounts; ++b) {
+			BenchCollisionTest(balloonCounts[n], bulletCounts[b]);
+			BenchTestForCollisions(balloonCounts[n], bulletCounts[b]);
+			BenchCollisionGrid(balloonCounts[n], bulletCounts[b]);
+		}
+
+	for(uint32_t n = 0; n != numBalloonCounts; ++n)
+		BenchTestForSinkingBalloons(balloonCounts[n]);
+
+	for(uint32_t r = 0; r != numRemovePercents; ++r)
+		for(uint32_t n = 0; n != numBalloonCounts; ++n)
+			BenchCleanUpContents(balloonCounts[n], removePercents[r]);
+
+	for(uint32_t n = 0; n != numBalloonCounts; ++n)
+		BenchUpdateBalls(balloonCounts[n]);
+
+	BenchAddBalloonCheck(balloonsPerSpawnBatch);
+	BenchUpdateMousePosition(mousePositions);
+
+	for(uint32_t n = 0; n != numBalloonCounts; ++n)
+		BenchSnapshot(balloonCounts[n]);
+}
+
+/** @function TBenchmark::BenchCollisionTest - Times TBall::CollisionTest between every bullet and every balloon
+ *		@param 		numBalloons			Number of balloons in play
+ *		@param 		numBullets			Number of bullets in play
+ */
+void TBenchmark::BenchCollisionTest(uint32_t numBalloons, uint32_t numBullets)
+{
+	mRandom.Seed(SEED);
+	vector<TBall> balloons, bullets;
+	MakeBalls(balloons, numBalloons, false, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+	MakeBalls(bullets, numBullets, true, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		// Collisions change the balls, so every run starts from a fresh copy. Copying isn't timed.
+		vector<TBall> balloonsCopy(balloons);
+		vector<TBall> bulletsCopy(bullets);
+
+		uint64_t start = THighResTimer::GetTicks();
+		for(vector<TBall>::iterator bullet = bulletsCopy.begin(); bullet != bulletsCopy.end(); ++bullet)
+			for(vector<TBall>::iterator balloon = balloonsCopy.begin(); balloon != balloonsCopy.end(); ++balloon)
+				bullet->CollisionTest<TBulletKind, TBalloonKind>(*balloon, mBurstTimer.GetExpiry());
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TBall::CollisionTest", numBalloons, numBullets, 0, iterations, ticks, double(numBalloons) * numBullets);
+}
+
+/** @function TBenchmark::BenchTestForCollisions - Times TBalloonManager::TestForCollisions
+ *		@param 		numBalloons			Number of balloons in play
+ *		@param 		numBullets			Number of bullets in play
+ */
+void TBenchmark::BenchTestForCollisions(uint32_t numBalloons, uint32_t numBullets)
+{
+	mRandom.Seed(SEED);
+	vector<TBall> balloons, bullets;
+	MakeBalls(balloons, numBalloons, false, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+	MakeBalls(bullets, numBullets, true, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+
+	TEntityWorld world;
+	TBalloonManager manager(gameVars::balloonScale, TStateVariables(), mRandom, mBurstTimer, world);
+	manager.AssignAssets(mBallAssets);
+	manager.SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+	uint32_t bulletArchetype = world.AddArchetype(0, numBullets);
+
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		// The balls burst last run are forgotten, so the burst timer's heap doesn't grow from run to run
+		world.Assign(bulletArchetype, bullets);
+		world.Assign(manager.mArchetype, balloons);
+		mBurstTimer.Reset(mBurstTimer.GetClock());
+
+		uint64_t start = THighResTimer::GetTicks();
+		manager.TestForCollisions(bulletArchetype);
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TBalloonManager::TestForCollisions", numBalloons, numBullets, 0, iterations, ticks, 1);
+}
+
+/** @function TBenchmark::BenchCollisionGrid - Times building a TCollisionGrid, searching each of its chunks in turn and
+ *											 resolving the pairs found with TBalloonManager::ResolveCollisions, which is
+ *											 what a frame run as a TJobGraph does, on one thread
+ *		@param 		numBalloons			Number of balloons in play
+ *		@param 		numBullets			Number of bullets in play
+ */
+void TBenchmark::BenchCollisionGrid(uint32_t numBalloons, uint32_t numBullets)
+{
+	mRandom.Seed(SEED);
+	vector<TBall> balloons, bullets;
+	MakeBalls(balloons, numBalloons, false, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+	MakeBalls(bullets, numBullets, true, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+
+	TEntityWorld world;
+	TBalloonManager manager(gameVars::balloonScale, TStateVariables(), mRandom, mBurstTimer, world);
+	manager.AssignAssets(mBallAssets);
+	manager.SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+	uint32_t bulletArchetype = world.AddArchetype(0, numBullets);
+	TCollisionGrid grid;
+
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		// The balls burst last run are forgotten, so the burst timer's heap doesn't grow from run to run
+		world.Assign(bulletArchetype, bullets);
+		world.Assign(manager.mArchetype, balloons);
+		mBurstTimer.Reset(mBurstTimer.GetClock());
+
+		uint64_t start = THighResTimer::GetTicks();
+		grid.Build(manager.GetBalloons(), world.GetBalls(bulletArchetype), manager.GetBounds(), gameVars::collisionJobs);
+		for(uint32_t chunk = 0; chunk != grid.GetNumChunks(); ++chunk)
+			grid.FindPairs(chunk);
+		manager.ResolveCollisions(bulletArchetype, grid);
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TCollisionGrid", numBalloons, numBullets, 0, iterations, ticks, 1);
+}
+
+/** @function TBenchmark::BenchTestForSinkingBalloons - Times TBarrier::TestForSinkingBalloons with balloons spread around the
+ *													   top of the barrier
+ *		@param 		numBalloons			Number of balloons in play
+ */
+void TBenchmark::BenchTestForSinkingBalloons(uint32_t numBalloons)
+{
+	mRandom.Seed(SEED);
+	vector<TBall> balloons;
+	MakeBalls(balloons, numBalloons, false, gameVars::initialBarrierPosition.y - 150.f, gameVars::initialBarrierPosition.y + 50.f);
+
+	TBarrier barrier(gameVars::initialBarrierPosition, gameVars::barrierRiseSpeed,
+					 gameVars::initialBarrierParallaxDifference, gameVars::barrierLevelHeight);
+	barrier.AssignAssets(mBarrierTextures);
+	barrier.SetGameOverHeight(gameVars::cannonPosition.y);
+	// Let the barrier settle at its starting height
+	barrier.Update(uint32_t(SCREEN_HEIGHT / gameVars::barrierRiseSpeed));
+
+	uint32_t callsPerBatch = ballsPerBatch / numBalloons + 1;
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		uint64_t start = THighResTimer::GetTicks();
+		for(uint32_t call = 0; call != callsPerBatch; ++call)
+			barrier.TestForSinkingBalloons(balloons);
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TBarrier::TestForSinkingBalloons", numBalloons, 0, 0, iterations, ticks, callsPerBatch);
+}
+
+/** @function TBenchmark::BenchCleanUpContents - Times TBalloonManager::CleanUpContents with a given share of the balloons
+ *												marked for removal
+ *		@param 		numBalloons			Number of balloons in play
+ *		@param 		removePercent		Percentage of balloons to mark for removal
+ */
+void TBenchmark::BenchCleanUpContents(uint32_t numBalloons, uint32_t removePercent)
+{
+	mRandom.Seed(SEED);
+	vector<TBall> balloons;
+	MakeBalls(balloons, numBalloons, false, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+	for(vector<TBall>::iterator balloon = balloons.begin(); balloon != balloons.end(); ++balloon)
+		if(mRandom.Rand() % 100 < removePercent)
+			balloon->SetRemoveTrue();
+
+	TEntityWorld world;
+	TBalloonManager manager(gameVars::balloonScale, TStateVariables(), mRandom, mBurstTimer, world);
+	manager.AssignAssets(mBallAssets);
+	manager.SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		world.Assign(manager.mArchetype, balloons);
+
+		uint64_t start = THighResTimer::GetTicks();
+		manager.CleanUpContents();
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TBalloonManager::CleanUpContents", numBalloons, 0, removePercent, iterations, ticks, 1);
+}
+
+/** @function TBenchmark::BenchUpdateBalls - Times moving balloons with TBalloonManager::MoveBalloons and removing those
+ *											that leave the playing area with TBalloonManager::CleanUpContents
+ *		@param 		numBalloons			Number of balloons in play
+ */
+void TBenchmark::BenchUpdateBalls(uint32_t numBalloons)
+{
+	mRandom.Seed(SEED);
+	vector<TBall> balloons;
+	MakeBalls(balloons, numBalloons, false, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+	TURect bounds(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	TEntityWorld world;
+	TBalloonManager manager(gameVars::balloonScale, TStateVariables(), mRandom, mBurstTimer, world);
+	manager.AssignAssets(mBallAssets);
+	manager.SetBounds(bounds);
+
+	// Each iteration moves the balloons a frame, so they are put back every so often to keep them on screen. This isn't timed.
+	const uint32_t framesPerReset = 60;
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		if(iterations % framesPerReset == 0)
+			world.Assign(manager.mArchetype, balloons);
+
+		uint64_t start = THighResTimer::GetTicks();
+		manager.MoveBalloons(0, uint32_t(manager.GetBalloons().size()), frameTime);
+		manager.CleanUpContents();
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+	AddResult("TBall::Update+CleanUpContents", numBalloons, 0, 0, iterations, ticks, numBalloons);
+}
+
+/** @function TBenchmark::BenchAddBalloonCheck - Times adding balloons with TBalloonManager::AddBalloonCheck
+ *		@param 		numBalloons			Number of balloons added in each batch
+ */
+void TBenchmark::BenchAddBalloonCheck(uint32_t numBalloons)
+{
+	mRandom.Seed(SEED);
+	TEntityWorld world;
+	TBalloonManager manager(gameVars::balloonScale, TStateVariables(), mRandom, mBurstTimer, world);
+	manager.AssignAssets(mBallAssets);
+	manager.SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		world.Clear(manager.mArchetype);
+
+		uint64_t start = THighResTimer::GetTicks();
+		for(uint32_t balloon = 0; balloon != numBalloons; ++balloon) {
+			manager.mVars.mTimeSinceLastBalloon = manager.mVars.mCurrentWaitForBalloon;
+			manager.AddBalloonCheck();
+		}
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TBalloonManager::AddBalloonCheck", numBalloons, 0, 0, iterations, ticks, numBalloons);
+}
+
+/** @function TBenchmark::BenchUpdateMousePosition - Times aiming the cannon with TCannon::UpdateMousePosition
+ *		@param 		numPositions		Number of mouse positions aimed at in each batch
+ */
+void TBenchmark::BenchUpdateMousePosition(uint32_t numPositions)
+{
+	mRandom.Seed(SEED);
+	vector<TPoint> positions;
+	positions.reserve(numPositions);
+	for(uint32_t p = 0; p != numPositions; ++p)
+		positions.push_back(TPoint(mRandom.Rand() % SCREEN_WIDTH, mRandom.Rand() % SCREEN_HEIGHT));
+
+	TEntityWorld world;
+	TCannon cannon(gameVars::cannonPosition, gameVars::bulletScale, gameVars::initialNumColoursInPlay, mRandom,
+				   mBurstTimer, world);
+	cannon.AssignAssets(mCannonTexture, mBallAssets);
+
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		uint64_t start = THighResTimer::GetTicks();
+		for(vector<TPoint>::const_iterator p = positions.begin(); p != positions.end(); ++p)
+			cannon.UpdateMousePosition(*p);
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TCannon::UpdateMousePosition", 0, 0, 0, iterations, ticks, numPositions);
+}
+
+/** @function TBenchmark::BenchSnapshot - Times taking a TSimulationSnapshot of a game and restoring it
+ *		@param 		numBalloons			Number of balloons in play
+ */
+void TBenchmark::BenchSnapshot(uint32_t numBalloons)
+{
+	mRandom.Seed(SEED);
+	TStateVariables vars;
+	TSimulation simulation(vars);
+	simulation.AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+	TBalloonManager& manager = simulation.GetBalloonManager();
+	vector<TBall> balloons;
+	MakeBalls(balloons, numBalloons, false, TReal(gameVars::hudBoundary), TReal(SCREEN_HEIGHT));
+	manager.mWorld.Assign(manager.mArchetype, balloons);
+
+	TSimulationSnapshot snapshot;
+	uint32_t iterations = 0;
+	uint64_t ticks = 0;
+	do {
+		uint64_t start = THighResTimer::GetTicks();
+		snapshot.Take(simulation);
+		snapshot.Restore(simulation);
+		ticks += THighResTimer::GetTicks() - start;
+		iterations++;
+	} while(THighResTimer::TicksToMilliseconds(ticks) < minMilliseconds);
+
+	AddResult("TSimulationSnapshot::Take+Restore", numBalloons, 0, 0, iterations, ticks, 1);
+}
+
+/** @function TBenchmark::MakeBalls - Adds balls at random positions with random colours to a vector. Balloons fall at the
+ *									 starting speed and bullets fly in random directions.
+ *		@param 		balls				List to add balls to
+ *		@param 		count				Number of balls to add
+ *		@param 		isBullets			Whether to make bullets or balloons
+ *		@param 		minY				Highest position on screen to place balls at
+ *		@param 		maxY				Lowest position on screen to place balls at
+ */
+void TBenchmark::MakeBalls(std::vector<TBall>& balls, uint32_t count, bool isBullets, TReal minY, TReal maxY)
+{
+	TReal scale = isBullets ? gameVars::bulletScale : gameVars::balloonScale;
+	for(uint32_t b = 0; b != count; ++b) {
+		TVec2 position(TReal(mRandom.Rand() % SCREEN_WIDTH),
+					   minY + (maxY - minY) * TReal(mRandom.Rand() % 1000) / 1000.f);
+		TVec2 velocity = gameVars::initialBalloonVelocity;
+		if(isBullets) {
+			velocity = TVec2(TReal(int32_t(mRandom.Rand() % 2001) - 1000), -TReal(mRandom.Rand() % 1000 + 1));
+			velocity.Normalize();
+		}
+		uint16_t colour = uint16_t(mRandom.Rand() % mBallAssets.GetNumColours());
+		balls.push_back(TBall(position, velocity, uint16_t(mBallAssets.mTextures[colour]->GetWidth() * scale / 2), colour, isBullets));
+	}
+}
+
+/** @function TBenchmark::AddResult - Stores the timing of one benchmark
+ *		@param 		name				Name of the benchmark
+ *		@param 		balloons			Number of balloons in play
+ *		@param 		bullets				Number of bullets in play
+ *		@param 		removePercent		Percentage of balls marked for removal
+ *		@param 		iterations			Number of times the benchmark was run
+ *		@param 		ticks				Total time taken by all iterations, in THighResTimer ticks
+ *		@param 		opsPerIteration		Number of operations timed in each iteration
+ */
+void TBenchmark::AddResult(const char* name, uint32_t balloons, uint32_t bullets, uint32_t removePercent,
+						   uint32_t iterations, uint64_t ticks, double opsPerIteration)
+{
+	TResult result;
+	result.mName = name;
+	result.mBalloons = balloons;
+	result.mBullets = bullets;
+	result.mRemovePercent = removePercent;
+	result.mIterations = iterations;
+	result.mNsPerOp = THighResTimer::TicksToNanoseconds(ticks) / (double(iterations) * opsPerIteration);
+	result.mOpsPerIteration = opsPerIteration;
+	mResults.push_back(result);
+}
+
+/** @function TBenchmark::WriteResults - Writes the results of Run() to a JSON file. Alongside each timing is the scaling
+ *										exponent from the previous ball count in the same series, so 1 means the time
+ *										grows linearly with the number of balloons and 2 means it grows quadratically.
+ *		@param 		filename			File to write to
+ *
+ *		@return		true if the file could be written
+ */
+bool TBenchmark::WriteResults(const char* filename) const
+{
+	FILE* file = fopen(filename, "w");
+	if(!file)
+		return false;
+
+	fprintf(file, "{\n\t\"build\": \"%s %s\",\n\t\"seed\": %d,\n\t\"results\": [\n", __DATE__, __TIME__, int(SEED));
+	for(vector<TResult>::size_type r = 0; r != mResults.size(); ++r)
+	{
+		const TResult& result = mResults[r];
+
+		// Find the previous result in the same series to work out how the time scales
+		double scaling = 0.0;
+		for(vector<TResult>::size_type p = r; p-- > 0;) {
+			const TResult& previous = mResults[p];
+			if(strcmp(previous.mName, result.mName) == 0 && previous.mBullets == result.mBullets &&
+			   previous.mRemovePercent == result.mRemovePercent) {
+				if(previous.mBalloons < result.mBalloons && previous.mNsPerOp > 0.0)
+					scaling = log(result.mNsPerOp / previous.mNsPerOp) / log(double(result.mBalloons) / previous.mBalloons);
+				break;
+			}
+		}
+
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"balloons\": %u, \"bullets\": %u, \"removePercent\": %u, "
+					  "\"iterations\": %u, \"opsPerIteration\": %.0f, \"nsPerOp\": %.2f, \"scaling\": %.3f }%s\n",
+				result.mName, result.mBalloons, result.mBullets, result.mRemovePercent, result.mIterations,
+				result.mOpsPerIteration, result.mNsPerOp, scaling, r + 1 == mResults.size() ? "" : ",");
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,87 @@
+/**
+ *	benchmark.h - Jan van der Kamp, 2011
+ */
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "gameVariables.h"
+#include "gameRandom.h"
+#include "ball.h"
+#include "burstTimer.h"
+
+/** @class TBenchmark - Times the parts of the game that run every frame: ball against ball collision tests,
+ *						TBalloonManager::TestForCollisions against the same collisions found with a TCollisionGrid,
+ *						TBarrier::TestForSinkingBalloons, removing balls in TBalloonManager::CleanUpContents, moving
+ *						balloons with TBall::Update, adding balloons in TBalloonManager::AddBalloonCheck, aiming with
+ *						TCannon::UpdateMousePosition, and taking and restoring a TSimulationSnapshot. Each one is run
+ *						over a range of ball counts so that it can be seen how it scales. Balls are placed using a fixed
+ *						seed so every run times exactly the same work. Results are written to a JSON file so that runs
+ *						from different builds can be compared. Set the "benchmark" config setting to the file to write
+ *						to in order to run the benchmarks at startup.
+ *
+ *	@property 	TBallAssets							mBallAssets				Textures used for balloons and bullets, shared by every game
+ *	@property 	std::vector<TTextureRef>			mBarrierTextures		Textures used for the barrier
+ *	@property 	TTextureRef							mCannonTexture			Texture used for the cannon
+ *	@property 	TRandom								mRandom					Random number generator used to place balls
+ *	@property 	TBurstTimer							mBurstTimer				Burst timer the benchmarked managers share
+ *	@property 	std::vector<TResult>				mResults				Timings of every benchmark run so far
+ */
+class TBenchmark
+{
+public:
+	TBenchmark(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+			   const TTextureRef& cannonTexture);
+	void		Run();
+	bool		WriteResults(const char* filename) const;
+
+	// seed used to place balls in every benchmark
+	enum { SEED = 2011 };
+private:
+	/** @struct TResult - Timing of one benchmark with one set of parameters
+	 *	@property 	const char*		mName			Name of the benchmark
+	 *	@property 	uint32_t		mBalloons		Number of balloons in play
+	 *	@property 	uint32_t		mBullets		Number of bullets in play
+	 *	@property 	uint32_t		mRemovePercent	Percentage of balls marked for removal
+	 *	@property 	uint32_t		mIterations		Number of times the benchmark was run
+	 *	@property 	double			mNsPerOp		Average time in nanoseconds of one operation
+	 *	@property 	double			mOpsPerIteration	Number of operations timed in each iteration
+	 */
+	struct TResult
+	{
+		const char*	mName;
+		uint32_t	mBalloons;
+		uint32_t	mBullets;
+		uint32_t	mRemovePercent;
+		uint32_t	mIterations;
+		double		mNsPerOp;
+		double		mOpsPerIteration;
+	};
+
+	// copying disallowed
+	TBenchmark(const TBenchmark &benchmark);
+	TBenchmark& operator=(const TBenchmark &benchmark);
+	void		BenchCollisionTest(uint32_t numBalloons, uint32_t numBullets);
+	void		BenchTestForCollisions(uint32_t numBalloons, uint32_t numBullets);
+	void		BenchCollisionGrid(uint32_t numBalloons, uint32_t numBullets);
+	void		BenchTestForSinkingBalloons(uint32_t numBalloons);
+	void		BenchCleanUpContents(uint32_t numBalloons, uint32_t removePercent);
+	void		BenchUpdateBalls(uint32_t numBalloons);
+	void		BenchAddBalloonCheck(uint32_t numBalloons);
+	void		BenchUpdateMousePosition(uint32_t numPositions);
+	void		BenchSnapshot(uint32_t numBalloons);
+	void		MakeBalls(std::vector<TBall>& balls, uint32_t count, bool isBullets, TReal minY, TReal maxY);
+	void		AddResult(const char* name, uint32_t balloons, uint32_t bullets, uint32_t removePercent,
+						  uint32_t iterations, uint64_t ticks, double opsPerIteration);
+
+	TBallAssets							mBallAssets;
+	std::vector<TTextureRef>			mBarrierTextures;
+	TTextureRef							mCannonTexture;
+	TRandom								mRandom;
+	TBurstTimer							mBurstTimer;
+	std::vector<TResult>				mResults;
+};
+
+#endif // BENCHMARK_H_INCLUDED
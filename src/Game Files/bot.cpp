@@ -0,0 +1,124 @@
+/**
+ *	bot.cpp - Jan van der Kamp, 2011
+ */
+#include "bot.h"
+
+using std::vector;
+
+namespace {
+	// Bullets are fired with a unit direction as their velocity, so travel one pixel per millisecond
+	const TReal		bulletSpeed = 1.f;
+}
+
+/** @function TBot::TBot - Constructor			Takes parameters to construct bot with
+ *		@param 		shotInterval			Time in milliseconds between reloading and firing
+ *		@param 		aimError				Largest distance in pixels that the bot misses its aim point by
+ */
+TBot::TBot(uint32_t shotInterval, TReal aimError) :
+mRandom(),
+mShotInterval(shotInterval),
+mAimError(aimError),
+mTimeSinceAction(),
+mSolver(),
+mColours()
+{}
+
+/** @function TBot::Reset - Gets the bot ready for a new game
+ *		@param 		seed				Seed for the bot's aiming errors
+ */
+void TBot::Reset(uint32_t seed)
+{
+	mRandom.Seed(seed);
+	mTimeSinceAction = 0.0;
+}
+
+/** @function TBot::Update - Plays one frame of a game, doing whatever Think() decides
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		simulation			Game being played
+ */
+void TBot::Update(double elapsedTime, TSimulation& simulation)
+{
+	simulation.ApplyInput(Think(elapsedTime, simulation));
+}
+
+/** @function TBot::Think - Decides to reload the cannon if it isn't loaded, otherwise to aim and fire. Nothing is done until
+ *							mShotInterval has passed since the last reload or shot.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		simulation			Game being played
+ *
+ *		@return		What the bot does this frame, which the caller must apply to simulation
+ */
+TPlayerInput TBot::Think(double elapsedTime, TSimulation& simulation)
+{
+	mTimeSinceAction += elapsedTime;
+	if(mTimeSinceAction < mShotInterval)
+		return TPlayerInput();
+
+	if(!simulation.GetCannon().IsReloaded()) {
+		mTimeSinceAction = 0.0;
+		return TPlayerInput(0, 0, TPlayerInput::RELOAD);
+	}
+
+	TPoint aimPoint;
+	if(FindAimPoint(simulation, aimPoint)) {
+		mTimeSinceAction = 0.0;
+		return TPlayerInput(int16_t(aimPoint.x), int16_t(aimPoint.y), TPlayerInput::AIM | TPlayerInput::FIRE);
+	}
+	return TPlayerInput();
+}
+
+/** @function TBot::FindAimPoint - Picks a balloon to shoot at and works out where to aim so that the bullet meets it.
+ *								   Following the rules of TBall::CollisionTest, only a balloon of the loaded colour is
+ *								   burst, so the one of those that will be lowest when the bullet arrives is picked. If
+ *								   there are none, the lowest balloon of any colour is knocked away instead.
+ *		@param 		simulation			Game being played
+ *		@param 		aimPoint			Set to the point to aim at
+ *
+ *		@return		true if there is a balloon to shoot at
+ */
+bool TBot::FindAimPoint(TSimulation& simulation, TPoint& aimPoint)
+{
+	TCannon& cannon = simulation.GetCannon();
+	const vector<TBall>& balloons = simulation.GetBalloonManager().GetBalloons();
+	uint16_t colour = cannon.GetLoadedColour();
+	const TVec2& base = cannon.GetPosition();
+
+	mSolver.Begin(base, (cannon.GetMuzzlePosition() - base).Length(), bulletSpeed);
+	mColours.clear();
+	for(vector<TBall>::const_iterator balloon = balloons.begin(); balloon != balloons.end(); ++balloon)
+		if(!balloon->IsBurst()) {
+			mSolver.Add(balloon->GetPosition(), balloon->GetVelocity());
+			mColours.push_back(balloon->GetColour());
+		}
+	mSolver.Solve();
+
+	// Lowest reachable balloon of the loaded colour, otherwise lowest of any colour
+	int32_t target = -1;
+	bool targetMatches = false;
+	TVec2 targetAim;
+	for(uint32_t b = 0; b != mSolver.GetCount(); ++b)
+	{
+		TVec2 aim = mSolver.GetAimPoint(b);
+		// The cannon can only point upwards
+		if(aim.y >= base.y)
+			continue;
+		bool matches = mColours[b] == colour;
+		if(target < 0 || (matches && !targetMatches) || (matches == targetMatches && aim.y > targetAim.y)) {
+			target = int32_t(b);
+			targetMatches = matches;
+			targetAim = aim;
+		}
+	}
+	if(target < 0)
+		return false;
+
+	if(mAimError > 0.f) {
+		targetAim.x += mAimError * (TReal(mRandom.Rand() % 2001) / 1000.f - 1.f);
+		targetAim.y += mAimError * (TReal(mRandom.Rand() % 2001) / 1000.f - 1.f);
+		if(targetAim.y >= base.y)
+			return false;
+	}
+
+	aimPoint = TPoint(int32_t(targetAim.x), int32_t(targetAim.y));
+	return true;
+}
@@ -0,0 +1,49 @@
+/**
+ *	bot.h - Jan van der Kamp, 2011
+ */
+#ifndef BOT_H_INCLUDED
+#define BOT_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/vec.h>
+
+#include "gameVariables.h"
+#include "gameRandom.h"
+#include "simulation.h"
+#include "interceptSolver.h"
+
+/** @class TBot - A scripted player used to play games without anyone at the mouse. It plays the way a person does, by
+ *				  reloading and then, a little later, aiming and firing. It aims at the lowest balloon the same colour as the
+ *				  loaded bullet, or the lowest balloon of any colour to knock it away if there isn't one. Every balloon is
+ *				  passed to a TInterceptSolver in one batch to find where it will be when the bullet reaches it, and
+ *				  balloons are compared by where they will be rather than where they are. Aim is spoilt by a random error
+ *				  so that the bot doesn't play perfectly, and the time between shots limits how many balloons it can deal with.
+ *				  Think() only decides what to do, as a TPlayerInput, so that the input can be sent elsewhere before it is applied.
+ *
+ *	@property 	TRandom			mRandom					Random number generator for aiming errors
+ *	@property 	uint32_t		mShotInterval			Time in milliseconds between reloading and firing
+ *	@property 	TReal			mAimError				Largest distance in pixels that the bot misses its aim point by
+ *	@property 	double			mTimeSinceAction		Time in milliseconds since the bot last reloaded or fired
+ *	@property 	TInterceptSolver	mSolver				Works out where to aim at every balloon
+ *	@property 	std::vector<uint16_t>	mColours			Colour of each balloon given to mSolver
+ */
+class TBot
+{
+public:
+	TBot(uint32_t shotInterval, TReal aimError);
+	void		Reset(uint32_t seed);
+	void		Update(double elapsedTime, TSimulation& simulation);
+	TPlayerInput	Think(double elapsedTime, TSimulation& simulation);
+	void		SetSkill(uint32_t shotInterval, TReal aimError)	{ mShotInterval = shotInterval; mAimError = aimError; }
+private:
+	bool		FindAimPoint(TSimulation& simulation, TPoint& aimPoint);
+
+	TRandom		mRandom;
+	uint32_t	mShotInterval;
+	TReal		mAimError;
+	double		mTimeSinceAction;
+	TInterceptSolver		mSolver;
+	std::vector<uint16_t>	mColours;
+};
+
+#endif // BOT_H_INCLUDED
@@ -0,0 +1,109 @@
+/**
+ *	burstTimer.cpp - Jan van der Kamp, 2011
+ */
+#include "burstTimer.h"
+
+#include <algorithm>
+
+using std::vector;
+
+/** @function TBurstTimer::TBurstTimer - Default Constructor, with no time for a burst to last until SetDuration is called
+ */
+TBurstTimer::TBurstTimer() :
+mDuration(),
+mClock(),
+mExpiries(),
+mExpired()
+{
+	mExpiries.reserve(gameVars::balloonCapacity + gameVars::bulletCapacity);
+	mExpired.reserve(gameVars::balloonCapacity + gameVars::bulletCapacity);
+}
+
+/** @function TBurstTimer::Reset - Sets the clock and forgets every ball scheduled, which should be done when a new game is
+ *								   started or every ball is replaced
+ *		@param 		clock				Time to set the clock to, in 1/TBall::BURST_TIME_SCALE milliseconds
+ */
+void TBurstTimer::Reset(uint32_t clock)
+{
+	mClock = clock;
+	mExpiries.clear();
+	mExpired.clear();
+}
+
+/** @function TBurstTimer::Advance - Moves the clock on a frame and takes every ball whose tick it has reached off the heap
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ */
+void TBurstTimer::Advance(double elapsedTime)
+{
+	mClock += TBall::ToBurstTime(elapsedTime);
+	mExpired.clear();
+	while(!mExpiries.empty() && int32_t(mClock - mExpiries.front().mExpiry) >= 0) {
+		mExpired.push_back(mExpiries.front().mEntity);
+		std::pop_heap(mExpiries.begin(), mExpiries.end(), IsLater);
+		mExpiries.pop_back();
+	}
+}
+
+/** @function TBurstTimer::Schedule - Schedules a ball burst this frame, which was given GetExpiry()
+ *		@param 		entity				The ball
+ */
+void TBurstTimer::Schedule(TEntity entity)
+{
+	Push(mClock + mDuration, entity);
+}
+
+/** @function TBurstTimer::ScheduleBalls - Schedules every burst ball of an archetype, for when the balls have been replaced
+ *										   rather than burst, after Reset
+ *		@param 		world				World holding the balls
+ *		@param 		archetype			Archetype of the balls to schedule
+ */
+void TBurstTimer::ScheduleBalls(const TEntityWorld& world, uint32_t archetype)
+{
+	const vector<TBall>& balls = world.GetBalls(archetype);
+	for(uint32_t row = 0; row != balls.size(); ++row)
+		if(balls[row].IsBurst())
+			Push(mClock + int16_t(balls[row].GetBurstExpiry() - uint16_t(mClock)), world.GetEntity(archetype, row));
+}
+
+/** @function TBurstTimer::RemoveExpired - Marks the balls of an archetype which finished bursting this frame for removal.
+ *										   Only the balls Advance took off the heap are looked at.
+ *		@param 		world				World holding the balls
+ *		@param 		archetype			Archetype of the balls to remove
+ */
+void TBurstTimer::RemoveExpired(TEntityWorld& world, uint32_t archetype) const
+{
+	for(vector<TEntity>::const_iterator entity = mExpired.begin(); entity != mExpired.end(); ++entity)
+		if(entity->mArchetype == archetype && world.IsAlive(*entity))
+			world.GetBall(*entity).SetRemoveTrue();
+}
+
+/** @function TBurstTimer::GetBurstTime - Gets how long ago a burst ball was burst
+ *		@param 		ball				The ball
+ *
+ *		@return		Time in milliseconds since the ball was burst
+ */
+TReal TBurstTimer::GetBurstTime(const TBall& ball) const
+{
+	int32_t remaining = int16_t(ball.GetBurstExpiry() - uint16_t(mClock));
+	return TReal(int32_t(mDuration) - remaining) / TBall::BURST_TIME_SCALE;
+}
+
+/** @function TBurstTimer::SetBurstTime - Sets how long ago a burst ball was burst, without scheduling it
+ *		@param 		ball				The ball
+ *		@param 		burstTime			Time in milliseconds since the ball was burst
+ */
+void TBurstTimer::SetBurstTime(TBall& ball, TReal burstTime) const
+{
+	ball.SetBurstExpiry(uint16_t(mClock + mDuration - TBall::ToBurstTime(burstTime)));
+}
+
+/** @function TBurstTimer::Push - Pushes a ball onto the heap
+ *		@param 		expiry				Tick the ball finishes bursting on
+ *		@param 		entity				The ball
+ */
+void TBurstTimer::Push(uint32_t expiry, TEntity entity)
+{
+	TExpiry scheduled = { expiry, entity };
+	mExpiries.push_back(scheduled);
+	std::push_heap(mExpiries.begin(), mExpiries.end(), IsLater);
+}
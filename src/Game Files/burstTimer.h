@@ -0,0 +1,71 @@
+/**
+ *	burstTimer.h - Jan van der Kamp, 2011
+ */
+#ifndef BURSTTIMER_H_INCLUDED
+#define BURSTTIMER_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "ball.h"
+#include "entityWorld.h"
+
+/** @class TBurstTimer - Decides when burst balls are removed, once their burst animation has played, so that removing
+ *						 them costs nothing for balls which aren't burst, and only touches the balls which finish. Its
+ *						 clock counts game time in 1/TBall::BURST_TIME_SCALE milliseconds, rounding each frame's time the
+ *						 way balls always rounded it, so a game removes a ball on the same frame whether played or
+ *						 replayed. A ball that bursts is given the tick its animation finishes on, kept to 16 bits, which
+ *						 is compared with the clock as a signed difference, so it holds as long as a burst lasts less
+ *						 than 2 seconds. The tick is pushed onto a min-heap with the ball's TEntity when the ball bursts,
+ *						 and each frame Advance() pops every entry the clock has reached into mExpired. The owners of the
+ *						 balls then mark just those balls for removal, in RemoveExpired(), each only touching its own
+ *						 archetype so that they can do so on separate threads at once. One timer is shared by a
+ *						 TBalloonManager and a TCannon, and advanced by whatever updates them, once a frame before they
+ *						 update.
+ *	@property 	uint32_t				mDuration				Time a burst lasts in 1/TBall::BURST_TIME_SCALE milliseconds
+ *	@property 	uint32_t				mClock					Game time in 1/TBall::BURST_TIME_SCALE milliseconds, which
+ *																wraps after 74 hours
+ *	@property 	std::vector<TExpiry>	mExpiries				Min-heap of the balls scheduled, by the tick they finish
+ *																bursting on
+ *	@property 	std::vector<TEntity>	mExpired				Balls which finished bursting this frame, some of which may
+ *																have been removed already
+ */
+class TBurstTimer
+{
+public:
+	TBurstTimer();
+	void		SetDuration(uint32_t duration)		{ mDuration = TBall::ToBurstTime(duration); }
+	uint32_t	GetDuration()	const				{ return mDuration / TBall::BURST_TIME_SCALE; }
+	uint32_t	GetClock()		const				{ return mClock; }
+	uint16_t	GetExpiry()		const				{ return uint16_t(mClock + mDuration); }
+	void		Reset(uint32_t clock = 0);
+	void		Advance(double elapsedTime);
+	void		Schedule(TEntity entity);
+	void		ScheduleBalls(const TEntityWorld& world, uint32_t archetype);
+	void		RemoveExpired(TEntityWorld& world, uint32_t archetype)	const;
+	TReal		GetBurstTime(const TBall& ball)		const;
+	void		SetBurstTime(TBall& ball, TReal burstTime)	const;
+private:
+	/** @struct TExpiry - A ball scheduled to finish bursting
+	 *	@property 	uint32_t		mExpiry					Tick the ball finishes bursting on
+	 *	@property 	TEntity			mEntity					The ball
+	 */
+	struct TExpiry
+	{
+		uint32_t	mExpiry;
+		TEntity		mEntity;
+	};
+
+	// copying disallowed
+	TBurstTimer(const TBurstTimer &timer);
+	TBurstTimer& operator=(const TBurstTimer &timer);
+	void		Push(uint32_t expiry, TEntity entity);
+	static bool	IsLater(const TExpiry& expiry, const TExpiry& other)	{ return int32_t(expiry.mExpiry - other.mExpiry) > 0; }
+
+	uint32_t				mDuration;
+	uint32_t				mClock;
+	std::vector<TExpiry>	mExpiries;
+	std::vector<TEntity>	mExpired;
+};
+
+#endif // BURSTTIMER_H_INCLUDED
@@ -2,86 +2,150 @@
  *	cannon.cpp - Jan van der Kamp, 2011
  */
 #include "cannon.h"
+#include "trace.h"
 
 using std::vector;
-using std::list;
 
 /** @function TCannon::TCannon - Constructor			Takes parameters to construct cannon with
  *		@param 		position				Position of the base of the cannon
  *		@param 		bulletScale				Size of the bullets fired
  *		@param 		numColoursInPlay		Range of colours that bullets can be
+ *		@param 		random					Random number generator used to colour new bullets
+ *		@param 		burstTimer				Decides when burst bullets are removed, shared with the balloon manager
+ *		@param 		world					Holds the bullets, shared with the balloon manager
  */
-TCannon::TCannon(const TVec2& position, const TReal& bulletScale, uint16_t numColoursInPlay) :
+TCannon::TCannon(const TVec2& position, const TReal& bulletScale, uint16_t numColoursInPlay, TRandom& random,
+				 TBurstTimer& burstTimer, TEntityWorld& world) :
 mDirectionAtRest(0.f, -1.f),
 mBulletScale(bulletScale),
+mBulletRadius(),
+mCannonLength(),
 mNumColoursInPlay(numColoursInPlay),
 mPosition(position),
 mLoadedBulletPosition(),
 mDrawSpec(),
 mAngle(0),
-mBullets(),
-mBulletsFired(),
+mWorld(world),
+mLoadedArchetype(world.AddArchetype(0, 2)),
+mFiredArchetype(world.AddArchetype(0, gameVars::bulletCapacity)),
+mBounds(),
 mCannonTexture(),
-mBalloonTextures(),
-mBalloonBurstTextures()
+mBallAssets(NULL),
+mNumColours(),
+mRandom(random),
+mBurstTimer(burstTimer)
 {}
 
 /** @function TCannon::AssignAssets - Seperate function to assign image assets to TCannon. AssignAssets is used so that TCannon's 
  *									  constructor can be called by TGame's default constructor, and AssignAssets should then be called
  *									  in TGame's default constructor.
  *		@param 		cannonTexture				Texture used to display cannon on screen
- *		@param 		balloonTextures				Textures used to display bullets on screen
- *		@param 		balloonBurstTextures		Animated textures for when bullets have been burst
+ *		@param 		ballAssets					Textures used to display bullets on screen, which must outlive this
  */
-void TCannon::AssignAssets(const TTextureRef& cannonTexture, const std::vector<TTextureRef>& balloonTextures, 
-						   const std::vector<TAnimatedTextureRef>& balloonBurstTextures)
+void TCannon::AssignAssets(const TTextureRef& cannonTexture, const TBallAssets& ballAssets)
 {
 	mCannonTexture = cannonTexture;
-	mBalloonTextures = balloonTextures;
-	mBalloonBurstTextures = balloonBurstTextures;
+	mBallAssets = &ballAssets;
+	mNumColours = ballAssets.GetNumColours();
 	
 	mDrawSpec.mCenter = TVec2(TReal(cannonTexture->GetWidth()/2), TReal(cannonTexture->GetHeight()));
 	mDrawSpec.mFlags = 1<<3;
 
-	uint16_t firstBulletColour =  TPlatform::GetInstance()->Rand() % (mNumColoursInPlay-1);
-	mBullets.push_back(TBall(mPosition, TVec2(), mBulletScale, firstBulletColour, 
-							 mBalloonTextures[firstBulletColour], mBalloonBurstTextures[firstBulletColour], true));
+	// Sizes are kept rather than read from the textures each frame, so that updating never touches the textures
+	mBulletRadius = uint16_t(ballAssets.mTextures[0]->GetWidth() * (mBulletScale / 2));
+	mCannonLength = TReal(cannonTexture->GetHeight());
+
+	uint16_t firstBulletColour =  mRandom.Rand() % (mNumColoursInPlay-1);
+	mWorld.Create(mLoadedArchetype, TBall(mPosition, TVec2(), mBulletRadius, firstBulletColour, true));
+}
+
+/** @function TCannon::Reset - Removes all bullets, loads a new one and points the cannon back to rest. Should be called any
+ *							   time a new game is started.
+ *		@param 		numColoursInPlay		Range of colours that bullets can be
+ */
+void TCannon::Reset(uint16_t numColoursInPlay)
+{
+	mNumColoursInPlay = numColoursInPlay;
+	mAngle = 0.f;
+	mLoadedBulletPosition = TVec2();
+	mWorld.Clear(mLoadedArchetype);
+	mWorld.Clear(mFiredArchetype);
+
+	uint16_t firstBulletColour =  mRandom.Rand() % (mNumColoursInPlay-1);
+	mWorld.Create(mLoadedArchetype, TBall(mPosition, TVec2(), mBulletRadius, firstBulletColour, true));
 }
 
-/** @function TCannon::Draw - Draws the cannon and both it's loaded bullets and fired bullets to the screen. 
+/** @function TCannon::Draw - Draws the cannon and both it's loaded bullets and fired bullets which are on screen. 
 */
 void TCannon::Draw() const
+{
+	TBallCuller culler(TRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT), TRect(0, 0, 0, 0));
+	Draw(culler);
+}
+
+/** @function TCannon::Draw - Draws the cannon and both it's loaded bullets and fired bullets which can be seen.
+ *		@param 		culler				Decides which bullets are hidden, and counts them
+ */
+void TCannon::Draw(TBallCuller& culler) const
 {
 	// Exception could be thrown here if AssignAssets has not been called
 
 	mCannonTexture->DrawSprite(mDrawSpec);
-	for(list<TBall>::const_iterator it = mBullets.begin(); it != mBullets.end(); ++it)
-		it->Draw();
-	for(list<TBall>::const_iterator it = mBulletsFired.begin(); it != mBulletsFired.end(); ++it)
-		it->Draw();
+	TRACE_DRAW_CALL();
+	TReal extent = mBallAssets->mDrawExtent * mBulletScale;
+	const vector<TBall>& bullets = GetBullets();
+	const vector<TBall>& bulletsFired = GetBulletsFired();
+	for(vector<TBall>::const_iterator it = bullets.begin(); it != bullets.end(); ++it)
+		if(!culler.IsHidden(*it, extent))
+			it->Draw(*mBallAssets, mBulletScale, mBurstTimer.GetBurstTime(*it));
+	for(vector<TBall>::const_iterator it = bulletsFired.begin(); it != bulletsFired.end(); ++it)
+		if(!culler.IsHidden(*it, extent))
+			it->Draw(*mBallAssets, mBulletScale, mBurstTimer.GetBurstTime(*it));
 }
 
 /** @function TCannon::Update - Calls TBall::Update on any bullets and makes sure loaded
  *								bullet is at end of cannon
  *		@param 		elapsedTime			Time in milliseconds since last frame
  */
-void TCannon::Update(uint32_t elapsedTime)
+void TCannon::Update(double elapsedTime)
+{
+	TRACE_SCOPE("TCannon::Update");
+	MoveBullets(elapsedTime);
+	UpdateContents();
+}
+
+/** @function TCannon::MoveBullets - Moves the bullets which have been fired with TEntityWorld::Update
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ */
+void TCannon::MoveBullets(double elapsedTime)
+{
+	mWorld.Update(mFiredArchetype, 0, uint32_t(GetBulletsFired().size()), elapsedTime, mBounds);
+}
+
+/** @function TCannon::UpdateContents - The rest of Update() once the bullets have moved: places a reloaded bullet at the
+ *										end of the cannon and removes bullets which are not needed any more. The burst
+ *										timer must have been advanced.
+ */
+void TCannon::UpdateContents()
 {
-	// Update bullets which have been fired
-	for(list<TBall>::iterator bullet = mBulletsFired.begin(); 
-		bullet != mBulletsFired.end(); ++bullet) 
-			bullet->Update(elapsedTime);
-	
 	// If user has reloaded, place first bullet at end of cannon
-	if(mBullets.size() > 1) 
-		mBullets.begin()->SetPosition(mPosition + 
-									  mLoadedBulletPosition * 
-									  TReal(mCannonTexture->GetHeight() + 
-									  mBullets.begin()->GetRadius()));
+	vector<TBall>& bullets = mWorld.GetBalls(mLoadedArchetype);
+	if(bullets.size() > 1) 
+		bullets.begin()->SetPosition(GetMuzzlePosition());
 
+	mBurstTimer.RemoveExpired(mWorld, mFiredArchetype);
 	CleanUpContents();
 }
 
+/** @function TCannon::GetMuzzlePosition - Gets the position a loaded bullet sits at, just off the end of the cannon
+ *
+ *		@return		Position of the loaded bullet
+ */
+TVec2 TCannon::GetMuzzlePosition() const
+{
+	return mPosition + mLoadedBulletPosition * (mCannonLength + TReal(mBulletRadius));
+}
+
 /** @function TCannon::UpdateMousePosition - Updates the angle of the cannon based on the position
  *											 of the mouse cursor
  */
@@ -98,31 +162,37 @@ void TCannon::UpdateMousePosition(const TPoint& p)
 
 	mLoadedBulletPosition = mouseDirection;
 
-	// Modify mDrawSpec accordingly
+	UpdateDrawSpec();
+}
+
+/** @function TCannon::UpdateDrawSpec - Rotates mDrawSpec to mAngle
+ */
+void TCannon::UpdateDrawSpec()
+{
 	mDrawSpec.mMatrix = TMat3(cosf(mAngle), -sinf(mAngle), 0, 
 							  sinf(mAngle), cosf(mAngle), 0, 
 							  mPosition.x, mPosition.y, 1);
 }
 
-/** @function TCannon::Reload - Adds another bullet to mBullets. 
+/** @function TCannon::Reload - Loads another bullet. 
 */
 void TCannon::Reload()
 {
-	uint16_t color =  TPlatform::GetInstance()->Rand() % (mNumColoursInPlay-1);
-	mBullets.push_back(TBall(mPosition, TVec2(), mBulletScale, color, mBalloonTextures[color], mBalloonBurstTextures[color], true));
+	uint16_t color =  mRandom.Rand() % (mNumColoursInPlay-1);
+	mWorld.Create(mLoadedArchetype, TBall(mPosition, TVec2(), mBulletRadius, color, true));
 }
 
-/** @function TCannon::Fire - Fires a bullet by moving one from mbullets to mBulletsFired and setting it's velocity
- *							  to the direction pointed by the cannon. Only fires a bullet if mBullets.size() >= 2 since
+/** @function TCannon::Fire - Fires a bullet by moving the first loaded one to the fired bullets and setting it's velocity
+ *							  to the direction pointed by the cannon. Only fires a bullet if two are loaded since
  *							  without this check bullets could be fired when user releases mouse button on a menu item
  */
 void TCannon::Fire()
 {
 	// Avoid firing without first reloading
-	if(mBullets.size() >= 2) {
-		mBullets.begin()->SetVelocity(mLoadedBulletPosition);
-		mBulletsFired.push_back(*mBullets.begin());
-		mBullets.pop_front();
+	if(IsReloaded()) {
+		TEntity bullet = mWorld.GetEntity(mLoadedArchetype, 0);
+		mWorld.GetBall(bullet).SetVelocity(mLoadedBulletPosition);
+		mWorld.Transfer(bullet, mFiredArchetype);
 	}
 }
 
@@ -131,19 +201,13 @@ void TCannon::Fire()
  */
 void TCannon::SetNumColours(uint16_t numColours) 
 { 
-	if(mNumColoursInPlay < mBalloonTextures.size()) mNumColoursInPlay = numColours; 
+	if(mNumColoursInPlay < mNumColours) mNumColoursInPlay = numColours; 
 }
 
-/** @function TCannon::CleanUpContents - Loops through mBulletsFired and removes any which have mRemoveThisBall set to true,
- *										 which could be due to flying off screen or finishing bursting.
+/** @function TCannon::CleanUpContents - Removes any fired bullets which have mRemoveThisBall set to true, which could be
+ *										 due to flying off screen or finishing bursting, with TEntityWorld::RemoveDead.
  */
 void TCannon::CleanUpContents()
 {
-	list<TBall>::iterator bullet = mBulletsFired.begin();
-	while(bullet != mBulletsFired.end())
-	{
-		if(bullet->GetRemove()) 
-			bullet = mBulletsFired.erase(bullet);
-		 else ++bullet;
-	}
+	mWorld.RemoveDead(mFiredArchetype);
 }
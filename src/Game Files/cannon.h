@@ -8,10 +8,13 @@
 #include <pf/vec.h>
 
 #include <vector>
-#include <list>
 
 #include "gameVariables.h"
+#include "gameObject.h"
 #include "ball.h"
+#include "gameRandom.h"
+#include "burstTimer.h"
+#include "entityWorld.h"
 
 /** @class TCannon - This class represents the cannon which can fire bullets. The angle of the cannon is determined by the
  *					 position of the mouse cursor. Bullets are represented by the TBall class. They are loaded onto the end of 
@@ -19,52 +22,83 @@
  *				     This class inherits from IObject for the Draw/Update interface.
  *	@property 	TVec2								mDirectionAtRest		Direction that gives 0.f for mAngle
  *	@property 	TReal								mBulletScale			Size of the bullets fired
+ *	@property 	uint16_t							mBulletRadius			Radius of the bullets fired
+ *	@property 	TReal								mCannonLength			Distance from the base of the cannon to its end
  *	@property 	uint16_t							mNumColoursInPlay		Range of colours that bullets can be
  *	@property 	TVec2								mPosition				Position of the base of the cannon
  *	@property 	TVec2								mLoadedBulletPosition	Position of bullet before firing (at end of cannon)
  *	@property 	TDrawSpec							mDrawSpec				TDrawSpec for the cannon image
  *	@property 	TReal								mAngle					Angle that cannon makes with mDirectionAtRest
- *	@property 	std::list<TBall>					mBullets				Bullets loaded on cannon, always <= 2
- *	@property 	std::list<TBall>					mBulletsFired			Bullets that have been fired
+ *	@property 	TEntityWorld&						mWorld					Holds the bullets, shared with the balloon manager
+ *	@property 	uint32_t							mLoadedArchetype		Archetype of mWorld holding the bullets loaded on cannon,
+ *																			always <= 2
+ *	@property 	uint32_t							mFiredArchetype			Archetype of mWorld holding the bullets that have been
+ *																			fired, with room kept for gameVars::bulletCapacity so that
+ *																			firing doesn't allocate
+ *	@property 	TRect								mBounds					The boundary of the playing area
  *	@property 	TTextureRef							mCannonTexture			Texture used to display cannon on screen
- *	@property 	std::vector<TTextureRef>			mBalloonTextures		Textures used to display bullets on screen
- *	@property 	std::vector<TAnimatedTextureRef>	mBalloonBurstTextures	Animated textures for when bullets have been burst
+ *	@property 	const TBallAssets*					mBallAssets				Textures used to display bullets on screen, owned by the game
+ *	@property 	uint16_t							mNumColours				Number of colours there are textures for
+ *	@property 	TRandom&							mRandom					Random number generator used to colour new bullets
+ *	@property 	TBurstTimer&						mBurstTimer				Decides when burst bullets are removed
  */
 
 class TCannon : public IObject
 {
 public:
-	TCannon(const TVec2& position, const TReal& bulletScale, uint16_t numColoursInPlay);
+	TCannon(const TVec2& position, const TReal& bulletScale, uint16_t numColoursInPlay, TRandom& random,
+			TBurstTimer& burstTimer, TEntityWorld& world);
 	virtual ~TCannon() {}
 	virtual void		Draw() const;
-	virtual void		Update(uint32_t elapsedTime);
-	void				AssignAssets(const TTextureRef& cannonTexture,	const std::vector<TTextureRef>& balloonTextures, 
-									 const std::vector<TAnimatedTextureRef>& balloonBurstTextures);
+	void				Draw(TBallCuller& culler) const;
+	virtual void		Update(double elapsedTime);
+	void				MoveBullets(double elapsedTime);
+	void				UpdateContents();
+	void				AssignAssets(const TTextureRef& cannonTexture, const TBallAssets& ballAssets);
+	void				Reset(uint16_t numColoursInPlay);
 	void				UpdateMousePosition(const TPoint& p);
 	void				Reload();
 	void				Fire();
 	void				SetNumColours(uint16_t numColours); 
-	const TVec2&		GetPosition()		{ return mPosition; }
-	const TReal			GetBulletRadius()	{ return mBalloonTextures[0]->GetWidth() * (mBulletScale / 2); }
-	std::list<TBall>&	GetBulletsFired()		{ return mBulletsFired; }
+	void				SetBounds(const TRect& bounds)	{ mBounds = bounds; }
+	const TVec2&		GetPosition()		const	{ return mPosition; }
+	const TReal			GetBulletRadius()	const	{ return TReal(mBulletRadius); }
+	TVec2				GetMuzzlePosition()	const;
+	uint16_t			GetLoadedColour()	const	{ return GetBullets().begin()->GetColour(); }
+	bool				IsReloaded()		const	{ return GetBullets().size() >= 2; }
+	TReal				GetAngle()			const	{ return mAngle; }
+	const std::vector<TBall>&	GetBullets()		const	{ return mWorld.GetBalls(mLoadedArchetype); }
+	std::vector<TBall>&	GetBulletsFired()		{ return mWorld.GetBalls(mFiredArchetype); }
+	const std::vector<TBall>&	GetBulletsFired()	const	{ return mWorld.GetBalls(mFiredArchetype); }
+	uint32_t			GetFiredArchetype()	const	{ return mFiredArchetype; }
 private:
+	// TSimulationSnapshot and TStateStreamDecoder write the state of the game directly
+	friend class TSimulationSnapshot;
+	friend class TStateStreamDecoder;
 	// copying disallowed
 	TCannon(const TCannon &cannon);
 	TCannon& operator=(const TCannon &cannon);
 	void				CleanUpContents();
+	void				UpdateDrawSpec();
 	
 	const TVec2							mDirectionAtRest;
 	const TReal							mBulletScale;
+	uint16_t							mBulletRadius;
+	TReal								mCannonLength;
 	uint16_t							mNumColoursInPlay;
 	TVec2								mPosition;
 	TVec2								mLoadedBulletPosition;
 	TDrawSpec							mDrawSpec;
 	TReal								mAngle;
-	std::list<TBall>					mBullets;
-	std::list<TBall>					mBulletsFired;
+	TEntityWorld&						mWorld;
+	const uint32_t						mLoadedArchetype;
+	const uint32_t						mFiredArchetype;
+	TRect								mBounds;
 	TTextureRef							mCannonTexture;
-	std::vector<TTextureRef>			mBalloonTextures;
-	std::vector<TAnimatedTextureRef>	mBalloonBurstTextures;
+	const TBallAssets*					mBallAssets;
+	uint16_t							mNumColours;
+	TRandom&							mRandom;
+	TBurstTimer&						mBurstTimer;
 };
 
 
@@ -0,0 +1,709 @@
+/**
+ *	collisionChecker.cpp - Jan van der Kamp, 2011
+ */
+#include "collisionChecker.h"
+
+#include <pf/script.h>
+#include <pf/luatable.h>
+#include <pf/debug.h>
+#include <cstring>
+
+#include "inputRecorder.h"
+#include "timer.h"
+
+using std::vector;
+
+namespace {
+	// Time in milliseconds a burst lasted when the reference was written, four frames of 100 milliseconds
+	const uint32_t	referenceBurstDuration = 400;
+}
+
+/** @function TCheckSpec::TCheckSpec - Default Constructor		Sets up a short check with no replay
+ */
+TCheckSpec::TCheckSpec() :
+mSeed(1),
+mRounds(100),
+mFrames(60),
+mTick(16),
+mMaxBalloons(300),
+mMaxBullets(30),
+mClusters(8),
+mBurstPercent(10),
+mReplayFile(""),
+mResultsFile("collisioncheck.json")
+{}
+
+/** @function TCheckSpec::Load - Runs a check file and reads the collisioncheck table it sets.
+ *		@param 		filename			Lua file to load
+ *
+ *		@return		true if the file was run and contained a collisioncheck table
+ */
+bool TCheckSpec::Load(const char* filename)
+{
+	TScript script;
+	if(!script.RunScript(filename))
+		return false;
+
+	lua_State* L = script.GetState();
+	LuaAutoBlock lab(L);
+	lua_getglobal(L, "collisioncheck");
+	TLuaTable table(L);
+
+	// Settings the file leaves out keep their defaults
+	if(table.IsNumber("seed"))
+		mSeed = uint32_t(table.GetNumber("seed"));
+	if(table.IsNumber("rounds"))
+		mRounds = uint32_t(table.GetNumber("rounds"));
+	if(table.IsNumber("frames"))
+		mFrames = uint32_t(table.GetNumber("frames"));
+	if(table.IsNumber("tick"))
+		mTick = uint32_t(table.GetNumber("tick"));
+	if(table.IsNumber("maxBalloons"))
+		mMaxBalloons = uint32_t(table.GetNumber("maxBalloons"));
+	if(table.IsNumber("maxBullets"))
+		mMaxBullets = uint32_t(table.GetNumber("maxBullets"));
+	if(table.IsNumber("clusters"))
+		mClusters = uint32_t(table.GetNumber("clusters"));
+	if(table.IsNumber("burstPercent"))
+		mBurstPercent = uint32_t(table.GetNumber("burstPercent"));
+	str replayFile = table.GetString("replayFile");
+	if(!replayFile.empty())
+		mReplayFile = replayFile;
+	str resultsFile = table.GetString("resultsFile");
+	if(!resultsFile.empty())
+		mResultsFile = resultsFile;
+
+	// Keep values the scenarios can't be made with in range
+	if(mTick == 0)
+		mTick = 16;
+	if(mClusters == 0)
+		mClusters = 1;
+	return true;
+}
+
+
+/** @function TCollisionChecker::TDivergence::TDivergence - Default Constructor, no divergence
+ */
+TCollisionChecker::TDivergence::TDivergence() :
+mPath(""),
+mWhat(""),
+mIndex(),
+mExpected(TVec2(), TVec2(), 0, 0, false),
+mActual(TVec2(), TVec2(), 0, 0, false),
+mExpectedValue(),
+mActualValue()
+{}
+
+/** @function TCollisionChecker::TCollisionChecker - Constructor		Takes the game's assets so that balls are the size they are in the game
+ *		@param 		ballAssets					Textures used for balloons and bullets
+ *		@param 		barrierTextures				Textures used for the barrier
+ *		@param 		cannonTexture				Texture used for the cannon
+ */
+TCollisionChecker::TCollisionChecker(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+									 const TTextureRef& cannonTexture) :
+mBallAssets(ballAssets),
+mBarrierTextures(barrierTextures),
+mCannonTexture(cannonTexture),
+mSpec(),
+mRandom(),
+mBurstTimer(),
+mWorld(),
+mScratch(gameVars::balloonScale, TStateVariables(), mRandom, mBurstTimer, mWorld),
+mGrid(),
+mScratchBullets(mWorld.AddArchetype(0, gameVars::bulletCapacity)),
+mRoundBalloons(mWorld.AddArchetype(0, gameVars::balloonCapacity)),
+mRoundBullets(mWorld.AddArchetype(0, gameVars::bulletCapacity)),
+mReferenceBalloons(),
+mReferenceBullets(),
+mBeforeMoving(),
+mExpectedMoves(),
+mBalloonBurstTimes(),
+mBulletBurstTimes(),
+mScenario(""),
+mRound(),
+mFrame(),
+mFramesChecked(),
+mBallsMoved(),
+mMostBalls(),
+mDiverged(false),
+mFirst(),
+mMinimised(),
+mReproBalloons(),
+mReproBullets(),
+mReproVars(),
+mReproBounds(),
+mReproElapsedTime(),
+mReproBurstClock(),
+mReproBurstTime()
+{
+	mBurstTimer.SetDuration(mBallAssets.mBurstDuration);
+}
+
+/** @function TCollisionChecker::Run - Loads a check file and runs its randomised scenarios, then replays its recording,
+ *									  stopping at the first divergence
+ *		@param 		filename			Lua file describing the check
+ *
+ *		@return		true if the file was loaded and the check run
+ */
+bool TCollisionChecker::Run(const char* filename)
+{
+	if(!mSpec.Load(filename))
+		return false;
+
+	// Balls are made the size the game makes them
+	TSimulation simulation((TStateVariables()));
+	simulation.AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+	TReal balloonRadius = TReal(simulation.GetBalloonManager().GetBalloonRadius());
+	TReal bulletRadius = simulation.GetCannon().GetBulletRadius();
+
+	uint64_t start = THighResTimer::GetTicks();
+	mRandom.Seed(mSpec.mSeed);
+	mScenario = "random";
+	for(mRound = 0; mRound != mSpec.mRounds && !mDiverged; ++mRound)
+		RunRandomRound(balloonRadius, bulletRadius);
+	if(!mDiverged && mSpec.mReplayFile.has_data())
+		RunReplay();
+
+	DEBUG_WRITE(("Collision check %s after %d frames in %.2f s", mDiverged ? "DIVERGED" : "matched", mFramesChecked,
+				 THighResTimer::TicksToMilliseconds(THighResTimer::GetTicks() - start) / 1000.0));
+	return true;
+}
+
+/** @function TCollisionChecker::CheckFrame - Checks the collisions about to be resolved in a game, once its balls have
+ *											 moved. TSimulation::Update calls this when the checker is set on it.
+ *		@param 		simulation			Game whose balls to check
+ *
+ *		@return		false if a divergence has been found, in this frame or before
+ */
+bool TCollisionChecker::CheckFrame(const TSimulation& simulation)
+{
+	if(mDiverged)
+		return false;
+
+	const TBalloonManager& manager = simulation.GetBalloonManager();
+	const vector<TBall>& bullets = simulation.GetCannon().GetBulletsFired();
+	// Balls burst this frame are given the tick the game's own timer would give them
+	mBurstTimer.Reset(simulation.GetBurstTimer().GetClock());
+	TDivergence divergence;
+	if(FindDivergence(manager.GetBalloons(), bullets, manager.GetStateVariables(), manager.GetBounds(), divergence)) {
+		RecordCollisionDivergence(manager.GetBalloons(), bullets, manager.GetStateVariables(), manager.GetBounds(),
+								  divergence);
+		return false;
+	}
+	mFrame++;
+	mFramesChecked++;
+	return true;
+}
+
+/** @function TCollisionChecker::ReferenceUpdate - Reference for TBall::Update followed by TBurstTimer::RemoveExpired.
+ *												  Moves a ball, marks it for removal once it has left the playing area or
+ *												  been burst for 400 milliseconds, and bounces it off the sides and top.
+ *		@param 		ball				Ball to move
+ *		@param 		burstTime			Time the ball has been burst for, in 1/TBall::BURST_TIME_SCALE milliseconds
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		bounds				The boundary of the playing area
+ */
+void TCollisionChecker::ReferenceUpdate(TBall& ball, uint32_t& burstTime, double elapsedTime, const TRect& bounds)
+{
+	TVec2 position = ball.GetPosition() + ball.GetVelocity() * TReal(elapsedTime);
+	TVec2 velocity = ball.GetVelocity();
+	int32_t radius = ball.GetRadius();
+	ball.SetPosition(position);
+
+	if(position.y > bounds.y2 + radius * 2 || position.y < -radius)
+		ball.SetRemoveTrue();
+
+	if(position.x < radius && velocity.x < 0.f)
+		velocity.x *= -1.f;
+	else if(position.x > bounds.x2 - radius && velocity.x > 0.f)
+		velocity.x *= -1.f;
+	else if(position.y < bounds.y1 + radius && velocity.y < 0.f)
+		velocity.y *= -1.f;
+	ball.SetVelocity(velocity);
+
+	// Burst time is kept in 1/BURST_TIME_SCALE milliseconds, each frame's time rounded to the nearest
+	if(ball.IsBurst()) {
+		burstTime += uint32_t(elapsedTime * TBall::BURST_TIME_SCALE + 0.5);
+		if(burstTime >= referenceBurstDuration * TBall::BURST_TIME_SCALE)
+			ball.SetRemoveTrue();
+	}
+}
+
+/** @function TCollisionChecker::ReferenceTestForCollisions - Reference for TBalloonManager::TestForCollisions. Tests
+ *															 every bullet against every balloon, then every balloon
+ *															 against every other balloon, both ways round.
+ *		@param 		balloons			Falling balloons
+ *		@param 		bullets				Bullets which have been fired
+ *		@param 		vars				Score and level, the score being increased for each collision
+ *		@param 		burstExpiry			Tick balls burst now finish bursting on
+ */
+void TCollisionChecker::ReferenceTestForCollisions(std::vector<TBall>& balloons, std::vector<TBall>& bullets,
+												   TStateVariables& vars, uint16_t burstExpiry)
+{
+	for(vector<TBall>::size_type balloon = 0; balloon != balloons.size(); ++balloon)
+		for(vector<TBall>::size_type bullet = 0; bullet != bullets.size(); ++bullet)
+			if(ReferenceCollisionTest(bullets[bullet], balloons[balloon], burstExpiry)) {
+				vars.mScore += vars.mLevel;
+				vars.mBalloonsBurstSoFar++;
+			}
+
+	for(vector<TBall>::size_type one = 0; one != balloons.size(); ++one)
+		for(vector<TBall>::size_type two = 0; two != balloons.size(); ++two)
+			if(one != two && ReferenceCollisionTest(balloons[one], balloons[two], burstExpiry)) {
+				vars.mScore += vars.mLevel * 2;
+				vars.mBalloonsBurstSoFar++;
+			}
+}
+
+/** @function TCollisionChecker::ReferenceCollisionTest - Reference for TBall::CollisionTest
+ *		@param 		ball				Ball to test
+ *		@param 		other				Another ball to test against for a collision
+ *		@param 		burstExpiry			Tick balls burst now finish bursting on
+ *
+ *		@return		true if both balls burst
+ */
+bool TCollisionChecker::ReferenceCollisionTest(TBall& ball, TBall& other, uint16_t burstExpiry)
+{
+	if(ball.IsBurst() || other.IsBurst())
+		return false;
+	if((ball.GetPosition() - other.GetPosition()).Length() > ball.GetRadius() + other.GetRadius())
+		return false;
+
+	if(ball.IsBullet() && !other.IsBullet() && ball.GetColour() != other.GetColour()) {
+		ball.SetToBurst(burstExpiry);
+		TVec2 away = other.GetPosition() - ball.GetPosition();
+		other.SetVelocity(away.Normalize());
+		return false;
+	}
+	if(!ball.IsBullet() && other.IsBullet() && ball.GetColour() != other.GetColour()) {
+		other.SetToBurst(burstExpiry);
+		TVec2 away = ball.GetPosition() - other.GetPosition();
+		ball.SetVelocity(away.Normalize());
+		return false;
+	}
+	ball.SetToBurst(burstExpiry);
+	other.SetToBurst(burstExpiry);
+	return true;
+}
+
+/** @function TCollisionChecker::RunRandomRound - Makes balls crowded round a few places, some of them already burst, then
+ *												 moves them and resolves their collisions for the spec's frames, checking
+ *												 each step. Frames vary between half and one and a half ticks long.
+ *		@param 		balloonRadius		Radius of balloons in the game
+ *		@param 		bulletRadius		Radius of bullets in the game
+ *
+ *		@return		false if a divergence was found
+ */
+bool TCollisionChecker::RunRandomRound(TReal balloonRadius, TReal bulletRadius)
+{
+	TRect bounds(0, gameVars::hudBoundary, SCREEN_WIDTH,
+				 gameVars::hudBoundary + 100 + int32_t(mRandom.Rand() % (SCREEN_HEIGHT - gameVars::hudBoundary - 99)));
+	vector<TVec2> clusters;
+	for(uint32_t c = 0; c != mSpec.mClusters; ++c)
+		clusters.push_back(TVec2(TReal(mRandom.Rand() % uint32_t(bounds.x2 + 1)),
+								 TReal(bounds.y1 + int32_t(mRandom.Rand() % uint32_t(bounds.y2 - bounds.y1 + 1)))));
+
+	vector<TBall> made;
+	mBurstTimer.Reset();
+	MakeBalls(made, mBalloonBurstTimes, mRandom.Rand() % (mSpec.mMaxBalloons + 1), balloonRadius, false, clusters);
+	mWorld.Assign(mRoundBalloons, made);
+	MakeBalls(made, mBulletBurstTimes, mRandom.Rand() % (mSpec.mMaxBullets + 1), bulletRadius, true, clusters);
+	mWorld.Assign(mRoundBullets, made);
+	mBurstTimer.ScheduleBalls(mWorld, mRoundBalloons);
+	mBurstTimer.ScheduleBalls(mWorld, mRoundBullets);
+	vector<TBall>& balloons = mWorld.GetBalls(mRoundBalloons);
+	vector<TBall>& bullets = mWorld.GetBalls(mRoundBullets);
+	TStateVariables vars;
+	vars.mLevel = uint16_t(1 + mRandom.Rand() % 20);
+	vars.mScore = uint16_t(mRandom.Rand() % 1000);
+	uint32_t numBalls = uint32_t(balloons.size() + bullets.size());
+	mMostBalls = numBalls > mMostBalls ? numBalls : mMostBalls;
+
+	for(mFrame = 0; mFrame != mSpec.mFrames; ++mFrame)
+	{
+		double elapsedTime = mSpec.mTick * (0.5 + (mRandom.Rand() % 1001) / 1000.0);
+		mBurstTimer.Advance(elapsedTime);
+		if(!CheckUpdate(mRoundBalloons, mBalloonBurstTimes, elapsedTime, bounds) ||
+		   !CheckUpdate(mRoundBullets, mBulletBurstTimes, elapsedTime, bounds))
+			return false;
+
+		TDivergence divergence;
+		if(FindDivergence(balloons, bullets, vars, bounds, divergence)) {
+			RecordCollisionDivergence(balloons, bullets, vars, bounds, divergence);
+			return false;
+		}
+		ReferenceTestForCollisions(balloons, bullets, vars, mBurstTimer.GetExpiry());
+		ScheduleBurst(mRoundBalloons, mBalloonBurstTimes);
+		ScheduleBurst(mRoundBullets, mBulletBurstTimes);
+		mFramesChecked++;
+	}
+	return true;
+}
+
+/** @function TCollisionChecker::RunReplay - Replays the spec's recording through a TSimulation which calls CheckFrame()
+ *											each frame. Mouse moves aim, presses reload and releases fire, wherever they
+ *											are, and a new game is started straight away at game over.
+ *
+ *		@return		false if the recording couldn't be read or a divergence was found
+ */
+bool TCollisionChecker::RunReplay()
+{
+	TInputReplayer replayer;
+	if(!replayer.Open(mSpec.mReplayFile.c_str())) {
+		DEBUG_WRITE(("Couldn't open %s to replay", mSpec.mReplayFile.c_str()));
+		return false;
+	}
+
+	TStateVariables vars;
+	TSimulation simulation(vars);
+	simulation.Seed(replayer.GetSeed());
+	simulation.AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+	simulation.SetCollisionChecker(this);
+	mScenario = "replay";
+	mFrame = 0;
+
+	TInputEvent event;
+	while(!mDiverged && replayer.Peek(event))
+	{
+		TPoint p = event.mPoint;
+		switch(event.mType)
+		{
+		case TInputEvent::TICK :
+			if(simulation.Update(event.mElapsedMicroseconds / 1000.0))
+				simulation.Reset(vars);
+			break;
+		case TInputEvent::MOUSE_MOVE :
+			simulation.ApplyInput(TPlayerInput(int16_t(p.x), int16_t(p.y), TPlayerInput::AIM));
+			break;
+		case TInputEvent::MOUSE_DOWN :
+			simulation.ApplyInput(TPlayerInput(0, 0, TPlayerInput::RELOAD));
+			break;
+		case TInputEvent::MOUSE_UP :
+			simulation.ApplyInput(TPlayerInput(0, 0, TPlayerInput::FIRE));
+			break;
+		}
+		replayer.Pop();
+
+		uint32_t numBalls = uint32_t(simulation.GetBalloonManager().GetBalloons().size() +
+									 simulation.GetCannon().GetBulletsFired().size());
+		mMostBalls = numBalls > mMostBalls ? numBalls : mMostBalls;
+	}
+	return !mDiverged;
+}
+
+/** @function TCollisionChecker::MakeBalls - Makes balls within three radii of one of a few places, with random speeds in
+ *											any direction and random colours, a few of them already some way into bursting
+ *		@param 		balls				Set to the balls made
+ *		@param 		burstTimes			Set to the time each ball has been burst for, for ReferenceUpdate
+ *		@param 		count				Number of balls to make
+ *		@param 		radius				Radius of the balls
+ *		@param 		isBullets			Whether the balls are bullets
+ *		@param 		clusters			Places the balls crowd round
+ */
+void TCollisionChecker::MakeBalls(std::vector<TBall>& balls, std::vector<uint32_t>& burstTimes, uint32_t count,
+								  TReal radius, bool isBullets, const std::vector<TVec2>& clusters)
+{
+	balls.clear();
+	burstTimes.clear();
+	for(uint32_t b = 0; b != count; ++b)
+	{
+		const TVec2& cluster = clusters[mRandom.Rand() % clusters.size()];
+		TVec2 offset(TReal(int32_t(mRandom.Rand() % 601) - 300) / 100.f, TReal(int32_t(mRandom.Rand() % 601) - 300) / 100.f);
+		TVec2 velocity(TReal(int32_t(mRandom.Rand() % 401) - 200) / 1000.f, TReal(int32_t(mRandom.Rand() % 601) - 300) / 1000.f);
+		balls.push_back(TBall(cluster + offset * radius, velocity, uint16_t(radius), uint16_t(mRandom.Rand() % 6), isBullets));
+		balls.back().SetId(uint16_t(b));
+		burstTimes.push_back(0);
+		if(mRandom.Rand() % 100 < mSpec.mBurstPercent) {
+			uint32_t burstTime = mRandom.Rand() % mBurstTimer.GetDuration();
+			balls.back().SetToBurst(0);
+			mBurstTimer.SetBurstTime(balls.back(), TReal(burstTime));
+			burstTimes.back() = TBall::ToBurstTime(burstTime);
+		}
+	}
+}
+
+/** @function TCollisionChecker::CheckUpdate - Moves balls with TBall::Update and removes those finished bursting with
+ *											  TBurstTimer::RemoveExpired, checking each against a copy moved with
+ *											  ReferenceUpdate, which decides when it has finished bursting by its own
+ *											  count. A ball that diverges is kept as the repro on its own. The burst
+ *											  timer must have been advanced by elapsedTime.
+ *		@param 		archetype			Archetype of mWorld holding the balls to move
+ *		@param 		burstTimes			Time each ball has been burst for, counted on by ReferenceUpdate
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		bounds				The boundary of the playing area
+ *
+ *		@return		false if a ball diverged
+ */
+bool TCollisionChecker::CheckUpdate(uint32_t archetype, std::vector<uint32_t>& burstTimes, double elapsedTime,
+									const TRect& bounds)
+{
+	// Burst balls are marked for removal after all of them have moved, so every ball is moved before any is compared
+	vector<TBall>& balls = mWorld.GetBalls(archetype);
+	mBeforeMoving = balls;
+	mExpectedMoves = balls;
+	for(vector<TBall>::size_type b = 0; b != mExpectedMoves.size(); ++b)
+		ReferenceUpdate(mExpectedMoves[b], burstTimes[b], elapsedTime, bounds);
+	mWorld.Update(archetype, 0, uint32_t(balls.size()), elapsedTime, bounds);
+	mBurstTimer.RemoveExpired(mWorld, archetype);
+
+	for(vector<TBall>::size_type b = 0; b != balls.size(); ++b)
+	{
+		const TBall& before = mBeforeMoving[b];
+		const TBall& expected = mExpectedMoves[b];
+		mBallsMoved++;
+		if(memcmp(&expected, &balls[b], sizeof(TBall)) == 0)
+			continue;
+
+		mDiverged = true;
+		mFirst.mPath = "TBall::Update";
+		mFirst.mWhat = before.IsBullet() ? "bullet" : "balloon";
+		mFirst.mIndex = uint32_t(b);
+		mFirst.mExpected = expected;
+		mFirst.mActual = balls[b];
+		mMinimised = mFirst;
+		mMinimised.mIndex = 0;
+		mReproBalloons.clear();
+		mReproBullets.clear();
+		(before.IsBullet() ? mReproBullets : mReproBalloons).push_back(before);
+		mReproBounds = bounds;
+		mReproElapsedTime = elapsedTime;
+		mReproBurstClock = mBurstTimer.GetClock();
+		// The reference has already counted this frame
+		mReproBurstTime = burstTimes[b] - (before.IsBurst() ? TBall::ToBurstTime(elapsedTime) : 0);
+		return false;
+	}
+	return true;
+}
+
+/** @function TCollisionChecker::ScheduleBurst - Schedules the balls the reference has just burst with the burst timer,
+ *												which are those burst that it hasn't yet counted any burst time for
+ *		@param 		archetype			Archetype of mWorld holding the balls
+ *		@param 		burstTimes			Time each ball has been burst for
+ */
+void TCollisionChecker::ScheduleBurst(uint32_t archetype, const std::vector<uint32_t>& burstTimes)
+{
+	const vector<TBall>& balls = mWorld.GetBalls(archetype);
+	for(uint32_t b = 0; b != balls.size(); ++b)
+		if(balls[b].IsBurst() && burstTimes[b] == 0)
+			mBurstTimer.Schedule(mWorld.GetEntity(archetype, b));
+}
+
+/** @function TCollisionChecker::FindDivergence - Resolves collisions between copies of some balls with the reference,
+ *												 with TBalloonManager::TestForCollisions, and with a TCollisionGrid, and
+ *												 compares what each left
+ *		@param 		balloons			Balloons, as they are before collisions are resolved
+ *		@param 		bullets				Bullets, as they are before collisions are resolved
+ *		@param 		vars				Score and level
+ *		@param 		bounds				The boundary of the playing area
+ *		@param 		divergence			Set to the first difference from the reference, if there is one
+ *
+ *		@return		true if an implementation diverged from the reference
+ */
+bool TCollisionChecker::FindDivergence(const std::vector<TBall>& balloons, const std::vector<TBall>& bullets,
+									   const TStateVariables& vars, const TRect& bounds, TDivergence& divergence)
+{
+	mReferenceBalloons = balloons;
+	mReferenceBullets = bullets;
+	TStateVariables expectedVars = vars;
+	ReferenceTestForCollisions(mReferenceBalloons, mReferenceBullets, expectedVars, mBurstTimer.GetExpiry());
+
+	mWorld.Assign(mScratch.mArchetype, balloons);
+	mScratch.mVars = vars;
+	mScratch.mBounds = bounds;
+	mWorld.Assign(mScratchBullets, bullets);
+	mScratch.TestForCollisions(mScratchBullets);
+	if(Compare(mWorld.GetBalls(mScratchBullets), expectedVars, "TBalloonManager::TestForCollisions", divergence))
+		return true;
+
+	mWorld.Assign(mScratch.mArchetype, balloons);
+	mScratch.mVars = vars;
+	mWorld.Assign(mScratchBullets, bullets);
+	mGrid.Build(mScratch.GetBalloons(), mWorld.GetBalls(mScratchBullets), bounds, gameVars::collisionJobs);
+	for(uint32_t chunk = 0; chunk != mGrid.GetNumChunks(); ++chunk)
+		mGrid.FindPairs(chunk);
+	mScratch.ResolveCollisions(mScratchBullets, mGrid);
+	return Compare(mWorld.GetBalls(mScratchBullets), expectedVars, "TCollisionGrid", divergence);
+}
+
+/** @function TCollisionChecker::Compare - Compares the balls and score left in mScratch and bullets with the reference's
+ *		@param 		bullets				Bullets as an implementation left them
+ *		@param 		expectedVars		Score and balloons burst as the reference left them
+ *		@param 		path				Name of the implementation
+ *		@param 		divergence			Set to the first difference, if there is one
+ *
+ *		@return		true if there was a difference
+ */
+bool TCollisionChecker::Compare(const std::vector<TBall>& bullets, const TStateVariables& expectedVars, const char* path,
+								TDivergence& divergence) const
+{
+	divergence.mPath = path;
+	if(CompareBalls(mReferenceBalloons, mScratch.GetBalloons(), "balloon", divergence) ||
+	   CompareBalls(mReferenceBullets, bullets, "bullet", divergence))
+		return true;
+
+	divergence.mIndex = 0;
+	if(expectedVars.mScore != mScratch.mVars.mScore) {
+		divergence.mWhat = "score";
+		divergence.mExpectedValue = expectedVars.mScore;
+		divergence.mActualValue = mScratch.mVars.mScore;
+		return true;
+	}
+	if(expectedVars.mBalloonsBurstSoFar != mScratch.mVars.mBalloonsBurstSoFar) {
+		divergence.mWhat = "balloonsBurst";
+		divergence.mExpectedValue = expectedVars.mBalloonsBurstSoFar;
+		divergence.mActualValue = mScratch.mVars.mBalloonsBurstSoFar;
+		return true;
+	}
+	return false;
+}
+
+/** @function TCollisionChecker::CompareBalls - Compares two lists of balls byte for byte, which covers their positions,
+ *											   velocities, flags and burst expiries
+ *		@param 		expected			Balls as the reference left them
+ *		@param 		actual				Balls as an implementation left them
+ *		@param 		what				"balloon" or "bullet"
+ *		@param 		divergence			Set to the first ball that differs, if there is one
+ *
+ *		@return		true if a ball differed
+ */
+bool TCollisionChecker::CompareBalls(const std::vector<TBall>& expected, const std::vector<TBall>& actual, const char* what,
+									 TDivergence& divergence)
+{
+	for(vector<TBall>::size_type b = 0; b != expected.size() && b != actual.size(); ++b)
+		if(memcmp(&expected[b], &actual[b], sizeof(TBall)) != 0) {
+			divergence.mWhat = what;
+			divergence.mIndex = uint32_t(b);
+			divergence.mExpected = expected[b];
+			divergence.mActual = actual[b];
+			return true;
+		}
+	return false;
+}
+
+/** @function TCollisionChecker::RecordCollisionDivergence - Keeps the first divergence in resolving collisions, then cuts
+ *															the balls it was found with down to a repro
+ *		@param 		balloons			Balloons the divergence was found with
+ *		@param 		bullets				Bullets the divergence was found with
+ *		@param 		vars				Score and level the divergence was found with
+ *		@param 		bounds				The boundary of the playing area
+ *		@param 		divergence			The divergence
+ */
+void TCollisionChecker::RecordCollisionDivergence(const std::vector<TBall>& balloons, const std::vector<TBall>& bullets,
+												  const TStateVariables& vars, const TRect& bounds,
+												  const TDivergence& divergence)
+{
+	mDiverged = true;
+	mFirst = divergence;
+	mReproBalloons = balloons;
+	mReproBullets = bullets;
+	mReproVars = vars;
+	mReproBounds = bounds;
+	mReproElapsedTime = 0.0;
+	mReproBurstClock = mBurstTimer.GetClock();
+	mReproBurstTime = 0;
+	Minimise(mReproBalloons, mReproBullets, vars, bounds);
+	FindDivergence(mReproBalloons, mReproBullets, vars, bounds, mMinimised);
+}
+
+/** @function TCollisionChecker::Minimise - Takes balls out one at a time, keeping each out if the rest still diverge, and
+ *										   goes round again until no ball can be taken out
+ *		@param 		balloons			Balloons which diverge, left holding the fewest that still do
+ *		@param 		bullets				Bullets which diverge, left holding the fewest that still do
+ *		@param 		vars				Score and level
+ *		@param 		bounds				The boundary of the playing area
+ */
+void TCollisionChecker::Minimise(std::vector<TBall>& balloons, std::vector<TBall>& bullets, const TStateVariables& vars,
+								 const TRect& bounds)
+{
+	TDivergence divergence;
+	bool removed = true;
+	while(removed)
+	{
+		removed = false;
+		for(uint32_t pass = 0; pass != 2; ++pass) {
+			vector<TBall>& balls = pass ? bullets : balloons;
+			for(vector<TBall>::size_type b = balls.size(); b-- != 0;) {
+				TBall ball = balls[b];
+				balls.erase(balls.begin() + b);
+				if(FindDivergence(balloons, bullets, vars, bounds, divergence))
+					removed = true;
+				else balls.insert(balls.begin() + b, ball);
+			}
+		}
+	}
+}
+
+/** @function TCollisionChecker::WriteResults - Writes how much was checked, and the first divergence and its repro if one
+ *											   was found, to the spec's results file as JSON. Floats are written with
+ *											   enough digits to be read back exactly.
+ *
+ *		@return		true if the file could be written
+ */
+bool TCollisionChecker::WriteResults() const
+{
+	FILE* file = fopen(mSpec.mResultsFile.c_str(), "w");
+	if(!file)
+		return false;
+
+	fprintf(file, "{\n\t\"build\": \"%s %s\",\n\t\"seed\": %u,\n\t\"rounds\": %u,\n\t\"frames\": %u,\n\t\"replayFile\": \"%s\",\n"
+				  "\t\"framesChecked\": %u,\n\t\"ballsMoved\": %u,\n\t\"mostBalls\": %u,\n\t\"diverged\": %s",
+			__DATE__, __TIME__, mSpec.mSeed, mSpec.mRounds, mSpec.mFrames, mSpec.mReplayFile.c_str(), mFramesChecked,
+			mBallsMoved, mMostBalls, mDiverged ? "true" : "false");
+	if(mDiverged)
+	{
+		fprintf(file, ",\n\t\"scenario\": \"%s\",\n\t\"round\": %u,\n\t\"frame\": %u,\n\t\"firstDivergence\": ", mScenario,
+				mRound, mFrame);
+		WriteDivergence(file, mFirst);
+		fprintf(file, ",\n\t\"repro\": {\n\t\t\"elapsedTime\": %.17g,\n\t\t\"burstClock\": %u,\n\t\t\"burstTime\": %u,\n"
+					  "\t\t\"bounds\": [ %d, %d, %d, %d ],\n"
+					  "\t\t\"score\": %u,\n\t\t\"level\": %u,\n\t\t\"balloonsBurst\": %u,\n\t\t\"divergence\": ",
+				mReproElapsedTime, mReproBurstClock, mReproBurstTime, int32_t(mReproBounds.x1), int32_t(mReproBounds.y1),
+				int32_t(mReproBounds.x2), int32_t(mReproBounds.y2), mReproVars.mScore, mReproVars.mLevel, mReproVars.mBalloonsBurstSoFar);
+		WriteDivergence(file, mMinimised);
+		fprintf(file, ",\n\t\t\"balloons\": [");
+		for(vector<TBall>::size_type b = 0; b != mReproBalloons.size(); ++b) {
+			fprintf(file, b ? ",\n\t\t\t" : "\n\t\t\t");
+			WriteBall(file, mReproBalloons[b]);
+		}
+		fprintf(file, "\n\t\t],\n\t\t\"bullets\": [");
+		for(vector<TBall>::size_type b = 0; b != mReproBullets.size(); ++b) {
+			fprintf(file, b ? ",\n\t\t\t" : "\n\t\t\t");
+			WriteBall(file, mReproBullets[b]);
+		}
+		fprintf(file, "\n\t\t]\n\t}");
+	}
+	fprintf(file, "\n}\n");
+	fclose(file);
+	return true;
+}
+
+/** @function TCollisionChecker::WriteDivergence - Writes where an implementation diverged as a JSON object, with the ball
+ *												that differed as each of them left it, or else the score or balloons burst
+ *		@param 		file				File to write to
+ *		@param 		divergence			Divergence to write
+ */
+void TCollisionChecker::WriteDivergence(FILE* file, const TDivergence& divergence)
+{
+	fprintf(file, "{ \"path\": \"%s\", \"what\": \"%s\", \"index\": %u", divergence.mPath, divergence.mWhat, divergence.mIndex);
+	if(strcmp(divergence.mWhat, "balloon") == 0 || strcmp(divergence.mWhat, "bullet") == 0) {
+		fprintf(file, ",\n\t\t\"expected\": ");
+		WriteBall(file, divergence.mExpected);
+		fprintf(file, ",\n\t\t\"actual\": ");
+		WriteBall(file, divergence.mActual);
+		fprintf(file, " }");
+	}
+	else fprintf(file, ", \"expected\": %u, \"actual\": %u }", divergence.mExpectedValue, divergence.mActualValue);
+}
+
+/** @function TCollisionChecker::WriteBall - Writes everything about a ball as a JSON object
+ *		@param 		file				File to write to
+ *		@param 		ball				Ball to write
+ */
+void TCollisionChecker::WriteBall(FILE* file, const TBall& ball)
+{
+	fprintf(file, "{ \"x\": %.9g, \"y\": %.9g, \"vx\": %.9g, \"vy\": %.9g, \"radius\": %u, \"colour\": %u, \"id\": %u, "
+				  "\"bullet\": %s, \"burst\": %s, \"remove\": %s, \"burstExpiry\": %u }",
+			ball.GetPosition().x, ball.GetPosition().y, ball.GetVelocity().x, ball.GetVelocity().y, ball.GetRadius(),
+			ball.GetColour(), ball.GetId(), ball.IsBullet() ? "true" : "false", ball.IsBurst() ? "true" : "false",
+			ball.GetRemove() ? "true" : "false", ball.GetBurstExpiry());
+}
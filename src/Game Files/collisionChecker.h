@@ -0,0 +1,208 @@
+/**
+ *	collisionChecker.h - Jan van der Kamp, 2011
+ */
+#ifndef COLLISIONCHECKER_H_INCLUDED
+#define COLLISIONCHECKER_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/rect.h>
+#include <vector>
+#include <cstdio>
+
+#include "gameVariables.h"
+#include "gameRandom.h"
+#include "balloonManager.h"
+#include "collisionGrid.h"
+#include "simulation.h"
+
+/** @struct TCheckSpec - Describes a run of TCollisionChecker. It is loaded from a Lua file which sets a global table called
+ *						 collisioncheck, see assets/scenarios/collisioncheck.lua.
+ *
+ *	@property 	uint32_t		mSeed							Seed the randomised scenarios are made from
+ *	@property 	uint32_t		mRounds							Number of randomised scenarios
+ *	@property 	uint32_t		mFrames							Frames each randomised scenario is run for
+ *	@property 	uint32_t		mTick							Time in milliseconds of each frame, randomised scenarios vary it
+ *	@property 	uint32_t		mMaxBalloons					Most balloons in a randomised scenario
+ *	@property 	uint32_t		mMaxBullets						Most bullets in a randomised scenario
+ *	@property 	uint32_t		mClusters						Number of places the balls of a randomised scenario crowd round
+ *	@property 	uint32_t		mBurstPercent					Percentage of the balls of a randomised scenario already burst
+ *	@property 	str				mReplayFile						Recording made with the "record" config setting to replay,
+ *																or empty for none
+ *	@property 	str				mResultsFile					File that results are written to
+ */
+struct TCheckSpec
+{
+	TCheckSpec();
+	bool		Load(const char* filename);
+
+	uint32_t	mSeed;
+	uint32_t	mRounds;
+	uint32_t	mFrames;
+	uint32_t	mTick;
+	uint32_t	mMaxBalloons;
+	uint32_t	mMaxBullets;
+	uint32_t	mClusters;
+	uint32_t	mBurstPercent;
+	str			mReplayFile;
+	str			mResultsFile;
+};
+
+/** @class TCollisionChecker - Checks the game's ball movement and collision code against a plain reference
+ *							   implementation of the same rules, byte for byte and score for score. The reference
+ *							   moves a ball in a straight line, removes it once it has left the playing area and
+ *							   bounces it off the sides and top. A bullet hitting a balloon of another colour bursts
+ *							   the bullet and knocks the balloon away, a bullet bursts a balloon of its own colour for
+ *							   the level in score, and two balloons burst each other for twice that. Burst balls are
+ *							   left alone, and removed once they have been burst for 400 milliseconds, which the
+ *							   reference times itself rather than with a TBurstTimer.
+ *							   Every frame, TBall::Update and TBurstTimer::RemoveExpired are checked against
+ *							   ReferenceUpdate, and TBalloonManager::TestForCollisions and
+ *							   TBalloonManager::ResolveCollisions against ReferenceTestForCollisions. This is done on
+ *							   randomised scenarios, with balls crowded round a few places, and on a recorded game
+ *							   replayed through a TSimulation. The first divergence found stops the run, and its balls
+ *							   are cut down to the fewest that still diverge and written out as a repro.
+ *							   Set the "collisioncheck" config setting to a check file to run the check at startup.
+ *
+ *	@property 	TBallAssets							mBallAssets				Textures used for balloons and bullets
+ *	@property 	std::vector<TTextureRef>			mBarrierTextures		Textures used for the barrier
+ *	@property 	TTextureRef							mCannonTexture			Texture used for the cannon
+ *	@property 	TCheckSpec							mSpec					The check being run
+ *	@property 	TRandom								mRandom					Random number generator used to make scenarios
+ *	@property 	TBurstTimer							mBurstTimer				Clock of the scenario being checked, which mScratch
+ *																			and the reference both burst balls with
+ *	@property 	TEntityWorld						mWorld					Holds the balls of the randomised scenario and the
+ *																			balloons and bullets of mScratch
+ *	@property 	TBalloonManager						mScratch				Holds copies of the balloons being checked, for the
+ *																			game's own collision code to run on
+ *	@property 	TCollisionGrid						mGrid					Finds the pairs of balls touching in mScratch
+ *	@property 	const uint32_t						mScratchBullets			Archetype of mWorld holding copies of the bullets
+ *																			being checked
+ *	@property 	const uint32_t						mRoundBalloons			Archetype of mWorld holding the balloons of the
+ *																			randomised scenario
+ *	@property 	const uint32_t						mRoundBullets			Archetype of mWorld holding its bullets
+ *	@property 	std::vector<TBall>					mReferenceBalloons		Copy of the balloons being checked, for the reference
+ *	@property 	std::vector<TBall>					mReferenceBullets		Copy of the bullets being checked, for the reference
+ *	@property 	std::vector<TBall>					mBeforeMoving			Copy of the balls being moved, as they were before
+ *	@property 	std::vector<TBall>					mExpectedMoves			Copy of the balls being moved, for ReferenceUpdate
+ *	@property 	std::vector<uint32_t>				mBalloonBurstTimes		Time each balloon of the randomised scenario has been
+ *																			burst for, in 1/TBall::BURST_TIME_SCALE milliseconds,
+ *																			counted by ReferenceUpdate
+ *	@property 	std::vector<uint32_t>				mBulletBurstTimes		Time each bullet has been burst for, likewise
+ *	@property 	const char*							mScenario				Kind of scenario being checked
+ *	@property 	uint32_t							mRound					Randomised scenario being checked
+ *	@property 	uint32_t							mFrame					Frame of the scenario being checked
+ *	@property 	uint32_t							mFramesChecked			Number of frames checked over every scenario
+ *	@property 	uint32_t							mBallsMoved				Number of ball moves checked
+ *	@property 	uint32_t							mMostBalls				Most balls in a frame that was checked
+ *	@property 	bool								mDiverged				Whether a divergence has been found
+ *	@property 	TDivergence							mFirst					The divergence that stopped the run
+ *	@property 	TDivergence							mMinimised				The divergence the repro shows
+ *	@property 	std::vector<TBall>					mReproBalloons			Fewest balloons which still diverge, as they
+ *																			were before moving or colliding
+ *	@property 	std::vector<TBall>					mReproBullets			Fewest bullets which still diverge
+ *	@property 	TStateVariables						mReproVars				Score and level of the repro
+ *	@property 	TRect								mReproBounds			Playing area of the repro
+ *	@property 	double								mReproElapsedTime		Time in milliseconds of the frame, for a divergence
+ *																			in moving
+ *	@property 	uint32_t							mReproBurstClock		Clock of the burst timer the repro's balls were burst by
+ *	@property 	uint32_t							mReproBurstTime			Time the ball had been burst for in
+ *																			1/TBall::BURST_TIME_SCALE milliseconds, for a
+ *																			divergence in moving
+ */
+class TCollisionChecker
+{
+public:
+	TCollisionChecker(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+					  const TTextureRef& cannonTexture);
+	bool		Run(const char* filename);
+	bool		CheckFrame(const TSimulation& simulation);
+	bool		WriteResults() const;
+	bool		HasDiverged()	const	{ return mDiverged; }
+
+	static void	ReferenceUpdate(TBall& ball, uint32_t& burstTime, double elapsedTime, const TRect& bounds);
+	static void	ReferenceTestForCollisions(std::vector<TBall>& balloons, std::vector<TBall>& bullets,
+										   TStateVariables& vars, uint16_t burstExpiry);
+private:
+	/** @struct TDivergence - Where an implementation first did something different to the reference
+	 *	@property 	const char*		mPath				Implementation that diverged
+	 *	@property 	const char*		mWhat				"balloon", "bullet", "score" or "balloonsBurst"
+	 *	@property 	uint32_t		mIndex				Position of the ball that diverged
+	 *	@property 	TBall			mExpected			The ball as the reference left it
+	 *	@property 	TBall			mActual				The ball as the implementation left it
+	 *	@property 	uint32_t		mExpectedValue		Score or balloons burst as the reference left it
+	 *	@property 	uint32_t		mActualValue		Score or balloons burst as the implementation left it
+	 */
+	struct TDivergence
+	{
+		TDivergence();
+
+		const char*	mPath;
+		const char*	mWhat;
+		uint32_t	mIndex;
+		TBall		mExpected;
+		TBall		mActual;
+		uint32_t	mExpectedValue;
+		uint32_t	mActualValue;
+	};
+
+	// copying disallowed
+	TCollisionChecker(const TCollisionChecker &checker);
+	TCollisionChecker& operator=(const TCollisionChecker &checker);
+	static bool	ReferenceCollisionTest(TBall& ball, TBall& other, uint16_t burstExpiry);
+	bool		RunRandomRound(TReal balloonRadius, TReal bulletRadius);
+	bool		RunReplay();
+	void		MakeBalls(std::vector<TBall>& balls, std::vector<uint32_t>& burstTimes, uint32_t count, TReal radius,
+						  bool isBullets, const std::vector<TVec2>& clusters);
+	bool		CheckUpdate(uint32_t archetype, std::vector<uint32_t>& burstTimes, double elapsedTime,
+							const TRect& bounds);
+	void		ScheduleBurst(uint32_t archetype, const std::vector<uint32_t>& burstTimes);
+	bool		FindDivergence(const std::vector<TBall>& balloons, const std::vector<TBall>& bullets,
+							   const TStateVariables& vars, const TRect& bounds, TDivergence& divergence);
+	bool		Compare(const std::vector<TBall>& bullets, const TStateVariables& expectedVars, const char* path,
+						TDivergence& divergence)	const;
+	static bool	CompareBalls(const std::vector<TBall>& expected, const std::vector<TBall>& actual, const char* what,
+							 TDivergence& divergence);
+	void		RecordCollisionDivergence(const std::vector<TBall>& balloons, const std::vector<TBall>& bullets,
+										  const TStateVariables& vars, const TRect& bounds, const TDivergence& divergence);
+	void		Minimise(std::vector<TBall>& balloons, std::vector<TBall>& bullets, const TStateVariables& vars,
+						 const TRect& bounds);
+	static void	WriteDivergence(FILE* file, const TDivergence& divergence);
+	static void	WriteBall(FILE* file, const TBall& ball);
+
+	TBallAssets							mBallAssets;
+	std::vector<TTextureRef>			mBarrierTextures;
+	TTextureRef							mCannonTexture;
+	TCheckSpec							mSpec;
+	TRandom								mRandom;
+	TBurstTimer							mBurstTimer;
+	TEntityWorld						mWorld;
+	TBalloonManager						mScratch;
+	TCollisionGrid						mGrid;
+	const uint32_t						mScratchBullets;
+	const uint32_t						mRoundBalloons;
+	const uint32_t						mRoundBullets;
+	std::vector<TBall>					mReferenceBalloons;
+	std::vector<TBall>					mReferenceBullets;
+	std::vector<TBall>					mBeforeMoving;
+	std::vector<TBall>					mExpectedMoves;
+	std::vector<uint32_t>				mBalloonBurstTimes;
+	std::vector<uint32_t>				mBulletBurstTimes;
+	const char*							mScenario;
+	uint32_t							mRound;
+	uint32_t							mFrame;
+	uint32_t							mFramesChecked;
+	uint32_t							mBallsMoved;
+	uint32_t							mMostBalls;
+	bool								mDiverged;
+	TDivergence							mFirst;
+	TDivergence							mMinimised;
+	std::vector<TBall>					mReproBalloons;
+	std::vector<TBall>					mReproBullets;
+	TStateVariables						mReproVars;
+	TRect								mReproBounds;
+	double								mReproElapsedTime;
+	uint32_t							mReproBurstClock;
+	uint32_t							mReproBurstTime;
+};
+
+#endif // COLLISIONCHECKER_H_INCLUDED
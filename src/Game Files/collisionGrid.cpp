@@ -0,0 +1,205 @@
+/**
+ *	collisionGrid.cpp - Jan van der Kamp, 2011
+ */
+#include "collisionGrid.h"
+
+#include <cmath>
+
+using std::vector;
+
+/** @function TCollisionGrid::TCollisionGrid - Default Constructor, the grid is empty until built
+ */
+TCollisionGrid::TCollisionGrid() :
+mBalloons(NULL),
+mBullets(NULL),
+mOrigin(),
+mCellSize(1.f),
+mColumns(1),
+mRows(1),
+mBalloonCells(),
+mBalloonCellStarts(),
+mBalloonsByCell(),
+mBulletCells(),
+mBulletCellStarts(),
+mBulletsByCell(),
+mChunks()
+{}
+
+/** @function TCollisionGrid::~TCollisionGrid - Destructor
+ */
+TCollisionGrid::~TCollisionGrid()
+{
+	for(vector<TChunk*>::iterator chunk = mChunks.begin(); chunk != mChunks.end(); ++chunk)
+		delete *chunk;
+}
+
+/** @function TCollisionGrid::Build - Sorts the balls into cells covering the playing area, ready for FindPairs(). The balls
+ *									  mustn't change until the pairs found have been resolved. Storage is kept from one
+ *									  build to the next, so once the game has settled building doesn't allocate.
+ *		@param 		balloons			Balloons to sort
+ *		@param 		bullets				Bullets to sort
+ *		@param 		bounds				The boundary of the playing area, balls outside it are counted as in the nearest cell
+ *		@param 		numChunks			Number of chunks to split the balloons into
+ */
+void TCollisionGrid::Build(const std::vector<TBall>& balloons, const std::vector<TBall>& bullets, const TRect& bounds,
+						   uint32_t numChunks)
+{
+	mBalloons = &balloons;
+	mBullets = &bullets;
+
+	// Cells are wider than the widest two balls, so balls that touch are never more than one cell apart
+	uint16_t maxRadius = 1;
+	for(vector<TBall>::const_iterator ball = balloons.begin(); ball != balloons.end(); ++ball)
+		maxRadius = ball->GetRadius() > maxRadius ? ball->GetRadius() : maxRadius;
+	for(vector<TBall>::const_iterator ball = bullets.begin(); ball != bullets.end(); ++ball)
+		maxRadius = ball->GetRadius() > maxRadius ? ball->GetRadius() : maxRadius;
+	mCellSize = TReal(maxRadius * 2 + 1);
+	mOrigin = TVec2(TReal(bounds.x1), TReal(bounds.y1));
+	mColumns = int32_t(TReal(bounds.x2 - bounds.x1) / mCellSize) + 1;
+	mRows = int32_t(TReal(bounds.y2 - bounds.y1) / mCellSize) + 1;
+	mColumns = mColumns > 1 ? mColumns : 1;
+	mRows = mRows > 1 ? mRows : 1;
+
+	SortBalls(balloons, mBalloonCells, mBalloonCellStarts, mBalloonsByCell);
+	SortBalls(bullets, mBulletCells, mBulletCellStarts, mBulletsByCell);
+
+	while(mChunks.size() > numChunks) {
+		delete mChunks.back();
+		mChunks.pop_back();
+	}
+	while(mChunks.size() < numChunks) {
+		TChunk* chunk = new TChunk;
+		chunk->mPairTests = 0;
+		mChunks.push_back(chunk);
+	}
+}
+
+/** @function TCollisionGrid::FindPairs - Finds every bullet, and every later balloon, touching each balloon in one chunk.
+ *										  Balls which have already burst are skipped, since TBall::CollisionTest leaves
+ *										  them alone. Only the chunk's own pairs are written.
+ *		@param 		chunk				Chunk of the balloons to search for
+ */
+void TCollisionGrid::FindPairs(uint32_t chunk)
+{
+	TChunk& found = *mChunks[chunk];
+	found.mBulletPairs.clear();
+	found.mBalloonPairs.clear();
+	found.mPairTests = 0;
+
+	uint32_t numBalloons = uint32_t(mBalloons->size());
+	uint32_t numChunks = GetNumChunks();
+	uint32_t last = numBalloons * (chunk + 1) / numChunks;
+	for(uint32_t b = numBalloons * chunk / numChunks; b != last; ++b)
+	{
+		const TBall& balloon = (*mBalloons)[b];
+		if(balloon.IsBurst())
+			continue;
+		found.mPairTests += FindTouching(balloon, 0, *mBullets, mBulletCellStarts, mBulletsByCell, b,
+										 found.mBulletPairs);
+		found.mPairTests += FindTouching(balloon, b + 1, *mBalloons, mBalloonCellStarts, mBalloonsByCell, b,
+										 found.mBalloonPairs);
+	}
+}
+
+/** @function TCollisionGrid::GetPairTests - Counts the distance tests the last search made, over every chunk
+ *
+ *		@return		Number of pairs of balls whose distance was tested
+ */
+uint32_t TCollisionGrid::GetPairTests() const
+{
+	uint32_t tests = 0;
+	for(vector<TChunk*>::const_iterator chunk = mChunks.begin(); chunk != mChunks.end(); ++chunk)
+		tests += (*chunk)->mPairTests;
+	return tests;
+}
+
+/** @function TCollisionGrid::GetCell - Finds the cell a position is in, or the nearest cell to it
+ *		@param 		position			Position to find the cell of
+ *		@param 		column				Set to the column of the cell
+ *		@param 		row					Set to the row of the cell
+ */
+void TCollisionGrid::GetCell(const TVec2& position, int32_t& column, int32_t& row) const
+{
+	column = int32_t(floor((position.x - mOrigin.x) / mCellSize));
+	row = int32_t(floor((position.y - mOrigin.y) / mCellSize));
+	column = column < 0 ? 0 : (column >= mColumns ? mColumns - 1 : column);
+	row = row < 0 ? 0 : (row >= mRows ? mRows - 1 : row);
+}
+
+/** @function TCollisionGrid::SortBalls - Counting sorts balls by cell, keeping balls in the same cell in order
+ *		@param 		balls				Balls to sort
+ *		@param 		cells				Set to the cell each ball is in
+ *		@param 		cellStarts			Set to the position in ballsByCell of each cell's first ball, and one past the last
+ *		@param 		ballsByCell			Set to the balls in cell order
+ */
+void TCollisionGrid::SortBalls(const std::vector<TBall>& balls, std::vector<uint32_t>& cells,
+							   std::vector<uint32_t>& cellStarts, std::vector<uint32_t>& ballsByCell)
+{
+	uint32_t numBalls = uint32_t(balls.size());
+	uint32_t numCells = uint32_t(mColumns * mRows);
+	cells.resize(numBalls);
+	ballsByCell.resize(numBalls);
+	cellStarts.assign(numCells + 1, 0);
+
+	for(uint32_t b = 0; b != numBalls; ++b) {
+		int32_t column, row;
+		GetCell(balls[b].GetPosition(), column, row);
+		cells[b] = uint32_t(row * mColumns + column);
+		cellStarts[cells[b]]++;
+	}
+	// Each cell's count becomes the end of its balls, and filling from the last ball back moves it to the start
+	for(uint32_t c = 1; c <= numCells; ++c)
+		cellStarts[c] += cellStarts[c - 1];
+	for(uint32_t b = numBalls; b-- != 0;)
+		ballsByCell[--cellStarts[cells[b]]] = b;
+}
+
+/** @function TCollisionGrid::FindTouching - Finds the balls touching a balloon in its own cell and the cells around it,
+ *											 and adds them to a list of pairs in the order of the balls
+ *		@param 		balloon				Balloon to find the balls touching
+ *		@param 		first				Balls before this one are skipped
+ *		@param 		balls				Balls to look through
+ *		@param 		cellStarts			Position in ballsByCell of each cell's first ball, and one past the last
+ *		@param 		ballsByCell			The balls in cell order
+ *		@param 		balloonIndex		Position of balloon, to put in the pairs
+ *		@param 		pairs				Pairs to add to
+ *
+ *		@return		Number of balls whose distance from the balloon was tested
+ */
+uint32_t TCollisionGrid::FindTouching(const TBall& balloon, uint32_t first, const std::vector<TBall>& balls,
+									  const std::vector<uint32_t>& cellStarts, const std::vector<uint32_t>& ballsByCell,
+									  uint32_t balloonIndex, std::vector<TCollisionPair>& pairs) const
+{
+	int32_t column, row;
+	GetCell(balloon.GetPosition(), column, row);
+	vector<TCollisionPair>::size_type firstFound = pairs.size();
+	uint32_t tests = 0;
+
+	for(int32_t r = (row > 0 ? row - 1 : 0); r <= row + 1 && r < mRows; ++r)
+		for(int32_t c = (column > 0 ? column - 1 : 0); c <= column + 1 && c < mColumns; ++c)
+		{
+			uint32_t cell = uint32_t(r * mColumns + c);
+			for(uint32_t b = cellStarts[cell]; b != cellStarts[cell + 1]; ++b)
+			{
+				uint32_t other = ballsByCell[b];
+				const TBall& ball = balls[other];
+				if(other < first || ball.IsBurst())
+					continue;
+				tests++;
+				// The same test TBall::CollisionTest makes, so that every pair it would find a collision in is found
+				if((balloon.GetPosition() - ball.GetPosition()).Length() <= balloon.GetRadius() + ball.GetRadius()) {
+					TCollisionPair pair = { balloonIndex, other };
+					pairs.push_back(pair);
+				}
+			}
+		}
+
+	// Cells are searched in grid order, so the few pairs found are put back in the order of the balls
+	for(vector<TCollisionPair>::size_type p = firstFound + 1; p < pairs.size(); ++p)
+		for(vector<TCollisionPair>::size_type q = p; q > firstFound && pairs[q].mOther < pairs[q - 1].mOther; --q) {
+			TCollisionPair swapped = pairs[q];
+			pairs[q] = pairs[q - 1];
+			pairs[q - 1] = swapped;
+		}
+	return tests;
+}
@@ -0,0 +1,106 @@
+/**
+ *	collisionGrid.h - Jan van der Kamp, 2011
+ */
+#ifndef COLLISIONGRID_H_INCLUDED
+#define COLLISIONGRID_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/vec.h>
+#include <pf/rect.h>
+#include <vector>
+
+#include "ball.h"
+
+/** @struct TCollisionPair - Two balls which touch, by their positions in the vectors they are kept in
+ *	@property 	uint32_t		mBalloon				Position of the balloon
+ *	@property 	uint32_t		mOther					Position of the bullet, or of the other balloon, which is after mBalloon
+ */
+struct TCollisionPair
+{
+	uint32_t	mBalloon;
+	uint32_t	mOther;
+};
+
+/** @class TCollisionGrid - Finds the balls which touch each other before TBalloonManager::ResolveCollisions works out what
+ *							happens to them, so that the search can be shared between threads without changing the game.
+ *							TBall::CollisionTest bursts and knocks balls, and what it does to a ball depends on which of
+ *							the balls it touches were tested first, so the tests themselves have to be run in the order
+ *							TBalloonManager::TestForCollisions runs them. Which balls touch doesn't depend on the order,
+ *							though, as collisions never move a ball, and it is finding them that costs.
+ *							Build() sorts the balls into square cells at least as wide as any two balls, so only balls in
+ *							the same or neighbouring cells can touch. The balloons are then split into chunks, and
+ *							FindPairs() finds the balls touching each balloon in one chunk, writing only to that chunk, so
+ *							chunks can be searched on separate threads at once. Each chunk's pairs are kept in the order
+ *							TestForCollisions would test them, so the chunks' pairs taken in turn are in that order too.
+ *	@property 	const std::vector<TBall>*		mBalloons				Balloons the grid was built from
+ *	@property 	const std::vector<TBall>*		mBullets				Bullets the grid was built from
+ *	@property 	TVec2							mOrigin					Corner of the first cell
+ *	@property 	TReal							mCellSize				Width and height of each cell
+ *	@property 	int32_t							mColumns				Number of columns of cells
+ *	@property 	int32_t							mRows					Number of rows of cells, balls outside them being
+ *																		counted as in the nearest one
+ *	@property 	std::vector<uint32_t>			mBalloonCells			Cell each balloon is in
+ *	@property 	std::vector<uint32_t>			mBalloonCellStarts		Position in mBalloonsByCell of the first balloon in
+ *																		each cell, and one past the last
+ *	@property 	std::vector<uint32_t>			mBalloonsByCell			Balloons in cell order, in order within each cell
+ *	@property 	std::vector<uint32_t>			mBulletCells			Cell each bullet is in
+ *	@property 	std::vector<uint32_t>			mBulletCellStarts		Position in mBulletsByCell of the first bullet in
+ *																		each cell, and one past the last
+ *	@property 	std::vector<uint32_t>			mBulletsByCell			Bullets in cell order, in order within each cell
+ *	@property 	std::vector<TChunk*>			mChunks					Pairs found in each chunk of the balloons
+ */
+class TCollisionGrid
+{
+public:
+	TCollisionGrid();
+	~TCollisionGrid();
+	void							Build(const std::vector<TBall>& balloons, const std::vector<TBall>& bullets,
+										  const TRect& bounds, uint32_t numChunks);
+	void							FindPairs(uint32_t chunk);
+	uint32_t						GetNumChunks()	const	{ return uint32_t(mChunks.size()); }
+	const std::vector<TCollisionPair>&	GetBulletPairs(uint32_t chunk)	const	{ return mChunks[chunk]->mBulletPairs; }
+	const std::vector<TCollisionPair>&	GetBalloonPairs(uint32_t chunk)	const	{ return mChunks[chunk]->mBalloonPairs; }
+	uint32_t						GetPairTests()	const;
+private:
+	/** @struct TChunk - What was found for one chunk of the balloons, allocated on its own so that threads searching
+	 *					 neighbouring chunks don't write to the same cache lines
+	 *	@property 	std::vector<TCollisionPair>		mBulletPairs		Balloons and the bullets touching them, by balloon
+	 *																	then bullet
+	 *	@property 	std::vector<TCollisionPair>		mBalloonPairs		Balloons and the later balloons touching them, by
+	 *																	first balloon then second
+	 *	@property 	uint32_t						mPairTests			Number of pairs of balls whose distance was tested
+	 */
+	struct TChunk
+	{
+		std::vector<TCollisionPair>		mBulletPairs;
+		std::vector<TCollisionPair>		mBalloonPairs;
+		uint32_t						mPairTests;
+	};
+
+	// copying disallowed
+	TCollisionGrid(const TCollisionGrid &grid);
+	TCollisionGrid& operator=(const TCollisionGrid &grid);
+	void							GetCell(const TVec2& position, int32_t& column, int32_t& row)	const;
+	void							SortBalls(const std::vector<TBall>& balls, std::vector<uint32_t>& cells,
+											  std::vector<uint32_t>& cellStarts, std::vector<uint32_t>& ballsByCell);
+	uint32_t						FindTouching(const TBall& balloon, uint32_t first, const std::vector<TBall>& balls,
+												 const std::vector<uint32_t>& cellStarts,
+												 const std::vector<uint32_t>& ballsByCell,
+												 uint32_t balloonIndex, std::vector<TCollisionPair>& pairs)	const;
+
+	const std::vector<TBall>*		mBalloons;
+	const std::vector<TBall>*		mBullets;
+	TVec2							mOrigin;
+	TReal							mCellSize;
+	int32_t							mColumns;
+	int32_t							mRows;
+	std::vector<uint32_t>			mBalloonCells;
+	std::vector<uint32_t>			mBalloonCellStarts;
+	std::vector<uint32_t>			mBalloonsByCell;
+	std::vector<uint32_t>			mBulletCells;
+	std::vector<uint32_t>			mBulletCellStarts;
+	std::vector<uint32_t>			mBulletsByCell;
+	std::vector<TChunk*>			mChunks;
+};
+
+#endif // COLLISIONGRID_H_INCLUDED
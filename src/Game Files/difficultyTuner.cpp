@@ -0,0 +1,313 @@
+/**
+ *	difficultyTuner.cpp - Jan van der Kamp, 2011
+ */
+#include "difficultyTuner.h"
+
+#include <pf/script.h>
+#include <pf/luatable.h>
+#include <pf/debug.h>
+#include <algorithm>
+
+#include "timer.h"
+
+using std::vector;
+
+namespace {
+	// Reads the min, max and step of a swept setting, named nameMin, nameMax and nameStep in the tuner table. Any of the
+	// three the table leaves out keeps its default.
+	void ReadRange(TLuaTable& table, const str& name, TReal range[3])
+	{
+		const char* suffixes[3] = { "Min", "Max", "Step" };
+		for(uint32_t part = TTunerSpec::MIN; part <= TTunerSpec::STEP; ++part) {
+			str key = name + suffixes[part];
+			if(table.IsNumber(key.c_str()))
+				range[part] = TReal(table.GetNumber(key.c_str()));
+		}
+		if(range[TTunerSpec::MAX] < range[TTunerSpec::MIN])
+			range[TTunerSpec::MAX] = range[TTunerSpec::MIN];
+	}
+
+	// Number of values a swept setting takes, worked out up front so that float steps don't drift
+	uint32_t RangeCount(const TReal range[3])
+	{
+		if(range[TTunerSpec::STEP] <= 0.f)
+			return 1;
+		return uint32_t((range[TTunerSpec::MAX] - range[TTunerSpec::MIN]) / range[TTunerSpec::STEP] + 0.5f) + 1;
+	}
+
+	// Value of a swept setting at an index into its range
+	TReal RangeValue(const TReal range[3], uint32_t index)
+	{
+		return range[TTunerSpec::MIN] + range[TTunerSpec::STEP] * TReal(index);
+	}
+}
+
+/** @function TTunerSpec::TTunerSpec - Default Constructor		Sets up a sweep of just the settings in gameVariables.h
+ */
+TTunerSpec::TTunerSpec() :
+mSeed(1),
+mGamesPerPoint(100),
+mMaxGameTime(600000),
+mTick(16),
+mWorkers(0),
+mBotShotInterval(250),
+mBotAimError(10.f),
+mResultsFile("tuner.json")
+{
+	mBurstToLevelUp[MIN] = mBurstToLevelUp[MAX] = TReal(gameVars::balloonsBurstToLevelUp);
+	mWaitTimeDecrease[MIN] = mWaitTimeDecrease[MAX] = TReal(gameVars::waitTimeDecrease);
+	mVelocityIncrease[MIN] = mVelocityIncrease[MAX] = gameVars::balloonVelocityIncrease;
+	mLevelsForNewColour[MIN] = mLevelsForNewColour[MAX] = TReal(gameVars::levelsToPassForNewColour);
+	mBurstToLevelUp[STEP] = mWaitTimeDecrease[STEP] = mVelocityIncrease[STEP] = mLevelsForNewColour[STEP] = 0.f;
+}
+
+/** @function TTunerSpec::Load - Runs a tuner file and reads the tuner table it sets.
+ *		@param 		filename			Lua file to load
+ *
+ *		@return		true if the file was run and contained a tuner table
+ */
+bool TTunerSpec::Load(const char* filename)
+{
+	TScript script;
+	if(!script.RunScript(filename))
+		return false;
+
+	lua_State* L = script.GetState();
+	LuaAutoBlock lab(L);
+	lua_getglobal(L, "tuner");
+	TLuaTable table(L);
+
+	// Settings the file leaves out keep their defaults
+	if(table.IsNumber("seed"))
+		mSeed = uint32_t(table.GetNumber("seed"));
+	if(table.IsNumber("gamesPerPoint"))
+		mGamesPerPoint = uint32_t(table.GetNumber("gamesPerPoint"));
+	if(table.IsNumber("maxGameTime"))
+		mMaxGameTime = uint32_t(table.GetNumber("maxGameTime"));
+	if(table.IsNumber("tick"))
+		mTick = uint32_t(table.GetNumber("tick"));
+	if(table.IsNumber("workers"))
+		mWorkers = uint32_t(table.GetNumber("workers"));
+	if(table.IsNumber("botShotInterval"))
+		mBotShotInterval = uint32_t(table.GetNumber("botShotInterval"));
+	if(table.IsNumber("botAimError"))
+		mBotAimError = TReal(table.GetNumber("botAimError"));
+	ReadRange(table, "balloonsBurstToLevelUp", mBurstToLevelUp);
+	ReadRange(table, "waitTimeDecrease", mWaitTimeDecrease);
+	ReadRange(table, "balloonVelocityIncrease", mVelocityIncrease);
+	ReadRange(table, "levelsToPassForNewColour", mLevelsForNewColour);
+	str resultsFile = table.GetString("resultsFile");
+	if(!resultsFile.empty())
+		mResultsFile = resultsFile;
+
+	// Keep values the game can't cope with in range
+	if(mTick == 0)
+		mTick = 16;
+	if(mLevelsForNewColour[MIN] < 1.f)
+		mLevelsForNewColour[MIN] = 1.f;
+	if(mLevelsForNewColour[MAX] < mLevelsForNewColour[MIN])
+		mLevelsForNewColour[MAX] = mLevelsForNewColour[MIN];
+	return true;
+}
+
+
+/** @function TDifficultyTuner::TDifficultyTuner - Constructor			Takes the game's assets so that games are set up as they are on screen
+ *		@param 		ballAssets					Textures used for balloons and bullets
+ *		@param 		barrierTextures				Textures used for the barrier
+ *		@param 		cannonTexture				Texture used for the cannon
+ */
+TDifficultyTuner::TDifficultyTuner(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+								   const TTextureRef& cannonTexture) :
+mBallAssets(ballAssets),
+mBarrierTextures(barrierTextures),
+mCannonTexture(cannonTexture),
+mSpec(),
+mPoints(),
+mResults(),
+mGamesStarted(),
+mNumWorkers(),
+mSeconds()
+{}
+
+/** @function TDifficultyTuner::Run - Loads a tuner file and plays every game it asks for. The calling thread plays games
+ *									 alongside the worker threads. Simulations are made and given their assets before any
+ *									 thread starts, since textures must only be touched from the calling thread.
+ *		@param 		filename			Lua file describing the sweep
+ *
+ *		@return		true if the file was loaded and the games played
+ */
+bool TDifficultyTuner::Run(const char* filename)
+{
+	if(!mSpec.Load(filename))
+		return false;
+
+	BuildPoints();
+	uint32_t numGames = uint32_t(mPoints.size()) * mSpec.mGamesPerPoint;
+	mResults.assign(numGames, TGameResult());
+	mGamesStarted.SetValue(0);
+
+	mNumWorkers = mSpec.mWorkers ? mSpec.mWorkers : TThread::GetNumCores();
+	if(mNumWorkers > numGames)
+		mNumWorkers = numGames ? numGames : 1;
+
+	vector<TWorker*> workers;
+	for(uint32_t w = 0; w != mNumWorkers; ++w) {
+		TWorker* worker = new TWorker;
+		worker->mTuner = this;
+		worker->mSimulation = new TSimulation(mPoints[0]);
+		worker->mSimulation->AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+		worker->mBot = new TBot(mSpec.mBotShotInterval, mSpec.mBotAimError);
+		workers.push_back(worker);
+	}
+
+	uint64_t start = THighResTimer::GetTicks();
+	// If a thread fails to start, the others just play its share of the games
+	for(uint32_t w = 1; w < mNumWorkers; ++w)
+		workers[w]->mThread.Start(WorkerMain, workers[w]);
+	PlayGames(*workers[0]->mSimulation, *workers[0]->mBot);
+	for(uint32_t w = 1; w < mNumWorkers; ++w)
+		workers[w]->mThread.Join();
+	mSeconds = THighResTimer::TicksToMilliseconds(THighResTimer::GetTicks() - start) / 1000.0;
+
+	for(vector<TWorker*>::iterator worker = workers.begin(); worker != workers.end(); ++worker) {
+		delete (*worker)->mBot;
+		delete (*worker)->mSimulation;
+		delete *worker;
+	}
+
+	DEBUG_WRITE(("Tuner played %d games on %d workers in %.2f s, %.1f games/s", numGames, mNumWorkers, mSeconds,
+				 mSeconds > 0.0 ? numGames / mSeconds : 0.0));
+	return true;
+}
+
+/** @function TDifficultyTuner::WorkerMain - Entry point of each worker thread
+ *		@param 		worker				The TWorker to play games with
+ */
+void TDifficultyTuner::WorkerMain(void* worker)
+{
+	TWorker* self = static_cast<TWorker*>(worker);
+	self->mTuner->PlayGames(*self->mSimulation, *self->mBot);
+}
+
+/** @function TDifficultyTuner::PlayGames - Takes games to play until there are none left. Each result goes into its own
+ *										   slot of mResults, so workers never write to the same place.
+ *		@param 		simulation			Game to play on
+ *		@param 		bot					Player of simulation
+ */
+void TDifficultyTuner::PlayGames(TSimulation& simulation, TBot& bot)
+{
+	for(;;)
+	{
+		uint32_t game = uint32_t(mGamesStarted.Increment() - 1);
+		if(game >= mResults.size())
+			return;
+
+		const TStateVariables& point = mPoints[game / mSpec.mGamesPerPoint];
+		uint32_t seed = mSpec.mSeed + game * 2654435761u;
+		simulation.Seed(seed);
+		simulation.Reset(point);
+		bot.Reset(seed ^ 0x5bd1e995);
+
+		bool gameOver = false;
+		while(!gameOver && simulation.GetTime() < mSpec.mMaxGameTime) {
+			bot.Update(mSpec.mTick, simulation);
+			gameOver = simulation.Update(mSpec.mTick);
+		}
+
+		TGameResult& result = mResults[game];
+		result.mSurvivalTime = simulation.GetTime();
+		result.mLevel = simulation.GetBalloonManager().GetLevel();
+		result.mScore = simulation.GetBalloonManager().GetScore();
+		result.mTimedOut = !gameOver;
+	}
+}
+
+/** @function TDifficultyTuner::BuildPoints - Makes the settings for every combination of the swept settings
+ */
+void TDifficultyTuner::BuildPoints()
+{
+	mPoints.clear();
+	for(uint32_t b = 0; b != RangeCount(mSpec.mBurstToLevelUp); ++b)
+		for(uint32_t w = 0; w != RangeCount(mSpec.mWaitTimeDecrease); ++w)
+			for(uint32_t v = 0; v != RangeCount(mSpec.mVelocityIncrease); ++v)
+				for(uint32_t l = 0; l != RangeCount(mSpec.mLevelsForNewColour); ++l) {
+					TStateVariables point;
+					point.mBalloonsBurstToLevelUp = uint16_t(RangeValue(mSpec.mBurstToLevelUp, b) + 0.5f);
+					point.mWaitTimeDecrease = uint16_t(RangeValue(mSpec.mWaitTimeDecrease, w) + 0.5f);
+					point.mBalloonVelocityIncrease = RangeValue(mSpec.mVelocityIncrease, v);
+					point.mLevelsToPassForNewColour = uint16_t(RangeValue(mSpec.mLevelsForNewColour, l) + 0.5f);
+					mPoints.push_back(point);
+				}
+}
+
+/** @function TDifficultyTuner::WriteResults - Writes the settings and spread of results of every combination swept by Run()
+ *											  to the spec's results file as JSON, along with how quickly games were played.
+ *
+ *		@return		true if the file could be written
+ */
+bool TDifficultyTuner::WriteResults() const
+{
+	FILE* file = fopen(mSpec.mResultsFile.c_str(), "w");
+	if(!file)
+		return false;
+
+	uint32_t numGames = uint32_t(mResults.size());
+	fprintf(file, "{\n\t\"build\": \"%s %s\",\n\t\"seed\": %u,\n\t\"gamesPerPoint\": %u,\n\t\"maxGameTime\": %u,\n"
+				  "\t\"tick\": %u,\n\t\"workers\": %u,\n\t\"games\": %u,\n\t\"seconds\": %.3f,\n\t\"gamesPerSecond\": %.2f,\n"
+				  "\t\"points\": [\n",
+			__DATE__, __TIME__, mSpec.mSeed, mSpec.mGamesPerPoint, mSpec.mMaxGameTime, mSpec.mTick, mNumWorkers,
+			numGames, mSeconds, mSeconds > 0.0 ? numGames / mSeconds : 0.0);
+
+	vector<uint32_t> survivalTimes, levels, scores;
+	for(vector<TStateVariables>::size_type p = 0; p != mPoints.size(); ++p)
+	{
+		survivalTimes.clear();
+		levels.clear();
+		scores.clear();
+		uint32_t timedOut = 0;
+		for(uint32_t g = uint32_t(p) * mSpec.mGamesPerPoint; g != uint32_t(p + 1) * mSpec.mGamesPerPoint; ++g) {
+			survivalTimes.push_back(mResults[g].mSurvivalTime);
+			levels.push_back(mResults[g].mLevel);
+			scores.push_back(mResults[g].mScore);
+			if(mResults[g].mTimedOut)
+				timedOut++;
+		}
+
+		const TStateVariables& point = mPoints[p];
+		fprintf(file, "\t\t{ \"balloonsBurstToLevelUp\": %u, \"waitTimeDecrease\": %u, \"balloonVelocityIncrease\": %.4f, "
+					  "\"levelsToPassForNewColour\": %u, \"timedOut\": %u,\n",
+				point.mBalloonsBurstToLevelUp, point.mWaitTimeDecrease, point.mBalloonVelocityIncrease,
+				point.mLevelsToPassForNewColour, timedOut);
+		WriteStats(file, "survivalTime", survivalTimes, false);
+		WriteStats(file, "level", levels, false);
+		WriteStats(file, "score", scores, true);
+		fprintf(file, "\t\t}%s\n", p + 1 == mPoints.size() ? "" : ",");
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
+
+/** @function TDifficultyTuner::WriteStats - Writes the mean, 10th, 50th and 90th percentiles and maximum of some values
+ *		@param 		file				File to write to
+ *		@param 		name				Name of the values
+ *		@param 		values				Values to write, these are sorted
+ *		@param 		last				Whether this is the last entry of the object being written
+ */
+void TDifficultyTuner::WriteStats(FILE* file, const char* name, std::vector<uint32_t>& values, bool last) const
+{
+	if(values.empty()) {
+		fprintf(file, "\t\t  \"%s\": null%s\n", name, last ? "" : ",");
+		return;
+	}
+
+	std::sort(values.begin(), values.end());
+	double total = 0.0;
+	for(vector<uint32_t>::const_iterator value = values.begin(); value != values.end(); ++value)
+		total += *value;
+	vector<uint32_t>::size_type top = values.size() - 1;
+
+	fprintf(file, "\t\t  \"%s\": { \"mean\": %.2f, \"p10\": %u, \"p50\": %u, \"p90\": %u, \"max\": %u }%s\n",
+			name, total / values.size(), values[top * 10 / 100], values[top / 2], values[top * 90 / 100], values[top],
+			last ? "" : ",");
+}
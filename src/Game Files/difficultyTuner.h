@@ -0,0 +1,128 @@
+/**
+ *	difficultyTuner.h - Jan van der Kamp, 2011
+ */
+#ifndef DIFFICULTYTUNER_H_INCLUDED
+#define DIFFICULTYTUNER_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+#include <cstdio>
+
+#include "gameVariables.h"
+#include "balloonManager.h"
+#include "simulation.h"
+#include "bot.h"
+#include "threading.h"
+
+/** @struct TTunerSpec - Describes a sweep of difficulty settings for TDifficultyTuner. It is loaded from a Lua file which sets
+ *						 a global table called tuner, see assets/scenarios/tuner.lua. Each swept setting has a min, max and
+ *						 step, a step of 0 uses just the min.
+ *
+ *	@property 	uint32_t		mSeed							Seed that every game's seed is made from
+ *	@property 	uint32_t		mGamesPerPoint					Number of games played with each combination of settings
+ *	@property 	uint32_t		mMaxGameTime					Time in milliseconds after which a game is stopped
+ *	@property 	uint32_t		mTick							Time in milliseconds of each simulated frame
+ *	@property 	uint32_t		mWorkers						Threads to play games on, 0 for one per core
+ *	@property 	uint32_t		mBotShotInterval				Time in milliseconds between the bot reloading and firing
+ *	@property 	TReal			mBotAimError					Largest distance in pixels the bot misses its aim by
+ *	@property 	TReal			mBurstToLevelUp[3]				Min, max and step of balloonsBurstToLevelUp
+ *	@property 	TReal			mWaitTimeDecrease[3]			Min, max and step of waitTimeDecrease
+ *	@property 	TReal			mVelocityIncrease[3]			Min, max and step of balloonVelocityIncrease
+ *	@property 	TReal			mLevelsForNewColour[3]			Min, max and step of levelsToPassForNewColour
+ *	@property 	str				mResultsFile					File that results are written to
+ */
+struct TTunerSpec
+{
+	TTunerSpec();
+	bool		Load(const char* filename);
+
+	enum { MIN = 0, MAX, STEP };
+
+	uint32_t	mSeed;
+	uint32_t	mGamesPerPoint;
+	uint32_t	mMaxGameTime;
+	uint32_t	mTick;
+	uint32_t	mWorkers;
+	uint32_t	mBotShotInterval;
+	TReal		mBotAimError;
+	TReal		mBurstToLevelUp[3];
+	TReal		mWaitTimeDecrease[3];
+	TReal		mVelocityIncrease[3];
+	TReal		mLevelsForNewColour[3];
+	str			mResultsFile;
+};
+
+/** @class TDifficultyTuner - Plays thousands of games without drawing them, each one by a TBot with its own seed, to see how
+ *							  the difficulty settings in gameVariables.h play out. Every combination of the settings swept by
+ *							  a TTunerSpec is played mGamesPerPoint times, and the spread of survival time, level reached and
+ *							  score is written out for each combination as JSON. Games are shared out between worker threads,
+ *							  each with its own TSimulation and TBot, which take the next game to play from an atomic counter.
+ *							  A game's seed depends only on its number, so results don't depend on the number of workers.
+ *							  Set the "tuner" config setting to a tuner file in order to run a sweep at startup.
+ *
+ *	@property 	TBallAssets							mBallAssets				Textures used for balloons and bullets, shared by every game
+ *	@property 	std::vector<TTextureRef>			mBarrierTextures		Textures used for the barrier
+ *	@property 	TTextureRef							mCannonTexture			Texture used for the cannon
+ *	@property 	TTunerSpec							mSpec					The sweep being run
+ *	@property 	std::vector<TStateVariables>		mPoints					Settings for each combination being swept
+ *	@property 	std::vector<TGameResult>			mResults				Result of every game, in game number order
+ *	@property 	TAtomicCounter						mGamesStarted			Number of games handed out to workers so far
+ *	@property 	uint32_t							mNumWorkers				Number of workers the games were shared between
+ *	@property 	double								mSeconds				Time taken to play every game
+ */
+class TDifficultyTuner
+{
+public:
+	TDifficultyTuner(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+					 const TTextureRef& cannonTexture);
+	bool		Run(const char* filename);
+	bool		WriteResults() const;
+private:
+	/** @struct TGameResult - How far the bot got in one game
+	 *	@property 	uint32_t	mSurvivalTime		Time in milliseconds until game over
+	 *	@property 	uint32_t	mLevel				Level reached
+	 *	@property 	uint32_t	mScore				Score reached
+	 *	@property 	bool		mTimedOut			Whether the game was stopped before game over
+	 */
+	struct TGameResult
+	{
+		uint32_t	mSurvivalTime;
+		uint32_t	mLevel;
+		uint32_t	mScore;
+		bool		mTimedOut;
+	};
+
+	/** @struct TWorker - Everything one worker thread needs to play games
+	 *	@property 	TDifficultyTuner*	mTuner				Tuner the worker plays games for
+	 *	@property 	TSimulation*		mSimulation			Game the worker plays
+	 *	@property 	TBot*				mBot				Player of mSimulation
+	 *	@property 	TThread				mThread				Thread the worker runs on
+	 */
+	struct TWorker
+	{
+		TDifficultyTuner*	mTuner;
+		TSimulation*		mSimulation;
+		TBot*				mBot;
+		TThread				mThread;
+	};
+
+	// copying disallowed
+	TDifficultyTuner(const TDifficultyTuner &tuner);
+	TDifficultyTuner& operator=(const TDifficultyTuner &tuner);
+	static void	WorkerMain(void* worker);
+	void		PlayGames(TSimulation& simulation, TBot& bot);
+	void		BuildPoints();
+	void		WriteStats(FILE* file, const char* name, std::vector<uint32_t>& values, bool last) const;
+
+	TBallAssets							mBallAssets;
+	std::vector<TTextureRef>			mBarrierTextures;
+	TTextureRef							mCannonTexture;
+	TTunerSpec							mSpec;
+	std::vector<TStateVariables>		mPoints;
+	std::vector<TGameResult>			mResults;
+	TAtomicCounter						mGamesStarted;
+	uint32_t							mNumWorkers;
+	double								mSeconds;
+};
+
+#endif // DIFFICULTYTUNER_H_INCLUDED
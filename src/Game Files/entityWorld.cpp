@@ -0,0 +1,262 @@
+/**
+ *	entityWorld.cpp - Jan van der Kamp, 2011
+ */
+#include "entityWorld.h"
+
+using std::vector;
+
+/** @function TEntityWorld::TEntityWorld - Default Constructor, with no archetypes
+ */
+TEntityWorld::TEntityWorld() :
+mArchetypes()
+{}
+
+/** @function TEntityWorld::AddArchetype - Adds an archetype, with room kept for a number of entities so that creating them
+ *										   doesn't allocate
+ *		@param 		components			Components the archetype's entities have besides TBall, as flags
+ *		@param 		capacity			Number of entities to keep room for
+ *
+ *		@return		Number of the archetype
+ */
+uint32_t TEntityWorld::AddArchetype(uint32_t components, uint32_t capacity)
+{
+	// Growing mArchetypes would copy the archetypes, and a copied vector only keeps room for what it holds, so their
+	// arrays are swapped into the larger one instead
+	if(mArchetypes.size() == mArchetypes.capacity()) {
+		vector<TArchetype> grown(mArchetypes.size());
+		grown.reserve(mArchetypes.size() * 2 + 1);
+		for(uint32_t moved = 0; moved != mArchetypes.size(); ++moved) {
+			grown[moved].mComponents = mArchetypes[moved].mComponents;
+			grown[moved].mEntities.swap(mArchetypes[moved].mEntities);
+			grown[moved].mBalls.swap(mArchetypes[moved].mBalls);
+			grown[moved].mLifetimes.swap(mArchetypes[moved].mLifetimes);
+			grown[moved].mSlots.swap(mArchetypes[moved].mSlots);
+			grown[moved].mFreeSlots.swap(mArchetypes[moved].mFreeSlots);
+		}
+		mArchetypes.swap(grown);
+	}
+	mArchetypes.push_back(TArchetype());
+	TArchetype& archetype = mArchetypes.back();
+	archetype.mComponents = components;
+	archetype.mEntities.reserve(capacity);
+	archetype.mBalls.reserve(capacity);
+	if(archetype.Has(LIFETIME))
+		archetype.mLifetimes.reserve(capacity);
+	archetype.mSlots.reserve(capacity);
+	archetype.mFreeSlots.reserve(capacity);
+	return uint32_t(mArchetypes.size() - 1);
+}
+
+/** @function TEntityWorld::Create - Adds an entity at the end of an archetype, with any components besides its ball zeroed
+ *		@param 		archetype			Archetype of the entity
+ *		@param 		ball				Ball of the entity
+ *
+ *		@return		Handle to the entity
+ */
+TEntity TEntityWorld::Create(uint32_t archetype, const TBall& ball)
+{
+	return AddRow(archetype, ball);
+}
+
+/** @function TEntityWorld::Transfer - Moves an entity to the end of another archetype. The rows after it in its old
+ *									   archetype move up, so their order is unchanged.
+ *		@param 		entity				Entity to move, which must be alive
+ *		@param 		archetype			Archetype to move it to
+ *
+ *		@return		Handle to the entity in its new archetype, the old handle no longer being alive
+ */
+TEntity TEntityWorld::Transfer(TEntity entity, uint32_t archetype)
+{
+	TArchetype& from = Locate(entity);
+	uint32_t row = GetRow(entity);
+	TBall ball = from.mBalls[row];
+	TLifetime lifetime = { 0.0, 0 };
+	if(from.Has(LIFETIME)) {
+		lifetime = from.mLifetimes[row];
+		from.mLifetimes.erase(from.mLifetimes.begin() + row);
+	}
+	FreeSlot(from, entity.mIndex);
+	from.mEntities.erase(from.mEntities.begin() + row);
+	from.mBalls.erase(from.mBalls.begin() + row);
+	for(uint32_t moved = row; moved != from.GetSize(); ++moved)
+		from.mSlots[from.mEntities[moved]].mRow = moved;
+
+	TEntity transferred = AddRow(archetype, ball);
+	TArchetype& to = mArchetypes[archetype];
+	if(to.Has(LIFETIME))
+		to.mLifetimes.back() = lifetime;
+	return transferred;
+}
+
+/** @function TEntityWorld::Assign - Replaces every entity of an archetype with new ones holding copies of some balls, for
+ *									 when a whole game is put back. Handles to the old entities are no longer alive.
+ *		@param 		archetype			Archetype to replace the entities of
+ *		@param 		balls				Balls of the new entities, in row order
+ *		@param 		count				Number of balls
+ */
+void TEntityWorld::Assign(uint32_t archetype, const TBall* balls, uint32_t count)
+{
+	Clear(archetype);
+	for(uint32_t b = 0; b != count; ++b)
+		AddRow(archetype, balls[b]);
+}
+
+/** @function TEntityWorld::Assign - Replaces every entity of an archetype with new ones holding copies of some balls
+ *		@param 		archetype			Archetype to replace the entities of
+ *		@param 		balls				Balls of the new entities, in row order
+ */
+void TEntityWorld::Assign(uint32_t archetype, const std::vector<TBall>& balls)
+{
+	Assign(archetype, balls.empty() ? NULL : &balls[0], uint32_t(balls.size()));
+}
+
+/** @function TEntityWorld::Clear - Removes every entity of an archetype, keeping its storage
+ *		@param 		archetype			Archetype to empty
+ */
+void TEntityWorld::Clear(uint32_t archetype)
+{
+	TArchetype& cleared = mArchetypes[archetype];
+	for(vector<uint32_t>::const_iterator slot = cleared.mEntities.begin(); slot != cleared.mEntities.end(); ++slot)
+		FreeSlot(cleared, *slot);
+	cleared.mEntities.clear();
+	cleared.mBalls.clear();
+	cleared.mLifetimes.clear();
+}
+
+/** @function TEntityWorld::IsAlive - Checks whether a handle still refers to an entity
+ *		@param 		entity				Handle to check
+ *
+ *		@return		true if the entity hasn't been removed
+ */
+bool TEntityWorld::IsAlive(TEntity entity) const
+{
+	if(entity.mArchetype >= mArchetypes.size())
+		return false;
+	const vector<TSlot>& slots = mArchetypes[entity.mArchetype].mSlots;
+	return entity.mIndex < slots.size() && slots[entity.mIndex].mAlive &&
+		   slots[entity.mIndex].mGeneration == entity.mGeneration;
+}
+
+/** @function TEntityWorld::GetEntity - Gets a handle to the entity in a row, which stays valid after the row moves
+ *		@param 		archetype			Archetype of the entity
+ *		@param 		row					Row of the entity
+ *
+ *		@return		Handle to the entity
+ */
+TEntity TEntityWorld::GetEntity(uint32_t archetype, uint32_t row) const
+{
+	uint32_t slot = mArchetypes[archetype].mEntities[row];
+	TEntity entity = { archetype, slot, mArchetypes[archetype].mSlots[slot].mGeneration };
+	return entity;
+}
+
+/** @function TEntityWorld::Update - Moves a range of an archetype's entities by the rules of TBall::Update. Each entity
+ *									 only touches itself, so separate ranges can be moved on separate threads at once.
+ *		@param 		archetype			Archetype of the entities
+ *		@param 		first				Row of the first entity to move
+ *		@param 		last				Row after the last entity to move, past the end of the archetype if need be
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		bounds				The boundary of the playing area
+ */
+void TEntityWorld::Update(uint32_t archetype, uint32_t first, uint32_t last, double elapsedTime, const TRect& bounds)
+{
+	vector<TBall>& balls = mArchetypes[archetype].mBalls;
+	if(last > balls.size())
+		last = uint32_t(balls.size());
+	for(uint32_t row = first; row < last; ++row)
+		balls[row].Update(elapsedTime, bounds);
+}
+
+/** @function TEntityWorld::CountAge - Ages every entity with a TLifetime, and marks those which have lived their lifetime
+ *									   for removal
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ */
+void TEntityWorld::CountAge(double elapsedTime)
+{
+	for(vector<TArchetype>::iterator archetype = mArchetypes.begin(); archetype != mArchetypes.end(); ++archetype) {
+		if(!archetype->Has(LIFETIME))
+			continue;
+		for(uint32_t row = 0; row != archetype->GetSize(); ++row) {
+			TLifetime& lifetime = archetype->mLifetimes[row];
+			lifetime.mAge += elapsedTime;
+			if(lifetime.mMaxAge && lifetime.mAge >= lifetime.mMaxAge)
+				archetype->mBalls[row].SetRemoveTrue();
+		}
+	}
+}
+
+/** @function TEntityWorld::RemoveDead - Removes the entities of an archetype whose balls are marked for removal, which could
+ *										 be due to leaving the playing area, finishing bursting or living their lifetime.
+ *										 Entities which are kept are moved down over the removed ones in one pass, so
+ *										 their order is unchanged and the archetype keeps its storage.
+ *		@param 		archetype			Archetype to remove entities from
+ */
+void TEntityWorld::RemoveDead(uint32_t archetype)
+{
+	TArchetype& packed = mArchetypes[archetype];
+	bool hasLifetime = packed.Has(LIFETIME);
+	uint32_t kept = 0;
+	for(uint32_t row = 0; row != packed.GetSize(); ++row) {
+		if(packed.mBalls[row].GetRemove()) {
+			FreeSlot(packed, packed.mEntities[row]);
+			continue;
+		}
+		if(kept != row) {
+			packed.mEntities[kept] = packed.mEntities[row];
+			packed.mBalls[kept] = packed.mBalls[row];
+			if(hasLifetime)
+				packed.mLifetimes[kept] = packed.mLifetimes[row];
+			packed.mSlots[packed.mEntities[kept]].mRow = kept;
+		}
+		++kept;
+	}
+	packed.mEntities.erase(packed.mEntities.begin() + kept, packed.mEntities.end());
+	packed.mBalls.erase(packed.mBalls.begin() + kept, packed.mBalls.end());
+	if(hasLifetime)
+		packed.mLifetimes.erase(packed.mLifetimes.begin() + kept, packed.mLifetimes.end());
+}
+
+/** @function TEntityWorld::AddRow - Adds a row at the end of an archetype, taking a free slot for it or adding one if none
+ *									 are free
+ *		@param 		archetype			Archetype to add the row to
+ *		@param 		ball				Ball of the row
+ *
+ *		@return		Handle to the entity the row holds
+ */
+TEntity TEntityWorld::AddRow(uint32_t archetype, const TBall& ball)
+{
+	TArchetype& added = mArchetypes[archetype];
+	uint32_t slot;
+	if(!added.mFreeSlots.empty()) {
+		slot = added.mFreeSlots.back();
+		added.mFreeSlots.pop_back();
+	}
+	else {
+		TSlot newSlot = { 0, 0, false };
+		added.mSlots.push_back(newSlot);
+		slot = uint32_t(added.mSlots.size() - 1);
+	}
+
+	TSlot& entity = added.mSlots[slot];
+	entity.mRow = added.GetSize();
+	entity.mAlive = true;
+	added.mEntities.push_back(slot);
+	added.mBalls.push_back(ball);
+	if(added.Has(LIFETIME)) {
+		TLifetime lifetime = { 0.0, 0 };
+		added.mLifetimes.push_back(lifetime);
+	}
+	TEntity handle = { archetype, slot, entity.mGeneration };
+	return handle;
+}
+
+/** @function TEntityWorld::FreeSlot - Frees the slot of a removed entity, so that handles to it are no longer alive
+ *		@param 		archetype			Archetype the entity belonged to
+ *		@param 		slot				Slot to free
+ */
+void TEntityWorld::FreeSlot(TArchetype& archetype, uint32_t slot)
+{
+	archetype.mSlots[slot].mAlive = false;
+	archetype.mSlots[slot].mGeneration++;
+	archetype.mFreeSlots.push_back(slot);
+}
@@ -0,0 +1,125 @@
+/**
+ *	entityWorld.h - Jan van der Kamp, 2011
+ */
+#ifndef ENTITYWORLD_H_INCLUDED
+#define ENTITYWORLD_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/rect.h>
+#include <vector>
+
+#include "gameVariables.h"
+#include "ball.h"
+
+/** @struct TLifetime - How long an entity has been alive, for entities which only last a while
+ *	@property 	double			mAge					Time in milliseconds since the entity was created
+ *	@property 	uint32_t		mMaxAge					Time in milliseconds after which the entity is removed, or 0 to keep it
+ */
+struct TLifetime
+{
+	double		mAge;
+	uint32_t	mMaxAge;
+};
+
+/** @struct TEntity - Handle to an entity in a TEntityWorld. Handles of removed entities are never mistaken for the entity
+ *					  which reuses their slot, since the slot's generation is counted up when it is freed.
+ *	@property 	uint32_t		mArchetype				Archetype of the entity
+ *	@property 	uint32_t		mIndex					Slot of the entity in its archetype
+ *	@property 	uint32_t		mGeneration				Generation of the slot when the entity was created
+ */
+struct TEntity
+{
+	uint32_t	mArchetype;
+	uint32_t	mIndex;
+	uint32_t	mGeneration;
+};
+
+/** @class TEntityWorld - Holds the balls in play, and any other entity made of the same components, grouped into
+ *						  archetypes by the components they have. Every entity has a TBall, the packed record of where
+ *						  it is, how it moves, the circle it collides with, its colour and its burst, and an archetype
+ *						  can add a TLifetime for entities which only last a while. Each archetype keeps each component
+ *						  in its own dense array, row r of every array being the same entity, and the systems run over
+ *						  them in order with no per-entity virtual call: Update moves a range of rows by the rules of
+ *						  TBall::Update, CountAge marks entities which have lived their lifetime for removal, and
+ *						  RemoveDead packs an archetype in one pass without changing the order of what is kept.
+ *						  TBalloonManager keeps its balloons in one archetype and TCannon its loaded and fired bullets in
+ *						  two more, so a new kind of entity, such as a power-up, only needs an archetype of its own rather
+ *						  than its own list and clean up pass. Rows are only added and removed through the world, which
+ *						  keeps each entity's TEntity handle pointing at its row as the row moves. Each archetype keeps
+ *						  its own slots for the handles, so entities of separate archetypes can be added, moved and
+ *						  removed on separate threads at once. One world is shared by a TBalloonManager and a TCannon,
+ *						  and owned by whatever owns them.
+ *	@property 	std::vector<TArchetype>		mArchetypes			Every archetype, each with its entities' components
+ */
+class TEntityWorld
+{
+public:
+	// Components an archetype can have besides the TBall every entity has
+	enum { LIFETIME = 1 };
+
+	TEntityWorld();
+	uint32_t					AddArchetype(uint32_t components, uint32_t capacity);
+	TEntity						Create(uint32_t archetype, const TBall& ball);
+	TEntity						Transfer(TEntity entity, uint32_t archetype);
+	void						Assign(uint32_t archetype, const TBall* balls, uint32_t count);
+	void						Assign(uint32_t archetype, const std::vector<TBall>& balls);
+	void						Clear(uint32_t archetype);
+	bool						IsAlive(TEntity entity)					const;
+	TEntity						GetEntity(uint32_t archetype, uint32_t row)	const;
+	TBall&						GetBall(TEntity entity)							{ return Locate(entity).mBalls[GetRow(entity)]; }
+	TLifetime&					GetLifetime(TEntity entity)						{ return Locate(entity).mLifetimes[GetRow(entity)]; }
+	std::vector<TBall>&			GetBalls(uint32_t archetype)					{ return mArchetypes[archetype].mBalls; }
+	const std::vector<TBall>&	GetBalls(uint32_t archetype)			const	{ return mArchetypes[archetype].mBalls; }
+
+	// Systems
+	void						Update(uint32_t archetype, uint32_t first, uint32_t last, double elapsedTime,
+									   const TRect& bounds);
+	void						CountAge(double elapsedTime);
+	void						RemoveDead(uint32_t archetype);
+private:
+	/** @struct TSlot - Where an entity is
+	 *	@property 	uint32_t		mRow					Row of the entity in its archetype
+	 *	@property 	uint32_t		mGeneration				Counted up each time the slot is freed
+	 *	@property 	bool			mAlive					Whether the slot holds an entity
+	 */
+	struct TSlot
+	{
+		uint32_t	mRow;
+		uint32_t	mGeneration;
+		bool		mAlive;
+	};
+
+	/** @struct TArchetype - Every entity with one set of components, each component in its own array. Row r of every
+	 *						 array is the same entity. Arrays for components the archetype doesn't have are left empty.
+	 *	@property 	uint32_t					mComponents			Components of the archetype besides TBall, as flags
+	 *	@property 	std::vector<uint32_t>		mEntities			Slot of the entity in each row
+	 *	@property 	std::vector<TBall>			mBalls				TBall of each row
+	 *	@property 	std::vector<TLifetime>		mLifetimes			TLifetime of each row, if the archetype has LIFETIME
+	 *	@property 	std::vector<TSlot>			mSlots				Where each entity is, by TEntity::mIndex
+	 *	@property 	std::vector<uint32_t>		mFreeSlots			Slots of removed entities, for reuse
+	 */
+	struct TArchetype
+	{
+		uint32_t					mComponents;
+		std::vector<uint32_t>		mEntities;
+		std::vector<TBall>			mBalls;
+		std::vector<TLifetime>		mLifetimes;
+		std::vector<TSlot>			mSlots;
+		std::vector<uint32_t>		mFreeSlots;
+
+		bool		Has(uint32_t components)	const	{ return (mComponents & components) == components; }
+		uint32_t	GetSize()					const	{ return uint32_t(mEntities.size()); }
+	};
+
+	// copying disallowed
+	TEntityWorld(const TEntityWorld &world);
+	TEntityWorld& operator=(const TEntityWorld &world);
+	TArchetype&			Locate(TEntity entity)				{ return mArchetypes[entity.mArchetype]; }
+	uint32_t			GetRow(TEntity entity)		const	{ return mArchetypes[entity.mArchetype].mSlots[entity.mIndex].mRow; }
+	TEntity				AddRow(uint32_t archetype, const TBall& ball);
+	static void			FreeSlot(TArchetype& archetype, uint32_t slot);
+
+	std::vector<TArchetype>		mArchetypes;
+};
+
+#endif // ENTITYWORLD_H_INCLUDED
@@ -0,0 +1,109 @@
+/**
+ *	frameScheduler.cpp - Jan van der Kamp, 2011
+ */
+#include "frameScheduler.h"
+#include "threading.h"
+#include "timer.h"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <mmsystem.h>
+	#pragma comment(lib, "winmm.lib")
+#else
+	#include <time.h>
+#endif
+
+namespace {
+	// Time in nanoseconds before a frame is due that Pace() stops sleeping and waits on the timer, long enough to cover
+	// a sleep that oversleeps by a scheduler tick once Start() has asked for a 1 ms tick
+	const double	spinTime = 1000000.0;
+}
+
+/** @function TFrameScheduler::TFrameScheduler - Default Constructor
+ */
+TFrameScheduler::TFrameScheduler() :
+mStartTicks(),
+mFrameTime(),
+mNextFrame(),
+mRedrawDue(true),
+mFramesDrawn(),
+mFramesSkipped()
+{}
+
+/** @function TFrameScheduler::~TFrameScheduler - Destructor, gives back the timer resolution asked for by Start()
+ */
+TFrameScheduler::~TFrameScheduler()
+{
+#if defined(_WIN32)
+	if(mFrameTime != 0.0)
+		timeEndPeriod(1);
+#endif
+}
+
+/** @function TFrameScheduler::Start - Starts the schedule, with the first frame due straight away
+ *		@param 		frameMicroseconds	Time in microseconds between frames
+ */
+void TFrameScheduler::Start(uint32_t frameMicroseconds)
+{
+#if defined(_WIN32)
+	// Sleep() is only as fine as the system timer, which is 15.6 ms unless asked for better
+	if(mFrameTime == 0.0)
+		timeBeginPeriod(1);
+#endif
+	mStartTicks = THighResTimer::GetTicks();
+	mFrameTime = frameMicroseconds * 1000.0;
+	mNextFrame = 0.0;
+	mRedrawDue = true;
+}
+
+/** @function TFrameScheduler::Pace - Waits until the next frame is due. If it is already more than a frame overdue, as it is
+ *									  when the game has been idle, the schedule starts again from now.
+ */
+void TFrameScheduler::Pace()
+{
+	double now = THighResTimer::TicksToNanoseconds(THighResTimer::GetTicks() - mStartTicks);
+	if(now > mNextFrame + mFrameTime) {
+		mNextFrame = now + mFrameTime;
+		return;
+	}
+
+	if(mNextFrame - now > spinTime)
+		Sleep(uint32_t((mNextFrame - now - spinTime) / 1000000.0));
+	while(THighResTimer::TicksToNanoseconds(THighResTimer::GetTicks() - mStartTicks) < mNextFrame)
+		TThread::YieldTimeSlice();
+	mNextFrame += mFrameTime;
+}
+
+/** @function TFrameScheduler::TakeRedraw - Decides whether this frame is drawn, and counts the frame
+ *		@param 		playing				Whether anything on screen moves by itself, so that every frame must be drawn
+ *
+ *		@return		true if the frame should be drawn
+ */
+bool TFrameScheduler::TakeRedraw(bool playing)
+{
+	bool redraw = playing || mRedrawDue;
+	mRedrawDue = false;
+	if(redraw)
+		mFramesDrawn++;
+	else mFramesSkipped++;
+	return redraw;
+}
+
+/** @function TFrameScheduler::Sleep - Gives up the processor for a while
+ *		@param 		milliseconds		Time to sleep for, at least
+ */
+void TFrameScheduler::Sleep(uint32_t milliseconds)
+{
+	if(milliseconds == 0)
+		return;
+#if defined(_WIN32)
+	::Sleep(milliseconds);
+#else
+	timespec duration;
+	duration.tv_sec = milliseconds / 1000;
+	duration.tv_nsec = long(milliseconds % 1000) * 1000000;
+	nanosleep(&duration, NULL);
+#endif
+}
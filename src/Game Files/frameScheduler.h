@@ -0,0 +1,48 @@
+/**
+ *	frameScheduler.h - Jan van der Kamp, 2011
+ */
+#ifndef FRAMESCHEDULER_H_INCLUDED
+#define FRAMESCHEDULER_H_INCLUDED
+
+#include <pf/pflib.h>
+
+/** @class TFrameScheduler - Decides when frames start and whether they need drawing. StartWindowAnimation only wakes the
+ *							 game to the nearest millisecond, so Pace() sleeps until shortly before the frame is due and
+ *							 then waits out the rest on THighResTimer, giving up the processor to any other thread that
+ *							 wants it while it waits, keeping frames an even length apart. A frame that
+ *							 starts late moves the schedule on rather than rushing the frames after it to catch up.
+ *							 Frames are only drawn when something on screen may have changed: always while the game is
+ *							 being played, otherwise only after Invalidate() has been called.
+ *	@property 	uint64_t		mStartTicks				Time the schedule was started, in THighResTimer ticks
+ *	@property 	double			mFrameTime				Time in nanoseconds between frames
+ *	@property 	double			mNextFrame				Time in nanoseconds after mStartTicks that the next frame is due
+ *	@property 	bool			mRedrawDue				Whether something on screen has changed since the last frame drawn
+ *	@property 	uint32_t		mFramesDrawn			Number of frames that have been drawn
+ *	@property 	uint32_t		mFramesSkipped			Number of frames that have not been drawn as nothing had changed
+ */
+class TFrameScheduler
+{
+public:
+	TFrameScheduler();
+	~TFrameScheduler();
+	void			Start(uint32_t frameMicroseconds);
+	void			Pace();
+	void			Invalidate()			{ mRedrawDue = true; }
+	bool			TakeRedraw(bool playing);
+	uint32_t		GetFramesDrawn()	const	{ return mFramesDrawn; }
+	uint32_t		GetFramesSkipped()	const	{ return mFramesSkipped; }
+private:
+	// copying disallowed
+	TFrameScheduler(const TFrameScheduler &scheduler);
+	TFrameScheduler& operator=(const TFrameScheduler &scheduler);
+	static void		Sleep(uint32_t milliseconds);
+
+	uint64_t		mStartTicks;
+	double			mFrameTime;
+	double			mNextFrame;
+	bool			mRedrawDue;
+	uint32_t		mFramesDrawn;
+	uint32_t		mFramesSkipped;
+};
+
+#endif // FRAMESCHEDULER_H_INCLUDED
@@ -0,0 +1,242 @@
+/**
+ *	frameStats.cpp - Jan van der Kamp, 2011
+ */
+#include "frameStats.h"
+
+#include "timer.h"
+
+namespace {
+	const char* const	phaseNames[TFrameStats::NUM_PHASES] = { "frame", "update", "draw" };
+
+	uint32_t TicksToMicroseconds(uint64_t ticks)
+	{
+		double microseconds = THighResTimer::TicksToNanoseconds(ticks) / 1000.0;
+		return microseconds < 4294967295.0 ? uint32_t(microseconds) : 0xFFFFFFFF;
+	}
+}
+
+/** @function THistogram::Reset - Empties the histogram
+ */
+void THistogram::Reset()
+{
+	for(uint32_t b = 0; b != NUM_BUCKETS; ++b)
+		mCounts[b] = 0;
+	mTotal = 0;
+	mMax = 0;
+}
+
+/** @function THistogram::Record - Adds a time to the histogram
+ *		@param 		microseconds		Time to add
+ */
+void THistogram::Record(uint32_t microseconds)
+{
+	mCounts[BucketIndex(microseconds)]++;
+	mTotal++;
+	if(microseconds > mMax)
+		mMax = microseconds;
+}
+
+/** @function THistogram::GetPercentile - Finds the time that a percentage of the recorded times are at or below
+ *		@param 		percentile			Percentage of times, between 0 and 100
+ *
+ *		@return		Top of the bucket the percentile falls in, in microseconds, or 0 if nothing has been recorded
+ */
+uint32_t THistogram::GetPercentile(double percentile) const
+{
+	if(mTotal == 0)
+		return 0;
+
+	uint32_t wanted = uint32_t(percentile / 100.0 * mTotal + 0.999999);
+	if(wanted < 1)
+		wanted = 1;
+	uint32_t seen = 0;
+	for(uint32_t b = 0; b != NUM_BUCKETS; ++b) {
+		seen += mCounts[b];
+		if(seen >= wanted) {
+			uint32_t top = BucketTop(b);
+			return top < mMax ? top : mMax;
+		}
+	}
+	return mMax;
+}
+
+/** @function THistogram::BucketIndex - Finds the bucket a time is counted in
+ *		@param 		microseconds		Time to find the bucket of
+ *
+ *		@return		Index into mCounts
+ */
+uint32_t THistogram::BucketIndex(uint32_t microseconds)
+{
+	if(microseconds < SUB_BUCKETS)
+		return microseconds;
+
+	uint32_t highestBit = 0;
+	for(uint32_t v = microseconds; v >>= 1;)
+		highestBit++;
+	// Shift so that the top SUB_BUCKET_BITS bits are left, which is between SUB_BUCKETS / 2 and SUB_BUCKETS - 1
+	uint32_t shift = highestBit - (SUB_BUCKET_BITS - 1);
+	uint32_t subBucket = microseconds >> shift;
+	return SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + (subBucket - SUB_BUCKETS / 2);
+}
+
+/** @function THistogram::BucketTop - Finds the longest time counted in a bucket
+ *		@param 		index				Index into mCounts
+ *
+ *		@return		Longest time in the bucket, in microseconds
+ */
+uint32_t THistogram::BucketTop(uint32_t index)
+{
+	if(index < SUB_BUCKETS)
+		return index;
+
+	uint32_t shift = (index - SUB_BUCKETS) / (SUB_BUCKETS / 2) + 1;
+	uint64_t subBucket = (index - SUB_BUCKETS) % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+	uint64_t top = ((subBucket + 1) << shift) - 1;
+	return top < 0xFFFFFFFF ? uint32_t(top) : 0xFFFFFFFF;
+}
+
+
+/** @function TFrameStats::TFrameStats - Default Constructor
+ */
+TFrameStats::TFrameStats() :
+mReportFile(),
+mHitchThreshold(gameVars::hitchThreshold * 1000),
+mUpdateTicks(),
+mDrawTicks(),
+mHistory(gameVars::hitchHistoryFrames),
+mNextRecord(),
+mFrames(),
+mFramesSinceHitch(gameVars::hitchHistoryFrames),
+mHitchesWritten()
+{
+	for(uint32_t s = 0; s != MAX_STATES; ++s)
+		mStateNames[s] = "";
+}
+
+/** @function TFrameStats::~TFrameStats - Destructor, writes the report if a report file was given
+ */
+TFrameStats::~TFrameStats()
+{
+	WriteReport();
+}
+
+/** @function TFrameStats::Open - Sets the file the report is written to, hitch files are written next to it
+ *		@param 		reportFile			File to write the report to
+ *		@param 		hitchThresholdMs	Frames longer than this many milliseconds are hitches
+ */
+void TFrameStats::Open(const char* reportFile, uint32_t hitchThresholdMs)
+{
+	mReportFile = reportFile;
+	mHitchThreshold = hitchThresholdMs * 1000;
+}
+
+/** @function TFrameStats::SetStateName - Names a game state for the report
+ *		@param 		state				Game state, less than MAX_STATES
+ *		@param 		name				Name of the state
+ */
+void TFrameStats::SetStateName(uint16_t state, const char* name)
+{
+	if(state < MAX_STATES)
+		mStateNames[state] = name;
+}
+
+/** @function TFrameStats::EndFrame - Records a frame, along with the update and draw times added since the last frame.
+ *									 If the frame was a hitch, the last frames are written out.
+ *		@param 		frameTicks			Time between the start of this frame and the last, in THighResTimer ticks
+ *		@param 		state				Game state during the frame, less than MAX_STATES
+ *		@param 		numBalloons			Balloons in play
+ *		@param 		numBullets			Bullets in play
+ */
+void TFrameStats::EndFrame(uint64_t frameTicks, uint16_t state, uint32_t numBalloons, uint32_t numBullets)
+{
+	if(state >= MAX_STATES)
+		state = MAX_STATES - 1;
+
+	TFrameRecord& record = mHistory[mNextRecord];
+	record.mFrame = mFrames++;
+	record.mState = state;
+	record.mTimes[FRAME] = TicksToMicroseconds(frameTicks);
+	record.mTimes[UPDATE] = TicksToMicroseconds(mUpdateTicks);
+	record.mTimes[DRAW] = TicksToMicroseconds(mDrawTicks);
+	record.mBalloons = numBalloons;
+	record.mBullets = numBullets;
+	mNextRecord = (mNextRecord + 1) % mHistory.size();
+	mUpdateTicks = 0;
+	mDrawTicks = 0;
+
+	for(uint32_t p = 0; p != NUM_PHASES; ++p) {
+		mHistograms[state][p].Record(record.mTimes[p]);
+		mHistograms[MAX_STATES][p].Record(record.mTimes[p]);
+	}
+
+	// Write the frames leading up to a hitch, but only once the frames from the last one have been replaced
+	mFramesSinceHitch++;
+	if(record.mTimes[FRAME] > mHitchThreshold && mFramesSinceHitch >= mHistory.size() &&
+	   mReportFile.has_data() && mHitchesWritten < gameVars::maxHitchFiles) {
+		WriteHitch();
+		mHitchesWritten++;
+		mFramesSinceHitch = 0;
+	}
+}
+
+/** @function TFrameStats::WriteHitch - Writes the last frames to a CSV file named after the report file
+ */
+void TFrameStats::WriteHitch() const
+{
+	char filename[512];
+	sprintf(filename, "%.480s.hitch%u.csv", mReportFile.c_str(), mHitchesWritten);
+	FILE* file = fopen(filename, "w");
+	if(!file)
+		return;
+
+	fprintf(file, "frame,state,frame_us,update_us,draw_us,balloons,bullets\n");
+	uint32_t recorded = mFrames < mHistory.size() ? mFrames : uint32_t(mHistory.size());
+	for(uint32_t r = 0; r != recorded; ++r) {
+		const TFrameRecord& record = mHistory[(mNextRecord + mHistory.size() - recorded + r) % mHistory.size()];
+		fprintf(file, "%u,%s,%u,%u,%u,%u,%u\n", record.mFrame, mStateNames[record.mState], record.mTimes[FRAME],
+				record.mTimes[UPDATE], record.mTimes[DRAW], record.mBalloons, record.mBullets);
+	}
+	fclose(file);
+}
+
+/** @function TFrameStats::WriteReport - Writes p50/p95/p99/max of each phase for each named game state and the whole session
+ *										to the report file as JSON. Times are in microseconds.
+ *
+ *		@return		true if the file could be written
+ */
+bool TFrameStats::WriteReport() const
+{
+	if(!mReportFile.has_data())
+		return false;
+	FILE* file = fopen(mReportFile.c_str(), "w");
+	if(!file)
+		return false;
+
+	fprintf(file, "{\n\t\"build\": \"%s %s\",\n\t\"frames\": %u,\n\t\"hitchThresholdUs\": %u,\n\t\"hitches\": %u,\n",
+			__DATE__, __TIME__, mFrames, mHitchThreshold, mHitchesWritten);
+	for(uint32_t s = 0; s != MAX_STATES; ++s)
+		if(mStateNames[s][0])
+			WriteHistograms(file, mStateNames[s], mHistograms[s], false);
+	WriteHistograms(file, "session", mHistograms[MAX_STATES], true);
+	fprintf(file, "}\n");
+	fclose(file);
+	return true;
+}
+
+/** @function TFrameStats::WriteHistograms - Writes the percentiles of every phase for one game state
+ *		@param 		file				File to write to
+ *		@param 		name				Name of the game state
+ *		@param 		histograms			Histogram of each phase
+ *		@param 		last				Whether this is the last entry of the report
+ */
+void TFrameStats::WriteHistograms(FILE* file, const char* name, const THistogram* histograms, bool last) const
+{
+	fprintf(file, "\t\"%s\": {\n", name);
+	for(uint32_t p = 0; p != NUM_PHASES; ++p) {
+		const THistogram& histogram = histograms[p];
+		fprintf(file, "\t\t\"%s\": { \"count\": %u, \"p50\": %u, \"p95\": %u, \"p99\": %u, \"max\": %u }%s\n",
+				phaseNames[p], histogram.GetTotal(), histogram.GetPercentile(50.0), histogram.GetPercentile(95.0),
+				histogram.GetPercentile(99.0), histogram.GetMax(), p + 1 == NUM_PHASES ? "" : ",");
+	}
+	fprintf(file, "\t}%s\n", last ? "" : ",");
+}
@@ -0,0 +1,114 @@
+/**
+ *	frameStats.h - Jan van der Kamp, 2011
+ */
+#ifndef FRAMESTATS_H_INCLUDED
+#define FRAMESTATS_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+#include <cstdio>
+
+#include "gameVariables.h"
+
+/** @class THistogram - Counts times in buckets which get wider as the times get longer, like an HDR histogram. Times under
+ *						SUB_BUCKETS microseconds each get a bucket of their own, above that every power of two is split into
+ *						SUB_BUCKETS / 2 buckets, so any percentile read back is within about 6% of the real value while
+ *						the histogram stays a fixed size and recording never allocates.
+ *	@property 	uint32_t		mCounts[NUM_BUCKETS]	Number of times recorded in each bucket
+ *	@property 	uint32_t		mTotal					Number of times recorded
+ *	@property 	uint32_t		mMax					Longest time recorded, in microseconds
+ */
+class THistogram
+{
+public:
+	THistogram()	{ Reset(); }
+	void			Reset();
+	void			Record(uint32_t microseconds);
+	uint32_t		GetPercentile(double percentile)	const;
+	uint32_t		GetMax()		const	{ return mMax; }
+	uint32_t		GetTotal()		const	{ return mTotal; }
+
+	enum { SUB_BUCKET_BITS = 5, SUB_BUCKETS = 1 << SUB_BUCKET_BITS, NUM_BUCKETS = SUB_BUCKETS + (32 - SUB_BUCKET_BITS) * SUB_BUCKETS / 2 };
+private:
+	static uint32_t	BucketIndex(uint32_t microseconds);
+	static uint32_t	BucketTop(uint32_t index);
+
+	uint32_t		mCounts[NUM_BUCKETS];
+	uint32_t		mTotal;
+	uint32_t		mMax;
+};
+
+/** @class TFrameStats - Keeps histograms of frame, update and draw times for the whole session and for each game state, and
+ *						 remembers the timings and ball counts of the last gameVars::hitchHistoryFrames frames. When a frame
+ *						 takes longer than the hitch threshold those frames are written to a CSV file, so that a hitch can be
+ *						 looked into after the fact. Set the "framestats" config setting to a file to write a report of
+ *						 p50/p95/p99/max times to when the game closes, hitches are written next to it. The "hitchms" config
+ *						 setting overrides gameVars::hitchThreshold.
+ *
+ *	@property 	str							mReportFile				File to write the report to, nothing is written if empty
+ *	@property 	uint32_t					mHitchThreshold			Frames longer than this many microseconds are hitches
+ *	@property 	const char*					mStateNames[MAX_STATES]	Name of each game state for the report
+ *	@property 	THistogram					mHistograms[MAX_STATES + 1][NUM_PHASES]		Times of each phase in each state,
+ *																		the last row is for every state together
+ *	@property 	uint64_t					mUpdateTicks			Time spent updating so far this frame
+ *	@property 	uint64_t					mDrawTicks				Time spent drawing so far this frame
+ *	@property 	std::vector<TFrameRecord>	mHistory				The last frames, used as a ring buffer
+ *	@property 	uint32_t					mNextRecord				Index in mHistory of the next frame to record
+ *	@property 	uint32_t					mFrames					Number of frames recorded
+ *	@property 	uint32_t					mFramesSinceHitch		Frames since a hitch was last written, so that a run of slow
+ *																		frames doesn't write a file every frame
+ *	@property 	uint32_t					mHitchesWritten			Number of hitch files written
+ */
+class TFrameStats
+{
+public:
+	enum { MAX_STATES = 4 };
+	enum { FRAME = 0, UPDATE, DRAW, NUM_PHASES };
+
+	TFrameStats();
+	~TFrameStats();
+	void		Open(const char* reportFile, uint32_t hitchThresholdMs);
+	void		SetStateName(uint16_t state, const char* name);
+	void		AddUpdateTicks(uint64_t ticks)		{ mUpdateTicks += ticks; }
+	void		AddDrawTicks(uint64_t ticks)		{ mDrawTicks += ticks; }
+	void		EndFrame(uint64_t frameTicks, uint16_t state, uint32_t numBalloons, uint32_t numBullets);
+	bool		WriteReport()	const;
+	bool		IsOpen()		const	{ return mReportFile.has_data(); }
+	const THistogram&	GetSessionHistogram(uint16_t phase)	const	{ return mHistograms[MAX_STATES][phase]; }
+private:
+	/** @struct TFrameRecord - Timings and ball counts of one frame
+	 *	@property 	uint32_t	mFrame				Number of the frame since the game started
+	 *	@property 	uint16_t	mState				Game state during the frame
+	 *	@property 	uint32_t	mTimes[NUM_PHASES]	Time taken by each phase, in microseconds
+	 *	@property 	uint32_t	mBalloons			Balloons in play
+	 *	@property 	uint32_t	mBullets			Bullets in play
+	 */
+	struct TFrameRecord
+	{
+		uint32_t	mFrame;
+		uint16_t	mState;
+		uint32_t	mTimes[NUM_PHASES];
+		uint32_t	mBalloons;
+		uint32_t	mBullets;
+	};
+
+	// copying disallowed
+	TFrameStats(const TFrameStats &frameStats);
+	TFrameStats& operator=(const TFrameStats &frameStats);
+	void		WriteHitch()	const;
+	void		WriteHistograms(FILE* file, const char* name, const THistogram* histograms, bool last) const;
+
+	str							mReportFile;
+	uint32_t					mHitchThreshold;
+	const char*					mStateNames[MAX_STATES];
+	THistogram					mHistograms[MAX_STATES + 1][NUM_PHASES];
+	uint64_t					mUpdateTicks;
+	uint64_t					mDrawTicks;
+	std::vector<TFrameRecord>	mHistory;
+	uint32_t					mNextRecord;
+	uint32_t					mFrames;
+	uint32_t					mFramesSinceHitch;
+	uint32_t					mHitchesWritten;
+};
+
+#endif // FRAMESTATS_H_INCLUDED
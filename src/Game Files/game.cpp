@@ -3,79 +3,261 @@
  */
 #include <pf/pflib.h>
 #include "pf/debug.h"
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 
 #include "game.h"
+#include "benchmark.h"
+#include "difficultyTuner.h"
+#include "versusMatch.h"
+#include "collisionChecker.h"
+#include "timer.h"
+#include "trace.h"
 #include "../settings.h"
 #include "../globaldefines.h"
 
-using std::vector;
-
 PFTYPEIMPL_DC(TGame);
 
+namespace {
+	// Texture loads are traced under the name of the texture
+	TTextureRef LoadTexture(const char* name)
+	{
+		TRACE_SCOPE(name);
+		return TTexture::Get(name);
+	}
+
+	TAnimatedTextureRef LoadAnimatedTexture(const char* name)
+	{
+		TRACE_SCOPE(name);
+		return TAnimatedTexture::Get(name);
+	}
+}
+
 /** @function TGame::TGame - Default Constructor	Constructs game objects and other member variables with default values given in
  *													gameVariables.h
  */
 TGame::TGame() :
-mStateVariables(gameVars::initialMinWaitForBalloon, 
-			    gameVars::initialMaxWaitForBalloon,
-				gameVars::balloonsBurstToLevelUp,
-				gameVars::waitTimeDecrease,
-				gameVars::initialBalloonVelocity, 
-				gameVars::balloonVelocityIncrease,
-				gameVars::initialNumColoursInPlay),
-mBalloonManager(gameVars::balloonScale,
-				mStateVariables),
- mCannon(gameVars::cannonPosition,
-		 gameVars::bulletScale,
-		 gameVars::initialNumColoursInPlay),
-mBarrier(gameVars::initialBarrierPosition, 
-		 gameVars::barrierRiseSpeed,	
-		 gameVars::initialBarrierParallaxDifference, 
-		 gameVars::barrierLevelHeight),
-mToUpdate(),
-mToDraw(),
+mStateVariables(),
+mSimulation(mStateVariables),
+mShownSimulation(mStateVariables),
 mMessageText("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
 mInfoButton("",gameVars::messageW,gameVars::messageH*2, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
-mBasicButton("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
+mPauseButton("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
+mNewGameButton("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
+mHelpButton("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
+mQuitButton("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
 mPausedButton("",gameVars::messageW,gameVars::messageH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
 mHelpTextButton("", gameVars::helpTextW, gameVars::helpTextH, TTextGraphic::EFlags::kHAlignCenter,"fonts/DomCasualStd-Bold.mvec",gameVars::textSize),
 mHelpTextStr1(""), mHelpTextStr2(""), mPauseButtonStr(""), mUnpauseButtonStr(""), mHelpButtonStr(""), mNewGameButtonStr(""), mQuitButtonStr(""), mScoreStr(""), 
-mLevelStr(""), mGameOverStr(""), mPausedStr(""), mGameState(HELP), mBalloonTextures(), mBalloonBurstTextures(), mBarrierTextures(), mCannonTexture(), mHudBackground(), 
-mLastLoopTime()
+mLevelStr(""), mGameOverStr(""), mPausedStr(""), mGameState(HELP), mBallAssets(), mBarrierTextures(), mCannonTexture(), mHudBackground(), 
+mLastLoopTicks(),
+mLeftoverNanoseconds(),
+mInputQueue(),
+mRecorder(),
+mReplayer(),
+mReplaying(false),
+mReplayRealTime(true),
+mReplayTimeBank(),
+mReplayTicks(),
+mReplayStartTicks(),
+mScenario(),
+mFrameStats(),
+mLastFrameTicks(),
+mFrameScheduler(),
+mAnimating(false),
+mDrawnState(HELP),
+mAllocations(),
+mShownScore(-1),
+mShownLevel(-1),
+mPerfStats(mFrameStats, mAllocations),
+mSnapshot(),
+mSnapshotFile(""),
+mSnapshotFrame(),
+mStreamEncoder(),
+mStreamDecoder(),
+mStreaming(false),
+mStreamViewing(false),
+mStreamViewTime(),
+mJobSystem(),
+mCommands(),
+mSimulationThread(mSimulation, mStateVariables),
+mThreaded(false),
+mGamesStarted()
 {
+	uint64_t startupStart = THighResTimer::GetTicks();
+
+	// Trace from the start if asked to, so that loading is traced too
+	str traceFile = TPlatform::GetConfig("trace");
+	if(traceFile.has_data()) {
+		if(TTrace::Open(traceFile.c_str()))
+			TTrace::SetThreadName("main");
+		else DEBUG_WRITE(("Couldn't open trace %s", traceFile.c_str()));
+	}
+
 	TPlatform::SetConfig( "vsync", "1" );
 	TTextGraphic::SetBoldOverride("fonts/DomCasualStd-Bold.mvec", true, .1f);
 
-	// Load strings and set text
+	// Load strings and set text, each button keeps its own title so that drawing never has to lay text out
 	LoadStrings();
-	mInfoButton.SetText(mScoreStr+": 0\n"+mLevelStr+": 1");
+	mPauseButton.SetText(mPauseButtonStr);
+	mNewGameButton.SetText(mNewGameButtonStr);
+	mHelpButton.SetText(mHelpButtonStr);
+	mQuitButton.SetText(mQuitButtonStr);
+	mPausedButton.SetText(mUnpauseButtonStr);
 	mHelpTextButton.SetText(mHelpTextStr1);
 
+	// Seed the game before anything uses it, from the recording if one is being replayed
+	str replayFile = TPlatform::GetConfig("replay");
+	if(replayFile.has_data() && mReplayer.Open(replayFile.c_str())) {
+		mReplaying = true;
+		mReplayRealTime = (TPlatform::GetConfig("replayspeed") != str("fast"));
+		mSimulation.Seed(mReplayer.GetSeed());
+	}
+	else {
+		mSimulation.Seed(TPlatform::GetInstance()->Rand());
+		str recordFile = TPlatform::GetConfig("record");
+		if(recordFile.has_data())
+			mRecorder.Open(recordFile.c_str(), mSimulation.GetRandomState());
+	}
+
 	// Load and assign assets to game objects
+	uint64_t loadStart = THighResTimer::GetTicks();
 	LoadAssets();
-	mBalloonManager.AssignAssets(mBalloonTextures, mBalloonBurstTextures);
-	mCannon.AssignAssets(mCannonTexture, mBalloonTextures, mBalloonBurstTextures);
-	mBarrier.AssignAssets(mBarrierTextures);
+	double assetLoadTime = THighResTimer::TicksToNanoseconds(THighResTimer::GetTicks() - loadStart) / 1000000.0;
+	mSimulation.AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+	mShownSimulation.AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+
+	// Time the game's hot paths if asked to, before the game starts
+	str benchmarkFile = TPlatform::GetConfig("benchmark");
+	if(benchmarkFile.has_data()) {
+		TBenchmark benchmark(mBallAssets, mBarrierTextures, mCannonTexture);
+		benchmark.Run();
+		benchmark.WriteResults(benchmarkFile.c_str());
+	}
 
-	mToUpdate.push_back(&mCannon);
-	mToUpdate.push_back(&mBarrier);
-	mToUpdate.push_back(&mBalloonManager);
-	
-	mToDraw.push_back(&mCannon);
-	mToDraw.push_back(&mBalloonManager);
+	// Sweep difficulty settings with headless games if asked to, before the game starts
+	str tunerFile = TPlatform::GetConfig("tuner");
+	if(tunerFile.has_data()) {
+		TDifficultyTuner tuner(mBallAssets, mBarrierTextures, mCannonTexture);
+		if(tuner.Run(tunerFile.c_str()))
+			tuner.WriteResults();
+	}
+
+	// Play a versus game between two bots over a simulated network if asked to, before the game starts
+	str versusFile = TPlatform::GetConfig("versus");
+	if(versusFile.has_data()) {
+		TVersusMatch match(mBallAssets, mBarrierTextures, mCannonTexture);
+		if(match.Run(versusFile.c_str()))
+			match.WriteResults();
+	}
+
+	// Check the collision code against its reference if asked to, before the game starts
+	str checkFile = TPlatform::GetConfig("collisioncheck");
+	if(checkFile.has_data()) {
+		TCollisionChecker checker(mBallAssets, mBarrierTextures, mCannonTexture);
+		if(checker.Run(checkFile.c_str()))
+			checker.WriteResults();
+	}
 
-	// height that barrier will reach when game over occurs. 
-	// This should coincide with the cannons loaded bullet becoming covered by the barrier.
-	TReal gameOverHeight = mCannon.GetPosition().y - mCannon.GetBulletRadius();
-	mBarrier.SetGameOverHeight(gameOverHeight);
+	// Start from a checkpoint if one has been given. A recording has to start from a new game, so stop recording.
+	str checkpointFile = TPlatform::GetConfig("checkpoint");
+	if(checkpointFile.has_data() && !mReplaying) {
+		if(mSnapshot.Load(checkpointFile.c_str()) && mSnapshot.Restore(mSimulation)) {
+			mRecorder.Close();
+			mGameState = UNPAUSED;
+		}
+		else DEBUG_WRITE(("Couldn't restore checkpoint %s", checkpointFile.c_str()));
+	}
+	if(mReplaying) {
+		mSnapshotFile = TPlatform::GetConfig("snapshot");
+		str snapshotFrame = TPlatform::GetConfig("snapshotat");
+		mSnapshotFrame = snapshotFrame.has_data() ? uint32_t(atoi(snapshotFrame.c_str())) : 0;
+	}
 
-	// Set game boundary
-	TBall::SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+	// Watch a state stream written earlier instead of playing if one has been given, otherwise write the game out as one
+	// if asked to
+	str streamViewFile = TPlatform::GetConfig("streamview");
+	if(streamViewFile.has_data()) {
+		if(mStreamDecoder.OpenFile(streamViewFile.c_str())) {
+			mStreamViewing = true;
+			mReplaying = false;
+			mRecorder.Close();
+			mGameState = UNPAUSED;
+		}
+		else DEBUG_WRITE(("Couldn't open state stream %s", streamViewFile.c_str()));
+	}
+	else {
+		str streamFile = TPlatform::GetConfig("stream");
+		if(streamFile.has_data()) {
+			mStreaming = mStreamEncoder.OpenFile(streamFile.c_str());
+			if(!mStreaming)
+				DEBUG_WRITE(("Couldn't open state stream %s", streamFile.c_str()));
+		}
+	}
 
-	mLastLoopTime = TPlatform::GetInstance()->GetTime();
+	// Go straight into the game if a stress scenario has been asked for
+	str scenarioFile = TPlatform::GetConfig("scenario");
+	if(scenarioFile.has_data() && mScenario.Start(scenarioFile.c_str())) {
+		mSimulation.SetKeepFullPlayArea(true);
+		mSimulation.SetFixedNumColours(mScenario.GetNumColours());
+		mGameState = UNPAUSED;
+	}
+
+	// Keep frame statistics under the names of the game states
+	mFrameStats.SetStateName(UNPAUSED, "unpaused");
+	mFrameStats.SetStateName(PAUSED, "paused");
+	mFrameStats.SetStateName(HELP, "help");
+	mFrameStats.SetStateName(GAMEOVER, "gameover");
+	str frameStatsFile = TPlatform::GetConfig("framestats");
+	if(frameStatsFile.has_data()) {
+		str hitchMs = TPlatform::GetConfig("hitchms");
+		mFrameStats.Open(frameStatsFile.c_str(), hitchMs.has_data() ? uint32_t(atoi(hitchMs.c_str())) : gameVars::hitchThreshold);
+	}
+
+	// Split each update into jobs shared between worker threads if asked to
+	str jobs = TPlatform::GetConfig("jobs");
+	if(jobs.has_data()) {
+		int32_t numWorkers = atoi(jobs.c_str());
+		if(numWorkers <= 0)
+			numWorkers = int32_t(TThread::GetNumCores()) - 1;
+		if(!mJobSystem.Start(uint32_t(numWorkers)))
+			DEBUG_WRITE(("Couldn't start every job system worker, running jobs on %d threads", mJobSystem.GetNumThreads()));
+		mSimulation.SetJobSystem(&mJobSystem);
+		str jobTraceFile = TPlatform::GetConfig("jobtrace");
+		if(jobTraceFile.has_data())
+			mSimulation.GetFrameGraph().Open(jobTraceFile.c_str());
+	}
+
+	// Update the game on a thread of its own if asked to. Replays, stream viewing and stress scenarios drive and time the
+	// game frame by frame, so they keep it on this thread.
+	if(TPlatform::GetConfig("simthread").has_data() && !mReplaying && !mStreamViewing && !mScenario.IsRunning()) {
+		mCommands.reserve(gameVars::simulationCommandCapacity);
+		mThreaded = mSimulationThread.Start(mStreaming ? &mStreamEncoder : NULL);
+		if(mThreaded)
+			TakeSimulationFrame();
+		else DEBUG_WRITE(("Couldn't start the simulation thread"));
+	}
+
+	mAllocations.SetAsserting(TPlatform::GetConfig("allocassert").has_data());
+	UpdateInfoText();
+
+	mLastLoopTicks = THighResTimer::GetTicks();
+	mPerfStats.SetLoadTimes(assetLoadTime, THighResTimer::TicksToNanoseconds(mLastLoopTicks - startupStart) / 1000000.0);
+	mPerfStats.Register(TWindowManager::GetInstance()->GetScript()->GetState());
+	mReplayStartTicks = mLastLoopTicks;
+	mLastFrameTicks = mLastLoopTicks;
 }
 
 
+/** @function TGame::~TGame - Destructor, writes the trace out once the simulation thread has stopped recording into it
+ */
+TGame::~TGame()
+{
+	mSimulationThread.Stop();
+	TTrace::Close();
+}
+
 /** @function TGame::Init - This function initializes the window and is called by the system only in Lua initialization
  *		@param 		style				Style of the window
  */
@@ -86,42 +268,100 @@ void TGame::Init(TWindowStyle&  style)
 	FindParentModal()->SetDefaultFocus(this);
 	//FindParentModal()->SetWindowSize(800,600);
 
-	StartWindowAnimation( 16 ); 
+	StartAnimating();
+}
+
+/** @function TGame::StartAnimating - Starts OnTaskAnimate being called, with frames paced by mFrameScheduler
+ */
+void TGame::StartAnimating()
+{
+	StartWindowAnimation( gameVars::animationInterval );
+	mFrameScheduler.Start( gameVars::targetFrameTime );
+	mAnimating = true;
+	// Time spent idle isn't a slow frame
+	mLastFrameTicks = THighResTimer::GetTicks();
+}
+
+/** @function TGame::IsPlaying - Checks whether anything on screen can change without the player clicking, so that every
+ *								 frame has to be run and drawn
+ *
+ *		@return		true if the game is being played, replayed, watched, or is running a stress scenario
+ */
+bool TGame::IsPlaying() const
+{
+	return mGameState == UNPAUSED || mReplaying || mScenario.IsRunning();
+}
+
+/** @function TGame::IsCollectingFrameStats - Checks whether frame times are wanted, by the frame stats file or by the
+ *											   stats table at any level but OFF
+ *
+ *		@return		true if frames should be recorded in mFrameStats
+ */
+bool TGame::IsCollectingFrameStats() const
+{
+	return mFrameStats.IsOpen() || mPerfStats.GetLevel() != TPerfStats::OFF;
+}
+
+/** @function TGame::GetShownSimulation - Gets the game as it is to be drawn
+ *
+ *		@return		mShownSimulation when the game is threaded, otherwise mSimulation
+ */
+const TSimulation& TGame::GetShownSimulation() const
+{
+	return mThreaded ? mShownSimulation : mSimulation;
 }
 
 /** @function TGame::LoadAssets - This function loads any image assets used in the game
  */
 void TGame::LoadAssets()
 {
-	mBalloonTextures.push_back(TTexture::Get("images/balloon1"));
-	mBalloonTextures.push_back(TTexture::Get("images/balloon2"));
-	mBalloonTextures.push_back(TTexture::Get("images/balloon3"));
-	mBalloonTextures.push_back(TTexture::Get("images/balloon4"));
-	mBalloonTextures.push_back(TTexture::Get("images/balloon5"));
-	mBalloonTextures.push_back(TTexture::Get("images/balloon6"));
+	TRACE_SCOPE("TGame::LoadAssets");
+	mBallAssets.mTextures.push_back(LoadTexture("images/balloon1"));
+	mBallAssets.mTextures.push_back(LoadTexture("images/balloon2"));
+	mBallAssets.mTextures.push_back(LoadTexture("images/balloon3"));
+	mBallAssets.mTextures.push_back(LoadTexture("images/balloon4"));
+	mBallAssets.mTextures.push_back(LoadTexture("images/balloon5"));
+	mBallAssets.mTextures.push_back(LoadTexture("images/balloon6"));
 	
-	mBarrierTextures.push_back(TTexture::Get("images/barrier1"));
-	mBarrierTextures.push_back(TTexture::Get("images/barrier2"));
-	mBarrierTextures.push_back(TTexture::Get("images/barrier3"));
-	mBarrierTextures.push_back(TTexture::Get("images/barrier4"));
-	mBarrierTextures.push_back(TTexture::Get("images/barrier5"));
-	mBarrierTextures.push_back(TTexture::Get("images/barrier6"));
-
-	mBalloonBurstTextures.push_back(TAnimatedTexture::Get("anim/balloon-burst1.xml"));
-	mBalloonBurstTextures.push_back(TAnimatedTexture::Get("anim/balloon-burst2.xml"));
-	mBalloonBurstTextures.push_back(TAnimatedTexture::Get("anim/balloon-burst3.xml"));
-	mBalloonBurstTextures.push_back(TAnimatedTexture::Get("anim/balloon-burst4.xml"));
-	mBalloonBurstTextures.push_back(TAnimatedTexture::Get("anim/balloon-burst5.xml"));
-	mBalloonBurstTextures.push_back(TAnimatedTexture::Get("anim/balloon-burst6.xml"));
-
-	mCannonTexture = TTexture::Get("images/arrow");
-	mHudBackground = TSprite::Create(0, TTexture::Get("images/hudBackground"));
+	mBarrierTextures.push_back(LoadTexture("images/barrier1"));
+	mBarrierTextures.push_back(LoadTexture("images/barrier2"));
+	mBarrierTextures.push_back(LoadTexture("images/barrier3"));
+	mBarrierTextures.push_back(LoadTexture("images/barrier4"));
+	mBarrierTextures.push_back(LoadTexture("images/barrier5"));
+	mBarrierTextures.push_back(LoadTexture("images/barrier6"));
+
+	mBallAssets.mBurstTextures.push_back(LoadAnimatedTexture("anim/balloon-burst1.xml"));
+	mBallAssets.mBurstTextures.push_back(LoadAnimatedTexture("anim/balloon-burst2.xml"));
+	mBallAssets.mBurstTextures.push_back(LoadAnimatedTexture("anim/balloon-burst3.xml"));
+	mBallAssets.mBurstTextures.push_back(LoadAnimatedTexture("anim/balloon-burst4.xml"));
+	mBallAssets.mBurstTextures.push_back(LoadAnimatedTexture("anim/balloon-burst5.xml"));
+	mBallAssets.mBurstTextures.push_back(LoadAnimatedTexture("anim/balloon-burst6.xml"));
+
+	// Balls are culled by the size of the largest sprite they could be drawn with
+	for(std::vector<TTextureRef>::const_iterator texture = mBallAssets.mTextures.begin(); texture != mBallAssets.mTextures.end(); ++texture)
+		mBallAssets.mDrawExtent = std::max(mBallAssets.mDrawExtent, std::max((*texture)->GetWidth(), (*texture)->GetHeight()) / 2);
+	for(std::vector<TAnimatedTextureRef>::const_iterator texture = mBallAssets.mBurstTextures.begin(); 
+		texture != mBallAssets.mBurstTextures.end(); ++texture)
+		mBallAssets.mDrawExtent = std::max(mBallAssets.mDrawExtent, std::max((*texture)->GetWidth(), (*texture)->GetHeight()) / 2);
+
+	// Burst balls are removed once their animation has played, which is worked out once here rather than each frame
+	for(std::vector<TAnimatedTextureRef>::const_iterator texture = mBallAssets.mBurstTextures.begin(); 
+		texture != mBallAssets.mBurstTextures.end(); ++texture)
+		mBallAssets.mBurstDuration = std::max(mBallAssets.mBurstDuration, 
+											  uint32_t((*texture)->GetNumFrames()) * gameVars::balloonBurstFrameTime);
+
+	mCannonTexture = LoadTexture("images/arrow");
+	mHudBackground = TSprite::Create(0, LoadTexture("images/hudBackground"));
 	mHudBackground->GetDrawSpec() = TDrawSpec(TVec2(SCREEN_WIDTH/2, SCREEN_HEIGHT/2));
 
-	mBasicButton.SetImage(TSprite::Create(0, TTexture::Get("images/button")));
-	mPausedButton.SetImage(TSprite::Create(0, TTexture::Get("images/pausedButton")));
-	mHelpTextButton.SetImage(TSprite::Create(0, TTexture::Get("images/helpTextBox")));
-	mInfoButton.SetImage(TSprite::Create(0, TTexture::Get("images/infoBG")));
+	TSpriteRef buttonImage = TSprite::Create(0, LoadTexture("images/button"));
+	mPauseButton.SetImage(buttonImage);
+	mNewGameButton.SetImage(buttonImage);
+	mHelpButton.SetImage(buttonImage);
+	mQuitButton.SetImage(buttonImage);
+	mPausedButton.SetImage(TSprite::Create(0, LoadTexture("images/pausedButton")));
+	mHelpTextButton.SetImage(TSprite::Create(0, LoadTexture("images/helpTextBox")));
+	mInfoButton.SetImage(TSprite::Create(0, LoadTexture("images/infoBG")));
 }
 
 /** @function TGame::LoadStrings - This function loads strings from the global string table,
@@ -150,193 +390,455 @@ void TGame::LoadStrings()
 	mPausedStr = stringTable->GetString("paused");
 }
 
-/** @function TGame::Reset - This function resets mBalloonManager & mBarrier to default values,
+/** @function TGame::Reset - This function resets mSimulation to default values,
  *							 and should be called when a new game is started.
  */
 void TGame::Reset()
 {	
-	mBalloonManager.Reset(gameVars::initialMinWaitForBalloon, 
-						  gameVars::initialMaxWaitForBalloon, 
-						  gameVars::initialBalloonVelocity, 						 
-						  gameVars::balloonsBurstToLevelUp);
-	mBarrier.Reset();
+	if(mThreaded) {
+		TSimulationCommand command = { TSimulationCommand::RESET, 0.0, TPlayerInput() };
+		mCommands.push_back(command);
+		mGamesStarted++;
+	}
+	else mSimulation.Reset(mStateVariables);
 }
 
-/** @function TGame::OnTaskAnimate - Since StartWindowAnimation was called with a value of 16, this function
- *									 will be called every 16 milliseconds to give a frame rate of around 60 fps.
+/** @function TGame::OnTaskAnimate - Called as often as the platform can while animating, this function waits for mFrameScheduler
+ *									 to say the next frame is due, giving a steady gameVars::targetFrameTime between frames.
+ *									 The screen is only redrawn if something on it may have changed, and once the game is
+ *									 idle, animation stops until a click starts it again.
  */
 bool TGame::OnTaskAnimate()
 {
-// Update the screen
-	TWindowManager::GetInstance()->InvalidateScreen();
-
-// Calculate elapsed time since the last time we were called
-	uint32_t thisLoop = TPlatform::GetInstance()->GetTime();
-	uint32_t elapsedTime = thisLoop - mLastLoopTime;
-	mLastLoopTime = thisLoop;
+	mFrameScheduler.Pace();
+	TRACE_SCOPE("TGame::OnTaskAnimate");
+
+// Calculate elapsed time since the last time we were called. The high resolution counter is 64 bit, so unlike
+// TPlatform::GetTime() it doesn't wrap after 49 days. The time is taken to whole microseconds, which is what a recording
+// holds, carrying the rest over to the next frame, so the game is updated identically whether played or replayed.
+	uint64_t lastLoop = mLastLoopTicks;
+	uint64_t thisLoop = THighResTimer::GetTicks();
+	uint64_t elapsedNanoseconds = uint64_t(THighResTimer::TicksToNanoseconds(thisLoop - lastLoop)) + mLeftoverNanoseconds;
+	mLastLoopTicks = thisLoop;
+	uint32_t elapsedMicroseconds;
+	if(elapsedNanoseconds >= uint64_t(gameVars::maxFrameTime) * 1000000) {
+		elapsedMicroseconds = gameVars::maxFrameTime * 1000;
+		mLeftoverNanoseconds = 0;
+	}
+	else {
+		elapsedMicroseconds = uint32_t(elapsedNanoseconds / 1000);
+		mLeftoverNanoseconds = uint32_t(elapsedNanoseconds % 1000);
+	}
+	double elapsedTime = elapsedMicroseconds / 1000.0;
+
+// The last frame, its update and its draw are over, so check it allocated nothing if it was spent playing, and record it
+	bool steadyState = (mGameState == UNPAUSED && !mScenario.IsRunning());
+	mAllocations.EndFrame(steadyState);
+	uint64_t frameStart = THighResTimer::GetTicks();
+	const TSimulation& shown = GetShownSimulation();
+	bool collectingFrameStats = IsCollectingFrameStats();
+	if(collectingFrameStats)
+		mFrameStats.EndFrame(frameStart - mLastFrameTicks, mGameState,
+							 uint32_t(shown.GetBalloonManager().GetBalloons().size()),
+							 uint32_t(shown.GetCannon().GetBulletsFired().size()));
+	TRACE_COUNTER("balloons", shown.GetBalloonManager().GetBalloons().size());
+	TRACE_COUNTER("bullets", shown.GetCannon().GetBulletsFired().size());
+	mPerfStats.EndFrame(uint32_t(shown.GetBalloonManager().GetBalloons().size()),
+						uint32_t(shown.GetCannon().GetBulletsFired().size()), mAllocations.GetFrameAllocations());
+	mLastFrameTicks = frameStart;
+	mAllocations.BeginFrame(steadyState);
+
+	if(mStreamViewing) {
+		TQueuedInput input;
+		while(mInputQueue.Pop(input))
+			HandleInput(input.mType, input.mPoint);
+		ViewStream( elapsedTime );
+	}
+	else if(mReplaying)
+		Replay( elapsedMicroseconds );
+	else
+		Play( elapsedMicroseconds, lastLoop );
+
+// Hand this frame's work to the simulation thread, and take whatever it has finished since the last frame
+	if(mThreaded) {
+		mSimulationThread.Submit(mCommands);
+		TakeSimulationFrame();
+	}
 
-	Update( elapsedTime );
+// Update the screen if anything on it may have changed, and stop animating if nothing will until the mouse is clicked
+	bool playing = IsPlaying();
+	if(mFrameScheduler.TakeRedraw(playing || mGameState != mDrawnState))
+		TWindowManager::GetInstance()->InvalidateScreen();
+	if(!playing && mInputQueue.IsEmpty()) {
+		StopWindowAnimation();
+		mAnimating = false;
+	}
 
+	if(collectingFrameStats)
+		mFrameStats.AddUpdateTicks(THighResTimer::GetTicks() - frameStart);
 	return true;
 }
 
-/** @function TGame::Update - Used to update the game objects, test for collisions between balls, and for balloons
- *							  sinking below lower boundary. This function also updates mInfoButton based on current 
- *							  score & level, and increases the amount of colours with difficulty
+/** @function TGame::Play - Plays a frame, handling the mouse events queued since the last one at the point in the frame they
+ *							happened. The game is updated up to the time of each button event before it is handled, so a
+ *							bullet is fired from where the cannon was aimed when the button was released, and then flies for
+ *							the rest of the frame rather than waiting for the next one. Moves only aim the cannon, so they are
+ *							handled in turn without splitting the frame. Updates and events are recorded as they are played,
+ *							so a replay splits frames in the same places.
+ *		@param 		elapsedMicroseconds	Time in microseconds since last frame
+ *		@param 		frameStartTicks		Time the last frame was timed from, in THighResTimer ticks
+ */
+void TGame::Play( uint32_t elapsedMicroseconds, uint64_t frameStartTicks )
+{
+	uint32_t played = 0;
+	TQueuedInput input;
+	while(mInputQueue.Pop(input))
+	{
+		if(input.mType != TInputEvent::MOUSE_MOVE && input.mTicks > frameStartTicks) {
+			uint32_t at = uint32_t(std::min(THighResTimer::TicksToNanoseconds(input.mTicks - frameStartTicks) / 1000.0,
+											double(elapsedMicroseconds)));
+			if(at > played) {
+				mRecorder.RecordTick( at - played );
+				Update( (at - played) / 1000.0 );
+				played = at;
+			}
+		}
+		mRecorder.RecordMouse(input.mType, input.mPoint);
+		HandleInput(input.mType, input.mPoint);
+	}
+
+	// The rest of the frame is always played, even if it is empty, so the game is updated at least once a frame
+	if(elapsedMicroseconds > played || played == 0) {
+		mRecorder.RecordTick( elapsedMicroseconds - played );
+		Update( (elapsedMicroseconds - played) / 1000.0 );
+	}
+}
+
+/** @function TGame::Replay - Feeds recorded mouse events and frames through the game. In real time, recorded frames are
+ *							  replayed while they fit in the time that has really passed. At full speed, recorded frames are
+ *							  replayed until gameVars::replayFrameBudget milliseconds have been used up this frame.
+ *							  Once the recording runs out the player is given control of the game.
+ *		@param 		elapsedMicroseconds	Time in microseconds since last frame
+ */
+void TGame::Replay( uint32_t elapsedMicroseconds )
+{
+	uint64_t frameStart = THighResTimer::GetTicks();
+	mReplayTimeBank += elapsedMicroseconds;
+
+	TInputEvent event;
+	while(mReplayer.Peek(event))
+	{
+		switch(event.mType)
+		{
+		case TInputEvent::TICK :
+			if(mReplayRealTime) {
+				if(event.mElapsedMicroseconds > mReplayTimeBank)
+					return;
+				mReplayTimeBank -= event.mElapsedMicroseconds;
+			}
+			else if(THighResTimer::TicksToMilliseconds(THighResTimer::GetTicks() - frameStart) >= gameVars::replayFrameBudget)
+				return;
+			Update( event.mElapsedMicroseconds / 1000.0 );
+			mReplayTicks++;
+			if(mReplayTicks == mSnapshotFrame && mSnapshotFile.has_data()) {
+				mSnapshot.Take(mSimulation);
+				if(mSnapshot.Save(mSnapshotFile.c_str()))
+					DEBUG_WRITE(("Checkpoint saved at frame %d", mReplayTicks));
+			}
+			break;
+		default :
+			HandleInput(event.mType, event.mPoint);
+			break;
+		}
+		mReplayer.Pop();
+	}
+
+	DEBUG_WRITE(("Replay finished: %d frames in %.0f ms", mReplayTicks,
+				 THighResTimer::TicksToMilliseconds(THighResTimer::GetTicks() - mReplayStartTicks)));
+	mReplaying = false;
+}
+
+/** @function TGame::ViewStream - Reads the state stream being watched up to the time that has passed since watching
+ *								  started, and puts the latest state into mSimulation to be drawn. The stream isn't read while
+ *								  paused. A stream that goes back in time has had a new game started, so watching carries on
+ *								  from the start of that game.
  *		@param 		elapsedTime			Time in milliseconds since last frame
  */
-void TGame::Update( uint32_t elapsedTime )
+void TGame::ViewStream( double elapsedTime )
+{
+	if(mGameState != UNPAUSED)
+		return;
+
+	mStreamViewTime += elapsedTime;
+	uint32_t lastTime = mStreamDecoder.GetTime();
+	bool read = false;
+	while(mStreamDecoder.GetTime() < mStreamViewTime && mStreamDecoder.ReadPacket()) {
+		if(mStreamDecoder.GetTime() < lastTime)
+			mStreamViewTime = mStreamDecoder.GetTime();
+		lastTime = mStreamDecoder.GetTime();
+		read = true;
+	}
+	if(read && mStreamDecoder.IsSynced()) {
+		mStreamDecoder.Apply(mSimulation);
+		UpdateInfoText();
+	}
+}
+
+/** @function TGame::Update - Used to update mSimulation, moving to the GAMEOVER state if the barrier has risen too far.
+ *							  This function also updates mInfoButton based on current score & level. When the game is
+ *							  threaded the update is only queued, see TakeSimulationFrame.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ */
+void TGame::Update( double elapsedTime )
 {	
+	TRACE_SCOPE("TGame::Update");
 	if(mGameState==UNPAUSED)
 	{
-		// Update game objects
-		for(vector<IObject*>::iterator iter = mToUpdate.begin(); iter != mToUpdate.end(); ++iter)
-			(*iter)->Update(elapsedTime);
-				
-		mBalloonManager.TestForCollisions(mCannon.GetBulletsFired());
-
-		// Check for balloons which are sinking
-		if(mBarrier.TestForSinkingBalloons(mBalloonManager.GetBalloons()) ||
-		   mBarrier.TestForSinkingBalloons(mCannon.GetBulletsFired())) {
-			mMessageText.SetText(mGameOverStr);
-			mGameState = GAMEOVER;
+		if(mThreaded) {
+			TSimulationCommand command = { TSimulationCommand::TICK, elapsedTime, TPlayerInput() };
+			mCommands.push_back(command);
+			return;
+		}
+
+		uint64_t updateStart = THighResTimer::GetTicks();
+		TBalloonManager& balloonManager = mSimulation.GetBalloonManager();
+		TCannon& cannon = mSimulation.GetCannon();
+		{
+			TAllocationScope allocations(mAllocations, TAllocationTracker::SIMULATION);
+			mScenario.Update(elapsedTime, balloonManager, cannon);
+
+			if(mSimulation.Update(elapsedTime)) {
+				mMessageText.SetText(mGameOverStr);
+				mGameState = GAMEOVER;
+			}
+			// A finished stress scenario hands the game back with the normal playing area and colours
+			if(!mScenario.IsRunning()) {
+				mSimulation.SetKeepFullPlayArea(false);
+				mSimulation.SetFixedNumColours(0);
+			}
+			if(mStreaming)
+				mStreamEncoder.Encode(mSimulation);
 		}
-		// Update the games boundary
-		TBall::SetBounds(TRect(0, gameVars::hudBoundary, SCREEN_WIDTH, int32_t(mBarrier.GetPosition().y)));
 
-		// Update info text
-		str gameInfo = AppendIntToStr(mBalloonManager.GetScore(), mScoreStr+": ") + '\n';
-		gameInfo += AppendIntToStr(mBalloonManager.GetLevel(), mLevelStr+": ");
-		mInfoButton.SetText(gameInfo);
+		UpdateInfoText();
 
-		// Increase colours with difficulty
-		mCannon.SetNumColours(gameVars::initialNumColoursInPlay + 
-							  mBalloonManager.GetLevel() / 
-							  gameVars::levelsToPassForNewColour);
+		mScenario.RecordUpdate(elapsedTime, THighResTimer::GetTicks() - updateStart,
+							   uint32_t(balloonManager.GetBalloons().size()), uint32_t(cannon.GetBulletsFired().size()));
 	}
 }
 
-/** @function TGame::AppendIntToStr - This function converts an int to a str and appends it to the end of a str.
- *		@param 		number				Number to convert
- *		@param 		textToAppendTo		Text to append the number to
- *
- *		@return		textToAppendTo		textToAppendTo with number at the end
+/** @function TGame::TakeSimulationFrame - Takes the last frame published by mSimulationThread, if there is a new one,
+ *										 into mShownSimulation, and moves to the GAMEOVER state if the game it shows is over.
+ *										 A game over from before the last new game was queued is ignored.
  */
-str TGame::AppendIntToStr(int32_t number, str textToAppendTo)
+void TGame::TakeSimulationFrame()
 {
-	str intAsStr = ConvertIntToStr(number);
-	textToAppendTo += intAsStr;
-	return textToAppendTo;
+	const TSimulationFrame* frame = mSimulationThread.TakeFrame();
+	if(!frame)
+		return;
+
+	frame->mSnapshot.Restore(mShownSimulation);
+	if(frame->mGameOver && frame->mGame == mGamesStarted && mGameState == UNPAUSED) {
+		mMessageText.SetText(mGameOverStr);
+		mGameState = GAMEOVER;
+	}
+	UpdateInfoText();
 }
 
-/** @function TGame::ConvertIntToStr - This function converts an int to a str and returns it
- *		@param 		numerator				Number to convert
- *
- *		@return		intAsStr			numerator as str
+/** @function TGame::UpdateInfoText - Sets the text of mInfoButton to the current score and level. The text is only built
+ *									 and laid out again when one of them has changed, which is counted as an expected
+ *									 allocation rather than one that spoils a steady-state frame.
  */
-str TGame::ConvertIntToStr(int32_t numerator)
+void TGame::UpdateInfoText()
 {
-	vector<char> scoreChars;
-	str intAsStr;
-
-	while(numerator >= 10) {
-		uint32_t temp = numerator / 10;
-		uint32_t remainder = numerator % 10;
-		numerator = temp;
-		scoreChars.push_back(char(remainder + 48));
-	}
-	scoreChars.push_back(char(numerator + 48));
-
-	for(vector<char>::reverse_iterator rit = scoreChars.rbegin(); rit < scoreChars.rend(); ++rit)
-		intAsStr += *rit;
-	
-	return intAsStr;
+	const TBalloonManager& balloonManager = GetShownSimulation().GetBalloonManager();
+	int32_t score = balloonManager.GetScore();
+	int32_t level = balloonManager.GetLevel();
+	if(score == mShownScore && level == mShownLevel)
+		return;
+	mShownScore = score;
+	mShownLevel = level;
+	mFrameScheduler.Invalidate();
+
+	TAllocationScope allocations(mAllocations, TAllocationTracker::HUD, true);
+	char gameInfo[128];
+	sprintf(gameInfo, "%.48s: %d\n%.48s: %d", mScoreStr.c_str(), score, mLevelStr.c_str(), level);
+	mInfoButton.SetText(gameInfo);
 }
 
 /** @function TGame::Draw - This function draws all game objects and buttons to the screen. It uses a switch statement
  *							to handle the different states that the game may be in. In the UNPAUSD state, it first draws
- *							the backgound section of mBarrier, before drawing the cannon and balloon manager. It then
- *							draws the foreground section of mBarrier.
+ *							the backgound section of the barrier, before drawing the cannon and balloon manager. It then
+ *							draws the foreground section of the barrier.
  */
 void TGame::Draw()
 {
+	uint64_t drawStart = THighResTimer::GetTicks();
+	TRACE_SCOPE("TGame::Draw");
+	TAllocationScope allocations(mAllocations, TAllocationTracker::DRAW);
 	TBegin2d draw;
+	mDrawnState = mGameState;
 
 	// First fill with background colour
 	TRenderer * r = TRenderer::GetInstance();
 	r->FillRect( TURect(0,0,SCREEN_WIDTH, SCREEN_HEIGHT), gameVars::backgroundColour );
+	TRACE_DRAW_CALL();
+	uint32_t culledBalls = 0;
 
 	switch(mGameState)
 	{
 	case UNPAUSED :
-		// Draw the background section of mBarrier
-		mBarrier.DrawBackground();
-
-		// Draw other game objects
-		for(vector<IObject*>::iterator iter = mToDraw.begin(); iter != mToDraw.end(); ++iter)
-			(*iter)->Draw();
-
-		// Draw the foreground section of mBarrier
-		mBarrier.DrawForeground();
+		// Draw the barrier, cannon and balloons
+		culledBalls = GetShownSimulation().Draw();
 
 		mHudBackground->Draw();
-		mBasicButton.Draw(gameVars::pauseButtonPosition, mPauseButtonStr);
-		mBasicButton.Draw(gameVars::newGameButtonPosition, mNewGameButtonStr);
-		mBasicButton.Draw(gameVars::helpButtonPosition, mHelpButtonStr);
-		mBasicButton.Draw(gameVars::quitButtonPosition, mQuitButtonStr);
+		TRACE_DRAW_CALL();
+		mPauseButton.Draw(gameVars::pauseButtonPosition);
+		mNewGameButton.Draw(gameVars::newGameButtonPosition);
+		mHelpButton.Draw(gameVars::helpButtonPosition);
+		mQuitButton.Draw(gameVars::quitButtonPosition);
 		mInfoButton.Draw(gameVars::gameInfoPosition);
 		break;
 	case PAUSED :
 		mHudBackground->Draw();
-		mPausedButton.Draw(gameVars::pauseButtonPosition, mUnpauseButtonStr);
-		mBasicButton.Draw(gameVars::newGameButtonPosition, mNewGameButtonStr);
-		mBasicButton.Draw(gameVars::helpButtonPosition, mHelpButtonStr);
-		mBasicButton.Draw(gameVars::quitButtonPosition, mQuitButtonStr);
+		TRACE_DRAW_CALL();
+		mPausedButton.Draw(gameVars::pauseButtonPosition);
+		mNewGameButton.Draw(gameVars::newGameButtonPosition);
+		mHelpButton.Draw(gameVars::helpButtonPosition);
+		mQuitButton.Draw(gameVars::quitButtonPosition);
 		mMessageText.Draw(gameVars::pauseMSGPosition, gameVars::messageH*2);
 		mInfoButton.Draw(gameVars::gameInfoPosition);
 		break;
 	case HELP :
 		mHudBackground->Draw();
+		TRACE_DRAW_CALL();
 		mHelpTextButton.Draw(gameVars::helpMSGPosition);
 		mInfoButton.Draw(gameVars::gameInfoPosition);
 		break;
 	case GAMEOVER :
-		mBarrier.Draw();
+		GetShownSimulation().GetBarrier().Draw();
 		mHudBackground->Draw();
-		mBasicButton.Draw(gameVars::newGameButtonPosition, mNewGameButtonStr);
-		mBasicButton.Draw(gameVars::helpButtonPosition, mHelpButtonStr);
-		mBasicButton.Draw(gameVars::quitButtonPosition, mQuitButtonStr);
+		TRACE_DRAW_CALL();
+		mNewGameButton.Draw(gameVars::newGameButtonPosition);
+		mHelpButton.Draw(gameVars::helpButtonPosition);
+		mQuitButton.Draw(gameVars::quitButtonPosition);
 		mInfoButton.Draw(gameVars::gameInfoPosition);
 		mMessageText.Draw(gameVars::gameOverMSGPosition, gameVars::messageH*2);
 		break;
 	}
+
+	int32_t drawCalls = TTrace::TakeDrawCalls();
+	TRACE_COUNTER("draw calls", drawCalls);
+	TRACE_COUNTER("culled balls", culledBalls);
+	mPerfStats.SetDrawCalls(drawCalls, culledBalls);
+	uint64_t drawTicks = THighResTimer::GetTicks() - drawStart;
+	mScenario.RecordDraw(drawTicks);
+	if(IsCollectingFrameStats())
+		mFrameStats.AddDrawTicks(drawTicks);
 }
 
-/** @function TGame::OnMouseDown - This function is called when the user clicks the left mouse button.
- *								   It then checks to see if the cursor was above any buttons when the mouse click happened.
- *								   If it wasn't, then mCannon loads a bullet to the end of itself.
+/** @function TGame::OnMouseDown - This function is called when the user clicks the left mouse button. The event is
+ *								   queued to be handled by the next frame, starting animation again if the game was idle,
+ *								   and ignored while a recording is being replayed.
  *		@param 		p					Mouse cursor position when mouse down event occurred
  *
  *		@return		true if event was handled in this function, false to keep searching for handlers
  */
 bool TGame::OnMouseDown(const TPoint& p)
+{
+	if(mReplaying)
+		return true;
+
+	TAllocationScope allocations(mAllocations, TAllocationTracker::INPUT);
+	mInputQueue.Push(TInputEvent::MOUSE_DOWN, p, THighResTimer::GetTicks());
+	if(!mAnimating)
+		StartAnimating();
+	return true;
+}
+
+/** @function TGame::OnMouseUp - This function is called when the user releases the left mouse button. The event is
+ *								 queued to be handled by the next frame, starting animation again if the game was idle,
+ *								 and ignored while a recording is being replayed.
+ *		@param 		p					Mouse cursor position when mouse up event occurred
+ *
+ *		@return		true if event was handled in this function, false to keep searching for handlers
+ */
+bool TGame::OnMouseUp(const TPoint& p)
+{
+	if(mReplaying)
+		return true;
+
+	TAllocationScope allocations(mAllocations, TAllocationTracker::INPUT);
+	mInputQueue.Push(TInputEvent::MOUSE_UP, p, THighResTimer::GetTicks());
+	if(!mAnimating)
+		StartAnimating();
+	return true;
+}
+
+/** @function TGame::OnMouseMove - This function is called when the user moves the mouse. The event is
+ *								   queued to be handled by the next frame, and ignored while a recording is being replayed.
+ *		@param 		p					Mouse cursor position when mouse move event occurred
+ *
+ *		@return		true if event was handled in this function, false to keep searching for handlers
+ */
+bool TGame::OnMouseMove(const TPoint& p)
+{
+	if(mReplaying)
+		return true;
+
+	TAllocationScope allocations(mAllocations, TAllocationTracker::INPUT);
+	mInputQueue.Push(TInputEvent::MOUSE_MOVE, p, THighResTimer::GetTicks());
+	return true;
+}
+
+/** @function TGame::HandleInput - Handles a mouse event taken from mInputQueue or from a recording
+ *		@param 		type				One of TInputEvent::MOUSE_MOVE, MOUSE_DOWN or MOUSE_UP
+ *		@param 		p					Mouse cursor position when the event happened
+ *
+ *		@return		true if event was handled
+ */
+bool TGame::HandleInput(uint8_t type, const TPoint& p)
+{
+	TAllocationScope allocations(mAllocations, TAllocationTracker::INPUT);
+	// Moves only aim the cannon, clicks can change anything on screen
+	if(type != TInputEvent::MOUSE_MOVE)
+		mFrameScheduler.Invalidate();
+	switch(type)
+	{
+	case TInputEvent::MOUSE_MOVE :
+		return HandleMouseMove(p);
+	case TInputEvent::MOUSE_DOWN :
+		return HandleMouseDown(p);
+	case TInputEvent::MOUSE_UP :
+		return HandleMouseUp(p);
+	}
+	return false;
+}
+
+/** @function TGame::HandleMouseDown - This function checks to see if the cursor was above any buttons when the mouse click 
+ *									   happened. If it wasn't, then the cannon loads a bullet to the end of itself.
+ *		@param 		p					Mouse cursor position when mouse down event occurred
+ *
+ *		@return		true if event was handled in this function, false to keep searching for handlers
+ */
+bool TGame::HandleMouseDown(const TPoint& p)
 {	
 
 	if(mGameState == PAUSED && mPausedButton.HitTest(p, gameVars::pauseButtonPosition)) {
 		mGameState = UNPAUSED;
 		return true;  
 	}
-	else if(mGameState == UNPAUSED && mBasicButton.HitTest(p, gameVars::pauseButtonPosition)) {
+	else if(mGameState == UNPAUSED && mPauseButton.HitTest(p, gameVars::pauseButtonPosition)) {
 		mMessageText.SetText(mPausedStr);
 		mGameState = PAUSED;
 		return true;
 	}
-	else if(mBasicButton.HitTest(p, gameVars::newGameButtonPosition)) {
+	else if(mNewGameButton.HitTest(p, gameVars::newGameButtonPosition)) {
 		Reset();
 		mGameState = UNPAUSED;
 		return true;
 	}
-	else if(mBasicButton.HitTest(p, gameVars::helpButtonPosition)) {
+	else if(mHelpButton.HitTest(p, gameVars::helpButtonPosition)) {
 		mGameState = HELP;
 		return true;
 	}
@@ -349,38 +851,50 @@ bool TGame::OnMouseDown(const TPoint& p)
 		mHelpTextButton.SetText(mHelpTextStr1);
 		return true;
 	}
-	else if(mGameState != HELP && mBasicButton.HitTest(p, gameVars::quitButtonPosition)) {
+	else if(mGameState != HELP && mQuitButton.HitTest(p, gameVars::quitButtonPosition)) {
 		TWindowManager::GetInstance()->GetScript()->RunScript("scripts/quitverify.lua");
 		return true;
 	}
-	else if(mGameState == UNPAUSED && p.y > gameVars::hudBoundary) {
-		mCannon.Reload();
+	else if(mGameState == UNPAUSED && !mStreamViewing && p.y > gameVars::hudBoundary) {
+		ApplyInput(TPlayerInput(0, 0, TPlayerInput::RELOAD));
 		return true;
 	}
 	return false;
 }
 
-/** @function TGame::OnMouseUp - This function is called when the user releases the left mouse button, and tells
- *								 mCannon to fire a bullet.
+/** @function TGame::HandleMouseUp - This function tells the cannon to fire a bullet.
  *		@param 		p					Mouse cursor position when mouse up event occurred
  *
  *		@return		true if event was handled in this function, false to keep searching for handlers
  */
-bool TGame::OnMouseUp(const TPoint& p)
+bool TGame::HandleMouseUp(const TPoint& p)
 {	
-	mCannon.Fire();
+	if(!mStreamViewing)
+		ApplyInput(TPlayerInput(0, 0, TPlayerInput::FIRE));
 	return true;
 }
 
-/** @function TGame::OnMouseMove - This function is called when the user moves the mouse and is 
- *								   used to update the direction of mCannon
- *		@param 		p					Mouse cursor position when mouse up event occurred
+/** @function TGame::HandleMouseMove - This function is used to update the direction of the cannon
+ *		@param 		p					Mouse cursor position when mouse move event occurred
  *
  *		@return		true if event was handled in this function, false to keep searching for handlers
  */
-bool TGame::OnMouseMove(const TPoint& p)
+bool TGame::HandleMouseMove(const TPoint& p)
 {	
-	mCannon.UpdateMousePosition(p);
+	if(!mStreamViewing)
+		ApplyInput(TPlayerInput(int16_t(p.x), int16_t(p.y), TPlayerInput::AIM));
 
 	return true;
 }
+
+/** @function TGame::ApplyInput - Aims, reloads or fires the cannon, or queues it for mSimulationThread when the game is threaded
+ *		@param 		input				What the player did with the cannon
+ */
+void TGame::ApplyInput(const TPlayerInput& input)
+{
+	if(mThreaded) {
+		TSimulationCommand command = { TSimulationCommand::INPUT, 0.0, input };
+		mCommands.push_back(command);
+	}
+	else mSimulation.ApplyInput(input);
+}
@@ -6,27 +6,59 @@
 #define GAME_H_INCLUDED  
 
 #include "gameVariables.h" 
-#include "ball.h"
-#include "balloonManager.h"
-#include "cannon.h"
-#include "barrier.h"
+#include "simulation.h"
 #include "basicButton.h"
+#include "inputRecorder.h"
+#include "inputQueue.h"
+#include "stressScenario.h"
+#include "frameStats.h"
+#include "frameScheduler.h"
+#include "allocationTracker.h"
+#include "perfStats.h"
+#include "snapshot.h"
+#include "stateStream.h"
+#include "simulationThread.h"
+#include "jobSystem.h"
 
 /** @class TGame - This class inherits from TWindow and is used to display the game objects to the screen and update them.
  *				   It also manages a simple state machine for the UNPAUSED, PAUSED, HELP, and GAMEOVER states. It listens
  *				   for mousedown and mousemove events, and if transitions between states based on the user clicking on the
- *				   relevant buttons, which are shown on screen using TSpriteRefs
- *	@property 	TStateVariables						mStateVariables			Variables to keep track of game difficulty/progress, used to initialize 
- *																			mBalloonManager
- * 	@property 	TBalloonManager						mBalloonManager			Manages falling balloons on screen and keeps track of game difficulty/progress
- *	@property 	TCannon								mCannon					Used to shoot bullets at balloons
- *	@property 	TBarrier							mBarrier				If balloons fall to far, this rises until too high and game over is reached
- *	@property 	std::vector<IObject*>				mToUpdate				Used to update mBalloonManager, mCannon, and mBarrier polymorphically
- *	@property 	std::vector<IObject*>				mToDraw					Used to draw mBalloonManager, mCannon, polymorphically, mBarrier needs
- *																			to be drawn using separate background and foreground draw functions
+ *				   relevant buttons, which are shown on screen using TSpriteRefs. Mouse events are queued with the time
+ *				   they happened and handled at that point in the next frame, see TGame::Play. Input can be recorded to a file with the "record"
+ *				   config setting and played back with the "replay" setting, either in real time or, with "replayspeed" set to
+ *				   "fast", as quickly as the game can be updated. Setting "scenario" to a scenario file starts the game in a
+ *				   stress scenario, see TStressScenario, and setting "tuner" to a tuner file sweeps difficulty settings
+ *				   with TDifficultyTuner before the game starts, as setting "versus" to a versus file plays a rollback
+ *				   versus game between two bots with TVersusMatch, and setting "collisioncheck" to a check file
+ *				   checks the collision code against its reference with TCollisionChecker. Frame times are kept in mFrameStats unless nothing reads them, setting
+ *				   "framestats" to a file writes a report of them, and any hitches, out. Frames are paced by mFrameScheduler and
+ *				   only drawn when something on screen may have changed, and once the game is left paused, on the help
+ *				   screen or over, it stops animating altogether until the mouse is clicked. Heap allocations are counted
+ *				   each frame in debug builds, and an unpaused frame that allocates is flagged; setting "allocassert"
+ *				   turns the flag into an assertion. Setting "checkpoint" to a file saved by TSimulationSnapshot starts
+ *				   the game from that checkpoint, and while replaying, setting "snapshot" to a file and "snapshotat" to a
+ *				   frame number saves a checkpoint when the replay reaches that frame, so a bug found late in a long
+ *				   recording can be jumped straight to. Setting "stream" to a file writes the game out as a state stream
+ *				   with TStateStreamEncoder, and setting "streamview" to one watches it, drawing the game without
+ *				   updating it, in place of playing. Setting "simthread" updates the game on a TSimulationThread while
+ *				   this thread draws the last frame it published, restored into mShownSimulation; replays, stream viewing
+ *				   and stress scenarios always update the game on this thread. Setting "jobs" runs each update as a
+ *				   TJobGraph on mJobSystem, with that many worker threads or one for each other core if it isn't a number
+ *				   above 0, and setting "jobtrace" to a file writes the time each job took, and the critical path, out. Setting "trace" to a file
+ *				   traces frames, updates, draws, jobs and texture loads with TTrace, written out when the game closes
+ *				   as a Chrome trace, along with counts of balloons, bullets, active effects, draw calls and culled
+ *				   balls. Scripts run by the window manager can read frame times, counts and load times from
+ *				   mPerfStats' stats table.
+ *	@property 	TStateVariables						mStateVariables			Variables to keep track of game difficulty/progress at the start of a game
+ * 	@property 	TSimulation							mSimulation				The balloon manager, cannon and barrier being played with
+ * 	@property 	TSimulation							mShownSimulation		Copy of the last frame published by mSimulationThread, which
+ *																				is what is drawn while the game is updated on it
  *	@property 	TTextGraphic						mMessageText			Used to display various info to the screen
  * 	@property 	TBasicButton						mInfoButton				Used to display on screen info on the score and level of the game
- * 	@property 	TBasicButton						mBasicButton			Used to draw the Pause, Quit, Help and New Game buttons
+ * 	@property 	TBasicButton						mPauseButton			Used to draw the Pause button
+ * 	@property 	TBasicButton						mNewGameButton			Used to draw the New Game button
+ * 	@property 	TBasicButton						mHelpButton				Used to draw the Help button
+ * 	@property 	TBasicButton						mQuitButton				Used to draw the Quit button
  * 	@property 	TBasicButton						mPausedButton			Used to draw the Unpause button
  *	@property 	TBasicButton						mHelpTextButton			Used to display info on how to play the game to the screen
  *	@property 	str									mHelpTextStr1			str containing info for the first page of instructions, loaded from strings.xml
@@ -41,19 +73,53 @@
  *	@property 	str									mGameOverStr			str containing info for the Game Over message, loaded from strings.xml
  *	@property 	str									mPausedStr				str containing info for the Paused message, loaded from strings.xml
  *	@property 	uint16_t							mGameState				The current state the game is in
- *	@property 	std::vector<TTextureRef>			mBalloonTextures		Textures used to display balloons on screen
- *	@property 	std::vector<TAnimatedTextureRef>	mBalloonBurstTextures	Textures used for burst balloon animation
+ *	@property 	TBallAssets							mBallAssets				Textures used to display balloons and bullets, and
+ *																				their burst animations, shared by every game
  * 	@property 	std::vector<TTextureRef>			mBarrierTextures		Textures to represent piles of balloons at the bottom of the screen
  *	@property 	TTextureRef							mCannonTexture			Texture used to display cannon on screen
  *	@property 	TSpriteRef							mHudBackground			Background for the HUD display
- *	@property 	uint32_t							mLastLoopTime			Time since last frame
+ *	@property 	uint64_t							mLastLoopTicks			Time the last frame was timed from, in THighResTimer ticks
+ *	@property 	uint32_t							mLeftoverNanoseconds	Time in nanoseconds left over from rounding the last frame's
+ *																				elapsed time to whole microseconds
+ *	@property 	TInputQueue							mInputQueue				Mouse events waiting to be handled at the next frame
+ *	@property 	TInputRecorder						mRecorder				Records mouse events and frame times when recording is on
+ *	@property 	TInputReplayer						mReplayer				Plays back a recording made by mRecorder
+ *	@property 	bool								mReplaying				Whether input is coming from mReplayer rather than the mouse
+ *	@property 	bool								mReplayRealTime			Whether the replay runs at the speed it was recorded at
+ *	@property 	uint64_t							mReplayTimeBank			Time in microseconds not yet used up by replayed frames
+ *	@property 	uint32_t							mReplayTicks			Number of frames replayed so far
+ *	@property 	uint64_t							mReplayStartTicks		Time the replay started, in THighResTimer ticks
+ *	@property 	TStressScenario						mScenario				Stress scenario being run, if any
+ *	@property 	TFrameStats							mFrameStats				Histograms of frame, update and draw times, and hitch capture
+ *	@property 	uint64_t							mLastFrameTicks			Time the last frame started, in THighResTimer ticks
+ *	@property 	TFrameScheduler						mFrameScheduler			Paces frames and decides whether each is drawn
+ *	@property 	bool								mAnimating				Whether OnTaskAnimate is being called, which it isn't while idle
+ *	@property 	uint16_t							mDrawnState				Game state the screen was last drawn in
+ *	@property 	TAllocationTracker					mAllocations			Counts heap allocations made each frame
+ *	@property 	int32_t								mShownScore				Score shown by mInfoButton, -1 before it is first set
+ *	@property 	int32_t								mShownLevel				Level shown by mInfoButton, -1 before it is first set
+ *	@property 	TPerfStats							mPerfStats				Performance stats read by Lua scripts
+ *	@property 	TSimulationSnapshot					mSnapshot				Checkpoint of mSimulation
+ *	@property 	str									mSnapshotFile			File to save a checkpoint to while replaying, if any
+ *	@property 	uint32_t							mSnapshotFrame			Replayed frame to save the checkpoint after
+ *	@property 	TStateStreamEncoder					mStreamEncoder			Writes the game out as a state stream when streaming is on
+ *	@property 	TStateStreamDecoder					mStreamDecoder			Reads the state stream being watched
+ *	@property 	bool								mStreaming				Whether each update is written to mStreamEncoder
+ *	@property 	bool								mStreamViewing			Whether a state stream is being watched instead of played
+ *	@property 	double								mStreamViewTime			Time in milliseconds of the stream that should be showing
+ *	@property 	TJobSystem							mJobSystem				Runs each update of mSimulation as a job graph, if asked to
+ *	@property 	std::vector<TSimulationCommand>		mCommands				Commands queued this frame for mSimulationThread, after any
+ *																				that didn't fit in its ring last frame
+ *	@property 	TSimulationThread					mSimulationThread		Updates mSimulation when the game is threaded
+ *	@property 	bool								mThreaded				Whether mSimulation is updated on mSimulationThread
+ *	@property 	uint32_t							mGamesStarted			Number of new games queued for mSimulationThread
  */
 class TGame : public TWindow
 {
 	PFTYPEDEF_DC(TGame,TWindow)
 public:
 	TGame();
-	~TGame() {}
+	~TGame();
 
 	void Draw();
 
@@ -72,28 +138,39 @@ public:
 	};
 	
 private:
-	void Update( uint32_t elapsedTime );
+	void Update( double elapsedTime );
+	void Play( uint32_t elapsedMicroseconds, uint64_t frameStartTicks );
+	void Replay( uint32_t elapsedMicroseconds );
+	void ViewStream( double elapsedTime );
+	bool HandleInput(uint8_t type, const TPoint& point);
+	void ApplyInput(const TPlayerInput& input);
+	void TakeSimulationFrame();
+	const TSimulation& GetShownSimulation() const;
+	bool IsPlaying() const;
+	bool IsCollectingFrameStats() const;
+	void StartAnimating();
+	bool HandleMouseDown(const TPoint& point);
+	bool HandleMouseUp(const TPoint& point);
+	bool HandleMouseMove(const TPoint& point);
 	void LoadAssets();
 	void LoadStrings();
 	void Reset();
-	
-	str ConvertIntToStr(int32_t);
-	str AppendIntToStr(int32_t number, str textToAppendTo = "");
+	void UpdateInfoText();
 	
 	// Game objects
 	TStateVariables mStateVariables;
-	TBalloonManager mBalloonManager;
-	TCannon mCannon;
-	TBarrier mBarrier;
-	std::vector<IObject*> mToUpdate;
-	std::vector<IObject*> mToDraw;
+	TSimulation mSimulation;
+	TSimulation mShownSimulation;
 
 	// Text Graphics
 	TTextGraphic mMessageText;
 
 	// Buttons
 	TBasicButton mInfoButton;
-	TBasicButton mBasicButton;
+	TBasicButton mPauseButton;
+	TBasicButton mNewGameButton;
+	TBasicButton mHelpButton;
+	TBasicButton mQuitButton;
 	TBasicButton mPausedButton;
 	TBasicButton mHelpTextButton;
 
@@ -105,13 +182,62 @@ private:
 	uint16_t mGameState;
 
 	// Assets
-	std::vector<TTextureRef> mBalloonTextures;
-	std::vector<TAnimatedTextureRef> mBalloonBurstTextures;
+	TBallAssets mBallAssets;
 	std::vector<TTextureRef> mBarrierTextures;
 	TTextureRef mCannonTexture;	
 	TSpriteRef mHudBackground;
 
-	uint32_t mLastLoopTime; 
+	uint64_t mLastLoopTicks;
+	uint32_t mLeftoverNanoseconds;
+
+	// Input recording
+	TInputQueue mInputQueue;
+	TInputRecorder mRecorder;
+	TInputReplayer mReplayer;
+	bool mReplaying;
+	bool mReplayRealTime;
+	uint64_t mReplayTimeBank;
+	uint32_t mReplayTicks;
+	uint64_t mReplayStartTicks;
+
+	// Stress testing
+	TStressScenario mScenario;
+
+	// Frame timing
+	TFrameStats mFrameStats;
+	uint64_t mLastFrameTicks;
+	TFrameScheduler mFrameScheduler;
+	bool mAnimating;
+	uint16_t mDrawnState;
+
+	// Allocation tracking
+	TAllocationTracker mAllocations;
+	int32_t mShownScore;
+	int32_t mShownLevel;
+
+	// Lua performance stats
+	TPerfStats mPerfStats;
+
+	// Checkpoints
+	TSimulationSnapshot mSnapshot;
+	str mSnapshotFile;
+	uint32_t mSnapshotFrame;
+
+	// State streaming
+	TStateStreamEncoder mStreamEncoder;
+	TStateStreamDecoder mStreamDecoder;
+	bool mStreaming;
+	bool mStreamViewing;
+	double mStreamViewTime;
+
+	// Job system
+	TJobSystem mJobSystem;
+
+	// Simulation thread, last so that it is stopped before anything it uses is destroyed
+	std::vector<TSimulationCommand> mCommands;
+	TSimulationThread mSimulationThread;
+	bool mThreaded;
+	uint32_t mGamesStarted;
 };
 
 #endif // GAME_H_INCLUDED
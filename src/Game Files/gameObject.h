@@ -6,13 +6,14 @@
 
 #include <pf/pflib.h>
 
-/** @class IObject - This abstract base class is inheritted from by TBall, TCannon, TBarrier, and TBalloonManager,
- *					 in order for these classes to be used polymorphically when Drawing/Updating in TGame.
+/** @class IObject - This abstract base class is inheritted from by TCannon, TBarrier, and TBalloonManager, in order for
+ *					 these classes to be used polymorphically when Drawing/Updating in TSimulation. Balls are not
+ *					 IObjects, since a virtual call per ball would keep their loops from being inlined.
  */
 class IObject {
 public:
 	virtual void Draw() const = 0;  
-	virtual void Update(uint32_t elapsedTime) = 0;  
+	virtual void Update(double elapsedTime) = 0;  
 	virtual ~IObject() {}
 };
 
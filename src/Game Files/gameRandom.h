@@ -0,0 +1,32 @@
+/**
+ *	gameRandom.h - Jan van der Kamp, 2011
+ */
+#ifndef GAMERANDOM_H_INCLUDED
+#define GAMERANDOM_H_INCLUDED
+
+#include <pf/pflib.h>
+
+/** @class TRandom - A small seeded random number generator (xorshift32) owned by the game. TPlatform::Rand() is shared by
+ *					 the whole application and can't be reseeded, so balloons and bullets take their random numbers from here
+ *					 instead. Given the same seed and the same input, a game will always play out the same way, which is what
+ *					 makes recorded input replayable.
+ *	@property 	uint32_t		mState					Current state of the generator, never 0
+ */
+class TRandom
+{
+public:
+	explicit TRandom(uint32_t seed = 1)	{ Seed(seed); }
+	void		Seed(uint32_t seed)		{ mState = seed ? seed : 0x9E3779B9; }
+	uint32_t	GetState()		const	{ return mState; }
+	uint32_t	Rand()
+	{
+		mState ^= mState << 13;
+		mState ^= mState >> 17;
+		mState ^= mState << 5;
+		return mState;
+	}
+private:
+	uint32_t	mState;
+};
+
+#endif // GAMERANDOM_H_INCLUDED
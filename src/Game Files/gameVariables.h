@@ -12,10 +12,14 @@
  *
  *	@variable 	TColor				backgroundColour					The background colour of the whole screen
  *	@variable 	TVec2				burstBalloonVelocity				The velocity of a balloon once it has been burst
+ *	@variable 	uint32_t			balloonBurstFrameTime				Time in milliseconds each frame of the balloon-burst animations is shown for,
+ *																		which should match the frametime of their timelines. A burst
+ *																		balloon stays on screen for this times the animation's frames.
  *	@variable 	uint16_t			initialMinWaitForBalloon			Initial shortest time to wait for new balloon  
  *	@variable 	uint16_t			initialMaxWaitForBalloon			Initial longest time to wait for new balloon 
  *	@variable 	uint16_t			waitTimeDecrease					Time in milliseconds that mMinWaitForBalloon & mMaxWaitForBalloon 
  *																		decrease by when new level is reached 
+ *	@variable 	uint16_t			shortestWaitForBalloon				mMinWaitForBalloon & mMaxWaitForBalloon never decrease below this
  *	@variable 	uint16_t			balloonsBurstToLevelUp				Number of balloons necessary to burst in order to level up 
  *	@variable 	uint16_t			initialNumColoursInPlay				Range of colours that bullets can be 
  *	@variable 	uint16_t			levelsToPassForNewColour			Number of levels player needs to pass before introducing a new colour 
@@ -23,13 +27,17 @@
  *	@variable 	TReal				balloonScale						The scale of the falling balloons 
  *	@variable 	TReal				balloonVelocityIncrease				Amount that mBalloonVelocity.y increases by when new level is reached
  *	@variable 	TVec2				initialBalloonVelocity				Initial velocity of falling balloons
+ *	@variable 	uint32_t			balloonCapacity						Number of balloons room is kept for, so that spawning doesn't allocate
  *	@variable 	TVec2				cannonPosition						Position of base of cannon 
  *	@variable 	TReal				bulletScale							The scale of the cannon's bullets 
+ *	@variable 	uint32_t			bulletCapacity						Number of fired bullets room is kept for, so that firing doesn't allocate
  *	@variable 	TReal				barrierRiseSpeed					Speed at which barrier rises
  *	@variable 	TReal				initialBarrierParallaxDifference	Difference in height between the first and last images of balloons which  
  *																		make up the barrier 
  *	@variable 	TReal				barrierLevelHeight					Height at which each element of mBarrierTextures appear at the same height 
  *	@variable 	TVec2				initialBarrierPosition				The overall position of the barrier when the game started 
+ *	@variable 	uint32_t			barrierOpaqueRows					First and last rows of each of the near barrier images, counted
+ *																		from its top, between which it is opaque across its whole width
  *	@variable 	uint32_t			textSize							The size of text on screen 
  *	@variable 	uint32_t			messageW							The width of messages to place on buttons etc. 
  *	@variable 	uint32_t			messageH							The height of messages to place on buttons etc. 
@@ -42,6 +50,30 @@
  *	@variable 	TVec2				newGameButtonPosition					Position that the New Game button should be drawn at 
  *	@variable 	TVec2				quitButtonPosition						Position that the Quit button should be drawn at 
  *	@variable 	TVec2				helpMSGPosition						Position that the Help button should be drawn at 
+ *	@variable 	uint32_t			replayFrameBudget					Time in milliseconds spent replaying recorded input each frame
+ *																		when replaying at full speed
+ *	@variable 	uint32_t			maxFrameTime						Most time in milliseconds the game is moved on by in one frame,
+ *																		so that a machine waking from sleep doesn't jump the game ahead
+ *	@variable 	uint32_t			inputQueueCapacity					Mouse events TInputQueue has room for without allocating
+ *	@variable 	uint32_t			hitchThreshold						Frames taking longer than this many milliseconds are hitches
+ *	@variable 	uint32_t			hitchHistoryFrames					Number of frames written out when a hitch happens
+ *	@variable 	uint32_t			maxHitchFiles						Most hitches written out in one session
+ *	@variable 	uint32_t			targetFrameTime						Time in microseconds between frames while the game is playing
+ *	@variable 	uint32_t			animationInterval					Time in milliseconds StartWindowAnimation is asked to wake the
+ *																		game after, short so that TFrameScheduler does the waiting
+ *	@variable 	uint32_t			simulationCommandCapacity			Commands the ring to TSimulationThread holds, and a frame can
+ *																		queue for it without allocating
+ *	@variable 	uint32_t			balloonMoveJobs						Jobs the balloons are split between to be moved when the
+ *																		frame is run as a TJobGraph
+ *	@variable 	uint32_t			collisionJobs						Jobs the balloons are split between to find collisions
+ *																		when the frame is run as a TJobGraph
+ *	@variable 	uint32_t			traceEventsPerThread				Events each thread can record into a TTrace before the rest
+ *																		of its events are dropped
+ *	@variable 	uint16_t			burstsPerGarbage					Balloons a player bursts in versus mode for each balloon
+ *																		dropped on the opponent
+ *	@variable 	uint32_t			maxRollbackFrames					Most frames a versus player runs ahead of the last input
+ *																		confirmed from the opponent before waiting for it
+ *	@variable 	uint32_t			streamKeyframeInterval				Packets of a state stream between each one holding the whole game
  */
 namespace gameVars {
 	// BACKGROUND COLOUR
@@ -49,11 +81,13 @@ namespace gameVars {
 
 	// BALL VARIABLES
 	const TVec2 burstBalloonVelocity(0, .1f);
+	const uint32_t balloonBurstFrameTime = 100;
 
 	// BALLOON MANAGER VARIABLES
 	const uint16_t initialMinWaitForBalloon = 4500;
 	const uint16_t initialMaxWaitForBalloon = 6000;
 	const uint16_t waitTimeDecrease = 200;
+	const uint16_t shortestWaitForBalloon = 250;
 	const uint16_t balloonsBurstToLevelUp = 3;
 	const uint16_t initialNumColoursInPlay = 3;
 	const uint16_t levelsToPassForNewColour = 3;
@@ -61,16 +95,19 @@ namespace gameVars {
 	const TReal balloonScale = 0.7f; 
 	const TReal balloonVelocityIncrease = 0.004f;
 	const TVec2 initialBalloonVelocity(0, .03f);
+	const uint32_t balloonCapacity = 128;
 
 	// CANNON VARIABLES
 	const TVec2 cannonPosition(TReal(SCREEN_WIDTH / 2), TReal(SCREEN_HEIGHT - 100));
 	const TReal bulletScale = .35f;  
+	const uint32_t bulletCapacity = 32;
 
 	// BARRIER VARIABLES 
 	const TReal barrierRiseSpeed = .1f;
 	const TReal initialBarrierParallaxDifference = 100.f;
 	const TReal barrierLevelHeight = SCREEN_HEIGHT - 200.f;
 	const TVec2 initialBarrierPosition(TReal(SCREEN_WIDTH / 2), TReal(SCREEN_HEIGHT));
+	const uint32_t barrierOpaqueRows[3][2] = { { 41, 59 }, { 65, 77 }, { 74, 113 } };
 
 	// TEXT INFORMATION
 	const uint32_t	textSize = 32;
@@ -89,6 +126,37 @@ namespace gameVars {
 	const TVec2		helpButtonPosition(552.f, 39.f);
 	const TVec2		quitButtonPosition(704.f, 39.f);
 	const TVec2		helpMSGPosition(SCREEN_WIDTH/2, SCREEN_HEIGHT/2);
+
+	// INPUT
+	const uint32_t	replayFrameBudget = 12;
+	const uint32_t	maxFrameTime = 1000;
+	const uint32_t	inputQueueCapacity = 32;
+
+	// FRAME STATISTICS
+	const uint32_t	hitchThreshold = 50;
+	const uint32_t	hitchHistoryFrames = 120;
+	const uint32_t	maxHitchFiles = 20;
+
+	// FRAME PACING
+	const uint32_t	targetFrameTime = 16667;
+	const uint32_t	animationInterval = 1;
+
+	// SIMULATION THREAD
+	const uint32_t	simulationCommandCapacity = 64;
+
+	// JOB SYSTEM
+	const uint32_t	balloonMoveJobs = 8;
+	const uint32_t	collisionJobs = 8;
+
+	// TRACING
+	const uint32_t	traceEventsPerThread = 1 << 18;
+
+	// VERSUS MODE
+	const uint16_t	burstsPerGarbage = 2;
+	const uint32_t	maxRollbackFrames = 16;
+
+	// STATE STREAM
+	const uint32_t	streamKeyframeInterval = 120;
 }
 
 #endif // GAMEVARIABLES_H_INCLUDED
\ No newline at end of file
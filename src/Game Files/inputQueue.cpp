@@ -0,0 +1,52 @@
+/**
+ *	inputQueue.cpp - Jan van der Kamp, 2011
+ */
+#include "inputQueue.h"
+#include "gameVariables.h"
+
+/** @function TInputQueue::TInputQueue - Default Constructor, reserves room for the events of a busy frame so that queueing
+ *										 doesn't allocate
+ */
+TInputQueue::TInputQueue() :
+mInputs(),
+mNext(),
+mMovesCoalesced()
+{
+	mInputs.reserve(gameVars::inputQueueCapacity);
+}
+
+/** @function TInputQueue::Push - Queues a mouse event, or replaces the last event queued if both are moves
+ *		@param 		type				One of TInputEvent::MOUSE_MOVE, MOUSE_DOWN or MOUSE_UP
+ *		@param 		p					Mouse cursor position when the event happened
+ *		@param 		ticks				Time the event happened, in THighResTimer ticks
+ */
+void TInputQueue::Push(uint8_t type, const TPoint& p, uint64_t ticks)
+{
+	if(type == TInputEvent::MOUSE_MOVE && !IsEmpty() && mInputs.back().mType == TInputEvent::MOUSE_MOVE) {
+		mInputs.back().mPoint = p;
+		mInputs.back().mTicks = ticks;
+		mMovesCoalesced++;
+		return;
+	}
+
+	TQueuedInput input = { type, p, ticks };
+	mInputs.push_back(input);
+}
+
+/** @function TInputQueue::Pop - Takes the oldest event off the queue. The queue is emptied once every event has been
+ *								 taken, keeping its room for the next frame.
+ *		@param 		input				Filled in with the event
+ *
+ *		@return		false if there were no events left
+ */
+bool TInputQueue::Pop(TQueuedInput& input)
+{
+	if(IsEmpty()) {
+		mInputs.clear();
+		mNext = 0;
+		return false;
+	}
+
+	input = mInputs[mNext++];
+	return true;
+}
@@ -0,0 +1,50 @@
+/**
+ *	inputQueue.h - Jan van der Kamp, 2011
+ */
+#ifndef INPUTQUEUE_H_INCLUDED
+#define INPUTQUEUE_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "inputRecorder.h"
+
+/** @struct TQueuedInput - A mouse event waiting to be handled, and when it happened
+ *	@property 	uint8_t			mType					One of TInputEvent::MOUSE_MOVE, MOUSE_DOWN or MOUSE_UP
+ *	@property 	TPoint			mPoint					Mouse cursor position when the event happened
+ *	@property 	uint64_t		mTicks					Time the event happened, in THighResTimer ticks
+ */
+struct TQueuedInput
+{
+	uint8_t		mType;
+	TPoint		mPoint;
+	uint64_t	mTicks;
+};
+
+/** @class TInputQueue - Holds the mouse events that arrive between frames so that the game can handle them at the point in
+ *						 the frame they happened. A mouse with a high polling rate sends many moves each frame, and only
+ *						 the last one before each button event changes anything, so moves that follow a move replace it
+ *						 rather than being queued, and the cannon is aimed once where it would have been aimed many times.
+ *	@property 	std::vector<TQueuedInput>	mInputs				Events queued, in the order they happened
+ *	@property 	uint32_t					mNext				Index in mInputs of the next event to pop
+ *	@property 	uint32_t					mMovesCoalesced		Number of moves replaced by a later move
+ */
+class TInputQueue
+{
+public:
+	TInputQueue();
+	void			Push(uint8_t type, const TPoint& p, uint64_t ticks);
+	bool			Pop(TQueuedInput& input);
+	bool			IsEmpty()				const	{ return mNext == mInputs.size(); }
+	uint32_t		GetMovesCoalesced()		const	{ return mMovesCoalesced; }
+private:
+	// copying disallowed
+	TInputQueue(const TInputQueue &queue);
+	TInputQueue& operator=(const TInputQueue &queue);
+
+	std::vector<TQueuedInput>	mInputs;
+	uint32_t					mNext;
+	uint32_t					mMovesCoalesced;
+};
+
+#endif // INPUTQUEUE_H_INCLUDED
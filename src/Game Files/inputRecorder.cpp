@@ -0,0 +1,248 @@
+/**
+ *	inputRecorder.cpp - Jan van der Kamp, 2011
+ */
+#include "inputRecorder.h"
+#include <algorithm>
+
+namespace {
+	const uint8_t	streamMagic[4] = { 'B', 'S', 'I', 'R' };
+	const uint8_t	streamVersion = 2;
+	// Version of the stream before tick times were recorded in microseconds rather than milliseconds
+	const uint8_t	millisecondStreamVersion = 1;
+	// Tag written for a tick with the same elapsed time as the previous one
+	const uint8_t	tickRepeatTag = 4;
+	const size_t	flushSize = 4096;
+
+	uint32_t ZigZagEncode(int32_t value) { return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+	int32_t ZigZagDecode(uint32_t value) { return int32_t(value >> 1) ^ -int32_t(value & 1); }
+}
+
+/** @function TInputRecorder::TInputRecorder - Default Constructor
+ */
+TInputRecorder::TInputRecorder() :
+mFile(NULL),
+mBuffer(),
+mLastPoint(),
+mLastElapsedTime()
+{}
+
+/** @function TInputRecorder::~TInputRecorder - Destructor, writes anything left in mBuffer to disk
+ */
+TInputRecorder::~TInputRecorder()
+{
+	Close();
+}
+
+/** @function TInputRecorder::Open - Creates the stream file and writes its header
+ *		@param 		filename			File to record to
+ *		@param 		seed				Seed of the game's TRandom
+ *
+ *		@return		true if the file could be opened
+ */
+bool TInputRecorder::Open(const char* filename, uint32_t seed)
+{
+	Close();
+	mFile = fopen(filename, "wb");
+	if(!mFile)
+		return false;
+
+	mBuffer.reserve(flushSize * 2);
+	mBuffer.insert(mBuffer.end(), streamMagic, streamMagic + 4);
+	mBuffer.push_back(streamVersion);
+	WriteVarint(seed);
+	mLastPoint = TPoint();
+	mLastElapsedTime = 0;
+	return true;
+}
+
+/** @function TInputRecorder::Close - Flushes and closes the stream file
+ */
+void TInputRecorder::Close()
+{
+	if(!mFile)
+		return;
+
+	Flush();
+	fclose(mFile);
+	mFile = NULL;
+}
+
+/** @function TInputRecorder::RecordTick - Records the time the game was updated by this frame
+ *		@param 		elapsedMicroseconds	Time in microseconds since last frame
+ */
+void TInputRecorder::RecordTick(uint32_t elapsedMicroseconds)
+{
+	if(!mFile)
+		return;
+
+	if(elapsedMicroseconds == mLastElapsedTime)
+		mBuffer.push_back(tickRepeatTag);
+	else {
+		mBuffer.push_back(TInputEvent::TICK);
+		WriteVarint(elapsedMicroseconds);
+		mLastElapsedTime = elapsedMicroseconds;
+	}
+
+	if(mBuffer.size() >= flushSize)
+		Flush();
+}
+
+/** @function TInputRecorder::RecordMouse - Records a mouse event as the difference from the last mouse position
+ *		@param 		type				One of TInputEvent::MOUSE_MOVE, MOUSE_DOWN or MOUSE_UP
+ *		@param 		p					Mouse cursor position when the event occurred
+ */
+void TInputRecorder::RecordMouse(uint8_t type, const TPoint& p)
+{
+	if(!mFile)
+		return;
+
+	mBuffer.push_back(type);
+	WriteVarint(ZigZagEncode(p.x - mLastPoint.x));
+	WriteVarint(ZigZagEncode(p.y - mLastPoint.y));
+	mLastPoint = p;
+}
+
+/** @function TInputRecorder::WriteVarint - Appends value to mBuffer 7 bits at a time, lowest bits first. The top bit of
+ *										   each byte is set if more bytes follow.
+ *		@param 		value				Value to write
+ */
+void TInputRecorder::WriteVarint(uint32_t value)
+{
+	while(value >= 0x80) {
+		mBuffer.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	mBuffer.push_back(uint8_t(value));
+}
+
+/** @function TInputRecorder::Flush - Writes mBuffer to disk and empties it
+ */
+void TInputRecorder::Flush()
+{
+	if(!mBuffer.empty())
+		fwrite(&mBuffer[0], 1, mBuffer.size(), mFile);
+	mBuffer.clear();
+}
+
+
+/** @function TInputReplayer::TInputReplayer - Default Constructor
+ */
+TInputReplayer::TInputReplayer() :
+mData(),
+mReadPos(),
+mSeed(),
+mNext(),
+mHasNext(false),
+mLastPoint(),
+mLastElapsedTime(),
+mTickUnit(1)
+{}
+
+/** @function TInputReplayer::Open - Loads a stream file into memory and reads its header
+ *		@param 		filename			File to replay
+ *
+ *		@return		true if the file was a valid input stream, of this version or the one before
+ */
+bool TInputReplayer::Open(const char* filename)
+{
+	mData.clear();
+	mReadPos = 0;
+	mHasNext = false;
+	mLastPoint = TPoint();
+	mLastElapsedTime = 0;
+
+	FILE* file = fopen(filename, "rb");
+	if(!file)
+		return false;
+
+	uint8_t block[4096];
+	size_t bytesRead;
+	while((bytesRead = fread(block, 1, sizeof(block), file)) > 0)
+		mData.insert(mData.end(), block, block + bytesRead);
+	fclose(file);
+
+	if(mData.size() < 5 || !std::equal(streamMagic, streamMagic + 4, mData.begin()) ||
+	   (mData[4] != streamVersion && mData[4] != millisecondStreamVersion))
+		return false;
+	mTickUnit = (mData[4] == millisecondStreamVersion) ? 1000 : 1;
+
+	mReadPos = 5;
+	return ReadVarint(mSeed);
+}
+
+/** @function TInputReplayer::Peek - Decodes the next event in the stream without consuming it
+ *		@param 		event				Filled in with the next event
+ *
+ *		@return		false if there are no events left
+ */
+bool TInputReplayer::Peek(TInputEvent& event)
+{
+	if(mHasNext) {
+		event = mNext;
+		return true;
+	}
+
+	if(mReadPos >= mData.size())
+		return false;
+
+	uint8_t tag = mData[mReadPos++];
+	if(tag == tickRepeatTag) {
+		mNext.mType = TInputEvent::TICK;
+		mNext.mElapsedMicroseconds = mLastElapsedTime * mTickUnit;
+	}
+	else if(tag == TInputEvent::TICK) {
+		mNext.mType = TInputEvent::TICK;
+		if(!ReadVarint(mLastElapsedTime))
+			return false;
+		mNext.mElapsedMicroseconds = mLastElapsedTime * mTickUnit;
+	}
+	else if(tag <= TInputEvent::MOUSE_UP) {
+		uint32_t dx, dy;
+		if(!ReadVarint(dx) || !ReadVarint(dy))
+			return false;
+		mLastPoint.x += ZigZagDecode(dx);
+		mLastPoint.y += ZigZagDecode(dy);
+		mNext.mType = tag;
+		mNext.mPoint = mLastPoint;
+	}
+	else {
+		// corrupt stream, stop here
+		mReadPos = mData.size();
+		return false;
+	}
+
+	mHasNext = true;
+	event = mNext;
+	return true;
+}
+
+/** @function TInputReplayer::IsFinished - Checks whether every event in the stream has been consumed
+ *
+ *		@return		true if there are no events left
+ */
+bool TInputReplayer::IsFinished()
+{
+	TInputEvent event;
+	return !Peek(event);
+}
+
+/** @function TInputReplayer::ReadVarint - Reads a value written by TInputRecorder::WriteVarint
+ *		@param 		value				Filled in with the value read
+ *
+ *		@return		false if the stream ended part way through the value
+ */
+bool TInputReplayer::ReadVarint(uint32_t& value)
+{
+	value = 0;
+	for(uint32_t shift = 0; shift < 35; shift += 7) {
+		if(mReadPos >= mData.size()) {
+			mReadPos = mData.size();
+			return false;
+		}
+		uint8_t byte = mData[mReadPos++];
+		value |= uint32_t(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,102 @@
+/**
+ *	inputRecorder.h - Jan van der Kamp, 2011
+ */
+#ifndef INPUTRECORDER_H_INCLUDED
+#define INPUTRECORDER_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <cstdio>
+#include <vector>
+
+/** @struct TInputEvent - A single event read back from an input stream. Mouse events carry the cursor position,
+ *						  tick events carry the time in microseconds that the frame was updated by.
+ *
+ *	@property 	uint8_t			mType					One of TICK, MOUSE_MOVE, MOUSE_DOWN or MOUSE_UP
+ *	@property 	TPoint			mPoint					Mouse cursor position for mouse events
+ *	@property 	uint32_t		mElapsedMicroseconds	Time in microseconds since last frame for tick events
+ */
+struct TInputEvent
+{
+	enum {
+		TICK = 0,
+		MOUSE_MOVE,
+		MOUSE_DOWN,
+		MOUSE_UP
+	};
+
+	TInputEvent() : mType(TICK), mPoint(), mElapsedMicroseconds() {}
+	uint8_t		mType;
+	TPoint		mPoint;
+	uint32_t	mElapsedMicroseconds;
+};
+
+/** @class TInputRecorder - Writes every mouse event and every frame's elapsed time to a compact binary stream. The stream
+ *							starts with a small header holding the seed of the game's TRandom, followed by one tag byte per
+ *							event. Tick events store their elapsed time in microseconds as a varint, unless it is the same
+ *							as the last tick in which case the tag alone is written. Mouse events store the zigzag varint
+ *							difference from the last mouse position, so a typical frame costs three or four bytes. Data is
+ *							buffered in memory and written to disk in blocks.
+ *	@property 	FILE*					mFile				File being written to, NULL if not recording
+ *	@property 	std::vector<uint8_t>	mBuffer				Bytes waiting to be written to mFile
+ *	@property 	TPoint					mLastPoint			Last mouse position recorded
+ *	@property 	uint32_t				mLastElapsedTime	Elapsed time of the last tick recorded
+ */
+class TInputRecorder
+{
+public:
+	TInputRecorder();
+	~TInputRecorder();
+	bool				Open(const char* filename, uint32_t seed);
+	void				Close();
+	bool				IsOpen()	const	{ return mFile != NULL; }
+	void				RecordTick(uint32_t elapsedMicroseconds);
+	void				RecordMouse(uint8_t type, const TPoint& p);
+private:
+	// copying disallowed
+	TInputRecorder(const TInputRecorder &recorder);
+	TInputRecorder& operator=(const TInputRecorder &recorder);
+	void				WriteVarint(uint32_t value);
+	void				Flush();
+
+	FILE*					mFile;
+	std::vector<uint8_t>	mBuffer;
+	TPoint					mLastPoint;
+	uint32_t				mLastElapsedTime;
+};
+
+/** @class TInputReplayer - Reads a stream written by TInputRecorder back into memory and hands out its events one at a
+ *							time. Peek decodes the next event without consuming it so that the caller can decide whether
+ *							there is time left in this frame to process it.
+ *	@property 	std::vector<uint8_t>	mData				Contents of the stream
+ *	@property 	size_t					mReadPos			Position of the next undecoded byte in mData
+ *	@property 	uint32_t				mSeed				Seed the recorded game was started with
+ *	@property 	TInputEvent				mNext				Event decoded by Peek and not yet consumed
+ *	@property 	bool					mHasNext			Whether mNext holds a decoded event
+ *	@property 	TPoint					mLastPoint			Last mouse position decoded
+ *	@property 	uint32_t				mLastElapsedTime	Elapsed time of the last tick decoded
+ *	@property 	uint32_t				mTickUnit			Microseconds in each unit of elapsed time in the stream, 1000 for
+ *															the first version of the stream which recorded milliseconds
+ */
+class TInputReplayer
+{
+public:
+	TInputReplayer();
+	bool				Open(const char* filename);
+	uint32_t			GetSeed()		const	{ return mSeed; }
+	bool				Peek(TInputEvent& event);
+	void				Pop()					{ mHasNext = false; }
+	bool				IsFinished();
+private:
+	bool				ReadVarint(uint32_t& value);
+
+	std::vector<uint8_t>	mData;
+	size_t					mReadPos;
+	uint32_t				mSeed;
+	TInputEvent				mNext;
+	bool					mHasNext;
+	TPoint					mLastPoint;
+	uint32_t				mLastElapsedTime;
+	uint32_t				mTickUnit;
+};
+
+#endif // INPUTRECORDER_H_INCLUDED
@@ -0,0 +1,173 @@
+/**
+ *	interceptSolver.cpp - Jan van der Kamp, 2011
+ */
+#include "interceptSolver.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+	#define INTERCEPT_USE_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace {
+	// Targets which would take longer than this to reach are aimed at directly
+	const float		longestLeadTime = 5000.f;
+	// Stops a target moving as fast as a bullet from dividing by zero
+	const float		smallestA = 1e-6f;
+}
+
+/** @function TInterceptSolver::TInterceptSolver - Default Constructor
+ */
+TInterceptSolver::TInterceptSolver() :
+mOrigin(),
+mMuzzleDistance(),
+mBulletSpeed(1.f),
+mCount(),
+mX(),
+mY(),
+mVX(),
+mVY(),
+mTime()
+{}
+
+/** @function TInterceptSolver::Begin - Starts a new batch of targets
+ *		@param 		origin				Position of the base of the cannon
+ *		@param 		muzzleDistance		Distance from the base of the cannon that bullets start at
+ *		@param 		bulletSpeed			Speed of bullets in pixels per millisecond
+ */
+void TInterceptSolver::Begin(const TVec2& origin, TReal muzzleDistance, TReal bulletSpeed)
+{
+	mOrigin = origin;
+	mMuzzleDistance = muzzleDistance;
+	mBulletSpeed = bulletSpeed;
+	mCount = 0;
+}
+
+/** @function TInterceptSolver::Add - Adds a target to the batch
+ *		@param 		position			Position of the target
+ *		@param 		velocity			Velocity of the target
+ */
+void TInterceptSolver::Add(const TVec2& position, const TVec2& velocity)
+{
+	if(mCount == mX.size()) {
+		mX.push_back(0.f);
+		mY.push_back(0.f);
+		mVX.push_back(0.f);
+		mVY.push_back(0.f);
+	}
+	mX[mCount] = position.x - mOrigin.x;
+	mY[mCount] = position.y - mOrigin.y;
+	mVX[mCount] = velocity.x;
+	mVY[mCount] = velocity.y;
+	mCount++;
+}
+
+/** @function TInterceptSolver::Solve - Works out the time to reach every target in the batch. The quadratic
+ *									   a*t^2 + b*t + c = 0 is solved for each, taking the earliest time in the future.
+ *									   Targets which can't be reached, or would take too long, get a time of 0 so that
+ *									   they are aimed at directly.
+ */
+void TInterceptSolver::Solve()
+{
+	// Pad to a whole number of groups of four, the padding is solved but never read
+	uint32_t padded = (mCount + 3) & ~3u;
+	if(mX.size() < padded) {
+		mX.resize(padded, 0.f);
+		mY.resize(padded, 0.f);
+		mVX.resize(padded, 0.f);
+		mVY.resize(padded, 0.f);
+	}
+	if(mTime.size() < padded)
+		mTime.resize(padded, 0.f);
+
+#if defined(INTERCEPT_USE_SSE)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 two = _mm_set1_ps(2.f);
+	const __m128 four = _mm_set1_ps(4.f);
+	const __m128 speed = _mm_set1_ps(mBulletSpeed);
+	const __m128 speedSquared = _mm_set1_ps(mBulletSpeed * mBulletSpeed);
+	const __m128 muzzle = _mm_set1_ps(mMuzzleDistance);
+	const __m128 muzzleSquared = _mm_set1_ps(mMuzzleDistance * mMuzzleDistance);
+	const __m128 muzzleSpeed = _mm_set1_ps(mMuzzleDistance * mBulletSpeed);
+	const __m128 longest = _mm_set1_ps(longestLeadTime);
+	const __m128 minA = _mm_set1_ps(smallestA);
+	const __m128 signMask = _mm_set1_ps(-0.f);
+
+	for(uint32_t t = 0; t != padded; t += 4)
+	{
+		__m128 x = _mm_loadu_ps(&mX[t]);
+		__m128 y = _mm_loadu_ps(&mY[t]);
+		__m128 vx = _mm_loadu_ps(&mVX[t]);
+		__m128 vy = _mm_loadu_ps(&mVY[t]);
+
+		__m128 a = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), speedSquared);
+		__m128 b = _mm_mul_ps(two, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, vx), _mm_mul_ps(y, vy)), muzzleSpeed));
+		__m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), muzzleSquared);
+
+		// a = -smallestA wherever |a| < smallestA
+		__m128 tiny = _mm_cmplt_ps(_mm_andnot_ps(signMask, a), minA);
+		a = _mm_or_ps(_mm_and_ps(tiny, _mm_sub_ps(zero, minA)), _mm_andnot_ps(tiny, a));
+
+		__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four, _mm_mul_ps(a, c)));
+		__m128 solvable = _mm_cmpge_ps(discriminant, zero);
+		__m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+		__m128 twoA = _mm_mul_ps(two, a);
+		__m128 negB = _mm_sub_ps(zero, b);
+		__m128 t1 = _mm_div_ps(_mm_sub_ps(negB, root), twoA);
+		__m128 t2 = _mm_div_ps(_mm_add_ps(negB, root), twoA);
+		__m128 earliest = _mm_min_ps(t1, t2);
+		__m128 latest = _mm_max_ps(t1, t2);
+
+		// Earliest time in the future, or 0 if both are in the past
+		__m128 earliestOk = _mm_cmpgt_ps(earliest, zero);
+		__m128 time = _mm_or_ps(_mm_and_ps(earliestOk, earliest),
+								_mm_andnot_ps(earliestOk, _mm_and_ps(_mm_cmpgt_ps(latest, zero), latest)));
+		__m128 valid = _mm_and_ps(solvable, _mm_cmple_ps(time, longest));
+		_mm_storeu_ps(&mTime[t], _mm_and_ps(valid, time));
+	}
+#else
+	for(uint32_t t = 0; t != padded; t += 4)
+		SolveScalar(t);
+#endif
+}
+
+/** @function TInterceptSolver::SolveScalar - Solves one group of four targets without SSE, in the same way as Solve()
+ *		@param 		first				Index of the first target of the group
+ */
+void TInterceptSolver::SolveScalar(uint32_t first)
+{
+	for(uint32_t t = first; t != first + 4; ++t)
+	{
+		float a = mVX[t] * mVX[t] + mVY[t] * mVY[t] - mBulletSpeed * mBulletSpeed;
+		float b = 2.f * (mX[t] * mVX[t] + mY[t] * mVY[t] - mMuzzleDistance * mBulletSpeed);
+		float c = mX[t] * mX[t] + mY[t] * mY[t] - mMuzzleDistance * mMuzzleDistance;
+		if(fabs(a) < smallestA)
+			a = -smallestA;
+
+		float time = 0.f;
+		float discriminant = b * b - 4.f * a * c;
+		if(discriminant >= 0.f) {
+			float root = sqrtf(discriminant);
+			float t1 = (-b - root) / (2.f * a);
+			float t2 = (-b + root) / (2.f * a);
+			float earliest = t1 < t2 ? t1 : t2;
+			float latest = t1 < t2 ? t2 : t1;
+			time = earliest > 0.f ? earliest : (latest > 0.f ? latest : 0.f);
+			if(time > longestLeadTime)
+				time = 0.f;
+		}
+		mTime[t] = time;
+	}
+}
+
+/** @function TInterceptSolver::GetAimPoint - Gets where a target will be when the bullet reaches it. Must be called after Solve().
+ *		@param 		target				Index of the target, in the order it was added
+ *
+ *		@return		Point to aim at
+ */
+TVec2 TInterceptSolver::GetAimPoint(uint32_t target) const
+{
+	TReal time = mTime[target];
+	return TVec2(mOrigin.x + mX[target] + mVX[target] * time, mOrigin.y + mY[target] + mVY[target] * time);
+}
@@ -0,0 +1,55 @@
+/**
+ *	interceptSolver.h - Jan van der Kamp, 2011
+ */
+#ifndef INTERCEPTSOLVER_H_INCLUDED
+#define INTERCEPTSOLVER_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/vec.h>
+#include <vector>
+
+#include "gameVariables.h"
+
+/** @class TInterceptSolver - Works out where to aim a bullet so that it meets each of a batch of moving targets. Bullets leave
+ *							  the cannon at mMuzzleDistance from its base and fly in a straight line at mBulletSpeed, so the
+ *							  time t to reach a target at offset d from the base, moving with velocity v, solves
+ *							  |d + v*t| = mMuzzleDistance + mBulletSpeed*t. Targets are kept as separate arrays of x, y and
+ *							  velocity so that Solve() can work on four targets at once with SSE where it is available.
+ *							  The arrays are padded to a multiple of four and kept between batches, so solving doesn't allocate
+ *							  once the largest batch has been seen.
+ *
+ *	@property 	TVec2					mOrigin				Position of the base of the cannon
+ *	@property 	TReal					mMuzzleDistance		Distance from the base of the cannon that bullets start at
+ *	@property 	TReal					mBulletSpeed		Speed of bullets in pixels per millisecond
+ *	@property 	uint32_t				mCount				Number of targets in the batch
+ *	@property 	std::vector<float>		mX					Horizontal offset of each target from mOrigin
+ *	@property 	std::vector<float>		mY					Vertical offset of each target from mOrigin
+ *	@property 	std::vector<float>		mVX					Horizontal velocity of each target
+ *	@property 	std::vector<float>		mVY					Vertical velocity of each target
+ *	@property 	std::vector<float>		mTime				Time in milliseconds to reach each target, 0 if it can't be reached
+ */
+class TInterceptSolver
+{
+public:
+	TInterceptSolver();
+	void			Begin(const TVec2& origin, TReal muzzleDistance, TReal bulletSpeed);
+	void			Add(const TVec2& position, const TVec2& velocity);
+	void			Solve();
+	uint32_t		GetCount()					const	{ return mCount; }
+	TReal			GetTime(uint32_t target)	const	{ return mTime[target]; }
+	TVec2			GetAimPoint(uint32_t target) const;
+private:
+	void			SolveScalar(uint32_t first);
+
+	TVec2				mOrigin;
+	TReal				mMuzzleDistance;
+	TReal				mBulletSpeed;
+	uint32_t			mCount;
+	std::vector<float>	mX;
+	std::vector<float>	mY;
+	std::vector<float>	mVX;
+	std::vector<float>	mVY;
+	std::vector<float>	mTime;
+};
+
+#endif // INTERCEPTSOLVER_H_INCLUDED
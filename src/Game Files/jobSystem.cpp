@@ -0,0 +1,392 @@
+/**
+ *	jobSystem.cpp - Jan van der Kamp, 2011
+ */
+#include "jobSystem.h"
+
+#include "timer.h"
+#include "trace.h"
+
+using std::vector;
+
+/** @function TJobGraph::TJobGraph - Default Constructor, the graph starts with no jobs
+ */
+TJobGraph::TJobGraph() :
+mJobs(),
+mRunStartTicks(),
+mRunEndTicks(),
+mRuns(),
+mTotalRunTicks(),
+mMaxRunTicks(),
+mThreads(),
+mReportFile("")
+{}
+
+/** @function TJobGraph::~TJobGraph - Destructor, writes the report if a report file was given
+ */
+TJobGraph::~TJobGraph()
+{
+	WriteReport();
+	Clear();
+}
+
+/** @function TJobGraph::AddJob - Adds a job with no dependencies
+ *		@param 		name				Name of the job for the report, which must outlive the graph
+ *		@param 		function			Function the job runs
+ *		@param 		data				Passed to function
+ *		@param 		index				Passed to function
+ *
+ *		@return		The job, for AddDependency
+ */
+uint32_t TJobGraph::AddJob(const char* name, TJobFunction function, void* data, uint32_t index)
+{
+	TJob* job = new TJob;
+	job->mName = name;
+	job->mFunction = function;
+	job->mData = data;
+	job->mIndex = index;
+	job->mStartTicks = job->mEndTicks = 0;
+	job->mThread = 0;
+	job->mTotalTicks = job->mMaxTicks = 0;
+	mJobs.push_back(job);
+	return uint32_t(mJobs.size() - 1);
+}
+
+/** @function TJobGraph::AddDependency - Makes one job wait for another to finish before it starts
+ *		@param 		job					Job which waits
+ *		@param 		dependency			Job it waits for
+ */
+void TJobGraph::AddDependency(uint32_t job, uint32_t dependency)
+{
+	mJobs[job]->mDependencies.push_back(dependency);
+	mJobs[dependency]->mSuccessors.push_back(job);
+}
+
+/** @function TJobGraph::Clear - Removes every job
+ */
+void TJobGraph::Clear()
+{
+	for(vector<TJob*>::iterator job = mJobs.begin(); job != mJobs.end(); ++job)
+		delete *job;
+	mJobs.clear();
+}
+
+/** @function TJobGraph::GetCriticalPath - Finds the chain of jobs that held up the last run: starting from the job which
+ *										  finished last, each job's dependency which finished last, back to a job with none
+ *		@param 		path				Set to the jobs on the critical path, first to last
+ */
+void TJobGraph::GetCriticalPath(std::vector<uint32_t>& path) const
+{
+	path.clear();
+	if(mJobs.empty())
+		return;
+
+	uint32_t job = 0;
+	for(uint32_t j = 1; j != mJobs.size(); ++j)
+		if(mJobs[j]->mEndTicks > mJobs[job]->mEndTicks)
+			job = j;
+	for(;;) {
+		path.insert(path.begin(), job);
+		const vector<uint32_t>& dependencies = mJobs[job]->mDependencies;
+		if(dependencies.empty())
+			return;
+		job = dependencies[0];
+		for(vector<uint32_t>::const_iterator d = dependencies.begin(); d != dependencies.end(); ++d)
+			if(mJobs[*d]->mEndTicks > mJobs[job]->mEndTicks)
+				job = *d;
+	}
+}
+
+/** @function TJobGraph::WriteReport - Writes the mean and longest time of each job, and when and on which thread each ran
+ *									  in the last run, to the report file as JSON, marking the jobs on the critical path.
+ *									  Times are in microseconds, those of the last run from when it started.
+ *
+ *		@return		true if the file could be written
+ */
+bool TJobGraph::WriteReport() const
+{
+	if(!mReportFile.has_data() || mRuns == 0)
+		return false;
+	FILE* file = fopen(mReportFile.c_str(), "w");
+	if(!file)
+		return false;
+
+	vector<uint32_t> path;
+	GetCriticalPath(path);
+	uint64_t pathTicks = 0;
+	for(vector<uint32_t>::const_iterator job = path.begin(); job != path.end(); ++job)
+		pathTicks += mJobs[*job]->mEndTicks - mJobs[*job]->mStartTicks;
+
+	fprintf(file, "{\n\t\"build\": \"%s %s\",\n\t\"runs\": %u,\n\t\"threads\": %u,\n\t\"meanRunUs\": %.2f,\n"
+				  "\t\"maxRunUs\": %.2f,\n\t\"lastRunUs\": %.2f,\n\t\"lastCriticalPathUs\": %.2f,\n\t\"jobs\": [\n",
+			__DATE__, __TIME__, mRuns, mThreads, THighResTimer::TicksToMilliseconds(mTotalRunTicks) * 1000.0 / mRuns,
+			THighResTimer::TicksToMilliseconds(mMaxRunTicks) * 1000.0,
+			THighResTimer::TicksToMilliseconds(mRunEndTicks - mRunStartTicks) * 1000.0,
+			THighResTimer::TicksToMilliseconds(pathTicks) * 1000.0);
+	for(uint32_t job = 0; job != mJobs.size(); ++job) {
+		bool critical = false;
+		for(vector<uint32_t>::const_iterator p = path.begin(); p != path.end(); ++p)
+			critical = critical || *p == job;
+		WriteJob(file, job, critical, job + 1 == mJobs.size());
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
+
+/** @function TJobGraph::WriteJob - Writes one job's timings
+ *		@param 		file				File to write to
+ *		@param 		job					Job whose timings to write
+ *		@param 		critical			Whether the job is on the critical path of the last run
+ *		@param 		last				Whether this is the last entry of the list being written
+ */
+void TJobGraph::WriteJob(FILE* file, uint32_t job, bool critical, bool last) const
+{
+	const TJob& j = *mJobs[job];
+	fprintf(file, "\t\t{ \"name\": \"%s\", \"index\": %u, \"meanUs\": %.2f, \"maxUs\": %.2f, \"lastStartUs\": %.2f, "
+				  "\"lastEndUs\": %.2f, \"lastThread\": %u, \"critical\": %s, \"dependencies\": [",
+			j.mName, j.mIndex, THighResTimer::TicksToMilliseconds(j.mTotalTicks) * 1000.0 / mRuns,
+			THighResTimer::TicksToMilliseconds(j.mMaxTicks) * 1000.0,
+			THighResTimer::TicksToMilliseconds(j.mStartTicks - mRunStartTicks) * 1000.0,
+			THighResTimer::TicksToMilliseconds(j.mEndTicks - mRunStartTicks) * 1000.0, j.mThread,
+			critical ? "true" : "false");
+	for(vector<uint32_t>::size_type d = 0; d != j.mDependencies.size(); ++d)
+		fprintf(file, "%s%u", d ? ", " : " ", j.mDependencies[d]);
+	fprintf(file, " ] }%s\n", last ? "" : ",");
+}
+
+
+/** @function TJobSystem::TJobSystem - Default Constructor, the system runs graphs on the calling thread alone until started
+ */
+TJobSystem::TJobSystem() :
+mWorkers(),
+mGraph(NULL),
+mRemaining(),
+mBusyWorkers(),
+mStopping(false)
+{
+	TWorker* worker = new TWorker;
+	worker->mSystem = this;
+	worker->mIndex = 0;
+	worker->mFront = 0;
+	worker->mSteals = 0;
+	mWorkers.push_back(worker);
+}
+
+/** @function TJobSystem::~TJobSystem - Destructor, stops the worker threads
+ */
+TJobSystem::~TJobSystem()
+{
+	Stop();
+	delete mWorkers[0];
+}
+
+/** @function TJobSystem::Start - Starts worker threads to share graphs with the thread that calls Run()
+ *		@param 		numWorkers			Number of threads to start
+ *
+ *		@return		true if every thread was started, otherwise graphs are shared between those that were
+ */
+bool TJobSystem::Start(uint32_t numWorkers)
+{
+	Stop();
+	mStopping = false;
+	bool started = true;
+	for(uint32_t w = 0; w != numWorkers; ++w) {
+		TWorker* worker = new TWorker;
+		worker->mSystem = this;
+		worker->mIndex = uint32_t(mWorkers.size());
+		worker->mFront = 0;
+		worker->mSteals = 0;
+		if(!worker->mThread.Start(WorkerMain, worker)) {
+			delete worker;
+			started = false;
+			break;
+		}
+		mWorkers.push_back(worker);
+	}
+	return started;
+}
+
+/** @function TJobSystem::Stop - Stops the worker threads, after which graphs are run on the calling thread alone
+ */
+void TJobSystem::Stop()
+{
+	mStopping = true;
+	for(vector<TWorker*>::size_type w = 1; w < mWorkers.size(); ++w) {
+		mWorkers[w]->mWake.Signal();
+		mWorkers[w]->mThread.Join();
+		delete mWorkers[w];
+	}
+	mWorkers.resize(1);
+}
+
+/** @function TJobSystem::GetSteals - Counts the jobs taken from another thread's deque
+ *
+ *		@return		Number of jobs stolen, over every run
+ */
+uint32_t TJobSystem::GetSteals() const
+{
+	uint32_t steals = 0;
+	for(vector<TWorker*>::const_iterator worker = mWorkers.begin(); worker != mWorkers.end(); ++worker)
+		steals += (*worker)->mSteals;
+	return steals;
+}
+
+/** @function TJobSystem::Run - Runs every job of a graph, returning once they have all finished. Jobs with no dependencies
+ *							   are dealt out between the threads' deques to start with, and everything the jobs wrote can
+ *							   be read once this returns.
+ *		@param 		graph				Graph to run
+ */
+void TJobSystem::Run(TJobGraph& graph)
+{
+	uint32_t numJobs = graph.GetNumJobs();
+	if(numJobs == 0)
+		return;
+
+	mGraph = &graph;
+	graph.mThreads = GetNumThreads();
+	graph.mRunStartTicks = THighResTimer::GetTicks();
+	for(vector<TWorker*>::iterator worker = mWorkers.begin(); worker != mWorkers.end(); ++worker) {
+		(*worker)->mDeque.reserve(numJobs);
+		(*worker)->mDeque.clear();
+		(*worker)->mFront = 0;
+	}
+	uint32_t roots = 0;
+	for(uint32_t job = 0; job != numJobs; ++job) {
+		uint32_t dependencies = uint32_t(graph.mJobs[job]->mDependencies.size());
+		graph.mJobs[job]->mPending.SetValue(long(dependencies));
+		if(dependencies == 0)
+			Push(*mWorkers[roots++ % mWorkers.size()], job);
+	}
+	mRemaining.SetValue(long(numJobs));
+
+	// The workers are woken after everything they read has been set up, and the run isn't over until they have all
+	// stopped looking at the graph
+	mBusyWorkers.SetValue(long(mWorkers.size() - 1));
+	for(vector<TWorker*>::size_type w = 1; w < mWorkers.size(); ++w)
+		mWorkers[w]->mWake.Signal();
+	Work(*mWorkers[0]);
+	while(mBusyWorkers.GetValue() != 0)
+		TThread::YieldTimeSlice();
+
+	graph.mRunEndTicks = THighResTimer::GetTicks();
+	uint64_t runTicks = graph.mRunEndTicks - graph.mRunStartTicks;
+	graph.mRuns++;
+	graph.mTotalRunTicks += runTicks;
+	if(runTicks > graph.mMaxRunTicks)
+		graph.mMaxRunTicks = runTicks;
+	mGraph = NULL;
+}
+
+/** @function TJobSystem::WorkerMain - Entry point of each worker thread, takes part in each run until asked to stop
+ *		@param 		worker				The TWorker
+ */
+void TJobSystem::WorkerMain(void* worker)
+{
+	TWorker& self = *static_cast<TWorker*>(worker);
+	TJobSystem& system = *self.mSystem;
+	char threadName[32];
+	sprintf(threadName, "job worker %u", self.mIndex);
+	TTrace::SetThreadName(threadName);
+	for(;;) {
+		self.mWake.Wait();
+		if(system.mStopping)
+			return;
+		system.Work(self);
+		system.mBusyWorkers.Decrement();
+	}
+}
+
+/** @function TJobSystem::Work - Runs jobs, its own first and then stolen ones, until every job of the graph has finished
+ *		@param 		worker				Worker of the thread calling
+ */
+void TJobSystem::Work(TWorker& worker)
+{
+	while(mRemaining.GetValue() != 0)
+	{
+		uint32_t job;
+		if(Take(worker, job) || Steal(worker, job))
+			Execute(worker, job);
+		else TThread::YieldTimeSlice();
+	}
+}
+
+/** @function TJobSystem::Push - Adds a job that is ready to run to the back of a worker's deque
+ *		@param 		worker				Worker whose deque to add to
+ *		@param 		job					Job to add
+ */
+void TJobSystem::Push(TWorker& worker, uint32_t job)
+{
+	worker.mLock.Lock();
+	worker.mDeque.push_back(job);
+	worker.mLock.Unlock();
+}
+
+/** @function TJobSystem::Take - Takes the job at the back of a worker's own deque, the one most recently made ready
+ *		@param 		worker				Worker taking the job
+ *		@param 		job					Set to the job taken
+ *
+ *		@return		false if the deque was empty
+ */
+bool TJobSystem::Take(TWorker& worker, uint32_t& job)
+{
+	worker.mLock.Lock();
+	bool taken = worker.mDeque.size() > worker.mFront;
+	if(taken) {
+		job = worker.mDeque.back();
+		worker.mDeque.pop_back();
+	}
+	worker.mLock.Unlock();
+	return taken;
+}
+
+/** @function TJobSystem::Steal - Takes the job at the front of another worker's deque, trying each in turn from the
+ *								 one after the thief
+ *		@param 		thief				Worker with nothing left of its own
+ *		@param 		job					Set to the job taken
+ *
+ *		@return		false if every other deque was empty
+ */
+bool TJobSystem::Steal(TWorker& thief, uint32_t& job)
+{
+	uint32_t numWorkers = GetNumThreads();
+	for(uint32_t w = 1; w < numWorkers; ++w)
+	{
+		TWorker& victim = *mWorkers[(thief.mIndex + w) % numWorkers];
+		victim.mLock.Lock();
+		bool taken = victim.mDeque.size() > victim.mFront;
+		if(taken)
+			job = victim.mDeque[victim.mFront++];
+		victim.mLock.Unlock();
+		if(taken) {
+			thief.mSteals++;
+			return true;
+		}
+	}
+	return false;
+}
+
+/** @function TJobSystem::Execute - Runs a job, times it, and pushes the jobs it was the last dependency of onto the
+ *								   worker's own deque
+ *		@param 		worker				Worker of the thread running the job
+ *		@param 		job					Job to run
+ */
+void TJobSystem::Execute(TWorker& worker, uint32_t job)
+{
+	TJobGraph::TJob& j = *mGraph->mJobs[job];
+	j.mStartTicks = THighResTimer::GetTicks();
+	{
+		TRACE_SCOPE(j.mName);
+		j.mFunction(j.mData, j.mIndex);
+	}
+	j.mEndTicks = THighResTimer::GetTicks();
+	j.mThread = worker.mIndex;
+	uint64_t ticks = j.mEndTicks - j.mStartTicks;
+	j.mTotalTicks += ticks;
+	if(ticks > j.mMaxTicks)
+		j.mMaxTicks = ticks;
+
+	for(vector<uint32_t>::const_iterator successor = j.mSuccessors.begin(); successor != j.mSuccessors.end(); ++successor)
+		if(mGraph->mJobs[*successor]->mPending.Decrement() == 0)
+			Push(worker, *successor);
+	mRemaining.Decrement();
+}
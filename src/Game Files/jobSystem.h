@@ -0,0 +1,156 @@
+/**
+ *	jobSystem.h - Jan van der Kamp, 2011
+ */
+#ifndef JOBSYSTEM_H_INCLUDED
+#define JOBSYSTEM_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+#include <cstdio>
+
+#include "threading.h"
+
+/** @class TJobGraph - One frame's work, split into jobs and the dependencies between them, for a TJobSystem to run. Each
+ *					   job is a plain function called with a pointer and an index, so one function can do each chunk of a
+ *					   list. A graph is built once and run every frame. The time each job started and finished in the last
+ *					   run, and which thread ran it, are kept along with totals over every run, so the critical path
+ *					   through a frame can be found, and if Open() has been called they are written to a report as JSON
+ *					   when the graph is destroyed.
+ *	@property 	std::vector<TJob*>		mJobs					Jobs in the order they were added
+ *	@property 	uint64_t				mRunStartTicks			Time the last run started, in THighResTimer ticks
+ *	@property 	uint64_t				mRunEndTicks			Time the last run finished, in THighResTimer ticks
+ *	@property 	uint32_t				mRuns					Number of times the graph has been run
+ *	@property 	uint64_t				mTotalRunTicks			Time spent in every run, in THighResTimer ticks
+ *	@property 	uint64_t				mMaxRunTicks			Longest run, in THighResTimer ticks
+ *	@property 	uint32_t				mThreads				Number of threads the last run was shared between
+ *	@property 	str						mReportFile				File to write the report to, nothing is written if empty
+ */
+class TJobGraph
+{
+public:
+	typedef void (*TJobFunction)(void* data, uint32_t index);
+
+	TJobGraph();
+	~TJobGraph();
+	uint32_t			AddJob(const char* name, TJobFunction function, void* data, uint32_t index = 0);
+	void				AddDependency(uint32_t job, uint32_t dependency);
+	void				Clear();
+	void				Open(const char* reportFile)	{ mReportFile = reportFile; }
+	uint32_t			GetNumJobs()	const	{ return uint32_t(mJobs.size()); }
+	uint32_t			GetRuns()		const	{ return mRuns; }
+	void				GetCriticalPath(std::vector<uint32_t>& path)	const;
+	bool				WriteReport()	const;
+private:
+	friend class TJobSystem;
+
+	/** @struct TJob - One job and how long it took
+	 *	@property 	const char*				mName				Name of the job, for the report
+	 *	@property 	TJobFunction			mFunction			Function the job runs
+	 *	@property 	void*					mData				Passed to mFunction
+	 *	@property 	uint32_t				mIndex				Passed to mFunction
+	 *	@property 	std::vector<uint32_t>	mDependencies		Jobs which must finish before this one starts
+	 *	@property 	std::vector<uint32_t>	mSuccessors			Jobs which depend on this one
+	 *	@property 	TAtomicCounter			mPending			Dependencies not yet finished in the current run
+	 *	@property 	uint64_t				mStartTicks			Time the job started in the last run
+	 *	@property 	uint64_t				mEndTicks			Time the job finished in the last run
+	 *	@property 	uint32_t				mThread				Thread that ran the job in the last run, 0 being the one
+	 *															that called TJobSystem::Run
+	 *	@property 	uint64_t				mTotalTicks			Time spent in the job over every run
+	 *	@property 	uint64_t				mMaxTicks			Longest time spent in the job in one run
+	 */
+	struct TJob
+	{
+		const char*				mName;
+		TJobFunction			mFunction;
+		void*					mData;
+		uint32_t				mIndex;
+		std::vector<uint32_t>	mDependencies;
+		std::vector<uint32_t>	mSuccessors;
+		TAtomicCounter			mPending;
+		uint64_t				mStartTicks;
+		uint64_t				mEndTicks;
+		uint32_t				mThread;
+		uint64_t				mTotalTicks;
+		uint64_t				mMaxTicks;
+	};
+
+	// copying disallowed
+	TJobGraph(const TJobGraph &graph);
+	TJobGraph& operator=(const TJobGraph &graph);
+	void				WriteJob(FILE* file, uint32_t job, bool critical, bool last)	const;
+
+	std::vector<TJob*>	mJobs;
+	uint64_t			mRunStartTicks;
+	uint64_t			mRunEndTicks;
+	uint32_t			mRuns;
+	uint64_t			mTotalRunTicks;
+	uint64_t			mMaxRunTicks;
+	uint32_t			mThreads;
+	str					mReportFile;
+};
+
+/** @class TJobSystem - Runs TJobGraphs on a few worker threads and the thread that calls Run(), which all take part until
+ *						every job is done. Each thread has its own deque of jobs that are ready to run: a thread pushes
+ *						the jobs its own jobs have made ready onto the back of its deque and takes its next job from the
+ *						back, so work stays on the thread whose cache holds its inputs, and a thread with nothing left
+ *						steals from the front of another's deque, taking the oldest, and so usually largest, piece of work.
+ *						A job is ready once its last dependency finishes, which is counted down atomically, so a graph
+ *						runs in an order consistent with its dependencies whatever threads its jobs land on. Deques are
+ *						only locked for the few instructions it takes to push or take a job. Workers sleep between runs.
+ *	@property 	std::vector<TWorker*>	mWorkers				A worker for each thread, the first being the thread calling Run()
+ *	@property 	TJobGraph*				mGraph					Graph being run
+ *	@property 	TAtomicCounter			mRemaining				Jobs of mGraph not yet finished
+ *	@property 	TAtomicCounter			mBusyWorkers			Worker threads still taking part in the current run
+ *	@property 	volatile bool			mStopping				Whether the worker threads have been asked to finish
+ */
+class TJobSystem
+{
+public:
+	TJobSystem();
+	~TJobSystem();
+	bool				Start(uint32_t numWorkers);
+	void				Stop();
+	void				Run(TJobGraph& graph);
+	uint32_t			GetNumThreads()	const	{ return uint32_t(mWorkers.size()); }
+	uint32_t			GetSteals()		const;
+private:
+	/** @struct TWorker - One thread and its deque of jobs
+	 *	@property 	TJobSystem*				mSystem				System the worker belongs to
+	 *	@property 	uint32_t				mIndex				Position of the worker in mWorkers
+	 *	@property 	TThread					mThread				Thread the worker runs on, not started for the first worker
+	 *	@property 	TEvent					mWake				Signalled when a run starts, or to stop
+	 *	@property 	TSpinLock				mLock				Held while the deque is pushed to or taken from
+	 *	@property 	std::vector<uint32_t>	mDeque				Jobs ready to run, from mFront to the back
+	 *	@property 	uint32_t				mFront				Position in mDeque of the job at the front
+	 *	@property 	uint32_t				mSteals				Number of jobs the worker has stolen from others
+	 */
+	struct TWorker
+	{
+		TJobSystem*				mSystem;
+		uint32_t				mIndex;
+		TThread					mThread;
+		TEvent					mWake;
+		TSpinLock				mLock;
+		std::vector<uint32_t>	mDeque;
+		uint32_t				mFront;
+		uint32_t				mSteals;
+	};
+
+	// copying disallowed
+	TJobSystem(const TJobSystem &system);
+	TJobSystem& operator=(const TJobSystem &system);
+	static void			WorkerMain(void* worker);
+	void				Work(TWorker& worker);
+	void				Push(TWorker& worker, uint32_t job);
+	bool				Take(TWorker& worker, uint32_t& job);
+	bool				Steal(TWorker& thief, uint32_t& job);
+	void				Execute(TWorker& worker, uint32_t job);
+
+	std::vector<TWorker*>	mWorkers;
+	TJobGraph*				mGraph;
+	TAtomicCounter			mRemaining;
+	TAtomicCounter			mBusyWorkers;
+	volatile bool			mStopping;
+};
+
+#endif // JOBSYSTEM_H_INCLUDED
@@ -0,0 +1,221 @@
+/**
+ *	perfStats.cpp - Jan van der Kamp, 2011
+ */
+#include "perfStats.h"
+
+#include <cstring>
+
+#include "trace.h"
+
+namespace {
+	/** @struct TTimeStat - A frame time percentile the stats table has, read from a THistogram
+	 *	@property 	const char*		mName				Name of the stat in Lua
+	 *	@property 	uint16_t		mPhase				TFrameStats::FRAME, UPDATE or DRAW
+	 *	@property 	double			mPercentile			Percentile of the phase's times, 100 being the longest
+	 */
+	struct TTimeStat
+	{
+		const char*		mName;
+		uint16_t		mPhase;
+		double			mPercentile;
+	};
+
+	const TTimeStat timeStats[] = {
+		{ "frameTimeP50", TFrameStats::FRAME, 50.0 }, { "frameTimeP95", TFrameStats::FRAME, 95.0 },
+		{ "frameTimeP99", TFrameStats::FRAME, 99.0 }, { "frameTimeMax", TFrameStats::FRAME, 100.0 },
+		{ "updateTimeP50", TFrameStats::UPDATE, 50.0 }, { "updateTimeP95", TFrameStats::UPDATE, 95.0 },
+		{ "updateTimeP99", TFrameStats::UPDATE, 99.0 }, { "updateTimeMax", TFrameStats::UPDATE, 100.0 },
+		{ "drawTimeP50", TFrameStats::DRAW, 50.0 }, { "drawTimeP95", TFrameStats::DRAW, 95.0 },
+		{ "drawTimeP99", TFrameStats::DRAW, 99.0 }, { "drawTimeMax", TFrameStats::DRAW, 100.0 }
+	};
+}
+
+TPerfStats* TPerfStats::mRegistered = NULL;
+
+/** @function TPerfStats::TPerfStats - Constructor, collecting COUNTS
+ *		@param 		frameStats			Frame times to read percentiles from, which must outlive this
+ *		@param 		allocations			Allocation counts to read, which must outlive this
+ */
+TPerfStats::TPerfStats(const TFrameStats& frameStats, const TAllocationTracker& allocations) :
+mFrameStats(frameStats),
+mAllocations(allocations),
+mLevel(COUNTS),
+mBalloons(),
+mBullets(),
+mDrawCalls(),
+mCulledBalls(),
+mFrameAllocations(),
+mAssetLoadTime(),
+mStartupTime()
+{}
+
+/** @function TPerfStats::~TPerfStats - Destructor, the stats table reads nil and draw calls stop being counted for it
+ *									   from then on if this was registered
+ */
+TPerfStats::~TPerfStats()
+{
+	if(mRegistered == this) {
+		mRegistered = NULL;
+		TTrace::SetCountingDrawCalls(false);
+	}
+}
+
+/** @function TPerfStats::Register - Sets the global stats table and SetStatsLevel function in a Lua state, which read this
+ *		@param 		L					Lua state to set them in
+ */
+void TPerfStats::Register(lua_State* L)
+{
+	mRegistered = this;
+	TTrace::SetCountingDrawCalls(mLevel != OFF);
+
+	// The table stays empty, its metatable looks every value up when it is read and refuses to set any
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_pushcfunction(L, Index);
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, NewIndex);
+	lua_setfield(L, -2, "__newindex");
+	lua_pushstring(L, "read-only");
+	lua_setfield(L, -2, "__metatable");
+	lua_setmetatable(L, -2);
+	lua_setglobal(L, "stats");
+
+	lua_pushcfunction(L, SetLevel);
+	lua_setglobal(L, "SetStatsLevel");
+}
+
+/** @function TPerfStats::SetLoadTimes - Keeps how long the game took to start
+ *		@param 		assetLoadTime		Time in milliseconds spent loading assets
+ *		@param 		startupTime			Time in milliseconds the game took to start, loading included
+ */
+void TPerfStats::SetLoadTimes(double assetLoadTime, double startupTime)
+{
+	mAssetLoadTime = assetLoadTime;
+	mStartupTime = startupTime;
+}
+
+/** @function TPerfStats::EndFrame - Keeps the counts of a frame, unless OFF, and its allocations at FULL
+ *		@param 		balloons			Balloons in play
+ *		@param 		bullets				Bullets in play
+ *		@param 		frameAllocations	Heap allocations made during the frame
+ */
+void TPerfStats::EndFrame(uint32_t balloons, uint32_t bullets, uint32_t frameAllocations)
+{
+	if(mLevel == OFF)
+		return;
+	mBalloons = balloons;
+	mBullets = bullets;
+	if(mLevel == FULL)
+		mFrameAllocations = frameAllocations;
+}
+
+/** @function TPerfStats::SetDrawCalls - Keeps the counts of a draw, unless OFF
+ *		@param 		drawCalls			Sprites and shapes drawn
+ *		@param 		culledBalls			Balls culled rather than drawn
+ */
+void TPerfStats::SetDrawCalls(int32_t drawCalls, uint32_t culledBalls)
+{
+	if(mLevel == OFF)
+		return;
+	mDrawCalls = drawCalls;
+	mCulledBalls = culledBalls;
+}
+
+/** @function TPerfStats::PushStat - Pushes the value of a stat onto a Lua state's stack
+ *		@param 		L					Lua state to push onto
+ *		@param 		name				Name of the stat
+ *
+ *		@return		false, having pushed nothing, if there is no such stat or it isn't collected at the current level
+ */
+bool TPerfStats::PushStat(lua_State* L, const char* name) const
+{
+	if(strcmp(name, "level") == 0) {
+		lua_pushnumber(L, mLevel);
+		return true;
+	}
+	if(mLevel == OFF)
+		return false;
+
+	for(uint32_t s = 0; s != sizeof(timeStats) / sizeof(timeStats[0]); ++s)
+		if(strcmp(name, timeStats[s].mName) == 0) {
+			const THistogram& histogram = mFrameStats.GetSessionHistogram(timeStats[s].mPhase);
+			uint32_t microseconds = timeStats[s].mPercentile < 100.0 ? histogram.GetPercentile(timeStats[s].mPercentile) :
+																	   histogram.GetMax();
+			lua_pushnumber(L, microseconds / 1000.0);
+			return true;
+		}
+
+	double value;
+	if(strcmp(name, "frames") == 0)
+		value = mFrameStats.GetSessionHistogram(TFrameStats::FRAME).GetTotal();
+	else if(strcmp(name, "balloons") == 0)
+		value = mBalloons;
+	else if(strcmp(name, "bullets") == 0)
+		value = mBullets;
+	else if(strcmp(name, "drawCalls") == 0)
+		value = mDrawCalls;
+	else if(strcmp(name, "culledBalls") == 0)
+		value = mCulledBalls;
+	else if(strcmp(name, "assetLoadTime") == 0)
+		value = mAssetLoadTime;
+	else if(strcmp(name, "startupTime") == 0)
+		value = mStartupTime;
+	else if(mLevel != FULL)
+		return false;
+	else if(strcmp(name, "frameAllocations") == 0)
+		value = mFrameAllocations;
+	else if(strcmp(name, "totalAllocations") == 0)
+		value = TAllocationTracker::GetAllocationCount();
+	else if(strcmp(name, "flaggedFrames") == 0)
+		value = mAllocations.GetFlaggedFrames();
+	else return false;
+
+	lua_pushnumber(L, value);
+	return true;
+}
+
+/** @function TPerfStats::Index - __index of the stats table, looks up the value of a stat
+ *		@param 		L					Lua state, holding the table and the name of the stat
+ *
+ *		@return		1, the value or nil having been pushed
+ */
+int TPerfStats::Index(lua_State* L)
+{
+	const char* name = lua_tostring(L, 2);
+	if(!mRegistered || !name || !mRegistered->PushStat(L, name))
+		lua_pushnil(L);
+	return 1;
+}
+
+/** @function TPerfStats::NewIndex - __newindex of the stats table, raises an error since the table is read-only
+ *		@param 		L					Lua state
+ *
+ *		@return		Doesn't return
+ */
+int TPerfStats::NewIndex(lua_State* L)
+{
+	lua_pushstring(L, "stats is read-only");
+	return lua_error(L);
+}
+
+/** @function TPerfStats::SetLevel - SetStatsLevel(level) in Lua, sets the level stats are collected at. Draw calls are
+ *								   only counted for the table above OFF.
+ *		@param 		L					Lua state, holding the level: 0 for OFF, 1 for COUNTS or 2 for FULL
+ *
+ *		@return		1, the level before having been pushed, or nil if no TPerfStats is registered
+ */
+int TPerfStats::SetLevel(lua_State* L)
+{
+	if(!lua_isnumber(L, 1) || lua_tonumber(L, 1) < OFF || lua_tonumber(L, 1) > FULL) {
+		lua_pushstring(L, "SetStatsLevel takes a level from 0 to 2");
+		return lua_error(L);
+	}
+	if(!mRegistered) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_pushnumber(L, mRegistered->mLevel);
+	mRegistered->mLevel = uint16_t(lua_tonumber(L, 1));
+	TTrace::SetCountingDrawCalls(mRegistered->mLevel != OFF);
+	return 1;
+}
@@ -0,0 +1,72 @@
+/**
+ *	perfStats.h - Jan van der Kamp, 2011
+ */
+#ifndef PERFSTATS_H_INCLUDED
+#define PERFSTATS_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/script.h>
+
+#include "frameStats.h"
+#include "allocationTracker.h"
+
+/** @class TPerfStats - Lets Lua scripts read how the game is performing, for debug HUDs and scripted performance checks.
+ *						Register() sets a global table called stats in a Lua state, which is read-only and empty: each
+ *						value is looked up when it is read, so nothing is worked out for Lua unless a script asks for it.
+ *						Frame, update and draw time percentiles are read straight from the game's TFrameStats, in
+ *						milliseconds, as frameTimeP50, frameTimeP95, frameTimeP99 and frameTimeMax, and the same for
+ *						updateTime and drawTime, along with frames. The game hands over balloons, bullets, drawCalls
+ *						and culledBalls each frame, and assetLoadTime and startupTime, in milliseconds, once it has
+ *						started. At the FULL level frameAllocations, totalAllocations and flaggedFrames are read from its
+ *						TAllocationTracker too. The registered function SetStatsLevel(level) sets the level, OFF, COUNTS
+ *						or FULL as 0 to 2, and returns the level it was at; stats.level reads it. Stats a level doesn't
+ *						show aren't collected: while OFF nothing is handed over, draw calls aren't counted and the game
+ *						stops recording frame times unless it is writing a frame stats file, and every stat but level
+ *						reads nil. Below FULL frame allocations aren't kept. Only one TPerfStats can be registered at once.
+ *	@property 	TPerfStats*				mRegistered				The TPerfStats the stats table reads, NULL if none
+ *	@property 	const TFrameStats&		mFrameStats				Frame times to read percentiles from
+ *	@property 	const TAllocationTracker&	mAllocations		Allocation counts to read
+ *	@property 	uint16_t				mLevel					OFF, COUNTS or FULL
+ *	@property 	uint32_t				mBalloons				Balloons in play at the end of the last frame
+ *	@property 	uint32_t				mBullets				Bullets in play at the end of the last frame
+ *	@property 	int32_t					mDrawCalls				Sprites and shapes drawn by the last draw
+ *	@property 	uint32_t				mCulledBalls			Balls the last draw culled rather than drew
+ *	@property 	uint32_t				mFrameAllocations		Heap allocations made during the last frame
+ *	@property 	double					mAssetLoadTime			Time in milliseconds spent loading assets
+ *	@property 	double					mStartupTime			Time in milliseconds the game took to start
+ */
+class TPerfStats
+{
+public:
+	enum { OFF = 0, COUNTS, FULL };
+
+	TPerfStats(const TFrameStats& frameStats, const TAllocationTracker& allocations);
+	~TPerfStats();
+	void				Register(lua_State* L);
+	uint16_t			GetLevel()	const	{ return mLevel; }
+	void				SetLoadTimes(double assetLoadTime, double startupTime);
+	void				EndFrame(uint32_t balloons, uint32_t bullets, uint32_t frameAllocations);
+	void				SetDrawCalls(int32_t drawCalls, uint32_t culledBalls);
+private:
+	// copying disallowed
+	TPerfStats(const TPerfStats &stats);
+	TPerfStats& operator=(const TPerfStats &stats);
+	bool				PushStat(lua_State* L, const char* name)	const;
+	static int			Index(lua_State* L);
+	static int			NewIndex(lua_State* L);
+	static int			SetLevel(lua_State* L);
+
+	static TPerfStats*			mRegistered;
+	const TFrameStats&			mFrameStats;
+	const TAllocationTracker&	mAllocations;
+	uint16_t					mLevel;
+	uint32_t					mBalloons;
+	uint32_t					mBullets;
+	int32_t						mDrawCalls;
+	uint32_t					mCulledBalls;
+	uint32_t					mFrameAllocations;
+	double						mAssetLoadTime;
+	double						mStartupTime;
+};
+
+#endif // PERFSTATS_H_INCLUDED
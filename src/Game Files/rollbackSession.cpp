@@ -0,0 +1,308 @@
+/**
+ *	rollbackSession.cpp - Jan van der Kamp, 2011
+ */
+#include "rollbackSession.h"
+
+#include "timer.h"
+
+using std::vector;
+
+namespace {
+	// rollbackFrame when nothing needs rolling back
+	const uint32_t	noRollback = 0xFFFFFFFF;
+	// Size of a packet's ack, first frame and input count, followed by inputSize bytes for each input
+	const uint32_t	headerSize = 10;
+	const uint32_t	inputSize = 5;
+
+	// Packets are little endian whatever the machine, so that different builds can play each other
+	void WriteUInt(vector<uint8_t>& packet, uint32_t value, uint32_t bytes)
+	{
+		for(uint32_t b = 0; b != bytes; ++b)
+			packet.push_back(uint8_t(value >> (b * 8)));
+	}
+
+	uint32_t ReadUInt(const uint8_t* data, uint32_t bytes)
+	{
+		uint32_t value = 0;
+		for(uint32_t b = 0; b != bytes; ++b)
+			value |= uint32_t(data[b]) << (b * 8);
+		return value;
+	}
+}
+
+/** @function TRollbackSession::TRollbackStats::TRollbackStats - Default Constructor
+ */
+TRollbackSession::TRollbackStats::TRollbackStats() :
+mFrames(),
+mRollbacks(),
+mResimulatedFrames(),
+mMaxDepth(),
+mResimulateTicks(),
+mMaxResimulateTicks(),
+mStalls(),
+mGarbageSent(),
+mPacketsSent(),
+mPacketsReceived()
+{
+	for(uint32_t d = 0; d != gameVars::maxRollbackFrames + 1; ++d)
+		mDepthCounts[d] = 0;
+}
+
+
+/** @function TRollbackSession::TRollbackSession - Constructor			Takes parameters to construct session with
+ *		@param 		transport			Carries packets to and from the opponent
+ *		@param 		localPlayer			Board of the player using this session, 0 or 1
+ *		@param 		tick				Time in milliseconds of each frame
+ *		@param 		maxGameTime			Time in milliseconds after which the game is stopped if neither player has lost
+ */
+TRollbackSession::TRollbackSession(ITransport& transport, uint32_t localPlayer, uint32_t tick, uint32_t maxGameTime) :
+mTransport(transport),
+mLocalPlayer(localPlayer & 1),
+mTick(tick ? tick : 16),
+mMaxFrames(maxGameTime / (tick ? tick : 16) ? maxGameTime / (tick ? tick : 16) : 1),
+mFrame(),
+mRemoteConfirmed(),
+mPeerAck(),
+mRollbackFrame(noRollback),
+mEndFrame(),
+mWinner(-1),
+mPacket(),
+mStats()
+{
+	for(uint32_t player = 0; player != 2; ++player)
+		mBoards[player] = new TSimulation(TStateVariables());
+	for(uint32_t frame = 0; frame != SNAPSHOT_HISTORY; ++frame)
+		mGarbage[frame] = 0;
+	mPacket.reserve(headerSize + INPUT_HISTORY * inputSize);
+}
+
+/** @function TRollbackSession::~TRollbackSession - Destructor
+ */
+TRollbackSession::~TRollbackSession()
+{
+	for(uint32_t player = 0; player != 2; ++player)
+		delete mBoards[player];
+}
+
+/** @function TRollbackSession::AssignAssets - Gives both boards the game's assets, which must be done before Start
+ *		@param 		ballAssets					Textures used for balloons and bullets
+ *		@param 		barrierTextures				Textures used for the barrier
+ *		@param 		cannonTexture				Texture used for the cannon
+ */
+void TRollbackSession::AssignAssets(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+								   const TTextureRef& cannonTexture)
+{
+	for(uint32_t player = 0; player != 2; ++player)
+		mBoards[player]->AssignAssets(ballAssets, barrierTextures, cannonTexture);
+}
+
+/** @function TRollbackSession::Start - Starts a new game. Both players must start with the same settings and seed.
+ *		@param 		stateVariables		Difficulty both boards start at
+ *		@param 		seed				Seed of both boards, so that both players get the same balloons
+ */
+void TRollbackSession::Start(const TStateVariables& stateVariables, uint32_t seed)
+{
+	for(uint32_t player = 0; player != 2; ++player) {
+		mBoards[player]->Seed(seed);
+		mBoards[player]->Reset(stateVariables);
+		for(uint32_t frame = 0; frame != INPUT_HISTORY; ++frame)
+			mInputs[player][frame] = TPlayerInput();
+	}
+	mFrame = 0;
+	mRemoteConfirmed = 0;
+	mPeerAck = 0;
+	mRollbackFrame = noRollback;
+	mEndFrame = 0;
+	mWinner = -1;
+	mStats = TRollbackStats();
+}
+
+/** @function TRollbackSession::Update - Takes in the opponent's input, rolling back if any of it was predicted wrongly, and
+ *										 sends the local input the opponent hasn't acknowledged. This should be called once
+ *										 a frame even after the game has ended, so that the opponent gets the last inputs.
+ *
+ *		@return		true if AdvanceFrame should be called this frame, false if the game has ended or the session is
+ *					waiting for the opponent to catch up
+ */
+bool TRollbackSession::Update()
+{
+	Receive();
+	if(mRollbackFrame != noRollback)
+		Rollback();
+	Send();
+
+	if(mEndFrame)
+		return false;
+	if(mFrame >= mRemoteConfirmed + gameVars::maxRollbackFrames || mFrame >= mPeerAck + gameVars::maxRollbackFrames * 2) {
+		mStats.mStalls++;
+		return false;
+	}
+	return true;
+}
+
+/** @function TRollbackSession::AdvanceFrame - Simulates the next frame with the local player's input. Should only be called
+ *											   when Update has returned true.
+ *		@param 		input				What the local player did this frame
+ */
+void TRollbackSession::AdvanceFrame(const TPlayerInput& input)
+{
+	Input(mLocalPlayer, mFrame) = input;
+	if(mFrame >= mRemoteConfirmed)
+		Input(1 - mLocalPlayer, mFrame) = TPlayerInput();
+	SimulateFrame();
+	mStats.mFrames++;
+}
+
+/** @function TRollbackSession::IsFinished - Checks whether the game has ended and every input before the end has been
+ *											 confirmed, so that the result can't change
+ *
+ *		@return		true if the result is final
+ */
+bool TRollbackSession::IsFinished() const
+{
+	return mEndFrame && mRemoteConfirmed >= mEndFrame;
+}
+
+/** @function TRollbackSession::Receive - Reads every packet that has arrived. Inputs are confirmed strictly in frame order,
+ *										  and an input for a frame already simulated that doesn't match its prediction marks
+ *										  the boards to be rolled back to that frame.
+ */
+void TRollbackSession::Receive()
+{
+	uint32_t remotePlayer = 1 - mLocalPlayer;
+	while(mTransport.Receive(mPacket))
+	{
+		mStats.mPacketsReceived++;
+		if(mPacket.size() < headerSize)
+			continue;
+		const uint8_t* data = &mPacket[0];
+		uint32_t ack = ReadUInt(data, 4);
+		uint32_t firstFrame = ReadUInt(data + 4, 4);
+		uint32_t count = ReadUInt(data + 8, 2);
+		if(mPacket.size() != headerSize + count * inputSize)
+			continue;
+
+		if(ack > mPeerAck)
+			mPeerAck = ack;
+		data += headerSize;
+		for(uint32_t i = 0; i != count; ++i, data += inputSize)
+		{
+			uint32_t frame = firstFrame + i;
+			if(frame < mRemoteConfirmed)
+				continue;
+			// The opponent can't be further ahead than this, so anything beyond it is from a damaged packet
+			if(frame > mRemoteConfirmed || frame >= mFrame + gameVars::maxRollbackFrames * 2)
+				break;
+
+			TPlayerInput input(int16_t(ReadUInt(data, 2)), int16_t(ReadUInt(data + 2, 2)), data[4]);
+			TPlayerInput& stored = Input(remotePlayer, frame);
+			if(frame < mFrame && stored != input && frame < mRollbackFrame)
+				mRollbackFrame = frame;
+			stored = input;
+			mRemoteConfirmed++;
+		}
+	}
+}
+
+/** @function TRollbackSession::Send - Sends every local input from the first one the opponent hasn't acknowledged, along
+ *									   with how many of the opponent's inputs have been confirmed
+ */
+void TRollbackSession::Send()
+{
+	uint32_t firstFrame = mPeerAck < mFrame ? mPeerAck : mFrame;
+	uint32_t count = mFrame - firstFrame;
+
+	mPacket.clear();
+	WriteUInt(mPacket, mRemoteConfirmed, 4);
+	WriteUInt(mPacket, firstFrame, 4);
+	WriteUInt(mPacket, count, 2);
+	for(uint32_t frame = firstFrame; frame != mFrame; ++frame) {
+		const TPlayerInput& input = Input(mLocalPlayer, frame);
+		WriteUInt(mPacket, uint16_t(input.mAimX), 2);
+		WriteUInt(mPacket, uint16_t(input.mAimY), 2);
+		WriteUInt(mPacket, input.mButtons, 1);
+	}
+	mTransport.Send(&mPacket[0], uint32_t(mPacket.size()));
+	mStats.mPacketsSent++;
+}
+
+/** @function TRollbackSession::Rollback - Restores both boards to the start of mRollbackFrame and simulates every frame
+ *										   since again. If the game now ends sooner, the frames after the end are dropped.
+ */
+void TRollbackSession::Rollback()
+{
+	uint64_t start = THighResTimer::GetTicks();
+	uint32_t depth = mFrame - mRollbackFrame;
+	uint32_t lastFrame = mFrame;
+
+	for(uint32_t player = 0; player != 2; ++player)
+		mSnapshots[player][mRollbackFrame % SNAPSHOT_HISTORY].Restore(*mBoards[player]);
+	for(uint32_t frame = mRollbackFrame; frame != lastFrame; ++frame)
+		mStats.mGarbageSent -= mGarbage[frame % SNAPSHOT_HISTORY];
+	mFrame = mRollbackFrame;
+	mRollbackFrame = noRollback;
+	mEndFrame = 0;
+	mWinner = -1;
+	while(mFrame != lastFrame && !mEndFrame) {
+		SimulateFrame();
+		mStats.mResimulatedFrames++;
+	}
+
+	uint64_t ticks = THighResTimer::GetTicks() - start;
+	mStats.mRollbacks++;
+	mStats.mResimulateTicks += ticks;
+	if(ticks > mStats.mMaxResimulateTicks)
+		mStats.mMaxResimulateTicks = ticks;
+	if(depth > mStats.mMaxDepth)
+		mStats.mMaxDepth = depth;
+	mStats.mDepthCounts[depth < gameVars::maxRollbackFrames ? depth : gameVars::maxRollbackFrames]++;
+}
+
+/** @function TRollbackSession::SimulateFrame - Takes a snapshot of both boards, then plays frame mFrame on both with the
+ *											  players' inputs and drops balloons on each board for the other's bursts.
+ *											  Garbage balloons are placed from a hash of the frame, so rolling back and
+ *											  simulating again places them in the same places.
+ */
+void TRollbackSession::SimulateFrame()
+{
+	uint16_t burstBefore[2];
+	bool gameOver[2];
+	for(uint32_t player = 0; player != 2; ++player) {
+		TSimulation& board = *mBoards[player];
+		mSnapshots[player][mFrame % SNAPSHOT_HISTORY].Take(board);
+		burstBefore[player] = board.GetBalloonManager().GetStateVariables().mBalloonsBurstSoFar;
+		board.ApplyInput(Input(player, mFrame));
+	}
+	for(uint32_t player = 0; player != 2; ++player)
+		gameOver[player] = mBoards[player]->Update(mTick);
+
+	for(uint32_t player = 0; player != 2; ++player)
+	{
+		uint16_t burstAfter = mBoards[player]->GetBalloonManager().GetStateVariables().mBalloonsBurstSoFar;
+		uint32_t garbage = burstAfter / gameVars::burstsPerGarbage - burstBefore[player] / gameVars::burstsPerGarbage;
+		if(player == mLocalPlayer) {
+			mGarbage[mFrame % SNAPSHOT_HISTORY] = garbage;
+			mStats.mGarbageSent += garbage;
+		}
+		TBalloonManager& opponent = mBoards[1 - player]->GetBalloonManager();
+		const TStateVariables& vars = opponent.GetStateVariables();
+		uint32_t radius = opponent.GetBalloonRadius();
+		for(uint32_t g = 0; g != garbage; ++g) {
+			TRandom random((mFrame * 2 + player) * 2654435761u + g * 0x9E3779B9);
+			TReal xPosition = TReal(radius + random.Rand() % (opponent.GetBounds().x2 - radius * 2));
+			uint16_t colour = uint16_t(random.Rand() % (vars.mNumColoursInPlay - 1));
+			opponent.SpawnBalloon(xPosition, vars.mBalloonVelocity, colour);
+		}
+	}
+
+	mFrame++;
+	if(gameOver[0] || gameOver[1] || mFrame >= mMaxFrames) {
+		mEndFrame = mFrame;
+		if(gameOver[0] != gameOver[1])
+			mWinner = gameOver[0] ? 1 : 0;
+		else if(!gameOver[0]) {
+			uint16_t score0 = mBoards[0]->GetBalloonManager().GetScore(), score1 = mBoards[1]->GetBalloonManager().GetScore();
+			mWinner = score0 == score1 ? -1 : (score0 > score1 ? 0 : 1);
+		}
+	}
+}
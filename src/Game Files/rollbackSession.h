@@ -0,0 +1,127 @@
+/**
+ *	rollbackSession.h - Jan van der Kamp, 2011
+ */
+#ifndef ROLLBACKSESSION_H_INCLUDED
+#define ROLLBACKSESSION_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "gameVariables.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "transport.h"
+
+/** @class TRollbackSession - One player's side of a versus game. Each player has their own board, a TSimulation, and
+ *							  every balloon a player bursts counts towards dropping balloons on the opponent's board, one
+ *							  for every gameVars::burstsPerGarbage. Both players' sessions simulate both boards, so only
+ *							  the players' inputs are sent over the ITransport.
+ *							  A player's own input is applied straight away, without waiting to hear from the opponent.
+ *							  Until the opponent's input for a frame arrives it is predicted to be nothing, which is right
+ *							  for most frames since the cannon is only touched every few hundred milliseconds. When an input
+ *							  arrives that doesn't match its prediction, both boards are restored to how they were at the
+ *							  start of that frame from a TSimulationSnapshot and every frame since is simulated again with
+ *							  the input corrected. Snapshots of the boards are taken at the start of every frame, kept for
+ *							  the last gameVars::maxRollbackFrames frames, and a player waits for the opponent rather than
+ *							  running further ahead than that. Each packet sent carries every input the opponent hasn't
+ *							  acknowledged yet, so lost packets don't need to be resent on their own.
+ *							  How far and how often the game rolls back, and what simulating frames again costs, is kept in
+ *							  a TRollbackStats.
+ *
+ *	@property 	ITransport&							mTransport				Carries packets to and from the opponent
+ *	@property 	uint32_t							mLocalPlayer			Board of the player using this session, 0 or 1
+ *	@property 	uint32_t							mTick					Time in milliseconds of each frame
+ *	@property 	uint32_t							mMaxFrames				Frame after which the game is stopped if neither player has lost
+ *	@property 	TSimulation*						mBoards[2]				Board of each player
+ *	@property 	uint32_t							mFrame					Next frame to simulate
+ *	@property 	uint32_t							mRemoteConfirmed		Number of frames the opponent's input is known for
+ *	@property 	uint32_t							mPeerAck				Number of frames the opponent has acknowledged the local input for
+ *	@property 	uint32_t							mRollbackFrame			Earliest frame which was simulated with a wrong prediction
+ *	@property 	uint32_t							mEndFrame				Frame the game ended at, or 0 if it hasn't ended
+ *	@property 	int32_t								mWinner					Board that won, or -1 for a draw
+ *	@property 	TPlayerInput						mInputs[2][INPUT_HISTORY]	Input of each player for recent frames, by frame number
+ *	@property 	TSimulationSnapshot					mSnapshots[2][SNAPSHOT_HISTORY]	Each board at the start of recent frames
+ *	@property 	uint32_t							mGarbage[SNAPSHOT_HISTORY]	Balloons the local player dropped on the opponent in
+ *																				recent frames, taken off mStats when they are rolled back
+ *	@property 	std::vector<uint8_t>				mPacket					Packet being sent or received, kept to save allocating
+ *	@property 	TRollbackStats						mStats					How the session has gone
+ */
+class TRollbackSession
+{
+public:
+	/** @struct TRollbackStats - How often a session has rolled back and what it has cost
+	 *	@property 	uint32_t		mFrames					Frames simulated for the first time
+	 *	@property 	uint32_t		mRollbacks				Number of times the boards were rolled back
+	 *	@property 	uint32_t		mResimulatedFrames		Frames simulated again after rolling back
+	 *	@property 	uint32_t		mMaxDepth				Most frames rolled back at once
+	 *	@property 	uint32_t		mDepthCounts[]			Number of rollbacks of each depth
+	 *	@property 	uint64_t		mResimulateTicks		THighResTimer ticks spent rolling back and simulating again
+	 *	@property 	uint64_t		mMaxResimulateTicks		Most ticks spent on one rollback
+	 *	@property 	uint32_t		mStalls					Frames spent waiting for the opponent
+	 *	@property 	uint32_t		mGarbageSent			Balloons the local player dropped on the opponent's board
+	 *	@property 	uint32_t		mPacketsSent			Packets sent
+	 *	@property 	uint32_t		mPacketsReceived		Packets received
+	 */
+	struct TRollbackStats
+	{
+		TRollbackStats();
+
+		uint32_t	mFrames;
+		uint32_t	mRollbacks;
+		uint32_t	mResimulatedFrames;
+		uint32_t	mMaxDepth;
+		uint32_t	mDepthCounts[gameVars::maxRollbackFrames + 1];
+		uint64_t	mResimulateTicks;
+		uint64_t	mMaxResimulateTicks;
+		uint32_t	mStalls;
+		uint32_t	mGarbageSent;
+		uint32_t	mPacketsSent;
+		uint32_t	mPacketsReceived;
+	};
+
+	enum {	INPUT_HISTORY = gameVars::maxRollbackFrames * 4,
+			SNAPSHOT_HISTORY = gameVars::maxRollbackFrames + 1 };
+
+	TRollbackSession(ITransport& transport, uint32_t localPlayer, uint32_t tick, uint32_t maxGameTime);
+	~TRollbackSession();
+	void						AssignAssets(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+											 const TTextureRef& cannonTexture);
+	void						Start(const TStateVariables& stateVariables, uint32_t seed);
+	bool						Update();
+	void						AdvanceFrame(const TPlayerInput& input);
+	bool						IsFinished()		const;
+	TSimulation&				GetBoard(uint32_t player)			{ return *mBoards[player & 1]; }
+	const TSimulation&			GetBoard(uint32_t player)	const	{ return *mBoards[player & 1]; }
+	uint32_t					GetFrame()			const	{ return mFrame; }
+	uint32_t					GetEndFrame()		const	{ return mEndFrame; }
+	int32_t						GetWinner()			const	{ return mWinner; }
+	const TRollbackStats&		GetStats()			const	{ return mStats; }
+private:
+	// copying disallowed
+	TRollbackSession(const TRollbackSession &session);
+	TRollbackSession& operator=(const TRollbackSession &session);
+	void						Receive();
+	void						Send();
+	void						Rollback();
+	void						SimulateFrame();
+	TPlayerInput&				Input(uint32_t player, uint32_t frame)	{ return mInputs[player][frame % INPUT_HISTORY]; }
+
+	ITransport&					mTransport;
+	const uint32_t				mLocalPlayer;
+	const uint32_t				mTick;
+	const uint32_t				mMaxFrames;
+	TSimulation*				mBoards[2];
+	uint32_t					mFrame;
+	uint32_t					mRemoteConfirmed;
+	uint32_t					mPeerAck;
+	uint32_t					mRollbackFrame;
+	uint32_t					mEndFrame;
+	int32_t						mWinner;
+	TPlayerInput				mInputs[2][INPUT_HISTORY];
+	TSimulationSnapshot			mSnapshots[2][SNAPSHOT_HISTORY];
+	uint32_t					mGarbage[SNAPSHOT_HISTORY];
+	std::vector<uint8_t>		mPacket;
+	TRollbackStats				mStats;
+};
+
+#endif // ROLLBACKSESSION_H_INCLUDED
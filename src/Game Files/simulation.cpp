@@ -0,0 +1,311 @@
+/**
+ *	simulation.cpp - Jan van der Kamp, 2011
+ */
+#include "simulation.h"
+#include "collisionChecker.h"
+#include "trace.h"
+
+#include "../globaldefines.h"
+
+using std::vector;
+
+/** @function TSimulation::TSimulation - Constructor			Constructs game objects with default values given in gameVariables.h
+ *		@param 		stateVariables				Variables for tracking difficulty and progress at the start of a game
+ */
+TSimulation::TSimulation(const TStateVariables& stateVariables) :
+mRandom(),
+mBurstTimer(),
+mWorld(),
+mBalloonManager(gameVars::balloonScale,
+				stateVariables,
+				mRandom,
+				mBurstTimer,
+				mWorld),
+mCannon(gameVars::cannonPosition,
+		gameVars::bulletScale,
+		stateVariables.mNumColoursInPlay,
+		mRandom,
+		mBurstTimer,
+		mWorld),
+mBarrier(gameVars::initialBarrierPosition, 
+		 gameVars::barrierRiseSpeed,	
+		 gameVars::initialBarrierParallaxDifference, 
+		 gameVars::barrierLevelHeight),
+mToUpdate(),
+mKeepFullPlayArea(false),
+mFixedNumColours(),
+mTime(),
+mJobSystem(NULL),
+mFrameGraph(),
+mCollisionGrid(),
+mFrameTime(),
+mGameOver(false),
+mCollisionChecker(NULL)
+{
+	mToUpdate.push_back(&mCannon);
+	mToUpdate.push_back(&mBarrier);
+	mToUpdate.push_back(&mBalloonManager);
+
+	SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+}
+
+/** @function TSimulation::AssignAssets - Assigns image assets to the game objects. Should be called once, after mRandom has
+ *										  been seeded, since the cannon loads its first bullet here. Textures are reference
+ *										  counted, so when simulations are to be updated on other threads this must be called
+ *										  before those threads start.
+ *		@param 		ballAssets					Textures used to display balloons and bullets on screen, which must
+ *												outlive the simulation, and how long their burst animations last
+ *		@param 		barrierTextures				Textures to represent piles of balloons at the bottom of the screen
+ *		@param 		cannonTexture				Texture used to display cannon on screen
+ */
+void TSimulation::AssignAssets(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+							   const TTextureRef& cannonTexture)
+{
+	mBurstTimer.SetDuration(ballAssets.mBurstDuration);
+	mBalloonManager.AssignAssets(ballAssets);
+	mCannon.AssignAssets(cannonTexture, ballAssets);
+	mBarrier.AssignAssets(barrierTextures);
+
+	// height that barrier will reach when game over occurs. 
+	// This should coincide with the cannons loaded bullet becoming covered by the barrier.
+	TReal gameOverHeight = mCannon.GetPosition().y - mCannon.GetBulletRadius();
+	mBarrier.SetGameOverHeight(gameOverHeight);
+}
+
+/** @function TSimulation::Reset - Puts every game object back to the start of a game, and should be called when a new
+ *								   game is started.
+ *		@param 		stateVariables				Variables for tracking difficulty and progress at the start of the game
+ */
+void TSimulation::Reset(const TStateVariables& stateVariables)
+{
+	mBalloonManager.Reset(stateVariables);
+	mCannon.Reset(stateVariables.mNumColoursInPlay);
+	mBarrier.Reset();
+	mBurstTimer.Reset();
+	SetBounds(TURect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT));
+	mTime = 0.0;
+}
+
+/** @function TSimulation::Update - Updates the game objects, tests for collisions between balls, and for balloons sinking
+ *									below lower boundary. The playing area is then moved to the top of the barrier and the
+ *									amount of colours increased with difficulty.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *
+ *		@return		true if the barrier has risen too far, which means game over
+ */
+bool TSimulation::Update(double elapsedTime)
+{
+	TRACE_SCOPE("TSimulation::Update");
+	mTime += elapsedTime;
+	mBurstTimer.Advance(elapsedTime);
+	mWorld.CountAge(elapsedTime);
+
+	if(mJobSystem) {
+		mFrameTime = elapsedTime;
+		mGameOver = false;
+		mJobSystem->Run(mFrameGraph);
+		return mGameOver;
+	}
+
+	// Update game objects
+	for(vector<IObject*>::iterator iter = mToUpdate.begin(); iter != mToUpdate.end(); ++iter)
+		(*iter)->Update(elapsedTime);
+
+	if(mCollisionChecker)
+		mCollisionChecker->CheckFrame(*this);
+	mBalloonManager.TestForCollisions(mCannon.GetFiredArchetype());
+
+	bool gameOver = TestForSinkingBalloons();
+	UpdateNumColours();
+	return gameOver;
+}
+
+/** @function TSimulation::SetJobSystem - Sets the job system Update runs each frame on, building the graph of jobs for it.
+ *										  The graph's dependencies keep every job that writes part of the game after every
+ *										  job that reads it in the order Update would otherwise run them.
+ *		@param 		jobSystem			Job system to run frames on, which must outlive the simulation, or NULL to update
+ *										in one go on the calling thread
+ */
+void TSimulation::SetJobSystem(TJobSystem* jobSystem)
+{
+	mJobSystem = jobSystem;
+	mFrameGraph.Clear();
+	if(!mJobSystem)
+		return;
+
+	uint32_t updateBalloons = mFrameGraph.AddJob("balloons.update", UpdateBalloonsJob, this);
+	for(uint32_t chunk = 0; chunk != gameVars::balloonMoveJobs; ++chunk)
+		mFrameGraph.AddDependency(updateBalloons, mFrameGraph.AddJob("balloons.move", MoveBalloonsJob, this, chunk));
+	uint32_t updateCannon = mFrameGraph.AddJob("cannon.update", UpdateCannonJob, this);
+	mFrameGraph.AddDependency(updateCannon, mFrameGraph.AddJob("bullets.move", MoveBulletsJob, this));
+	uint32_t updateBarrier = mFrameGraph.AddJob("barrier.update", UpdateBarrierJob, this);
+
+	uint32_t buildGrid = mFrameGraph.AddJob("collisions.grid", BuildCollisionGridJob, this);
+	mFrameGraph.AddDependency(buildGrid, updateBalloons);
+	mFrameGraph.AddDependency(buildGrid, updateCannon);
+	uint32_t resolve = mFrameGraph.AddJob("collisions.resolve", ResolveCollisionsJob, this);
+	for(uint32_t chunk = 0; chunk != gameVars::collisionJobs; ++chunk) {
+		uint32_t find = mFrameGraph.AddJob("collisions.find", FindCollisionsJob, this, chunk);
+		mFrameGraph.AddDependency(find, buildGrid);
+		mFrameGraph.AddDependency(resolve, find);
+	}
+	uint32_t sinking = mFrameGraph.AddJob("barrier.sinking", SinkingJob, this);
+	mFrameGraph.AddDependency(sinking, resolve);
+	mFrameGraph.AddDependency(sinking, updateBarrier);
+	uint32_t numColours = mFrameGraph.AddJob("cannon.colours", NumColoursJob, this);
+	mFrameGraph.AddDependency(numColours, sinking);
+}
+
+/** @function TSimulation::ApplyInput - Aims, reloads and fires the cannon as a player's input says to
+ *		@param 		input				What the player did this frame
+ */
+void TSimulation::ApplyInput(const TPlayerInput& input)
+{
+	if(input.mButtons & TPlayerInput::AIM)
+		mCannon.UpdateMousePosition(TPoint(input.mAimX, input.mAimY));
+	if(input.mButtons & TPlayerInput::RELOAD)
+		mCannon.Reload();
+	if(input.mButtons & TPlayerInput::FIRE)
+		mCannon.Fire();
+}
+
+/** @function TSimulation::Draw - Draws the background section of mBarrier, then the cannon and balloons, then the
+ *								  foreground section of mBarrier. Balls are culled if they are under the HUD, off
+ *								  screen, or behind the foreground's opaque part, since they would be drawn over.
+ *
+ *		@return		Number of balls culled
+ */
+uint32_t TSimulation::Draw() const
+{
+	TBallCuller culler(TRect(0, gameVars::hudBoundary, SCREEN_WIDTH, SCREEN_HEIGHT), mBarrier.GetOccluder());
+	mBarrier.DrawBackground();
+	mCannon.Draw(culler);
+	mBalloonManager.Draw(culler);
+	mBarrier.DrawForeground();
+	return culler.GetCulled();
+}
+
+/** @function TSimulation::TestForSinkingBalloons - Checks for balloons which are sinking, then moves the playing area up to
+ *													the top of the barrier. When keeping the full play area the game carries
+ *													on regardless, so that the load isn't cut short by the barrier rising.
+ *
+ *		@return		true if the barrier has risen too far, which means game over
+ */
+bool TSimulation::TestForSinkingBalloons()
+{
+	bool gameOver = (mBarrier.TestForSinkingBalloons(mBalloonManager.GetBalloons()) ||
+					 mBarrier.TestForSinkingBalloons(mCannon.GetBulletsFired())) && !mKeepFullPlayArea;
+
+	// Update the games boundary
+	if(!mKeepFullPlayArea)
+		SetBounds(TRect(0, gameVars::hudBoundary, SCREEN_WIDTH, int32_t(mBarrier.GetPosition().y)));
+	return gameOver;
+}
+
+/** @function TSimulation::UpdateNumColours - Increases the colours the cannon loads with difficulty, unless they have been
+ *											 fixed with SetFixedNumColours
+ */
+void TSimulation::UpdateNumColours()
+{
+	if(mFixedNumColours) {
+		uint16_t numTextures = mBalloonManager.GetNumTextures();
+		mCannon.SetNumColours(mFixedNumColours < numTextures ? mFixedNumColours : numTextures);
+		return;
+	}
+	mCannon.SetNumColours(gameVars::initialNumColoursInPlay + 
+						  mBalloonManager.GetLevel() / 
+						  mBalloonManager.GetStateVariables().mLevelsToPassForNewColour);
+}
+
+/** @function TSimulation::MoveBalloonsJob - Moves one of gameVars::balloonMoveJobs equal chunks of the balloons
+ *		@param 		simulation			The TSimulation
+ *		@param 		chunk				Which chunk to move
+ */
+void TSimulation::MoveBalloonsJob(void* simulation, uint32_t chunk)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	uint32_t numBalloons = uint32_t(self.mBalloonManager.GetBalloons().size());
+	self.mBalloonManager.MoveBalloons(numBalloons * chunk / gameVars::balloonMoveJobs,
+									  numBalloons * (chunk + 1) / gameVars::balloonMoveJobs, self.mFrameTime);
+}
+
+/** @function TSimulation::MoveBulletsJob - Moves the bullets which have been fired
+ */
+void TSimulation::MoveBulletsJob(void* simulation, uint32_t)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	self.mCannon.MoveBullets(self.mFrameTime);
+}
+
+/** @function TSimulation::UpdateBarrierJob - Raises the barrier at the start of a game
+ */
+void TSimulation::UpdateBarrierJob(void* simulation, uint32_t)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	self.mBarrier.Update(self.mFrameTime);
+}
+
+/** @function TSimulation::UpdateCannonJob - The rest of the cannon's update, once its bullets have moved
+ */
+void TSimulation::UpdateCannonJob(void* simulation, uint32_t)
+{
+	static_cast<TSimulation*>(simulation)->mCannon.UpdateContents();
+}
+
+/** @function TSimulation::UpdateBalloonsJob - The rest of the balloon manager's update, once every balloon has moved
+ */
+void TSimulation::UpdateBalloonsJob(void* simulation, uint32_t)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	self.mBalloonManager.UpdateContents(self.mFrameTime);
+}
+
+/** @function TSimulation::BuildCollisionGridJob - Sorts the balls into mCollisionGrid once they have been updated
+ */
+void TSimulation::BuildCollisionGridJob(void* simulation, uint32_t)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	self.mCollisionGrid.Build(self.mBalloonManager.GetBalloons(), self.mCannon.GetBulletsFired(),
+							  self.mBalloonManager.GetBounds(), gameVars::collisionJobs);
+}
+
+/** @function TSimulation::FindCollisionsJob - Finds the balls touching one chunk of the balloons
+ *		@param 		simulation			The TSimulation
+ *		@param 		chunk				Which chunk to search for
+ */
+void TSimulation::FindCollisionsJob(void* simulation, uint32_t chunk)
+{
+	static_cast<TSimulation*>(simulation)->mCollisionGrid.FindPairs(chunk);
+}
+
+/** @function TSimulation::ResolveCollisionsJob - Tests the pairs found for collisions, once every chunk has been searched
+ */
+void TSimulation::ResolveCollisionsJob(void* simulation, uint32_t)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	self.mBalloonManager.ResolveCollisions(self.mCannon.GetFiredArchetype(), self.mCollisionGrid);
+}
+
+/** @function TSimulation::SinkingJob - Checks for sinking balloons once collisions have been tested and the barrier updated
+ */
+void TSimulation::SinkingJob(void* simulation, uint32_t)
+{
+	TSimulation& self = *static_cast<TSimulation*>(simulation);
+	self.mGameOver = self.TestForSinkingBalloons();
+}
+
+/** @function TSimulation::NumColoursJob - Increases the colours the cannon loads, once the frame's level is known
+ */
+void TSimulation::NumColoursJob(void* simulation, uint32_t)
+{
+	static_cast<TSimulation*>(simulation)->UpdateNumColours();
+}
+
+/** @function TSimulation::SetBounds - Sets the boundary of the playing area for every ball in the game
+ *		@param 		bounds				The boundary of the playing area
+ */
+void TSimulation::SetBounds(const TRect& bounds)
+{
+	mBalloonManager.SetBounds(bounds);
+	mCannon.SetBounds(bounds);
+}
@@ -0,0 +1,140 @@
+/**
+ *	simulation.h - Jan van der Kamp, 2011
+ */
+#ifndef SIMULATION_H_INCLUDED
+#define SIMULATION_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/vec.h>
+#include <pf/rect.h>
+#include <vector>
+
+#include "gameVariables.h"
+#include "gameObject.h"
+#include "gameRandom.h"
+#include "burstTimer.h"
+#include "entityWorld.h"
+#include "balloonManager.h"
+#include "cannon.h"
+#include "barrier.h"
+#include "jobSystem.h"
+
+class TCollisionChecker;
+
+/** @struct TPlayerInput - Everything a player does with the cannon in one frame, kept small so that it can be sent to
+ *						   another machine. The cannon is only aimed if AIM is set, then reloaded if RELOAD is set,
+ *						   then fired if FIRE is set.
+ *	@property 	int16_t			mAimX					Horizontal position of the point aimed at
+ *	@property 	int16_t			mAimY					Vertical position of the point aimed at
+ *	@property 	uint8_t			mButtons				AIM, RELOAD and FIRE flags
+ */
+struct TPlayerInput
+{
+	enum { AIM = 1, RELOAD = 2, FIRE = 4 };
+
+	TPlayerInput() : mAimX(), mAimY(), mButtons() {}
+	TPlayerInput(int16_t aimX, int16_t aimY, uint8_t buttons) : mAimX(aimX), mAimY(aimY), mButtons(buttons) {}
+	bool operator==(const TPlayerInput& other) const	{ return mAimX == other.mAimX && mAimY == other.mAimY &&
+																 mButtons == other.mButtons; }
+	bool operator!=(const TPlayerInput& other) const	{ return !(*this == other); }
+
+	int16_t		mAimX;
+	int16_t		mAimY;
+	uint8_t		mButtons;
+};
+
+/** @class TSimulation - This class holds everything needed to play one game: the balloon manager, the cannon, the barrier
+ *						 and the random number generator, burst timer and entity world they share. TGame uses one to play the game on screen, and
+ *						 TDifficultyTuner uses many to play games without drawing them. Once AssignAssets has been called
+ *						 nothing in Update touches the textures, so separate simulations can be updated on separate threads.
+ *						 Given a TJobSystem, Update runs one frame as a TJobGraph instead: the balloons are moved in
+ *						 gameVars::balloonMoveJobs chunks alongside the bullets and the barrier, then mCollisionGrid finds
+ *						 the balls which touch in gameVars::collisionJobs chunks, and the collisions are resolved in the
+ *						 order TBalloonManager::TestForCollisions would test them, so the game plays out exactly as it
+ *						 does updated in one go. Given a TCollisionChecker, Update checks each frame's collisions with it before
+ *						 resolving them, when updating in one go.
+ *
+ *	@property 	TRandom						mRandom					Random number generator shared by mBalloonManager and mCannon
+ *	@property 	TBurstTimer					mBurstTimer				Removes burst balls for mBalloonManager and mCannon, advanced
+ *																	at the start of each Update
+ *	@property 	TEntityWorld				mWorld					Holds the balloons of mBalloonManager and the bullets of mCannon
+ * 	@property 	TBalloonManager				mBalloonManager			Manages falling balloons and keeps track of game difficulty/progress
+ *	@property 	TCannon						mCannon					Used to shoot bullets at balloons
+ *	@property 	TBarrier					mBarrier				If balloons fall to far, this rises until too high and game over is reached
+ *	@property 	std::vector<IObject*>		mToUpdate				Used to update mBalloonManager, mCannon, and mBarrier polymorphically
+ *	@property 	bool						mKeepFullPlayArea		Whether the playing area stays the full screen rather than
+ *																	stopping at the barrier, and game over is never reached
+ *	@property 	uint16_t					mFixedNumColours		Colours the cannon loads whatever the level, or 0 for the
+ *																	colours to increase with difficulty
+ *	@property 	double						mTime					Time in milliseconds since the game started
+ *	@property 	TJobSystem*					mJobSystem				Runs mFrameGraph each Update, or NULL to update in one go
+ *	@property 	TJobGraph					mFrameGraph				Jobs making up one Update, when there is a job system
+ *	@property 	TCollisionGrid				mCollisionGrid			Finds the balls which touch, for mFrameGraph
+ *	@property 	double						mFrameTime				Time in milliseconds the frame being run by mFrameGraph covers
+ *	@property 	bool						mGameOver				Whether the frame run by mFrameGraph reached game over
+ *	@property 	TCollisionChecker*			mCollisionChecker		Checks each frame's collisions, or NULL not to check them
+ */
+class TSimulation
+{
+public:
+	TSimulation(const TStateVariables& stateVariables);
+	void						AssignAssets(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+											 const TTextureRef& cannonTexture);
+	void						Reset(const TStateVariables& stateVariables);
+	bool						Update(double elapsedTime);
+	void						ApplyInput(const TPlayerInput& input);
+	uint32_t					Draw()				const;
+	void						Seed(uint32_t seed)				{ mRandom.Seed(seed); }
+	void						SetKeepFullPlayArea(bool keep)	{ mKeepFullPlayArea = keep; }
+	void						SetFixedNumColours(uint16_t numColours)	{ mFixedNumColours = numColours; }
+	void						SetJobSystem(TJobSystem* jobSystem);
+	void						SetCollisionChecker(TCollisionChecker* checker)	{ mCollisionChecker = checker; }
+	TJobGraph&					GetFrameGraph()				{ return mFrameGraph; }
+	uint32_t					GetRandomState()	const	{ return mRandom.GetState(); }
+	const TBurstTimer&			GetBurstTimer()		const	{ return mBurstTimer; }
+	uint32_t					GetTime()			const	{ return uint32_t(mTime); }
+	TBalloonManager&			GetBalloonManager()			{ return mBalloonManager; }
+	const TBalloonManager&		GetBalloonManager()	const	{ return mBalloonManager; }
+	TCannon&					GetCannon()					{ return mCannon; }
+	const TCannon&				GetCannon()			const	{ return mCannon; }
+	const TBarrier&				GetBarrier()		const	{ return mBarrier; }
+private:
+	// TSimulationSnapshot copies the state of the whole game in and out directly, TStateStreamDecoder copies it in
+	friend class TSimulationSnapshot;
+	friend class TStateStreamDecoder;
+	// copying disallowed
+	TSimulation(const TSimulation &simulation);
+	TSimulation& operator=(const TSimulation &simulation);
+	void						SetBounds(const TRect& bounds);
+	bool						TestForSinkingBalloons();
+	void						UpdateNumColours();
+	static void					MoveBalloonsJob(void* simulation, uint32_t chunk);
+	static void					MoveBulletsJob(void* simulation, uint32_t);
+	static void					UpdateBarrierJob(void* simulation, uint32_t);
+	static void					UpdateCannonJob(void* simulation, uint32_t);
+	static void					UpdateBalloonsJob(void* simulation, uint32_t);
+	static void					BuildCollisionGridJob(void* simulation, uint32_t);
+	static void					FindCollisionsJob(void* simulation, uint32_t chunk);
+	static void					ResolveCollisionsJob(void* simulation, uint32_t);
+	static void					SinkingJob(void* simulation, uint32_t);
+	static void					NumColoursJob(void* simulation, uint32_t);
+
+	TRandom						mRandom;
+	TBurstTimer					mBurstTimer;
+	TEntityWorld				mWorld;
+	TBalloonManager				mBalloonManager;
+	TCannon						mCannon;
+	TBarrier					mBarrier;
+	std::vector<IObject*>		mToUpdate;
+	bool						mKeepFullPlayArea;
+	uint16_t					mFixedNumColours;
+	double						mTime;
+	TJobSystem*					mJobSystem;
+	TJobGraph					mFrameGraph;
+	TCollisionGrid				mCollisionGrid;
+	double						mFrameTime;
+	bool						mGameOver;
+	TCollisionChecker*			mCollisionChecker;
+};
+
+#endif // SIMULATION_H_INCLUDED
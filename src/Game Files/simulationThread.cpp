@@ -0,0 +1,154 @@
+/**
+ *	simulationThread.cpp - Jan van der Kamp, 2011
+ */
+#include "simulationThread.h"
+
+#include <pf/debug.h>
+
+#include "trace.h"
+
+/** @function TSimulationThread::TSimulationThread - Constructor
+ *		@param 		simulation			Game to update, which mustn't be touched by anything else while the thread runs
+ *		@param 		stateVariables		Difficulty a RESET starts the game at
+ */
+TSimulationThread::TSimulationThread(TSimulation& simulation, const TStateVariables& stateVariables) :
+mSimulation(simulation),
+mStateVariables(stateVariables),
+mEncoder(NULL),
+mThread(),
+mCommands(gameVars::simulationCommandCapacity),
+mWake(),
+mSleeping(),
+mStopping(true),
+mGameOver(false),
+mGame(),
+mFrames(),
+mCommandsRun(),
+mHeldBackSubmits(),
+mWakes()
+{}
+
+/** @function TSimulationThread::~TSimulationThread - Destructor, stops the thread if it is still running
+ */
+TSimulationThread::~TSimulationThread()
+{
+	Stop();
+}
+
+/** @function TSimulationThread::Start - Publishes the game as it is, so there is a frame to draw straight away, then starts
+ *										the thread
+ *		@param 		encoder				Encoder to write every update to as a state stream, or NULL
+ *
+ *		@return		true if the thread was started
+ */
+bool TSimulationThread::Start(TStateStreamEncoder* encoder)
+{
+	mEncoder = encoder;
+	mStopping = false;
+	PublishFrame();
+	return mThread.Start(Run, this);
+}
+
+/** @function TSimulationThread::Stop - Waits for the commands being run, if any, then stops the thread, if it is running
+ */
+void TSimulationThread::Stop()
+{
+	if(mStopping)
+		return;
+	mStopping = true;
+	mWake.Signal();
+	mThread.Join();
+	DEBUG_WRITE(("Simulation thread ran %d commands, the ring of %d held at most %d, %d submits held commands back, "
+				 "%d woke the thread", mCommandsRun, mCommands.GetCapacity(), mCommands.GetMaxOccupancy(),
+				 mHeldBackSubmits, mWakes));
+}
+
+/** @function TSimulationThread::Submit - Pushes commands into the ring, in order, for the thread to run, and wakes the thread
+ *										 if it is asleep. Commands that don't fit are left at the front of commands for the
+ *										 next Submit(), which has to be given them before anything queued after them.
+ *		@param 		commands			Commands to run, in order, left holding those that didn't fit
+ *
+ *		@return		true if every command was handed over
+ */
+bool TSimulationThread::Submit(std::vector<TSimulationCommand>& commands)
+{
+	std::vector<TSimulationCommand>::iterator command = commands.begin();
+	while(command != commands.end() && mCommands.Push(*command))
+		++command;
+	bool pushed = (command != commands.begin());
+	commands.erase(commands.begin(), command);
+	if(!commands.empty())
+		mHeldBackSubmits++;
+
+	// Pushing published the commands with a full barrier, so if the thread hasn't said it is going to sleep yet, it will
+	// see them when it looks at the ring again before sleeping
+	if(pushed && mSleeping.GetValue()) {
+		mWakes++;
+		mWake.Signal();
+	}
+	return commands.empty();
+}
+
+/** @function TSimulationThread::Run - Entry point of the thread, runs commands as they are submitted and publishes the game
+ *									  each time the ring is emptied, sleeping while there is nothing to run, until asked to stop
+ *		@param 		thread				The TSimulationThread
+ */
+void TSimulationThread::Run(void* thread)
+{
+	TSimulationThread* self = static_cast<TSimulationThread*>(thread);
+	TTrace::SetThreadName("simulation");
+	while(!self->mStopping)
+	{
+		if(self->mCommands.IsEmpty()) {
+			// Say so before looking at the ring a last time, so that commands submitted after that look always wake us
+			self->mSleeping.Exchange(1);
+			if(self->mCommands.IsEmpty() && !self->mStopping)
+				self->mWake.Wait();
+			self->mSleeping.Exchange(0);
+			continue;
+		}
+		self->RunCommands();
+		self->PublishFrame();
+	}
+}
+
+/** @function TSimulationThread::RunCommands - Runs the commands in the ring against the game in order, until it is empty
+ */
+void TSimulationThread::RunCommands()
+{
+	TSimulationCommand command;
+	while(mCommands.Pop(command))
+	{
+		mCommandsRun++;
+		switch(command.mType)
+		{
+		case TSimulationCommand::TICK :
+			if(mGameOver)
+				break;
+			mGameOver = mSimulation.Update(command.mElapsedTime);
+			if(mEncoder)
+				mEncoder->Encode(mSimulation);
+			break;
+		case TSimulationCommand::INPUT :
+			if(!mGameOver)
+				mSimulation.ApplyInput(command.mInput);
+			break;
+		case TSimulationCommand::RESET :
+			mSimulation.Reset(mStateVariables);
+			mGameOver = false;
+			mGame++;
+			break;
+		}
+	}
+}
+
+/** @function TSimulationThread::PublishFrame - Copies the game into the next frame and publishes it
+ */
+void TSimulationThread::PublishFrame()
+{
+	TSimulationFrame& frame = mFrames.GetWriteSlot();
+	frame.mSnapshot.Take(mSimulation);
+	frame.mGameOver = mGameOver;
+	frame.mGame = mGame;
+	mFrames.Publish();
+}
@@ -0,0 +1,108 @@
+/**
+ *	simulationThread.h - Jan van der Kamp, 2011
+ */
+#ifndef SIMULATIONTHREAD_H_INCLUDED
+#define SIMULATIONTHREAD_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "simulation.h"
+#include "snapshot.h"
+#include "stateStream.h"
+#include "threading.h"
+#include "tripleBuffer.h"
+#include "spscRing.h"
+
+/** @struct TSimulationCommand - One thing for a TSimulationThread to do to its game
+ *	@property 	uint8_t			mType					TICK, INPUT or RESET
+ *	@property 	double			mElapsedTime			Time in milliseconds to update the game by, for a TICK
+ *	@property 	TPlayerInput	mInput					What the player did with the cannon, for an INPUT
+ */
+struct TSimulationCommand
+{
+	enum { TICK = 0, INPUT, RESET };
+
+	uint8_t			mType;
+	double			mElapsedTime;
+	TPlayerInput	mInput;
+};
+
+/** @struct TSimulationFrame - What a TSimulationThread publishes each time it has run every command it was given
+ *	@property 	TSimulationSnapshot		mSnapshot			The whole game, to be restored into a TSimulation that is drawn
+ *	@property 	bool					mGameOver			Whether the game is over
+ *	@property 	uint32_t				mGame				Number of RESET commands run, so that a game over published
+ *															before a new game was started can be told apart
+ */
+struct TSimulationFrame
+{
+	TSimulationSnapshot		mSnapshot;
+	bool					mGameOver;
+	uint32_t				mGame;
+};
+
+/** @class TSimulationThread - Updates a game on a thread of its own, so that a slow draw doesn't hold up the game and a slow
+ *							   update doesn't hold up drawing. The platform thread decides what happens each frame, as it
+ *							   does when it updates the game itself, but queues it as TSimulationCommands and hands them
+ *							   over with Submit(), through a TSpscRing that neither side ever locks or waits on. The thread
+ *							   runs every command in the ring, then publishes the game as a TSimulationFrame through a
+ *							   TTripleBuffer, which the platform thread takes with TakeFrame() and draws from.
+ *							   When the thread has emptied the ring it sleeps on mWake, and only then does Submit() signal
+ *							   it, so a frame in which the thread is busy costs the platform thread nothing but the pushes.
+ *							   If the game falls so far behind that the ring fills, Submit() leaves the commands that didn't
+ *							   fit with the platform thread, in order, to be submitted first next frame, so nothing is lost
+ *							   or reordered, it is only drawn later. Once the game is over, ticks and inputs are ignored
+ *							   until the next RESET.
+ *	@property 	TSimulation&						mSimulation			Game updated on the thread
+ *	@property 	const TStateVariables&				mStateVariables		Difficulty a RESET starts the game at
+ *	@property 	TStateStreamEncoder*				mEncoder			Writes every update out as a state stream, if set
+ *	@property 	TThread								mThread				The thread
+ *	@property 	TSpscRing<TSimulationCommand>		mCommands			Commands submitted and not yet run
+ *	@property 	TEvent								mWake				Signalled when commands are submitted to a sleeping thread,
+ *																		or to stop
+ *	@property 	TAtomicValue						mSleeping			Whether the thread is, or is about to be, waiting on mWake
+ *	@property 	volatile bool						mStopping			Whether the thread has been asked to finish, or isn't running
+ *	@property 	bool								mGameOver			Whether the game is over, only touched by the thread
+ *	@property 	uint32_t							mGame				Number of RESET commands run, only touched by the thread
+ *	@property 	TTripleBuffer<TSimulationFrame>		mFrames				Published frames
+ *	@property 	uint32_t							mCommandsRun		Number of commands run, only touched by the thread
+ *	@property 	uint32_t							mHeldBackSubmits	Number of times Submit() couldn't fit every command in the ring
+ *	@property 	uint32_t							mWakes				Number of times Submit() woke the thread
+ */
+class TSimulationThread
+{
+public:
+	TSimulationThread(TSimulation& simulation, const TStateVariables& stateVariables);
+	~TSimulationThread();
+	bool							Start(TStateStreamEncoder* encoder);
+	void							Stop();
+	bool							Submit(std::vector<TSimulationCommand>& commands);
+	const TSimulationFrame*			TakeFrame()					{ return mFrames.Consume() ? &mFrames.GetReadSlot() : NULL; }
+	const TSpscRing<TSimulationCommand>&	GetCommands()	const	{ return mCommands; }
+	uint32_t						GetHeldBackSubmits()	const	{ return mHeldBackSubmits; }
+	uint32_t						GetWakes()			const	{ return mWakes; }
+private:
+	// copying disallowed
+	TSimulationThread(const TSimulationThread &thread);
+	TSimulationThread& operator=(const TSimulationThread &thread);
+	static void						Run(void* thread);
+	void							RunCommands();
+	void							PublishFrame();
+
+	TSimulation&					mSimulation;
+	const TStateVariables&			mStateVariables;
+	TStateStreamEncoder*			mEncoder;
+	TThread							mThread;
+	TSpscRing<TSimulationCommand>	mCommands;
+	TEvent							mWake;
+	TAtomicValue					mSleeping;
+	volatile bool					mStopping;
+	bool							mGameOver;
+	uint32_t						mGame;
+	TTripleBuffer<TSimulationFrame>	mFrames;
+	uint32_t						mCommandsRun;
+	uint32_t						mHeldBackSubmits;
+	uint32_t						mWakes;
+};
+
+#endif // SIMULATIONTHREAD_H_INCLUDED
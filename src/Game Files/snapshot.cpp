@@ -0,0 +1,207 @@
+/**
+ *	snapshot.cpp - Jan van der Kamp, 2011
+ */
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+
+using std::vector;
+
+/** @function TSimulationSnapshot::TSimulationSnapshot - Default Constructor, makes an empty snapshot which can't be restored
+ */
+TSimulationSnapshot::TSimulationSnapshot() :
+mData()
+{}
+
+/** @function TSimulationSnapshot::Take - Copies the state of a game into the blob, replacing whatever was there
+ *		@param 		simulation			Game to take a snapshot of
+ */
+void TSimulationSnapshot::Take(const TSimulation& simulation)
+{
+	const TBalloonManager& balloonManager = simulation.mBalloonManager;
+	const TCannon& cannon = simulation.mCannon;
+	const TBarrier& barrier = simulation.mBarrier;
+
+	THeader header;
+	header.mMagic = MAGIC;
+	header.mVersion = VERSION;
+	header.mStateSize = sizeof(TState);
+	header.mBallSize = sizeof(TBall);
+	header.mNumBalloons = uint32_t(balloonManager.GetBalloons().size());
+	header.mNumBullets = uint32_t(cannon.GetBullets().size());
+	header.mNumBulletsFired = uint32_t(cannon.GetBulletsFired().size());
+	header.mSize = Align(sizeof(THeader)) + Align(sizeof(TState)) +
+				   Align((header.mNumBalloons + header.mNumBullets + header.mNumBulletsFired) * sizeof(TBall));
+
+	// Cleared first so that padding is always zero, and the same game always gives the same blob
+	TState state;
+	memset(&state, 0, sizeof(TState));
+	state.mRandomState = simulation.mRandom.GetState();
+	state.mBurstClock = simulation.mBurstTimer.GetClock();
+	state.mTime = simulation.mTime;
+	state.mKeepFullPlayArea = simulation.mKeepFullPlayArea;
+	state.mVars = balloonManager.mVars;
+	state.mBounds = balloonManager.mBounds;
+	state.mCannonColours = cannon.mNumColoursInPlay;
+	state.mCannonAngle = cannon.mAngle;
+	state.mCannonDirection = cannon.mLoadedBulletPosition;
+	state.mBarrierPosition = barrier.mPosition;
+	state.mBarrierPositionLastFrame = barrier.mPositionLastFrame;
+	state.mBarrierHeightAdjust = barrier.mHeightAdjust;
+	state.mBarrierNewGame = barrier.newGame;
+
+	mData.resize(header.mSize);
+	uint8_t* out = &mData[0];
+	memcpy(out, &header, sizeof(THeader));
+	out += Align(sizeof(THeader));
+	memcpy(out, &state, sizeof(TState));
+	memset(out + sizeof(TState), 0, Align(sizeof(TState)) - sizeof(TState));
+	out += Align(sizeof(TState));
+	WriteBalls(out, balloonManager.GetBalloons());
+	WriteBalls(out, cannon.GetBullets());
+	WriteBalls(out, cannon.GetBulletsFired());
+	memset(out, 0, &mData[0] + header.mSize - out);
+}
+
+/** @function TSimulationSnapshot::Restore - Puts a game back to the state it was in when the snapshot was taken. Balls are
+ *											copied into the archetypes of the game's existing entity world, so restoring
+ *											doesn't allocate unless an archetype has to grow.
+ *		@param 		simulation			Game to restore, which must have had AssignAssets called
+ *
+ *		@return		false if there is no valid snapshot to restore, in which case the game isn't changed
+ */
+bool TSimulationSnapshot::Restore(TSimulation& simulation) const
+{
+	if(!IsValid())
+		return false;
+
+	const uint8_t* in = &mData[0];
+	THeader header;
+	memcpy(&header, in, sizeof(THeader));
+	in += Align(sizeof(THeader));
+	TState state;
+	memcpy(&state, in, sizeof(TState));
+	in += Align(sizeof(TState));
+
+	TBalloonManager& balloonManager = simulation.mBalloonManager;
+	TCannon& cannon = simulation.mCannon;
+	TBarrier& barrier = simulation.mBarrier;
+
+	simulation.mRandom.Seed(state.mRandomState);
+	simulation.mTime = state.mTime;
+	simulation.mKeepFullPlayArea = (state.mKeepFullPlayArea != 0);
+	balloonManager.mVars = state.mVars;
+	simulation.SetBounds(state.mBounds);
+	cannon.mNumColoursInPlay = uint16_t(state.mCannonColours);
+	cannon.mAngle = state.mCannonAngle;
+	cannon.mLoadedBulletPosition = state.mCannonDirection;
+	cannon.UpdateDrawSpec();
+	barrier.mPosition = state.mBarrierPosition;
+	barrier.mPositionLastFrame = state.mBarrierPositionLastFrame;
+	barrier.mHeightAdjust = state.mBarrierHeightAdjust;
+	barrier.newGame = (state.mBarrierNewGame != 0);
+
+	ReadBalls(in, header.mNumBalloons, simulation.mWorld, balloonManager.mArchetype);
+	ReadBalls(in, header.mNumBullets, simulation.mWorld, cannon.mLoadedArchetype);
+	ReadBalls(in, header.mNumBulletsFired, simulation.mWorld, cannon.mFiredArchetype);
+
+	// The heap of expiries isn't kept, it is rebuilt from the burst balls
+	simulation.mBurstTimer.Reset(state.mBurstClock);
+	simulation.mBurstTimer.ScheduleBalls(simulation.mWorld, balloonManager.mArchetype);
+	simulation.mBurstTimer.ScheduleBalls(simulation.mWorld, cannon.mFiredArchetype);
+	return true;
+}
+
+/** @function TSimulationSnapshot::IsValid - Checks that the blob holds a whole snapshot that this build can restore
+ *
+ *		@return		true if the snapshot can be restored
+ */
+bool TSimulationSnapshot::IsValid() const
+{
+	if(mData.size() < Align(sizeof(THeader)) + Align(sizeof(TState)))
+		return false;
+
+	THeader header;
+	memcpy(&header, &mData[0], sizeof(THeader));
+	if(header.mMagic != MAGIC || header.mVersion != VERSION || header.mSize != mData.size() ||
+	   header.mStateSize != sizeof(TState) || header.mBallSize != sizeof(TBall))
+		return false;
+
+	// Checked in 64 bits so that ball counts from a damaged file can't wrap around to a size that matches
+	uint64_t numBalls = uint64_t(header.mNumBalloons) + header.mNumBullets + header.mNumBulletsFired;
+	return Align(sizeof(THeader)) + Align(sizeof(TState)) + ((numBalls * sizeof(TBall) + 7) & ~uint64_t(7)) == header.mSize;
+}
+
+/** @function TSimulationSnapshot::SetData - Replaces the blob with one taken elsewhere, such as by another TSimulationSnapshot
+ *		@param 		data				Start of the blob
+ *		@param 		size				Size of the blob in bytes
+ *
+ *		@return		true if the blob is a snapshot that can be restored
+ */
+bool TSimulationSnapshot::SetData(const uint8_t* data, uint32_t size)
+{
+	mData.assign(data, data + size);
+	return IsValid();
+}
+
+/** @function TSimulationSnapshot::Save - Writes the blob to a file
+ *		@param 		filename			File to write to
+ *
+ *		@return		true if a valid snapshot was written
+ */
+bool TSimulationSnapshot::Save(const char* filename) const
+{
+	if(!IsValid())
+		return false;
+	FILE* file = fopen(filename, "wb");
+	if(!file)
+		return false;
+	bool written = (fwrite(&mData[0], 1, mData.size(), file) == mData.size());
+	fclose(file);
+	return written;
+}
+
+/** @function TSimulationSnapshot::Load - Reads a blob written by Save
+ *		@param 		filename			File to read from
+ *
+ *		@return		true if the file holds a snapshot that can be restored
+ */
+bool TSimulationSnapshot::Load(const char* filename)
+{
+	mData.clear();
+	FILE* file = fopen(filename, "rb");
+	if(!file)
+		return false;
+
+	uint8_t block[4096];
+	size_t bytesRead;
+	while((bytesRead = fread(block, 1, sizeof(block), file)) > 0)
+		mData.insert(mData.end(), block, block + bytesRead);
+	fclose(file);
+	return IsValid();
+}
+
+/** @function TSimulationSnapshot::WriteBalls - Copies a list of balls into the blob
+ *		@param 		out					Where to write the balls, moved past them
+ *		@param 		balls				Balls to write
+ */
+void TSimulationSnapshot::WriteBalls(uint8_t*& out, const std::vector<TBall>& balls)
+{
+	if(balls.empty())
+		return;
+	memcpy(out, &balls[0], balls.size() * sizeof(TBall));
+	out += balls.size() * sizeof(TBall);
+}
+
+/** @function TSimulationSnapshot::ReadBalls - Copies a list of balls out of the blob, replacing the entities of an archetype
+ *		@param 		in					Where to read the balls from, moved past them
+ *		@param 		count				Number of balls to read
+ *		@param 		world				World holding the archetype
+ *		@param 		archetype			Archetype set to the balls read
+ */
+void TSimulationSnapshot::ReadBalls(const uint8_t*& in, uint32_t count, TEntityWorld& world, uint32_t archetype)
+{
+	world.Assign(archetype, reinterpret_cast<const TBall*>(in), count);
+	in += count * sizeof(TBall);
+}
@@ -0,0 +1,103 @@
+/**
+ *	snapshot.h - Jan van der Kamp, 2011
+ */
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "simulation.h"
+
+/** @class TSimulationSnapshot - A checkpoint of a whole running game: the state variables, every balloon, the loaded and
+ *								 fired bullets, the barrier's position and height adjustments, the cannon's angle, the
+ *								 playing area, and the state of the random number generator and the burst timer's clock. Everything is held in one
+ *								 flat, versioned blob laid out as a header, then a fixed-size block of the scalar state,
+ *								 then the balls of each list one after another. TBall is plain data, so each list of balls
+ *								 is copied in and out with a single memcpy, and taking or restoring a snapshot costs a few
+ *								 copies no matter how many balls there are. The blob's storage is kept between snapshots,
+ *								 so taking one every frame doesn't allocate once it has grown to fit.
+ *								 Textures aren't part of a snapshot, so it can only be restored into a TSimulation which
+ *								 has had AssignAssets called with the same assets. The blob can be written to a file and
+ *								 read back, but only by the same build, since the layout of TBall is part of the format.
+ *	@property 	std::vector<uint8_t>	mData					The blob
+ */
+class TSimulationSnapshot
+{
+public:
+	TSimulationSnapshot();
+	void				Take(const TSimulation& simulation);
+	bool				Restore(TSimulation& simulation)	const;
+	bool				IsValid()	const;
+	bool				Save(const char* filename)	const;
+	bool				Load(const char* filename);
+	const uint8_t*		GetData()	const	{ return mData.empty() ? NULL : &mData[0]; }
+	uint32_t			GetSize()	const	{ return uint32_t(mData.size()); }
+	bool				SetData(const uint8_t* data, uint32_t size);
+
+	enum { MAGIC = 0x504E5342, VERSION = 5 };
+private:
+	/** @struct THeader - Start of the blob, used to check that a blob is a snapshot this build can restore
+	 *	@property 	uint32_t		mMagic				Always MAGIC
+	 *	@property 	uint32_t		mVersion			Always VERSION
+	 *	@property 	uint32_t		mSize				Size of the whole blob in bytes
+	 *	@property 	uint32_t		mStateSize			sizeof(TState) in the build that took the snapshot
+	 *	@property 	uint32_t		mBallSize			sizeof(TBall) in the build that took the snapshot
+	 *	@property 	uint32_t		mNumBalloons		Number of balloons
+	 *	@property 	uint32_t		mNumBullets			Number of bullets loaded on the cannon
+	 *	@property 	uint32_t		mNumBulletsFired	Number of bullets in flight
+	 */
+	struct THeader
+	{
+		uint32_t		mMagic;
+		uint32_t		mVersion;
+		uint32_t		mSize;
+		uint32_t		mStateSize;
+		uint32_t		mBallSize;
+		uint32_t		mNumBalloons;
+		uint32_t		mNumBullets;
+		uint32_t		mNumBulletsFired;
+	};
+
+	/** @struct TState - Everything in the game other than the balls
+	 *	@property 	double			mTime					Time in milliseconds since the game started
+	 *	@property 	uint32_t		mRandomState			State of the simulation's random number generator
+	 *	@property 	uint32_t		mBurstClock				Clock of the simulation's burst timer, which burst balls'
+	 *															expiries are ticks of
+	 *	@property 	uint32_t		mKeepFullPlayArea		Whether the playing area is being kept at the full screen
+	 *	@property 	TStateVariables	mVars					Difficulty and progress of the game
+	 *	@property 	TRect			mBounds					Playing area of the balls
+	 *	@property 	uint32_t		mCannonColours			Range of colours the cannon's bullets can be
+	 *	@property 	TReal			mCannonAngle			Angle of the cannon
+	 *	@property 	TVec2			mCannonDirection		Direction the cannon points in
+	 *	@property 	TVec2			mBarrierPosition		Position of the barrier
+	 *	@property 	TVec2			mBarrierPositionLastFrame	Position of the barrier at the last frame
+	 *	@property 	TReal			mBarrierHeightAdjust	Height the barrier has been held at as sunk balloons were removed
+	 *	@property 	uint32_t		mBarrierNewGame			Whether the barrier is still sinking at the start of a game
+	 */
+	struct TState
+	{
+		double			mTime;
+		uint32_t		mRandomState;
+		uint32_t		mBurstClock;
+		uint32_t		mKeepFullPlayArea;
+		TStateVariables	mVars;
+		TRect			mBounds;
+		uint32_t		mCannonColours;
+		TReal			mCannonAngle;
+		TVec2			mCannonDirection;
+		TVec2			mBarrierPosition;
+		TVec2			mBarrierPositionLastFrame;
+		TReal			mBarrierHeightAdjust;
+		uint32_t		mBarrierNewGame;
+	};
+
+	// Sections start on 8 byte boundaries so that the balls can be read in place
+	static uint32_t		Align(uint32_t size)	{ return (size + 7) & ~7u; }
+	static void			WriteBalls(uint8_t*& out, const std::vector<TBall>& balls);
+	static void			ReadBalls(const uint8_t*& in, uint32_t count, TEntityWorld& world, uint32_t archetype);
+
+	std::vector<uint8_t>	mData;
+};
+
+#endif // SNAPSHOT_H_INCLUDED
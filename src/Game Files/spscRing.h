@@ -0,0 +1,105 @@
+/**
+ *	spscRing.h - Jan van der Kamp, 2011
+ */
+#ifndef SPSCRING_H_INCLUDED
+#define SPSCRING_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "threading.h"
+
+/** @class TSpscRing - A fixed size queue between exactly one thread that pushes and one that pops, which never locks, never
+ *					   waits and never allocates once constructed. Each side only writes its own end of the ring, and
+ *					   publishes it with a TAtomicValue so that the other side sees the slot it has filled or emptied.
+ *					   Push() fails rather than waits when the ring is full, leaving the producer to decide what to do
+ *					   with the value; how full the ring has been and how often it was full are counted for it.
+ *	@property 	std::vector<T>		mSlots					Ring of values, a power of two long
+ *	@property 	uint32_t			mMask					Length of mSlots less one, to wrap positions into it
+ *	@property 	TAtomicValue		mHead					Number of values popped, only written by the consumer
+ *	@property 	TAtomicValue		mTail					Number of values pushed, only written by the producer
+ *	@property 	uint32_t			mMaxOccupancy			Most values the ring has held at once, as the producer saw it
+ *	@property 	uint32_t			mFullPushes				Number of pushes that failed because the ring was full
+ */
+template<class T>
+class TSpscRing
+{
+public:
+	explicit TSpscRing(uint32_t capacity);
+	bool				Push(const T& value);
+	bool				Pop(T& value);
+	bool				IsEmpty()			const	{ return GetOccupancy() == 0; }
+	uint32_t			GetOccupancy()		const	{ return uint32_t(mTail.GetValue()) - uint32_t(mHead.GetValue()); }
+	uint32_t			GetCapacity()		const	{ return mMask + 1; }
+	uint32_t			GetMaxOccupancy()	const	{ return mMaxOccupancy; }
+	uint32_t			GetFullPushes()		const	{ return mFullPushes; }
+private:
+	// copying disallowed
+	TSpscRing(const TSpscRing &ring);
+	TSpscRing& operator=(const TSpscRing &ring);
+
+	std::vector<T>		mSlots;
+	uint32_t			mMask;
+	TAtomicValue		mHead;
+	TAtomicValue		mTail;
+	uint32_t			mMaxOccupancy;
+	uint32_t			mFullPushes;
+};
+
+/** @function TSpscRing::TSpscRing - Constructor
+ *		@param 		capacity			Values the ring must hold, rounded up to a power of two
+ */
+template<class T>
+inline TSpscRing<T>::TSpscRing(uint32_t capacity) :
+mSlots(),
+mMask(),
+mHead(),
+mTail(),
+mMaxOccupancy(),
+mFullPushes()
+{
+	uint32_t size = 1;
+	while(size < capacity)
+		size *= 2;
+	mSlots.resize(size);
+	mMask = size - 1;
+}
+
+/** @function TSpscRing::Push - Adds a value to the back of the ring, only called by the producer
+ *		@param 		value				Value to add
+ *
+ *		@return		false if the ring was full, in which case the value isn't added
+ */
+template<class T>
+inline bool TSpscRing<T>::Push(const T& value)
+{
+	uint32_t tail = uint32_t(mTail.GetValue());
+	uint32_t occupancy = tail - uint32_t(mHead.GetValue());
+	if(occupancy > mMask) {
+		mFullPushes++;
+		return false;
+	}
+	mSlots[tail & mMask] = value;
+	mTail.Exchange(long(tail + 1));
+	if(occupancy + 1 > mMaxOccupancy)
+		mMaxOccupancy = occupancy + 1;
+	return true;
+}
+
+/** @function TSpscRing::Pop - Takes the value from the front of the ring, only called by the consumer
+ *		@param 		value				Set to the value taken
+ *
+ *		@return		false if the ring was empty
+ */
+template<class T>
+inline bool TSpscRing<T>::Pop(T& value)
+{
+	uint32_t head = uint32_t(mHead.GetValue());
+	if(uint32_t(mTail.GetValue()) == head)
+		return false;
+	value = mSlots[head & mMask];
+	mHead.Exchange(long(head + 1));
+	return true;
+}
+
+#endif // SPSCRING_H_INCLUDED
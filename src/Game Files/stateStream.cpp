@@ -0,0 +1,701 @@
+/**
+ *	stateStream.cpp - Jan van der Kamp, 2011
+ */
+#include "stateStream.h"
+
+#include <pf/debug.h>
+
+#include "timer.h"
+
+using std::vector;
+
+namespace {
+	// Start of a stream file, followed by each packet with its size in front
+	const uint32_t	fileMagic = 0x54535342;
+	const uint32_t	fileVersion = 1;
+	// Largest packet read from a file, far more than a screen full of balloons needs
+	const uint32_t	maxPacketSize = 1 << 20;
+	// Longest time in milliseconds balloons are moved on by between packets, anything longer is sent as a keyframe
+	const uint32_t	maxPredictTime = 1000;
+
+	// First byte of each packet
+	enum { KEYFRAME = 1, DELTA = 2 };
+	// Set on a ball's colour byte if it has been burst, in which case its burst time follows
+	const uint8_t	burstFlag = 0x80;
+	// Which parts of a balloon a correction changes
+	enum { CORRECT_X = 1, CORRECT_Y = 2, CORRECT_VELOCITY_X = 4, CORRECT_VELOCITY_Y = 8 };
+
+	// Numbers are written 7 bits at a time, lowest first, with the top bit set on every byte but the last
+	void WriteVarint(vector<uint8_t>& out, uint32_t value)
+	{
+		while(value >= 0x80) {
+			out.push_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(uint8_t(value));
+	}
+
+	// Signed numbers are zigzagged first, so that small negative numbers are written as small numbers
+	void WriteSigned(vector<uint8_t>& out, int32_t value)
+	{
+		WriteVarint(out, value < 0 ? (uint32_t(-(value + 1)) << 1) | 1 : uint32_t(value) << 1);
+	}
+
+	// Reads numbers back out of a packet, remembering if it ran off the end
+	struct TReader
+	{
+		TReader(const uint8_t* data, uint32_t size) : mData(data), mEnd(data + size), mOk(true) {}
+		uint32_t	Remaining()	const	{ return uint32_t(mEnd - mData); }
+		uint8_t		ReadByte()
+		{
+			if(mData == mEnd) {
+				mOk = false;
+				return 0;
+			}
+			return *mData++;
+		}
+		uint32_t	ReadVarint()
+		{
+			uint32_t value = 0;
+			for(uint32_t shift = 0; shift < 35; shift += 7) {
+				uint8_t byte = ReadByte();
+				value |= uint32_t(byte & 0x7F) << shift;
+				if(!(byte & 0x80))
+					return value;
+			}
+			mOk = false;
+			return 0;
+		}
+		int32_t		ReadSigned()
+		{
+			uint32_t value = ReadVarint();
+			return (value & 1) ? -int32_t(value >> 1) - 1 : int32_t(value >> 1);
+		}
+
+		const uint8_t*	mData;
+		const uint8_t*	mEnd;
+		bool			mOk;
+	};
+
+	void WriteUInt32(FILE* file, uint32_t value)
+	{
+		uint8_t bytes[4] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) };
+		fwrite(bytes, 1, 4, file);
+	}
+
+	bool ReadUInt32(FILE* file, uint32_t& value)
+	{
+		uint8_t bytes[4];
+		if(fread(bytes, 1, 4, file) != 4)
+			return false;
+		value = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+		return true;
+	}
+
+	// Converts to fixed point, rounding to the nearest step
+	int32_t ToFixed(TReal value, int32_t scale)
+	{
+		double scaled = double(value) * scale;
+		return int32_t(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+	}
+
+	TReal FromFixed(int32_t value, int32_t scale)
+	{
+		return TReal(double(value) / scale);
+	}
+
+	// Divides rounding to the nearest whole number, the same way for positive and negative numbers
+	int32_t RoundDivide(int32_t value, int32_t divisor)
+	{
+		return value < 0 ? -((-value + divisor / 2) / divisor) : (value + divisor / 2) / divisor;
+	}
+
+	// Writes a ball's colour, its burst time if it has been burst, and its position to 1/QUANTUM of a pixel
+	void WriteBall(vector<uint8_t>& out, const TBall& ball, const TBurstTimer& burstTimer, int32_t& x, int32_t& y)
+	{
+		out.push_back(uint8_t(ball.GetColour() | (ball.IsBurst() ? burstFlag : 0)));
+		if(ball.IsBurst())
+			WriteVarint(out, uint32_t(burstTimer.GetBurstTime(ball)));
+		x = RoundDivide(ToFixed(ball.GetPosition().x, TStreamState::POSITION_SCALE), TStreamState::QUANTUM_STEP);
+		y = RoundDivide(ToFixed(ball.GetPosition().y, TStreamState::POSITION_SCALE), TStreamState::QUANTUM_STEP);
+		WriteSigned(out, x);
+		WriteSigned(out, y);
+	}
+
+	// Reads what WriteBall wrote
+	void ReadBall(TReader& in, TStreamBall& ball)
+	{
+		uint8_t colour = in.ReadByte();
+		ball.mColour = uint8_t(colour & ~burstFlag);
+		ball.mBurst = (colour & burstFlag) != 0;
+		ball.mBurstTime = ball.mBurst ? in.ReadVarint() : 0;
+		ball.mX = in.ReadSigned() * TStreamState::QUANTUM_STEP;
+		ball.mY = in.ReadSigned() * TStreamState::QUANTUM_STEP;
+		ball.mVelocityX = ball.mVelocityY = 0;
+		ball.mId = 0;
+	}
+
+	// Writes a list of bullets whole
+	void WriteBullets(vector<uint8_t>& out, const vector<TBall>& bullets, const TBurstTimer& burstTimer)
+	{
+		WriteVarint(out, uint32_t(bullets.size()));
+		int32_t x, y;
+		for(vector<TBall>::const_iterator bullet = bullets.begin(); bullet != bullets.end(); ++bullet)
+			WriteBall(out, *bullet, burstTimer, x, y);
+	}
+
+	bool ReadBullets(TReader& in, vector<TStreamBall>& bullets)
+	{
+		uint32_t count = in.ReadVarint();
+		if(count > in.Remaining())
+			return false;
+		bullets.resize(count);
+		for(vector<TStreamBall>::iterator bullet = bullets.begin(); bullet != bullets.end(); ++bullet)
+			ReadBall(in, *bullet);
+		return in.mOk;
+	}
+
+	// Writes a new balloon in full, and adds it to the balloons the decoder knows about
+	void WriteSpawn(vector<uint8_t>& out, const TBall& balloon, const TBurstTimer& burstTimer, vector<TStreamBall>& known)
+	{
+		TStreamBall ball;
+		WriteBall(out, balloon, burstTimer, ball.mX, ball.mY);
+		ball.mX *= TStreamState::QUANTUM_STEP;
+		ball.mY *= TStreamState::QUANTUM_STEP;
+		ball.mVelocityX = ToFixed(balloon.GetVelocity().x, TStreamState::POSITION_SCALE);
+		ball.mVelocityY = ToFixed(balloon.GetVelocity().y, TStreamState::POSITION_SCALE);
+		WriteSigned(out, ball.mVelocityX);
+		WriteSigned(out, ball.mVelocityY);
+		ball.mBurstTime = balloon.IsBurst() ? uint32_t(burstTimer.GetBurstTime(balloon)) : 0;
+		ball.mId = balloon.GetId();
+		ball.mColour = uint8_t(balloon.GetColour());
+		ball.mBurst = balloon.IsBurst();
+		known.push_back(ball);
+	}
+
+	// Reads what WriteSpawn wrote
+	bool ReadSpawns(TReader& in, vector<TStreamBall>& balloons)
+	{
+		uint32_t count = in.ReadVarint();
+		if(count > in.Remaining())
+			return false;
+		for(uint32_t s = 0; s != count && in.mOk; ++s) {
+			TStreamBall ball;
+			ReadBall(in, ball);
+			ball.mVelocityX = in.ReadSigned();
+			ball.mVelocityY = in.ReadSigned();
+			balloons.push_back(ball);
+		}
+		return in.mOk;
+	}
+
+	// Replaces the entities of an archetype with the balls a stream describes, reusing the archetype's storage. Burst
+	// balls are given expiries by the burst timer, but not scheduled, since a game being drawn from a stream isn't updated.
+	void ApplyBalls(const vector<TStreamBall>& from, TEntityWorld& world, uint32_t archetype, uint16_t radius,
+					bool isBullet, const TBurstTimer& burstTimer)
+	{
+		world.Clear(archetype);
+		for(vector<TStreamBall>::const_iterator ball = from.begin(); ball != from.end(); ++ball) {
+			TVec2 velocity(FromFixed(ball->mVelocityX, TStreamState::POSITION_SCALE),
+						   FromFixed(ball->mVelocityY, TStreamState::POSITION_SCALE));
+			TEntity entity = world.Create(archetype, TBall(TVec2(FromFixed(ball->mX, TStreamState::POSITION_SCALE),
+																 FromFixed(ball->mY, TStreamState::POSITION_SCALE)),
+														   velocity, radius, ball->mColour, isBullet));
+			if(ball->mBurst) {
+				TBall& burst = world.GetBall(entity);
+				burst.SetToBurst(0);
+				burst.SetVelocity(velocity);
+				burstTimer.SetBurstTime(burst, TReal(ball->mBurstTime));
+			}
+		}
+	}
+}
+
+/** @function TStreamState::TStreamState - Default Constructor
+ */
+TStreamState::TStreamState() :
+mBalloons(),
+mBullets(),
+mBulletsFired()
+{
+	Clear();
+}
+
+/** @function TStreamState::Clear - Forgets the game, keeping the storage of the lists of balls
+ */
+void TStreamState::Clear()
+{
+	mSequence = 0;
+	mTime = 0;
+	mScore = 0;
+	mLevel = 0;
+	mBalloonsAdded = 0;
+	mBarrierX = mBarrierY = 0;
+	mCannonAngle = 0;
+	mBalloons.clear();
+	mBullets.clear();
+	mBulletsFired.clear();
+}
+
+/** @function TStreamState::Predict - Moves every balloon on by its velocity, and counts up the burst time of burst ones,
+ *									  which is done in exactly the same way by the encoder and decoder
+ *		@param 		elapsedTime			Time in milliseconds since the last packet
+ */
+void TStreamState::Predict(uint32_t elapsedTime)
+{
+	int32_t time = int32_t(elapsedTime);
+	for(vector<TStreamBall>::iterator balloon = mBalloons.begin(); balloon != mBalloons.end(); ++balloon) {
+		balloon->mX += balloon->mVelocityX * time;
+		balloon->mY += balloon->mVelocityY * time;
+		if(balloon->mBurst)
+			balloon->mBurstTime += elapsedTime;
+	}
+}
+
+
+/** @function TStateStreamEncoder::TStateStreamEncoder - Default Constructor
+ */
+TStateStreamEncoder::TStateStreamEncoder() :
+mFile(NULL),
+mTransport(NULL),
+mState(),
+mKeyframeDue(true),
+mPacketsSinceKeyframe(),
+mPacket(),
+mCorrections(),
+mIndices(),
+mPackets(),
+mKeyframes(),
+mBytes(),
+mEncodeTicks()
+{
+	mState.mBalloons.reserve(gameVars::balloonCapacity);
+	mIndices.reserve(gameVars::balloonCapacity);
+}
+
+/** @function TStateStreamEncoder::~TStateStreamEncoder - Destructor, closes the file if one is open
+ */
+TStateStreamEncoder::~TStateStreamEncoder()
+{
+	Close();
+}
+
+/** @function TStateStreamEncoder::OpenFile - Starts writing packets to a file, starting with a keyframe
+ *		@param 		filename			File to write to
+ *
+ *		@return		true if the file could be opened
+ */
+bool TStateStreamEncoder::OpenFile(const char* filename)
+{
+	Close();
+	mFile = fopen(filename, "wb");
+	if(!mFile)
+		return false;
+	WriteUInt32(mFile, fileMagic);
+	WriteUInt32(mFile, fileVersion);
+	mKeyframeDue = true;
+	return true;
+}
+
+/** @function TStateStreamEncoder::Close - Closes the file, if one is open, and writes out how big and how quick encoding was
+ */
+void TStateStreamEncoder::Close()
+{
+	if(!mFile)
+		return;
+	fclose(mFile);
+	mFile = NULL;
+	DEBUG_WRITE(("State stream: %d packets, %d keyframes, %.1f bytes/packet, %.2f us/packet to encode", mPackets,
+				 mKeyframes, mPackets ? double(mBytes) / mPackets : 0.0,
+				 mPackets ? THighResTimer::TicksToNanoseconds(mEncodeTicks) / 1000.0 / mPackets : 0.0));
+}
+
+/** @function TStateStreamEncoder::Encode - Encodes the next packet of the stream and writes it to the file and transport
+ *		@param 		simulation			Game being streamed
+ *
+ *		@return		The packet, which is kept until the next call
+ */
+const std::vector<uint8_t>& TStateStreamEncoder::Encode(const TSimulation& simulation)
+{
+	uint64_t start = THighResTimer::GetTicks();
+	const TBalloonManager& balloonManager = simulation.GetBalloonManager();
+	const vector<TBall>& balloons = balloonManager.GetBalloons();
+	uint16_t balloonsAdded = balloonManager.GetStateVariables().mBalloonsAddedSoFar;
+
+	// A game that has gone back in time has been restarted or restored, so doesn't follow on from the last packet
+	uint32_t time = simulation.GetTime();
+	bool keyframe = (mKeyframeDue || mPacketsSinceKeyframe + 1 >= gameVars::streamKeyframeInterval ||
+					 time < mState.mTime || time - mState.mTime > maxPredictTime);
+	mState.mSequence++;
+	if(!keyframe) {
+		mState.Predict(time - mState.mTime);
+		EncodeHeader(simulation, false);
+		// If the balloons weren't all found, the game has changed some other way which only a keyframe can describe
+		keyframe = !EncodeBalloonChanges(balloons, balloonsAdded, simulation.GetBurstTimer());
+	}
+	if(keyframe) {
+		EncodeHeader(simulation, true);
+		EncodeKeyframeBalloons(balloons, balloonsAdded, simulation.GetBurstTimer());
+		mKeyframeDue = false;
+		mPacketsSinceKeyframe = 0;
+		mKeyframes++;
+	}
+	else mPacketsSinceKeyframe++;
+
+	if(mFile) {
+		WriteUInt32(mFile, uint32_t(mPacket.size()));
+		fwrite(&mPacket[0], 1, mPacket.size(), mFile);
+	}
+	if(mTransport)
+		mTransport->Send(&mPacket[0], uint32_t(mPacket.size()));
+
+	mPackets++;
+	mBytes += mPacket.size();
+	mEncodeTicks += THighResTimer::GetTicks() - start;
+	return mPacket;
+}
+
+/** @function TStateStreamEncoder::EncodeHeader - Starts a packet with everything that is sent whole every time: the
+ *												  time, score, level, barrier, cannon and bullets
+ *		@param 		simulation			Game being streamed
+ *		@param 		keyframe			Whether the packet is a keyframe
+ */
+void TStateStreamEncoder::EncodeHeader(const TSimulation& simulation, bool keyframe)
+{
+	const TBalloonManager& balloonManager = simulation.GetBalloonManager();
+	const TCannon& cannon = simulation.GetCannon();
+	mState.mTime = simulation.GetTime();
+	mState.mScore = balloonManager.GetScore();
+	mState.mLevel = balloonManager.GetLevel();
+	mState.mBarrierX = ToFixed(simulation.GetBarrier().GetPosition().x, TStreamState::QUANTUM);
+	mState.mBarrierY = ToFixed(simulation.GetBarrier().GetPosition().y, TStreamState::QUANTUM);
+	mState.mCannonAngle = ToFixed(cannon.GetAngle(), TStreamState::ANGLE_SCALE);
+
+	mPacket.clear();
+	mPacket.push_back(uint8_t(keyframe ? KEYFRAME : DELTA));
+	WriteVarint(mPacket, mState.mSequence);
+	WriteVarint(mPacket, mState.mTime);
+	WriteVarint(mPacket, mState.mScore);
+	WriteVarint(mPacket, mState.mLevel);
+	WriteSigned(mPacket, mState.mBarrierX);
+	WriteSigned(mPacket, mState.mBarrierY);
+	WriteSigned(mPacket, mState.mCannonAngle);
+	WriteBullets(mPacket, cannon.GetBullets(), simulation.GetBurstTimer());
+	WriteBullets(mPacket, cannon.GetBulletsFired(), simulation.GetBurstTimer());
+}
+
+/** @function TStateStreamEncoder::EncodeBalloonChanges - Adds what has happened to the balloons since the last packet: the
+ *														  balloons removed, those burst, new balloons, then corrections to
+ *														  any whose predicted position is out by a QUANTUM or more, or
+ *														  whose velocity has changed. Removed, burst and corrected balloons
+ *														  are given by their distance from the last one in the list.
+ *		@param 		balloons			Balloons in the game
+ *		@param 		balloonsAdded		Number of balloons the game has added so far
+ *		@param 		burstTimer			Burst timer of the game, which burst times are read from
+ *
+ *		@return		false if the balloons don't follow on from the last packet, so a keyframe is needed
+ */
+bool TStateStreamEncoder::EncodeBalloonChanges(const std::vector<TBall>& balloons, uint16_t balloonsAdded,
+											   const TBurstTimer& burstTimer)
+{
+	vector<TStreamBall>& known = mState.mBalloons;
+
+	// Both lists are in the same order, so a balloon that's gone is one whose id doesn't match the next one in the game,
+	// and whatever is left over at the end of the game's list is new
+	mIndices.clear();
+	vector<TBall>::size_type next = 0;
+	for(vector<TStreamBall>::size_type b = 0; b != known.size(); ++b) {
+		if(next != balloons.size() && balloons[next].GetId() == known[b].mId)
+			next++;
+		else mIndices.push_back(uint32_t(b));
+	}
+	if(uint16_t(balloonsAdded - mState.mBalloonsAdded) != balloons.size() - next)
+		return false;
+	mState.mBalloonsAdded = balloonsAdded;
+
+	WriteVarint(mPacket, uint32_t(mIndices.size()));
+	uint32_t last = 0;
+	for(vector<uint32_t>::const_iterator index = mIndices.begin(); index != mIndices.end(); ++index) {
+		WriteVarint(mPacket, *index - last);
+		last = *index;
+	}
+	if(!mIndices.empty()) {
+		vector<TStreamBall>::size_type kept = 0;
+		vector<uint32_t>::const_iterator removed = mIndices.begin();
+		for(vector<TStreamBall>::size_type b = 0; b != known.size(); ++b) {
+			if(removed != mIndices.end() && *removed == b)
+				++removed;
+			else known[kept++] = known[b];
+		}
+		known.resize(kept);
+	}
+
+	// Balloons the decoder already has, which are now in step with the game's list
+	mIndices.clear();
+	mCorrections.clear();
+	uint32_t numCorrections = 0;
+	uint32_t lastCorrected = 0;
+	for(vector<TStreamBall>::size_type b = 0; b != known.size(); ++b)
+	{
+		const TBall& balloon = balloons[b];
+		TStreamBall& ball = known[b];
+		if(balloon.IsBurst() && !ball.mBurst) {
+			mIndices.push_back(uint32_t(b));
+			ball.mBurst = true;
+			ball.mBurstTime = 0;
+		}
+
+		uint8_t corrections = 0;
+		int32_t errorX = ToFixed(balloon.GetPosition().x, TStreamState::POSITION_SCALE) - ball.mX;
+		int32_t errorY = ToFixed(balloon.GetPosition().y, TStreamState::POSITION_SCALE) - ball.mY;
+		int32_t velocityX = ToFixed(balloon.GetVelocity().x, TStreamState::POSITION_SCALE);
+		int32_t velocityY = ToFixed(balloon.GetVelocity().y, TStreamState::POSITION_SCALE);
+		if(errorX >= TStreamState::QUANTUM_STEP || errorX <= -TStreamState::QUANTUM_STEP)
+			corrections |= CORRECT_X;
+		if(errorY >= TStreamState::QUANTUM_STEP || errorY <= -TStreamState::QUANTUM_STEP)
+			corrections |= CORRECT_Y;
+		if(velocityX != ball.mVelocityX)
+			corrections |= CORRECT_VELOCITY_X;
+		if(velocityY != ball.mVelocityY)
+			corrections |= CORRECT_VELOCITY_Y;
+		if(!corrections)
+			continue;
+
+		WriteVarint(mCorrections, uint32_t(b) - lastCorrected);
+		lastCorrected = uint32_t(b);
+		mCorrections.push_back(corrections);
+		if(corrections & CORRECT_X) {
+			int32_t steps = RoundDivide(errorX, TStreamState::QUANTUM_STEP);
+			WriteSigned(mCorrections, steps);
+			ball.mX += steps * TStreamState::QUANTUM_STEP;
+		}
+		if(corrections & CORRECT_Y) {
+			int32_t steps = RoundDivide(errorY, TStreamState::QUANTUM_STEP);
+			WriteSigned(mCorrections, steps);
+			ball.mY += steps * TStreamState::QUANTUM_STEP;
+		}
+		if(corrections & CORRECT_VELOCITY_X) {
+			WriteSigned(mCorrections, velocityX - ball.mVelocityX);
+			ball.mVelocityX = velocityX;
+		}
+		if(corrections & CORRECT_VELOCITY_Y) {
+			WriteSigned(mCorrections, velocityY - ball.mVelocityY);
+			ball.mVelocityY = velocityY;
+		}
+		numCorrections++;
+	}
+
+	WriteVarint(mPacket, uint32_t(mIndices.size()));
+	last = 0;
+	for(vector<uint32_t>::const_iterator index = mIndices.begin(); index != mIndices.end(); ++index) {
+		WriteVarint(mPacket, *index - last);
+		last = *index;
+	}
+
+	WriteVarint(mPacket, uint32_t(balloons.size() - next));
+	for(vector<TBall>::size_type b = next; b != balloons.size(); ++b)
+		WriteSpawn(mPacket, balloons[b], burstTimer, known);
+
+	WriteVarint(mPacket, numCorrections);
+	mPacket.insert(mPacket.end(), mCorrections.begin(), mCorrections.end());
+	return true;
+}
+
+/** @function TStateStreamEncoder::EncodeKeyframeBalloons - Adds every balloon in full, replacing what the decoder knows
+ *		@param 		balloons			Balloons in the game
+ *		@param 		balloonsAdded		Number of balloons the game has added so far
+ *		@param 		burstTimer			Burst timer of the game, which burst times are read from
+ */
+void TStateStreamEncoder::EncodeKeyframeBalloons(const std::vector<TBall>& balloons, uint16_t balloonsAdded,
+												 const TBurstTimer& burstTimer)
+{
+	mState.mBalloons.clear();
+	mState.mBalloonsAdded = balloonsAdded;
+	WriteVarint(mPacket, uint32_t(balloons.size()));
+	for(vector<TBall>::const_iterator balloon = balloons.begin(); balloon != balloons.end(); ++balloon)
+		WriteSpawn(mPacket, *balloon, burstTimer, mState.mBalloons);
+}
+
+
+/** @function TStateStreamDecoder::TStateStreamDecoder - Default Constructor
+ */
+TStateStreamDecoder::TStateStreamDecoder() :
+mFile(NULL),
+mState(),
+mSynced(false),
+mPacket()
+{}
+
+/** @function TStateStreamDecoder::~TStateStreamDecoder - Destructor, closes the file if one is open
+ */
+TStateStreamDecoder::~TStateStreamDecoder()
+{
+	Close();
+}
+
+/** @function TStateStreamDecoder::OpenFile - Starts reading packets from a file written by TStateStreamEncoder
+ *		@param 		filename			File to read from
+ *
+ *		@return		true if the file could be opened and is a state stream
+ */
+bool TStateStreamDecoder::OpenFile(const char* filename)
+{
+	Close();
+	mFile = fopen(filename, "rb");
+	if(!mFile)
+		return false;
+	uint32_t magic, version;
+	if(!ReadUInt32(mFile, magic) || !ReadUInt32(mFile, version) || magic != fileMagic || version != fileVersion) {
+		Close();
+		return false;
+	}
+	mSynced = false;
+	return true;
+}
+
+/** @function TStateStreamDecoder::Close - Closes the file, if one is open
+ */
+void TStateStreamDecoder::Close()
+{
+	if(mFile)
+		fclose(mFile);
+	mFile = NULL;
+}
+
+/** @function TStateStreamDecoder::ReadPacket - Reads the next packet from the file and decodes it
+ *
+ *		@return		false once the end of the file has been reached
+ */
+bool TStateStreamDecoder::ReadPacket()
+{
+	uint32_t size;
+	if(!mFile || !ReadUInt32(mFile, size) || size == 0 || size > maxPacketSize)
+		return false;
+	mPacket.resize(size);
+	if(fread(&mPacket[0], 1, size, mFile) != size)
+		return false;
+	Decode(&mPacket[0], size);
+	return true;
+}
+
+/** @function TStateStreamDecoder::Decode - Brings the state of the game up to date with a packet. A delta that doesn't
+ *										   follow on from the last packet is ignored, and a packet that turns out to be
+ *										   damaged leaves the decoder waiting for a keyframe.
+ *		@param 		data				Start of the packet
+ *		@param 		size				Size of the packet in bytes
+ *
+ *		@return		true if the packet was applied
+ */
+bool TStateStreamDecoder::Decode(const uint8_t* data, uint32_t size)
+{
+	TReader in(data, size);
+	uint8_t type = in.ReadByte();
+	uint32_t sequence = in.ReadVarint();
+	if(type != KEYFRAME && type != DELTA)
+		return false;
+	if(type == DELTA && (!mSynced || sequence != mState.mSequence + 1)) {
+		mSynced = false;
+		return false;
+	}
+
+	// From here on the state is changed as the packet is read, so a damaged packet leaves it incomplete
+	mSynced = false;
+	uint32_t time = in.ReadVarint();
+	if(type == KEYFRAME)
+		mState.mBalloons.clear();
+	else mState.Predict(time - mState.mTime);
+	mState.mSequence = sequence;
+	mState.mTime = time;
+	mState.mScore = in.ReadVarint();
+	mState.mLevel = in.ReadVarint();
+	mState.mBarrierX = in.ReadSigned();
+	mState.mBarrierY = in.ReadSigned();
+	mState.mCannonAngle = in.ReadSigned();
+	if(!ReadBullets(in, mState.mBullets) || !ReadBullets(in, mState.mBulletsFired))
+		return false;
+
+	vector<TStreamBall>& balloons = mState.mBalloons;
+	if(type == DELTA)
+	{
+		uint32_t numRemoved = in.ReadVarint();
+		if(numRemoved > balloons.size())
+			return false;
+		vector<TStreamBall>::size_type kept = 0, b = 0;
+		uint32_t index = 0;
+		for(uint32_t r = 0; r != numRemoved; ++r) {
+			index += in.ReadVarint();
+			if(!in.mOk || index < b || index >= balloons.size())
+				return false;
+			while(b != index)
+				balloons[kept++] = balloons[b++];
+			b++;
+		}
+		while(b != balloons.size())
+			balloons[kept++] = balloons[b++];
+		balloons.resize(kept);
+
+		uint32_t numBurst = in.ReadVarint();
+		index = 0;
+		for(uint32_t s = 0; s != numBurst; ++s) {
+			index += in.ReadVarint();
+			if(!in.mOk || index >= balloons.size())
+				return false;
+			balloons[index].mBurst = true;
+			balloons[index].mBurstTime = 0;
+		}
+	}
+
+	vector<TStreamBall>::size_type numKnown = balloons.size();
+	if(!ReadSpawns(in, balloons))
+		return false;
+
+	if(type == DELTA)
+	{
+		uint32_t numCorrections = in.ReadVarint();
+		uint32_t index = 0;
+		for(uint32_t c = 0; c != numCorrections; ++c) {
+			index += in.ReadVarint();
+			uint8_t corrections = in.ReadByte();
+			if(!in.mOk || index >= numKnown)
+				return false;
+			TStreamBall& ball = balloons[index];
+			if(corrections & CORRECT_X)
+				ball.mX += in.ReadSigned() * TStreamState::QUANTUM_STEP;
+			if(corrections & CORRECT_Y)
+				ball.mY += in.ReadSigned() * TStreamState::QUANTUM_STEP;
+			if(corrections & CORRECT_VELOCITY_X)
+				ball.mVelocityX += in.ReadSigned();
+			if(corrections & CORRECT_VELOCITY_Y)
+				ball.mVelocityY += in.ReadSigned();
+		}
+	}
+
+	mSynced = in.mOk && in.Remaining() == 0;
+	return mSynced;
+}
+
+/** @function TStateStreamDecoder::Apply - Puts the state of the game into a simulation, replacing its balls, so that it
+ *										  can be drawn. The simulation shouldn't be updated, since the stream doesn't hold
+ *										  everything an update needs.
+ *		@param 		simulation			Game to draw the stream with, which must have had AssignAssets called
+ */
+void TStateStreamDecoder::Apply(TSimulation& simulation) const
+{
+	TBalloonManager& balloonManager = simulation.mBalloonManager;
+	TCannon& cannon = simulation.mCannon;
+
+	simulation.mTime = mState.mTime;
+	balloonManager.mVars.mScore = uint16_t(mState.mScore);
+	balloonManager.mVars.mLevel = uint16_t(mState.mLevel);
+	simulation.mBurstTimer.Reset();
+	ApplyBalls(mState.mBalloons, simulation.mWorld, balloonManager.mArchetype, balloonManager.mBalloonRadius, false,
+			   simulation.mBurstTimer);
+	ApplyBalls(mState.mBullets, simulation.mWorld, cannon.mLoadedArchetype, cannon.mBulletRadius, true,
+			   simulation.mBurstTimer);
+	ApplyBalls(mState.mBulletsFired, simulation.mWorld, cannon.mFiredArchetype, cannon.mBulletRadius, true,
+			   simulation.mBurstTimer);
+	cannon.mAngle = FromFixed(mState.mCannonAngle, TStreamState::ANGLE_SCALE);
+	cannon.UpdateDrawSpec();
+	simulation.mBarrier.mPosition = TVec2(FromFixed(mState.mBarrierX, TStreamState::QUANTUM),
+										  FromFixed(mState.mBarrierY, TStreamState::QUANTUM));
+}
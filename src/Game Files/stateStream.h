@@ -0,0 +1,170 @@
+/**
+ *	stateStream.h - Jan van der Kamp, 2011
+ */
+#ifndef STATESTREAM_H_INCLUDED
+#define STATESTREAM_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+#include <cstdio>
+
+#include "simulation.h"
+#include "transport.h"
+
+/** @struct TStreamBall - A ball as a state stream knows it. Positions are in 1/TStreamState::POSITION_SCALE pixels and
+ *						  velocities in 1/TStreamState::POSITION_SCALE pixels per millisecond, so that the encoder and
+ *						  decoder move balls on by exactly the same amount with integer sums.
+ *	@property 	int32_t			mX						Horizontal position
+ *	@property 	int32_t			mY						Vertical position
+ *	@property 	int32_t			mVelocityX				Horizontal velocity
+ *	@property 	int32_t			mVelocityY				Vertical velocity
+ *	@property 	uint32_t		mBurstTime				Time in milliseconds since the ball was burst
+ *	@property 	uint16_t		mId						Id of the balloon, see TBall::GetId
+ *	@property 	uint8_t			mColour					Colour of the ball
+ *	@property 	bool			mBurst					Whether the ball has been burst
+ */
+struct TStreamBall
+{
+	int32_t		mX;
+	int32_t		mY;
+	int32_t		mVelocityX;
+	int32_t		mVelocityY;
+	uint32_t	mBurstTime;
+	uint16_t	mId;
+	uint8_t		mColour;
+	bool		mBurst;
+};
+
+/** @struct TStreamState - Everything a state stream says about a game, which the encoder keeps a copy of so that it always
+ *						   knows exactly what the decoder has
+ *	@property 	uint32_t					mSequence				Number of the last packet
+ *	@property 	uint32_t					mTime					Time in milliseconds since the game started
+ *	@property 	uint32_t					mScore					Score
+ *	@property 	uint32_t					mLevel					Level
+ *	@property 	uint16_t					mBalloonsAdded			Number of balloons added so far, used to check that every new balloon was found
+ *	@property 	int32_t						mBarrierX				Horizontal position of the barrier in 1/QUANTUM pixels
+ *	@property 	int32_t						mBarrierY				Vertical position of the barrier in 1/QUANTUM pixels
+ *	@property 	int32_t						mCannonAngle			Angle of the cannon in 1/ANGLE_SCALE radians
+ *	@property 	std::vector<TStreamBall>	mBalloons				Balloons, in the order the game keeps them
+ *	@property 	std::vector<TStreamBall>	mBullets				Bullets loaded on the cannon
+ *	@property 	std::vector<TStreamBall>	mBulletsFired			Bullets in flight
+ */
+struct TStreamState
+{
+	TStreamState();
+	void		Clear();
+	void		Predict(uint32_t elapsedTime);
+
+	// Balls are moved in 1/POSITION_SCALE pixels, but positions are only sent to 1/QUANTUM of a pixel
+	enum { POSITION_SCALE = 65536, QUANTUM = 8, QUANTUM_STEP = POSITION_SCALE / QUANTUM, ANGLE_SCALE = 4096 };
+
+	uint32_t					mSequence;
+	uint32_t					mTime;
+	uint32_t					mScore;
+	uint32_t					mLevel;
+	uint16_t					mBalloonsAdded;
+	int32_t						mBarrierX;
+	int32_t						mBarrierY;
+	int32_t						mCannonAngle;
+	std::vector<TStreamBall>	mBalloons;
+	std::vector<TStreamBall>	mBullets;
+	std::vector<TStreamBall>	mBulletsFired;
+};
+
+/** @class TStateStreamEncoder - Turns a running game into a stream of small packets, one per frame, for spectators and for
+ *								 recording. Each packet holds what has changed since the last one: the balloons removed and
+ *								 burst, new balloons in full, and corrections to the rest. Both ends move balloons on by their
+ *								 last known velocity, so a balloon falling steadily costs nothing until its position has
+ *								 drifted by a QUANTUM of a pixel, and a correction is only a few bytes. Balloons are matched
+ *								 from frame to frame by their ids, which only needs one pass since the game keeps balloons
+ *								 in order, removing from anywhere and adding at the end. Bullets, the cannon, the barrier, the
+ *								 score and the level are small and sent whole every packet.
+ *								 Every gameVars::streamKeyframeInterval packets, and whenever the game doesn't follow on from
+ *								 the last packet, a keyframe holding the whole game is sent instead, so a spectator can join
+ *								 part way through, or recover from a lost packet. Packets are written to a file, sent over an
+ *								 ITransport, or both.
+ *	@property 	FILE*						mFile					File packets are written to, if any
+ *	@property 	ITransport*					mTransport				Transport packets are sent over, if any
+ *	@property 	TStreamState				mState					What the decoder has been told
+ *	@property 	bool						mKeyframeDue			Whether the next packet must be a keyframe
+ *	@property 	uint32_t					mPacketsSinceKeyframe	Packets encoded since the last keyframe
+ *	@property 	std::vector<uint8_t>		mPacket					Packet being encoded, kept to save allocating
+ *	@property 	std::vector<uint8_t>		mCorrections			Corrections being encoded, kept to save allocating
+ *	@property 	std::vector<uint32_t>		mIndices				Balloons removed or burst this frame, kept to save allocating
+ *	@property 	uint32_t					mPackets				Number of packets encoded
+ *	@property 	uint32_t					mKeyframes				Number of keyframes encoded
+ *	@property 	uint64_t					mBytes					Bytes encoded
+ *	@property 	uint64_t					mEncodeTicks			THighResTimer ticks spent encoding
+ */
+class TStateStreamEncoder
+{
+public:
+	TStateStreamEncoder();
+	~TStateStreamEncoder();
+	bool							OpenFile(const char* filename);
+	void							SetTransport(ITransport* transport)	{ mTransport = transport; }
+	void							Close();
+	const std::vector<uint8_t>&		Encode(const TSimulation& simulation);
+	void							RequestKeyframe()			{ mKeyframeDue = true; }
+	uint32_t						GetPackets()		const	{ return mPackets; }
+	uint32_t						GetKeyframes()		const	{ return mKeyframes; }
+	uint64_t						GetBytes()			const	{ return mBytes; }
+	uint64_t						GetEncodeTicks()	const	{ return mEncodeTicks; }
+private:
+	// copying disallowed
+	TStateStreamEncoder(const TStateStreamEncoder &encoder);
+	TStateStreamEncoder& operator=(const TStateStreamEncoder &encoder);
+	void							EncodeHeader(const TSimulation& simulation, bool keyframe);
+	bool							EncodeBalloonChanges(const std::vector<TBall>& balloons, uint16_t balloonsAdded,
+														 const TBurstTimer& burstTimer);
+	void							EncodeKeyframeBalloons(const std::vector<TBall>& balloons, uint16_t balloonsAdded,
+														   const TBurstTimer& burstTimer);
+
+	FILE*							mFile;
+	ITransport*						mTransport;
+	TStreamState					mState;
+	bool							mKeyframeDue;
+	uint32_t						mPacketsSinceKeyframe;
+	std::vector<uint8_t>			mPacket;
+	std::vector<uint8_t>			mCorrections;
+	std::vector<uint32_t>			mIndices;
+	uint32_t						mPackets;
+	uint32_t						mKeyframes;
+	uint64_t						mBytes;
+	uint64_t						mEncodeTicks;
+};
+
+/** @class TStateStreamDecoder - Reads the packets written by a TStateStreamEncoder and keeps the state of the game they
+ *								 describe, which Apply() puts into a TSimulation so that it can be drawn without being
+ *								 updated. Packets that don't follow on from the last one are ignored until the next keyframe.
+ *	@property 	FILE*						mFile					File packets are read from, if any
+ *	@property 	TStreamState				mState					State of the game
+ *	@property 	bool						mSynced					Whether mState is complete, which it isn't until a keyframe
+ *																	has been decoded, or after a packet is missed
+ *	@property 	std::vector<uint8_t>		mPacket					Packet read from mFile, kept to save allocating
+ */
+class TStateStreamDecoder
+{
+public:
+	TStateStreamDecoder();
+	~TStateStreamDecoder();
+	bool							OpenFile(const char* filename);
+	void							Close();
+	bool							ReadPacket();
+	bool							Decode(const uint8_t* data, uint32_t size);
+	void							Apply(TSimulation& simulation)	const;
+	bool							IsSynced()			const	{ return mSynced; }
+	uint32_t						GetTime()			const	{ return mState.mTime; }
+	const TStreamState&				GetState()			const	{ return mState; }
+private:
+	// copying disallowed
+	TStateStreamDecoder(const TStateStreamDecoder &decoder);
+	TStateStreamDecoder& operator=(const TStateStreamDecoder &decoder);
+
+	FILE*							mFile;
+	TStreamState					mState;
+	bool							mSynced;
+	std::vector<uint8_t>			mPacket;
+};
+
+#endif // STATESTREAM_H_INCLUDED
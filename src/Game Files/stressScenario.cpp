@@ -0,0 +1,261 @@
+/**
+ *	stressScenario.cpp - Jan van der Kamp, 2011
+ */
+#include "stressScenario.h"
+
+#include <pf/script.h>
+#include <pf/luatable.h>
+
+#include "timer.h"
+
+namespace {
+	// Length of each window that statistics are gathered over
+	const uint32_t	statsWindowTime = 1000;
+}
+
+/** @function TScenarioSpec::TScenarioSpec - Default Constructor		Sets up a scenario matching the start of a normal game
+ */
+TScenarioSpec::TScenarioSpec() :
+mSeed(1),
+mDuration(60000),
+mSpawnRateStart(1000.f / gameVars::initialMaxWaitForBalloon),
+mSpawnRateEnd(1000.f / gameVars::initialMaxWaitForBalloon),
+mSpawnRampTime(1),
+mVelocityMin(gameVars::initialBalloonVelocity.y),
+mVelocityMax(gameVars::initialBalloonVelocity.y),
+mVelocitySpreadX(0.f),
+mNumColours(gameVars::initialNumColoursInPlay),
+mFireRate(0.f),
+mMaxBalls(1000),
+mStatsFile("scenario.csv")
+{}
+
+/** @function TScenarioSpec::Load - Runs a scenario file and reads the scenario table it sets.
+ *		@param 		filename			Lua file to load
+ *
+ *		@return		true if the file was run and contained a scenario table
+ */
+bool TScenarioSpec::Load(const char* filename)
+{
+	TScript script;
+	if(!script.RunScript(filename))
+		return false;
+
+	lua_State* L = script.GetState();
+	LuaAutoBlock lab(L);
+	lua_getglobal(L, "scenario");
+	TLuaTable table(L);
+
+	// Settings the file leaves out keep their defaults
+	if(table.IsNumber("seed"))
+		mSeed = uint32_t(table.GetNumber("seed"));
+	if(table.IsNumber("duration"))
+		mDuration = uint32_t(table.GetNumber("duration"));
+	if(table.IsNumber("spawnRateStart"))
+		mSpawnRateStart = TReal(table.GetNumber("spawnRateStart"));
+	if(table.IsNumber("spawnRateEnd"))
+		mSpawnRateEnd = TReal(table.GetNumber("spawnRateEnd"));
+	if(table.IsNumber("spawnRampTime"))
+		mSpawnRampTime = uint32_t(table.GetNumber("spawnRampTime"));
+	if(table.IsNumber("velocityMin"))
+		mVelocityMin = TReal(table.GetNumber("velocityMin"));
+	if(table.IsNumber("velocityMax"))
+		mVelocityMax = TReal(table.GetNumber("velocityMax"));
+	if(table.IsNumber("velocitySpreadX"))
+		mVelocitySpreadX = TReal(table.GetNumber("velocitySpreadX"));
+	if(table.IsNumber("numColours"))
+		mNumColours = uint16_t(table.GetNumber("numColours"));
+	if(table.IsNumber("fireRate"))
+		mFireRate = TReal(table.GetNumber("fireRate"));
+	if(table.IsNumber("maxBalls"))
+		mMaxBalls = uint32_t(table.GetNumber("maxBalls"));
+	str statsFile = table.GetString("statsFile");
+	if(!statsFile.empty())
+		mStatsFile = statsFile;
+
+	// Keep values the game can't cope with in range
+	if(mNumColours < 2)
+		mNumColours = 2;
+	if(mSpawnRampTime == 0)
+		mSpawnRampTime = 1;
+	if(mVelocityMax < mVelocityMin)
+		mVelocityMax = mVelocityMin;
+	return true;
+}
+
+
+/** @function TStressScenario::TStressScenario - Default Constructor
+ */
+TStressScenario::TStressScenario() :
+mSpec(),
+mRandom(),
+mRunning(false),
+mTime(),
+mBalloonsDue(),
+mBulletsDue(),
+mStatsFile(NULL),
+mWindow()
+{}
+
+/** @function TStressScenario::~TStressScenario - Destructor, writes out any statistics not yet written
+ */
+TStressScenario::~TStressScenario()
+{
+	Stop();
+}
+
+/** @function TStressScenario::Start - Loads a scenario file and starts running it
+ *		@param 		filename			Lua file describing the scenario
+ *
+ *		@return		true if the scenario was loaded
+ */
+bool TStressScenario::Start(const char* filename)
+{
+	Stop();
+	if(!mSpec.Load(filename))
+		return false;
+
+	mRandom.Seed(mSpec.mSeed);
+	mTime = 0.0;
+	mBalloonsDue = 0.f;
+	mBulletsDue = 0.f;
+	mWindow = TWindowStats();
+
+	mStatsFile = fopen(mSpec.mStatsFile.c_str(), "w");
+	if(mStatsFile)
+		fprintf(mStatsFile, "time_ms,balloons,bullets,frames,frame_ms_avg,frame_ms_max,"
+							"update_ms_avg,update_ms_max,draw_ms_avg,draw_ms_max\n");
+	mRunning = true;
+	return true;
+}
+
+/** @function TStressScenario::Stop - Stops the scenario and closes the stats file
+ */
+void TStressScenario::Stop()
+{
+	if(mStatsFile) {
+		if(mWindow.mFrames)
+			WriteWindow();
+		fclose(mStatsFile);
+		mStatsFile = NULL;
+	}
+	mRunning = false;
+}
+
+/** @function TStressScenario::Update - Adds balloons and fires bullets at the rates given by the spec. Nothing is added while
+ *									   the number of balls in play is at the spec's limit.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		balloonManager		Balloon manager to add balloons to
+ *		@param 		cannon				Cannon to fire bullets from
+ */
+void TStressScenario::Update(double elapsedTime, TBalloonManager& balloonManager, TCannon& cannon)
+{
+	if(!mRunning)
+		return;
+
+	mTime += elapsedTime;
+	if(mTime >= mSpec.mDuration) {
+		Stop();
+		return;
+	}
+
+	// Spawn rate moves in a straight line from the start rate to the end rate over the ramp time
+	TReal ramp = mTime < mSpec.mSpawnRampTime ? TReal(mTime) / TReal(mSpec.mSpawnRampTime) : 1.f;
+	TReal spawnRate = mSpec.mSpawnRateStart + (mSpec.mSpawnRateEnd - mSpec.mSpawnRateStart) * ramp;
+	mBalloonsDue += spawnRate * TReal(elapsedTime) / 1000.f;
+	mBulletsDue += mSpec.mFireRate * TReal(elapsedTime) / 1000.f;
+
+	uint32_t ballsInPlay = uint32_t(balloonManager.GetBalloons().size() + cannon.GetBulletsFired().size());
+	uint16_t numColours = mSpec.mNumColours < balloonManager.GetNumTextures() ? mSpec.mNumColours : balloonManager.GetNumTextures();
+	TReal radius = TReal(balloonManager.GetBalloonRadius());
+	TReal width = TReal(balloonManager.GetBounds().x2);
+
+	for(; mBalloonsDue >= 1.f && ballsInPlay < mSpec.mMaxBalls; mBalloonsDue -= 1.f, ++ballsInPlay)
+		balloonManager.SpawnBalloon(RandomReal(radius, width - radius),
+									TVec2(RandomReal(-mSpec.mVelocitySpreadX, mSpec.mVelocitySpreadX),
+										  RandomReal(mSpec.mVelocityMin, mSpec.mVelocityMax)),
+									uint16_t(mRandom.Rand() % numColours));
+
+	for(; mBulletsDue >= 1.f && ballsInPlay < mSpec.mMaxBalls; mBulletsDue -= 1.f, ++ballsInPlay) {
+		// Aim anywhere above the cannon
+		cannon.UpdateMousePosition(TPoint(int32_t(RandomReal(0.f, width)),
+										  int32_t(RandomReal(TReal(balloonManager.GetBounds().y1), cannon.GetPosition().y - 1.f))));
+		cannon.Reload();
+		cannon.Fire();
+	}
+
+	// Don't let spawns build up while at the limit, or they would all arrive at once when balls are removed
+	if(mBalloonsDue > 1.f)
+		mBalloonsDue = 1.f;
+	if(mBulletsDue > 1.f)
+		mBulletsDue = 1.f;
+}
+
+/** @function TStressScenario::RecordUpdate - Adds a frame's update to the statistics. Should be called once per frame after
+ *											 the game has been updated.
+ *		@param 		elapsedTime			Time in milliseconds since last frame
+ *		@param 		updateTicks			Time taken to update the game, in THighResTimer ticks
+ *		@param 		numBalloons			Balloons in play
+ *		@param 		numBullets			Bullets in play
+ */
+void TStressScenario::RecordUpdate(double elapsedTime, uint64_t updateTicks, uint32_t numBalloons, uint32_t numBullets)
+{
+	if(!mRunning)
+		return;
+
+	mWindow.mFrames++;
+	mWindow.mFrameTime += elapsedTime;
+	if(elapsedTime > mWindow.mMaxFrameTime)
+		mWindow.mMaxFrameTime = elapsedTime;
+	mWindow.mUpdateTicks += updateTicks;
+	if(updateTicks > mWindow.mMaxUpdateTicks)
+		mWindow.mMaxUpdateTicks = updateTicks;
+	mWindow.mBalloons = numBalloons;
+	mWindow.mBullets = numBullets;
+
+	if(mWindow.mFrameTime >= statsWindowTime)
+		WriteWindow();
+}
+
+/** @function TStressScenario::RecordDraw - Adds a frame's draw to the statistics.
+ *		@param 		drawTicks			Time taken to draw the game, in THighResTimer ticks
+ */
+void TStressScenario::RecordDraw(uint64_t drawTicks)
+{
+	if(!mRunning)
+		return;
+
+	mWindow.mDrawTicks += drawTicks;
+	if(drawTicks > mWindow.mMaxDrawTicks)
+		mWindow.mMaxDrawTicks = drawTicks;
+}
+
+/** @function TStressScenario::RandomReal - Picks a random number in a range
+ *		@param 		min					Smallest number to pick
+ *		@param 		max					Largest number to pick
+ *
+ *		@return		Random number between min and max
+ */
+TReal TStressScenario::RandomReal(TReal min, TReal max)
+{
+	return min + (max - min) * TReal(mRandom.Rand() % 10001) / 10000.f;
+}
+
+/** @function TStressScenario::WriteWindow - Writes the statistics for the current window to the stats file and starts
+ *											a new window
+ */
+void TStressScenario::WriteWindow()
+{
+	if(mStatsFile && mWindow.mFrames) {
+		double frames = double(mWindow.mFrames);
+		fprintf(mStatsFile, "%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+				uint32_t(mTime), mWindow.mBalloons, mWindow.mBullets, mWindow.mFrames,
+				mWindow.mFrameTime / frames, mWindow.mMaxFrameTime,
+				THighResTimer::TicksToMilliseconds(mWindow.mUpdateTicks) / frames,
+				THighResTimer::TicksToMilliseconds(mWindow.mMaxUpdateTicks),
+				THighResTimer::TicksToMilliseconds(mWindow.mDrawTicks) / frames,
+				THighResTimer::TicksToMilliseconds(mWindow.mMaxDrawTicks));
+		fflush(mStatsFile);
+	}
+	mWindow = TWindowStats();
+}
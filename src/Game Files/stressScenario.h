@@ -0,0 +1,122 @@
+/**
+ *	stressScenario.h - Jan van der Kamp, 2011
+ */
+#ifndef STRESSSCENARIO_H_INCLUDED
+#define STRESSSCENARIO_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <pf/vec.h>
+#include <cstdio>
+
+#include "gameVariables.h"
+#include "gameRandom.h"
+#include "balloonManager.h"
+#include "cannon.h"
+
+/** @struct TScenarioSpec - Describes the load a stress scenario puts on the game. It is loaded from a Lua file which sets
+ *							a global table called scenario, see assets/scenarios/stress.lua.
+ *
+ *	@property 	uint32_t		mSeed					Seed for the scenario's random numbers
+ *	@property 	uint32_t		mDuration				Time in milliseconds the scenario runs for
+ *	@property 	TReal			mSpawnRateStart			Balloons added per second at the start
+ *	@property 	TReal			mSpawnRateEnd			Balloons added per second once mSpawnRampTime has passed
+ *	@property 	uint32_t		mSpawnRampTime			Time in milliseconds taken to go from mSpawnRateStart to mSpawnRateEnd
+ *	@property 	TReal			mVelocityMin			Slowest falling speed of a new balloon
+ *	@property 	TReal			mVelocityMax			Fastest falling speed of a new balloon
+ *	@property 	TReal			mVelocitySpreadX		Largest sideways speed of a new balloon, in either direction
+ *	@property 	uint16_t		mNumColours				Number of colours balloons and bullets can be
+ *	@property 	TReal			mFireRate				Bullets fired per second
+ *	@property 	uint32_t		mMaxBalls				Balloons and bullets in play are never allowed to go above this
+ *	@property 	str				mStatsFile				File that frame time statistics are written to
+ */
+struct TScenarioSpec
+{
+	TScenarioSpec();
+	bool		Load(const char* filename);
+
+	uint32_t	mSeed;
+	uint32_t	mDuration;
+	TReal		mSpawnRateStart;
+	TReal		mSpawnRateEnd;
+	uint32_t	mSpawnRampTime;
+	TReal		mVelocityMin;
+	TReal		mVelocityMax;
+	TReal		mVelocitySpreadX;
+	uint16_t	mNumColours;
+	TReal		mFireRate;
+	uint32_t	mMaxBalls;
+	str			mStatsFile;
+};
+
+/** @class TStressScenario - Drives TBalloonManager and TCannon far harder than a normal game does, following a TScenarioSpec,
+ *							 so that it can be seen how the game copes with very large numbers of balls. Balloons are added
+ *							 at a rate that ramps between two values, with random speeds, and the cannon fires at a fixed
+ *							 rate in random directions. While it runs, frame, update and draw times are gathered into one
+ *							 second windows and written to the spec's stats file, along with the number of balls in play.
+ *							 Set the "scenario" config setting to a scenario file to start the game in a stress scenario.
+ *
+ *	@property 	TScenarioSpec		mSpec					The scenario being run
+ *	@property 	TRandom				mRandom					Random number generator for new balloons and aiming
+ *	@property 	bool				mRunning				Whether a scenario is running
+ *	@property 	double				mTime					Time in milliseconds since the scenario started
+ *	@property 	TReal				mBalloonsDue			Balloons which should have been added but haven't been yet
+ *	@property 	TReal				mBulletsDue				Bullets which should have been fired but haven't been yet
+ *	@property 	FILE*				mStatsFile				File statistics are being written to
+ *	@property 	TWindowStats		mWindow					Statistics for the current one second window
+ */
+class TStressScenario
+{
+public:
+	TStressScenario();
+	~TStressScenario();
+	bool		Start(const char* filename);
+	void		Stop();
+	bool		IsRunning()		const	{ return mRunning; }
+	uint16_t	GetNumColours()	const	{ return mSpec.mNumColours; }
+	void		Update(double elapsedTime, TBalloonManager& balloonManager, TCannon& cannon);
+	void		RecordUpdate(double elapsedTime, uint64_t updateTicks, uint32_t numBalloons, uint32_t numBullets);
+	void		RecordDraw(uint64_t drawTicks);
+private:
+	/** @struct TWindowStats - Frame time statistics for one window of time
+	 *	@property 	uint32_t	mFrames					Number of frames in the window
+	 *	@property 	double		mFrameTime				Total time between frames, in milliseconds
+	 *	@property 	double		mMaxFrameTime			Longest time between frames, in milliseconds
+	 *	@property 	uint64_t	mUpdateTicks			Total time spent updating
+	 *	@property 	uint64_t	mMaxUpdateTicks			Longest time spent updating
+	 *	@property 	uint64_t	mDrawTicks				Total time spent drawing
+	 *	@property 	uint64_t	mMaxDrawTicks			Longest time spent drawing
+	 *	@property 	uint32_t	mBalloons				Balloons in play at the end of the window
+	 *	@property 	uint32_t	mBullets				Bullets in play at the end of the window
+	 */
+	struct TWindowStats
+	{
+		TWindowStats() : mFrames(), mFrameTime(), mMaxFrameTime(), mUpdateTicks(), mMaxUpdateTicks(),
+						 mDrawTicks(), mMaxDrawTicks(), mBalloons(), mBullets() {}
+		uint32_t	mFrames;
+		double		mFrameTime;
+		double		mMaxFrameTime;
+		uint64_t	mUpdateTicks;
+		uint64_t	mMaxUpdateTicks;
+		uint64_t	mDrawTicks;
+		uint64_t	mMaxDrawTicks;
+		uint32_t	mBalloons;
+		uint32_t	mBullets;
+	};
+
+	// copying disallowed
+	TStressScenario(const TStressScenario &scenario);
+	TStressScenario& operator=(const TStressScenario &scenario);
+	TReal		RandomReal(TReal min, TReal max);
+	void		WriteWindow();
+
+	TScenarioSpec		mSpec;
+	TRandom				mRandom;
+	bool				mRunning;
+	double				mTime;
+	TReal				mBalloonsDue;
+	TReal				mBulletsDue;
+	FILE*				mStatsFile;
+	TWindowStats		mWindow;
+};
+
+#endif // STRESSSCENARIO_H_INCLUDED
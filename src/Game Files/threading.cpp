@@ -0,0 +1,237 @@
+/**
+ *	threading.cpp - Jan van der Kamp, 2011
+ */
+#include "threading.h"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <unistd.h>
+	#include <sched.h>
+#endif
+
+/** @function TThread::TThread - Default Constructor
+ */
+TThread::TThread() :
+mFunction(NULL),
+mData(NULL),
+mStarted(false),
+mHandle()
+{}
+
+/** @function TThread::~TThread - Destructor, waits for the thread to finish if it is still running
+ */
+TThread::~TThread()
+{
+	Join();
+}
+
+/** @function TThread::Start - Starts a new thread running function(data)
+ *		@param 		function			Function for the thread to run
+ *		@param 		data				Passed to function
+ *
+ *		@return		true if the thread was started
+ */
+bool TThread::Start(TThreadFunction function, void* data)
+{
+	if(mStarted)
+		return false;
+
+	mFunction = function;
+	mData = data;
+#if defined(_WIN32)
+	mHandle = CreateThread(NULL, 0, Run, this, 0, NULL);
+	mStarted = (mHandle != NULL);
+#else
+	mStarted = (pthread_create(&mHandle, NULL, Run, this) == 0);
+#endif
+	return mStarted;
+}
+
+/** @function TThread::Join - Waits for the thread to finish
+ */
+void TThread::Join()
+{
+	if(!mStarted)
+		return;
+
+#if defined(_WIN32)
+	WaitForSingleObject(mHandle, INFINITE);
+	CloseHandle(mHandle);
+	mHandle = NULL;
+#else
+	pthread_join(mHandle, NULL);
+#endif
+	mStarted = false;
+}
+
+/** @function TThread::GetNumCores - Gets the number of processors the system has
+ *
+ *		@return		Number of processors, at least 1
+ */
+uint32_t TThread::GetNumCores()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? uint32_t(info.dwNumberOfProcessors) : 1;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? uint32_t(cores) : 1;
+#endif
+}
+
+/** @function TThread::YieldTimeSlice - Lets another thread that is ready to run have the processor, if there is one
+ */
+void TThread::YieldTimeSlice()
+{
+#if defined(_WIN32)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+/** @function TThread::Run - Entry point of the new thread, calls the function it was started with
+ *		@param 		thread				The TThread that was started
+ */
+#if defined(_WIN32)
+unsigned long __stdcall TThread::Run(void* thread)
+#else
+void* TThread::Run(void* thread)
+#endif
+{
+	TThread* self = static_cast<TThread*>(thread);
+	self->mFunction(self->mData);
+	return 0;
+}
+
+/** @function TAtomicCounter::Increment - Adds one to the counter
+ *
+ *		@return		Value of the counter after this increment
+ */
+long TAtomicCounter::Increment()
+{
+#if defined(_WIN32)
+	return InterlockedIncrement(&mValue);
+#else
+	return __sync_add_and_fetch(&mValue, 1);
+#endif
+}
+
+/** @function TAtomicCounter::Decrement - Takes one from the counter
+ *
+ *		@return		Value of the counter after this decrement
+ */
+long TAtomicCounter::Decrement()
+{
+#if defined(_WIN32)
+	return InterlockedDecrement(&mValue);
+#else
+	return __sync_sub_and_fetch(&mValue, 1);
+#endif
+}
+
+/** @function TAtomicCounter::GetValue - Reads the counter
+ *
+ *		@return		Current value of the counter
+ */
+long TAtomicCounter::GetValue() const
+{
+#if defined(_WIN32)
+	// Visual C++ reads volatiles with acquire semantics
+	return mValue;
+#else
+	long value = mValue;
+	__sync_synchronize();
+	return value;
+#endif
+}
+
+/** @function TAtomicValue::Exchange - Replaces the value
+ *		@param 		value				New value
+ *
+ *		@return		Value before it was replaced
+ */
+long TAtomicValue::Exchange(long value)
+{
+#if defined(_WIN32)
+	return InterlockedExchange(&mValue, value);
+#else
+	// __sync_lock_test_and_set is only an acquire barrier, the release half comes from the barrier before it
+	__sync_synchronize();
+	return __sync_lock_test_and_set(&mValue, value);
+#endif
+}
+
+/** @function TAtomicValue::GetValue - Reads the value
+ *
+ *		@return		Current value
+ */
+long TAtomicValue::GetValue() const
+{
+#if defined(_WIN32)
+	// Visual C++ reads volatiles with acquire semantics
+	return mValue;
+#else
+	long value = mValue;
+	__sync_synchronize();
+	return value;
+#endif
+}
+
+/** @function TEvent::TEvent - Default Constructor, the event starts unsignalled
+ */
+TEvent::TEvent()
+{
+#if defined(_WIN32)
+	mHandle = CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+	pthread_mutex_init(&mMutex, NULL);
+	pthread_cond_init(&mCondition, NULL);
+	mSignalled = false;
+#endif
+}
+
+/** @function TEvent::~TEvent - Destructor
+ */
+TEvent::~TEvent()
+{
+#if defined(_WIN32)
+	CloseHandle(mHandle);
+#else
+	pthread_cond_destroy(&mCondition);
+	pthread_mutex_destroy(&mMutex);
+#endif
+}
+
+/** @function TEvent::Signal - Wakes a thread waiting on the event, or the next one to wait if none is
+ */
+void TEvent::Signal()
+{
+#if defined(_WIN32)
+	SetEvent(mHandle);
+#else
+	pthread_mutex_lock(&mMutex);
+	mSignalled = true;
+	pthread_cond_signal(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+/** @function TEvent::Wait - Sleeps until the event is signalled
+ */
+void TEvent::Wait()
+{
+#if defined(_WIN32)
+	WaitForSingleObject(mHandle, INFINITE);
+#else
+	pthread_mutex_lock(&mMutex);
+	while(!mSignalled)
+		pthread_cond_wait(&mCondition, &mMutex);
+	mSignalled = false;
+	pthread_mutex_unlock(&mMutex);
+#endif
+}
@@ -0,0 +1,144 @@
+/**
+ *	threading.h - Jan van der Kamp, 2011
+ */
+#ifndef THREADING_H_INCLUDED
+#define THREADING_H_INCLUDED
+
+#include <pf/pflib.h>
+
+#if !defined(_WIN32)
+	#include <pthread.h>
+#endif
+
+// Declares a variable each thread has its own copy of. Only plain data can be thread-local, and it starts as zero.
+#if defined(_WIN32)
+	#define THREAD_LOCAL	__declspec(thread)
+#else
+	#define THREAD_LOCAL	__thread
+#endif
+
+/** @class TThread - A thread running a plain function. The Playground SDK has no threads of its own, so this wraps
+ *					 CreateThread on Windows and pthreads elsewhere. Nothing the SDK owns is safe to use from a TThread;
+ *					 the function should only touch data set up for it before Start() was called.
+ *	@property 	TThreadFunction		mFunction				Function the thread runs
+ *	@property 	void*				mData					Passed to mFunction
+ *	@property 	bool				mStarted				Whether the thread has been started and not yet joined
+ *	@property 	void*				mHandle					Platform handle of the thread, a pthread_t other than on Windows
+ */
+class TThread
+{
+public:
+	typedef void (*TThreadFunction)(void* data);
+
+	TThread();
+	~TThread();
+	bool				Start(TThreadFunction function, void* data);
+	void				Join();
+	static uint32_t		GetNumCores();
+	static void			YieldTimeSlice();
+private:
+	// copying disallowed
+	TThread(const TThread &thread);
+	TThread& operator=(const TThread &thread);
+#if defined(_WIN32)
+	static unsigned long __stdcall Run(void* thread);
+#else
+	static void*		Run(void* thread);
+#endif
+
+	TThreadFunction		mFunction;
+	void*				mData;
+	bool				mStarted;
+#if defined(_WIN32)
+	void*				mHandle;
+#else
+	pthread_t			mHandle;
+#endif
+};
+
+/** @class TAtomicCounter - A counter that any number of threads can increment at once, each getting a different value back.
+ *							Whatever a thread wrote before an Increment is seen by a thread that reads the new value.
+ *	@property 	volatile long		mValue					Current value of the counter
+ */
+class TAtomicCounter
+{
+public:
+	explicit TAtomicCounter(long value = 0) : mValue(value) {}
+	long				Increment();
+	long				Decrement();
+	long				GetValue()	const;
+	void				SetValue(long value)	{ mValue = value; }
+private:
+	// copying disallowed
+	TAtomicCounter(const TAtomicCounter &counter);
+	TAtomicCounter& operator=(const TAtomicCounter &counter);
+
+	volatile long		mValue;
+};
+
+/** @class TAtomicValue - A value that one thread can swap for another while other threads read it, without a lock. Every
+ *						  Exchange is a full memory barrier, so whatever a thread wrote before swapping a value in is seen
+ *						  by the thread that swaps it out.
+ *	@property 	volatile long		mValue					Current value
+ */
+class TAtomicValue
+{
+public:
+	explicit TAtomicValue(long value = 0) : mValue(value) {}
+	long				Exchange(long value);
+	long				GetValue()	const;
+private:
+	// copying disallowed
+	TAtomicValue(const TAtomicValue &value);
+	TAtomicValue& operator=(const TAtomicValue &value);
+
+	volatile long		mValue;
+};
+
+/** @class TSpinLock - A lock for data that is only ever held for a few instructions, which spins rather than sleeping
+ *					   while another thread has it
+ *	@property 	TAtomicValue		mLocked					1 while a thread holds the lock
+ */
+class TSpinLock
+{
+public:
+	TSpinLock() : mLocked(0) {}
+	void				Lock()			{ while(mLocked.Exchange(1)) TThread::YieldTimeSlice(); }
+	void				Unlock()		{ mLocked.Exchange(0); }
+private:
+	// copying disallowed
+	TSpinLock(const TSpinLock &lock);
+	TSpinLock& operator=(const TSpinLock &lock);
+
+	TAtomicValue		mLocked;
+};
+
+/** @class TEvent - Lets a thread sleep until another wakes it. A Signal() made while nothing is waiting isn't lost, the next
+ *					Wait() returns straight away, but any number of signals only wake one Wait().
+ *	@property 	void*				mHandle					Auto-reset event on Windows
+ *	@property 	pthread_mutex_t		mMutex					Guards mSignalled other than on Windows
+ *	@property 	pthread_cond_t		mCondition				Waited on for mSignalled other than on Windows
+ *	@property 	bool				mSignalled				Whether Signal() has been called since the last Wait() returned
+ */
+class TEvent
+{
+public:
+	TEvent();
+	~TEvent();
+	void				Signal();
+	void				Wait();
+private:
+	// copying disallowed
+	TEvent(const TEvent &event);
+	TEvent& operator=(const TEvent &event);
+
+#if defined(_WIN32)
+	void*				mHandle;
+#else
+	pthread_mutex_t		mMutex;
+	pthread_cond_t		mCondition;
+	bool				mSignalled;
+#endif
+};
+
+#endif // THREADING_H_INCLUDED
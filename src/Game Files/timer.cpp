@@ -0,0 +1,65 @@
+/**
+ *	timer.cpp - Jan van der Kamp, 2011
+ */
+#include "timer.h"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#elif defined(__APPLE__)
+	#include <mach/mach_time.h>
+#else
+	#include <time.h>
+#endif
+
+namespace {
+	// Length of a tick, read from the platform once
+	double ReadNanosecondsPerTick()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return 1000000000.0 / double(frequency.QuadPart);
+#elif defined(__APPLE__)
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info(&timebase);
+		return double(timebase.numer) / double(timebase.denom);
+#else
+		return 1.0;
+#endif
+	}
+
+	// Set while the program is loaded, before main() can start a thread, so the job workers, the simulation thread and
+	// the trace only ever read it
+	const double	nanosecondsPerTick = ReadNanosecondsPerTick();
+}
+
+/** @function THighResTimer::GetTicks - Reads the platform's high resolution counter
+ *
+ *		@return		Current value of the counter, in platform specific units
+ */
+uint64_t THighResTimer::GetTicks()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return uint64_t(counter.QuadPart);
+#elif defined(__APPLE__)
+	return mach_absolute_time();
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return uint64_t(now.tv_sec) * 1000000000 + uint64_t(now.tv_nsec);
+#endif
+}
+
+/** @function THighResTimer::TicksToNanoseconds - Converts a difference between two GetTicks() values to nanoseconds
+ *		@param 		ticks				Number of ticks
+ *
+ *		@return		ticks in nanoseconds
+ */
+double THighResTimer::TicksToNanoseconds(uint64_t ticks)
+{
+	return double(ticks) * nanosecondsPerTick;
+}
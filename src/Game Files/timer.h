@@ -0,0 +1,22 @@
+/**
+ *	timer.h - Jan van der Kamp, 2011
+ */
+#ifndef TIMER_H_INCLUDED
+#define TIMER_H_INCLUDED
+
+#include <pf/pflib.h>
+
+/** @class THighResTimer - TPlatform::GetTime() only has millisecond resolution, which is far too coarse for timing
+ *						   individual pieces of the game. This wraps the platform's high resolution counter.
+ *						   GetTicks() is cheap enough to call around small sections of code, the ticks are 
+ *						   converted to nanoseconds afterwards.
+ */
+class THighResTimer
+{
+public:
+	static uint64_t		GetTicks();
+	static double		TicksToNanoseconds(uint64_t ticks);
+	static double		TicksToMilliseconds(uint64_t ticks)		{ return TicksToNanoseconds(ticks) / 1000000.0; }
+};
+
+#endif // TIMER_H_INCLUDED
@@ -0,0 +1,237 @@
+/**
+ *	trace.cpp - Jan van der Kamp, 2011
+ */
+#include "trace.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+#include "gameVariables.h"
+#include "threading.h"
+#include "timer.h"
+
+using std::vector;
+
+namespace {
+	enum { BEGIN = 0, END, COUNTER };
+	const char			eventPhases[] = { 'B', 'E', 'C' };
+
+	/** @struct TTraceEvent - One span beginning or ending, or one counter value
+	 *	@property 	const char*		mName				Name of the span or counter, nothing for the end of a span
+	 *	@property 	uint64_t		mTicks				Time of the event in THighResTimer ticks
+	 *	@property 	int32_t			mValue				Value of a counter
+	 *	@property 	uint8_t			mType				BEGIN, END or COUNTER
+	 */
+	struct TTraceEvent
+	{
+		const char*		mName;
+		uint64_t		mTicks;
+		int32_t			mValue;
+		uint8_t			mType;
+	};
+
+	/** @struct TTraceBuffer - The events one thread has recorded, only ever written by that thread
+	 *	@property 	std::vector<TTraceEvent>	mEvents			Room for gameVars::traceEventsPerThread events
+	 *	@property 	uint32_t					mCount			Number of events recorded
+	 *	@property 	uint32_t					mDropped		Number of events dropped once mEvents was full
+	 *	@property 	uint32_t					mThreadId		Id of the thread in the trace, the first to record being 1
+	 *	@property 	char						mThreadName[32]	Name of the thread in the trace
+	 */
+	struct TTraceBuffer
+	{
+		std::vector<TTraceEvent>	mEvents;
+		uint32_t					mCount;
+		uint32_t					mDropped;
+		uint32_t					mThreadId;
+		char						mThreadName[32];
+	};
+
+	volatile bool					traceOpen = false;
+	FILE*							traceFile = NULL;
+	uint64_t						traceStartTicks = 0;
+	int32_t							drawCalls = 0;
+	bool							countingDrawCalls = false;
+	// Buffers are kept once made, since each thread holds on to its own through threadBuffer
+	TSpinLock						buffersLock;
+	vector<TTraceBuffer*>			buffers;
+	THREAD_LOCAL TTraceBuffer*		threadBuffer;
+
+	TTraceBuffer& GetThreadBuffer()
+	{
+		if(!threadBuffer) {
+			TTraceBuffer* buffer = new TTraceBuffer;
+			buffer->mEvents.resize(gameVars::traceEventsPerThread);
+			buffer->mCount = 0;
+			buffer->mDropped = 0;
+			buffersLock.Lock();
+			buffers.push_back(buffer);
+			buffer->mThreadId = uint32_t(buffers.size());
+			buffersLock.Unlock();
+			sprintf(buffer->mThreadName, "thread %u", buffer->mThreadId);
+			threadBuffer = buffer;
+		}
+		return *threadBuffer;
+	}
+
+	void Record(uint8_t type, const char* name, int32_t value)
+	{
+		TTraceBuffer& buffer = GetThreadBuffer();
+		if(buffer.mCount == buffer.mEvents.size()) {
+			buffer.mDropped++;
+			return;
+		}
+		TTraceEvent& event = buffer.mEvents[buffer.mCount++];
+		event.mName = name;
+		event.mTicks = THighResTimer::GetTicks();
+		event.mValue = value;
+		event.mType = type;
+	}
+}
+
+/** @function TTrace::Open - Starts recording events, clearing any recorded before
+ *		@param 		filename			File the trace is written to when it is closed
+ *
+ *		@return		false if a trace is already open or the file couldn't be opened
+ */
+bool TTrace::Open(const char* filename)
+{
+	if(traceOpen)
+		return false;
+	traceFile = fopen(filename, "w");
+	if(!traceFile)
+		return false;
+
+	buffersLock.Lock();
+	for(vector<TTraceBuffer*>::iterator buffer = buffers.begin(); buffer != buffers.end(); ++buffer) {
+		(*buffer)->mCount = 0;
+		(*buffer)->mDropped = 0;
+	}
+	buffersLock.Unlock();
+	traceStartTicks = THighResTimer::GetTicks();
+	traceOpen = true;
+	return true;
+}
+
+/** @function TTrace::Close - Stops recording and writes every thread's events out, named threads first getting a
+ *							 thread_name record. Times are written in microseconds since the trace was opened.
+ *
+ *		@return		false if no trace was open
+ */
+bool TTrace::Close()
+{
+	if(!traceOpen)
+		return false;
+	traceOpen = false;
+
+	uint32_t dropped = 0;
+	buffersLock.Lock();
+	for(vector<TTraceBuffer*>::const_iterator buffer = buffers.begin(); buffer != buffers.end(); ++buffer)
+		dropped += (*buffer)->mDropped;
+
+	fprintf(traceFile, "{\n\t\"displayTimeUnit\": \"ms\",\n\t\"otherData\": { \"build\": \"%s %s\", \"droppedEvents\": %u },\n"
+					   "\t\"traceEvents\": [\n", __DATE__, __TIME__, dropped);
+	bool first = true;
+	for(vector<TTraceBuffer*>::const_iterator buffer = buffers.begin(); buffer != buffers.end(); ++buffer)
+	{
+		const TTraceBuffer& b = **buffer;
+		fprintf(traceFile, "%s\t\t{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": { \"name\": \"%s\" } }",
+				first ? "" : ",\n", b.mThreadId, b.mThreadName);
+		first = false;
+		for(uint32_t e = 0; e != b.mCount; ++e)
+		{
+			const TTraceEvent& event = b.mEvents[e];
+			double microseconds = THighResTimer::TicksToNanoseconds(event.mTicks - traceStartTicks) / 1000.0;
+			fprintf(traceFile, ",\n\t\t{ \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u", eventPhases[event.mType],
+					microseconds, b.mThreadId);
+			if(event.mType == BEGIN)
+				fprintf(traceFile, ", \"name\": \"%s\" }", event.mName);
+			else if(event.mType == COUNTER)
+				fprintf(traceFile, ", \"name\": \"%s\", \"args\": { \"value\": %d } }", event.mName, event.mValue);
+			else fprintf(traceFile, " }");
+		}
+	}
+	buffersLock.Unlock();
+
+	fprintf(traceFile, "\n\t]\n}\n");
+	fclose(traceFile);
+	traceFile = NULL;
+	return true;
+}
+
+/** @function TTrace::IsOpen - Checks whether events are being recorded
+ *
+ *		@return		true if a trace is open
+ */
+bool TTrace::IsOpen()
+{
+	return traceOpen;
+}
+
+/** @function TTrace::SetThreadName - Names the calling thread in the trace, making its buffer now rather than when it first
+ *									 records. Does nothing unless a trace is open.
+ *		@param 		name				Name of the thread, cut to 31 characters
+ */
+void TTrace::SetThreadName(const char* name)
+{
+	if(!traceOpen)
+		return;
+	TTraceBuffer& buffer = GetThreadBuffer();
+	strncpy(buffer.mThreadName, name, sizeof(buffer.mThreadName) - 1);
+	buffer.mThreadName[sizeof(buffer.mThreadName) - 1] = '\0';
+}
+
+/** @function TTrace::Begin - Begins a span on the calling thread, which lasts until the next End() on the same thread
+ *		@param 		name				Name of the span, which has to last as long as the trace
+ */
+void TTrace::Begin(const char* name)
+{
+	if(traceOpen)
+		Record(BEGIN, name, 0);
+}
+
+/** @function TTrace::End - Ends the span last begun on the calling thread
+ */
+void TTrace::End()
+{
+	if(traceOpen)
+		Record(END, NULL, 0);
+}
+
+/** @function TTrace::Counter - Records the value of a counter, shown as a track of its own
+ *		@param 		name				Name of the counter, which has to last as long as the trace
+ *		@param 		value				Value of the counter from now on
+ */
+void TTrace::Counter(const char* name, int32_t value)
+{
+	if(traceOpen)
+		Record(COUNTER, name, value);
+}
+
+/** @function TTrace::SetCountingDrawCalls - Sets whether draw calls are counted while no trace is open
+ *		@param 		counting			true to count them
+ */
+void TTrace::SetCountingDrawCalls(bool counting)
+{
+	countingDrawCalls = counting;
+}
+
+/** @function TTrace::CountDrawCall - Counts a sprite or shape drawn, if a trace is open or counting has been turned on.
+ *									 Only the thread drawing the game may count them.
+ */
+void TTrace::CountDrawCall()
+{
+	if(traceOpen || countingDrawCalls)
+		drawCalls++;
+}
+
+/** @function TTrace::TakeDrawCalls - Takes the number of draw calls counted since it was last taken
+ *
+ *		@return		Number of draw calls
+ */
+int32_t TTrace::TakeDrawCalls()
+{
+	int32_t calls = drawCalls;
+	drawCalls = 0;
+	return calls;
+}
@@ -0,0 +1,71 @@
+/**
+ *	transport.cpp - Jan van der Kamp, 2011
+ */
+#include "transport.h"
+
+using std::vector;
+
+/** @function TLoopbackLink::TLoopbackLink - Constructor			Takes parameters to construct link with
+ *		@param 		latency				Time in milliseconds every packet is held back for
+ *		@param 		jitter				Largest extra time in milliseconds a packet is held back for
+ *		@param 		lossPercent			Percentage of packets dropped
+ *		@param 		seed				Seed for the jitter and loss
+ */
+TLoopbackLink::TLoopbackLink(uint32_t latency, uint32_t jitter, uint32_t lossPercent, uint32_t seed) :
+mLatency(latency),
+mJitter(jitter),
+mLossPercent(lossPercent),
+mRandom(seed),
+mTime(),
+mNextOrder(),
+mPacketsSent(),
+mPacketsLost()
+{
+	for(uint32_t player = 0; player != 2; ++player) {
+		mEnds[player].mLink = this;
+		mEnds[player].mPlayer = player;
+	}
+}
+
+/** @function TLoopbackLink::Send - Puts a packet on its way to a player, unless it is chosen to be lost
+ *		@param 		toPlayer			Player the packet is for
+ *		@param 		data				Contents of the packet
+ *		@param 		size				Size of the packet in bytes
+ */
+void TLoopbackLink::Send(uint32_t toPlayer, const uint8_t* data, uint32_t size)
+{
+	mPacketsSent++;
+	if(mRandom.Rand() % 100 < mLossPercent) {
+		mPacketsLost++;
+		return;
+	}
+
+	vector<TPacket>& inFlight = mInFlight[toPlayer];
+	inFlight.push_back(TPacket());
+	TPacket& packet = inFlight.back();
+	packet.mArrivalTime = mTime + mLatency + (mJitter ? mRandom.Rand() % (mJitter + 1) : 0);
+	packet.mOrder = mNextOrder++;
+	packet.mData.assign(data, data + size);
+}
+
+/** @function TLoopbackLink::Receive - Takes the packet for a player that arrived first, if any have arrived by now
+ *		@param 		player				Player receiving
+ *		@param 		packet				Set to the contents of the packet
+ *
+ *		@return		true if a packet was received
+ */
+bool TLoopbackLink::Receive(uint32_t player, std::vector<uint8_t>& packet)
+{
+	vector<TPacket>& inFlight = mInFlight[player];
+	vector<TPacket>::iterator first = inFlight.end();
+	for(vector<TPacket>::iterator it = inFlight.begin(); it != inFlight.end(); ++it)
+		if(it->mArrivalTime <= mTime && (first == inFlight.end() || it->mArrivalTime < first->mArrivalTime ||
+		   (it->mArrivalTime == first->mArrivalTime && it->mOrder < first->mOrder)))
+			first = it;
+	if(first == inFlight.end())
+		return false;
+
+	packet.swap(first->mData);
+	inFlight.erase(first);
+	return true;
+}
@@ -0,0 +1,90 @@
+/**
+ *	transport.h - Jan van der Kamp, 2011
+ */
+#ifndef TRANSPORT_H_INCLUDED
+#define TRANSPORT_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+
+#include "gameRandom.h"
+
+/** @class ITransport - This abstract base class is inherited from by anything that carries packets between two players.
+ *						Packets may arrive late, out of order or not at all, as they would over UDP.
+ */
+class ITransport {
+public:
+	virtual void Send(const uint8_t* data, uint32_t size) = 0;
+	virtual bool Receive(std::vector<uint8_t>& packet) = 0;
+	virtual ~ITransport() {}
+};
+
+/** @class TLoopbackLink - An in-process connection between two players, so that networked play can be tried out without a
+ *						   network. Each packet sent is held back for the latency plus a random amount of jitter, which can
+ *						   make packets overtake each other, and a share of packets are dropped altogether. Time is whatever
+ *						   the owner says it is with SetTime(), so that a link behaves the same on every run.
+ *	@property 	TEnd					mEnds[2]				The transport used by each player
+ *	@property 	std::vector<TPacket>	mInFlight[2]			Packets on their way to each player
+ *	@property 	uint32_t				mLatency				Time in milliseconds every packet is held back for
+ *	@property 	uint32_t				mJitter					Largest extra time in milliseconds a packet is held back for
+ *	@property 	uint32_t				mLossPercent			Percentage of packets dropped
+ *	@property 	TRandom					mRandom					Random number generator for jitter and loss
+ *	@property 	uint32_t				mTime					Current time in milliseconds
+ *	@property 	uint32_t				mNextOrder				Number given to the next packet sent, to break ties in arrival time
+ *	@property 	uint32_t				mPacketsSent			Number of packets sent in both directions
+ *	@property 	uint32_t				mPacketsLost			Number of packets dropped in both directions
+ */
+class TLoopbackLink
+{
+public:
+	TLoopbackLink(uint32_t latency, uint32_t jitter, uint32_t lossPercent, uint32_t seed);
+	ITransport&		GetEnd(uint32_t player)		{ return mEnds[player & 1]; }
+	void			SetTime(uint32_t time)		{ mTime = time; }
+	uint32_t		GetPacketsSent()	const	{ return mPacketsSent; }
+	uint32_t		GetPacketsLost()	const	{ return mPacketsLost; }
+private:
+	/** @class TEnd - One player's end of the link
+	 *	@property 	TLoopbackLink*	mLink				Link the end belongs to
+	 *	@property 	uint32_t		mPlayer				Player using this end
+	 */
+	class TEnd : public ITransport {
+	public:
+		TEnd() : mLink(NULL), mPlayer() {}
+		virtual void Send(const uint8_t* data, uint32_t size)	{ mLink->Send(1 - mPlayer, data, size); }
+		virtual bool Receive(std::vector<uint8_t>& packet)		{ return mLink->Receive(mPlayer, packet); }
+
+		TLoopbackLink*	mLink;
+		uint32_t		mPlayer;
+	};
+
+	/** @struct TPacket - A packet on its way to a player
+	 *	@property 	uint32_t				mArrivalTime		Time the packet can be received at
+	 *	@property 	uint32_t				mOrder				Number of the packet in the order sent
+	 *	@property 	std::vector<uint8_t>	mData				Contents of the packet
+	 */
+	struct TPacket
+	{
+		uint32_t				mArrivalTime;
+		uint32_t				mOrder;
+		std::vector<uint8_t>	mData;
+	};
+
+	// copying disallowed
+	TLoopbackLink(const TLoopbackLink &link);
+	TLoopbackLink& operator=(const TLoopbackLink &link);
+	void			Send(uint32_t toPlayer, const uint8_t* data, uint32_t size);
+	bool			Receive(uint32_t player, std::vector<uint8_t>& packet);
+
+	TEnd					mEnds[2];
+	std::vector<TPacket>	mInFlight[2];
+	uint32_t				mLatency;
+	uint32_t				mJitter;
+	uint32_t				mLossPercent;
+	TRandom					mRandom;
+	uint32_t				mTime;
+	uint32_t				mNextOrder;
+	uint32_t				mPacketsSent;
+	uint32_t				mPacketsLost;
+};
+
+#endif // TRANSPORT_H_INCLUDED
@@ -0,0 +1,58 @@
+/**
+ *	tripleBuffer.h - Jan van der Kamp, 2011
+ */
+#ifndef TRIPLEBUFFER_H_INCLUDED
+#define TRIPLEBUFFER_H_INCLUDED
+
+#include <pf/pflib.h>
+
+#include "threading.h"
+
+/** @class TTripleBuffer - Hands the latest of a stream of values from one thread to another without either ever waiting.
+ *						   There are three slots: the writer fills one, the reader reads from another, and the third is
+ *						   passed between them. Publish() swaps the filled slot for the one being passed, marked as fresh,
+ *						   and Consume() swaps the slot it has read for the fresh one, if there is one. Values published
+ *						   faster than they are consumed are overwritten, so the reader always gets the newest. Each slot's
+ *						   storage is kept, so values which hold vectors stop allocating once every slot has grown to fit.
+ *	@property 	T					mSlots[3]				The slots
+ *	@property 	uint32_t			mWrite					Slot the writer is filling, only touched by the writer
+ *	@property 	TAtomicValue		mShared					Slot being passed between them, with FRESH set if it was published
+ *															since the reader last took it
+ *	@property 	uint32_t			mRead					Slot the reader is reading, only touched by the reader
+ */
+template<class T>
+class TTripleBuffer
+{
+public:
+	TTripleBuffer() : mWrite(0), mShared(1), mRead(2) {}
+	T&					GetWriteSlot()				{ return mSlots[mWrite]; }
+	const T&			GetReadSlot()		const	{ return mSlots[mRead]; }
+	void				Publish()					{ mWrite = uint32_t(mShared.Exchange(long(mWrite | FRESH)) & SLOT); }
+	bool				Consume();
+private:
+	// copying disallowed
+	TTripleBuffer(const TTripleBuffer &buffer);
+	TTripleBuffer& operator=(const TTripleBuffer &buffer);
+
+	enum { SLOT = 3, FRESH = 4 };
+
+	T					mSlots[3];
+	uint32_t			mWrite;
+	TAtomicValue		mShared;
+	uint32_t			mRead;
+};
+
+/** @function TTripleBuffer::Consume - Takes the newest published value, if there is one the reader hasn't had
+ *
+ *		@return		true if GetReadSlot() now holds a value it didn't before
+ */
+template<class T>
+inline bool TTripleBuffer<T>::Consume()
+{
+	if(!(mShared.GetValue() & FRESH))
+		return false;
+	mRead = uint32_t(mShared.Exchange(long(mRead)) & SLOT);
+	return true;
+}
+
+#endif // TRIPLEBUFFER_H_INCLUDED
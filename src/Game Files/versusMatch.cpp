@@ -0,0 +1,209 @@
+/**
+ *	versusMatch.cpp - Jan van der Kamp, 2011
+ */
+#include "versusMatch.h"
+
+#include <pf/script.h>
+#include <pf/luatable.h>
+#include <pf/debug.h>
+#include <cstring>
+
+#include "snapshot.h"
+#include "timer.h"
+
+using std::vector;
+
+/** @function TVersusSpec::TVersusSpec - Default Constructor		Sets up a game over a link with no latency or loss
+ */
+TVersusSpec::TVersusSpec() :
+mSeed(1),
+mTick(16),
+mMaxGameTime(300000),
+mLatency(0),
+mJitter(0),
+mLossPercent(0),
+mBotShotInterval(250),
+mBotAimError(10.f),
+mResultsFile("versus.json")
+{}
+
+/** @function TVersusSpec::Load - Runs a versus file and reads the versus table it sets.
+ *		@param 		filename			Lua file to load
+ *
+ *		@return		true if the file was run and contained a versus table
+ */
+bool TVersusSpec::Load(const char* filename)
+{
+	TScript script;
+	if(!script.RunScript(filename))
+		return false;
+
+	lua_State* L = script.GetState();
+	LuaAutoBlock lab(L);
+	lua_getglobal(L, "versus");
+	TLuaTable table(L);
+
+	// Settings the file leaves out keep their defaults
+	if(table.IsNumber("seed"))
+		mSeed = uint32_t(table.GetNumber("seed"));
+	if(table.IsNumber("tick"))
+		mTick = uint32_t(table.GetNumber("tick"));
+	if(table.IsNumber("maxGameTime"))
+		mMaxGameTime = uint32_t(table.GetNumber("maxGameTime"));
+	if(table.IsNumber("latency"))
+		mLatency = uint32_t(table.GetNumber("latency"));
+	if(table.IsNumber("jitter"))
+		mJitter = uint32_t(table.GetNumber("jitter"));
+	if(table.IsNumber("lossPercent"))
+		mLossPercent = uint32_t(table.GetNumber("lossPercent"));
+	if(table.IsNumber("botShotInterval"))
+		mBotShotInterval = uint32_t(table.GetNumber("botShotInterval"));
+	if(table.IsNumber("botAimError"))
+		mBotAimError = TReal(table.GetNumber("botAimError"));
+	str resultsFile = table.GetString("resultsFile");
+	if(!resultsFile.empty())
+		mResultsFile = resultsFile;
+
+	// Keep values the game can't cope with in range, a link that loses every packet never delivers an input
+	if(mTick == 0)
+		mTick = 16;
+	if(mLossPercent > 90)
+		mLossPercent = 90;
+	return true;
+}
+
+
+/** @function TVersusMatch::TVersusMatch - Constructor			Takes the game's assets so that games are set up as they are on screen
+ *		@param 		ballAssets					Textures used for balloons and bullets
+ *		@param 		barrierTextures				Textures used for the barrier
+ *		@param 		cannonTexture				Texture used for the cannon
+ */
+TVersusMatch::TVersusMatch(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+						   const TTextureRef& cannonTexture) :
+mBallAssets(ballAssets),
+mBarrierTextures(barrierTextures),
+mCannonTexture(cannonTexture),
+mSpec(),
+mEndFrame(),
+mWinner(-1),
+mDesynced(false),
+mPacketsSent(),
+mPacketsLost()
+{
+	mScores[0] = mScores[1] = 0;
+}
+
+/** @function TVersusMatch::Run - Loads a versus file and plays the game it asks for. Each tick, each session takes in what
+ *								 has arrived over the link and, unless it is waiting for its opponent, its bot plays a frame.
+ *								 The game is given up on if the sessions haven't both finished well after the game should
+ *								 have ended, which only happens if the link loses too much.
+ *		@param 		filename			Lua file describing the game
+ *
+ *		@return		true if the file was loaded and the game played
+ */
+bool TVersusMatch::Run(const char* filename)
+{
+	if(!mSpec.Load(filename))
+		return false;
+
+	TLoopbackLink link(mSpec.mLatency, mSpec.mJitter, mSpec.mLossPercent, mSpec.mSeed ^ 0x27d4eb2d);
+	TRollbackSession* sessions[2];
+	TBot* bots[2];
+	for(uint32_t player = 0; player != 2; ++player) {
+		sessions[player] = new TRollbackSession(link.GetEnd(player), player, mSpec.mTick, mSpec.mMaxGameTime);
+		sessions[player]->AssignAssets(mBallAssets, mBarrierTextures, mCannonTexture);
+		sessions[player]->Start(TStateVariables(), mSpec.mSeed);
+		bots[player] = new TBot(mSpec.mBotShotInterval, mSpec.mBotAimError);
+		bots[player]->Reset((mSpec.mSeed + player) * 2654435761u ^ 0x5bd1e995);
+	}
+
+	uint64_t timeLimit = uint64_t(mSpec.mMaxGameTime) * 2 + 10000;
+	uint64_t start = THighResTimer::GetTicks();
+	for(uint64_t time = 0; time < timeLimit && !(sessions[0]->IsFinished() && sessions[1]->IsFinished()); time += mSpec.mTick)
+	{
+		link.SetTime(uint32_t(time));
+		for(uint32_t player = 0; player != 2; ++player) {
+			TRollbackSession& session = *sessions[player];
+			if(session.Update())
+				session.AdvanceFrame(bots[player]->Think(mSpec.mTick, session.GetBoard(player)));
+		}
+	}
+	double seconds = THighResTimer::TicksToMilliseconds(THighResTimer::GetTicks() - start) / 1000.0;
+
+	// Both sessions must agree on how the game ended and on every byte of both boards
+	bool finished = sessions[0]->IsFinished() && sessions[1]->IsFinished();
+	mDesynced = !finished || sessions[0]->GetEndFrame() != sessions[1]->GetEndFrame() ||
+				sessions[0]->GetWinner() != sessions[1]->GetWinner();
+	TSimulationSnapshot snapshots[2];
+	for(uint32_t board = 0; board != 2; ++board) {
+		for(uint32_t player = 0; player != 2; ++player)
+			snapshots[player].Take(sessions[player]->GetBoard(board));
+		if(snapshots[0].GetSize() != snapshots[1].GetSize() ||
+		   memcmp(snapshots[0].GetData(), snapshots[1].GetData(), snapshots[0].GetSize()) != 0)
+			mDesynced = true;
+		mScores[board] = sessions[0]->GetBoard(board).GetBalloonManager().GetScore();
+	}
+
+	mEndFrame = finished ? sessions[0]->GetEndFrame() : 0;
+	mWinner = sessions[0]->GetWinner();
+	mPacketsSent = link.GetPacketsSent();
+	mPacketsLost = link.GetPacketsLost();
+	for(uint32_t player = 0; player != 2; ++player) {
+		mStats[player] = sessions[player]->GetStats();
+		delete bots[player];
+		delete sessions[player];
+	}
+
+	DEBUG_WRITE(("Versus game ended at frame %d, winner %d, %s, played in %.2f s", mEndFrame, mWinner,
+				 mDesynced ? "DESYNCED" : "in sync", seconds));
+	return true;
+}
+
+/** @function TVersusMatch::WriteResults - Writes the result of the game played by Run() and each session's statistics to
+ *										  the spec's results file as JSON
+ *
+ *		@return		true if the file could be written
+ */
+bool TVersusMatch::WriteResults() const
+{
+	FILE* file = fopen(mSpec.mResultsFile.c_str(), "w");
+	if(!file)
+		return false;
+
+	fprintf(file, "{\n\t\"build\": \"%s %s\",\n\t\"seed\": %u,\n\t\"tick\": %u,\n\t\"latency\": %u,\n\t\"jitter\": %u,\n"
+				  "\t\"lossPercent\": %u,\n\t\"endFrame\": %u,\n\t\"winner\": %d,\n\t\"scores\": [ %u, %u ],\n"
+				  "\t\"desynced\": %s,\n\t\"packetsSent\": %u,\n\t\"packetsLost\": %u,\n\t\"players\": [\n",
+			__DATE__, __TIME__, mSpec.mSeed, mSpec.mTick, mSpec.mLatency, mSpec.mJitter, mSpec.mLossPercent, mEndFrame,
+			mWinner, mScores[0], mScores[1], mDesynced ? "true" : "false", mPacketsSent, mPacketsLost);
+	WriteStats(file, 0, false);
+	WriteStats(file, 1, true);
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
+
+/** @function TVersusMatch::WriteStats - Writes one player's session statistics
+ *		@param 		file				File to write to
+ *		@param 		player				Player whose statistics to write
+ *		@param 		last				Whether this is the last entry of the list being written
+ */
+void TVersusMatch::WriteStats(FILE* file, uint32_t player, bool last) const
+{
+	const TRollbackSession::TRollbackStats& stats = mStats[player];
+	double resimulateMs = THighResTimer::TicksToMilliseconds(stats.mResimulateTicks);
+	uint32_t totalDepth = 0;
+	for(uint32_t depth = 0; depth != gameVars::maxRollbackFrames + 1; ++depth)
+		totalDepth += depth * stats.mDepthCounts[depth];
+	fprintf(file, "\t\t{ \"frames\": %u, \"stalls\": %u, \"garbageSent\": %u, \"packetsSent\": %u, \"packetsReceived\": %u,\n"
+				  "\t\t  \"rollbacks\": %u, \"resimulatedFrames\": %u, \"meanDepth\": %.2f, \"maxDepth\": %u,\n"
+				  "\t\t  \"resimulateMs\": %.3f, \"meanRollbackUs\": %.2f, \"maxRollbackUs\": %.2f, \"meanResimulatedFrameUs\": %.2f,\n"
+				  "\t\t  \"depthCounts\": [",
+			stats.mFrames, stats.mStalls, stats.mGarbageSent, stats.mPacketsSent, stats.mPacketsReceived, stats.mRollbacks,
+			stats.mResimulatedFrames, stats.mRollbacks ? double(totalDepth) / stats.mRollbacks : 0.0,
+			stats.mMaxDepth, resimulateMs, stats.mRollbacks ? resimulateMs * 1000.0 / stats.mRollbacks : 0.0,
+			THighResTimer::TicksToMilliseconds(stats.mMaxResimulateTicks) * 1000.0,
+			stats.mResimulatedFrames ? resimulateMs * 1000.0 / stats.mResimulatedFrames : 0.0);
+	for(uint32_t depth = 0; depth != gameVars::maxRollbackFrames + 1; ++depth)
+		fprintf(file, "%s%u", depth ? ", " : " ", stats.mDepthCounts[depth]);
+	fprintf(file, " ] }%s\n", last ? "" : ",");
+}
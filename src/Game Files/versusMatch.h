@@ -0,0 +1,91 @@
+/**
+ *	versusMatch.h - Jan van der Kamp, 2011
+ */
+#ifndef VERSUSMATCH_H_INCLUDED
+#define VERSUSMATCH_H_INCLUDED
+
+#include <pf/pflib.h>
+#include <vector>
+#include <cstdio>
+
+#include "rollbackSession.h"
+#include "transport.h"
+#include "bot.h"
+
+/** @struct TVersusSpec - Describes a versus game between two bots for TVersusMatch. It is loaded from a Lua file which sets
+ *						  a global table called versus, see assets/scenarios/versus.lua.
+ *
+ *	@property 	uint32_t		mSeed							Seed of the game, the bots and the link
+ *	@property 	uint32_t		mTick							Time in milliseconds of each simulated frame
+ *	@property 	uint32_t		mMaxGameTime					Time in milliseconds after which the game is stopped
+ *	@property 	uint32_t		mLatency						Time in milliseconds every packet is held back for
+ *	@property 	uint32_t		mJitter							Largest extra time in milliseconds a packet is held back for
+ *	@property 	uint32_t		mLossPercent					Percentage of packets dropped
+ *	@property 	uint32_t		mBotShotInterval				Time in milliseconds between the bots reloading and firing
+ *	@property 	TReal			mBotAimError					Largest distance in pixels the bots miss their aim by
+ *	@property 	str				mResultsFile					File that results are written to
+ */
+struct TVersusSpec
+{
+	TVersusSpec();
+	bool		Load(const char* filename);
+
+	uint32_t	mSeed;
+	uint32_t	mTick;
+	uint32_t	mMaxGameTime;
+	uint32_t	mLatency;
+	uint32_t	mJitter;
+	uint32_t	mLossPercent;
+	uint32_t	mBotShotInterval;
+	TReal		mBotAimError;
+	str			mResultsFile;
+};
+
+/** @class TVersusMatch - Plays a versus game between two bots without drawing it, each bot with its own TRollbackSession,
+ *						  connected by a TLoopbackLink with the latency and packet loss of a TVersusSpec. Both sessions are
+ *						  stepped in the same loop, one tick of the link's clock at a time, as if they were running on two
+ *						  machines. When both have finished, their copies of both boards are compared byte for byte with
+ *						  TSimulationSnapshot, since any difference means the players saw different games. The result, any
+ *						  desync and each session's rollback statistics are written out as JSON.
+ *						  Set the "versus" config setting to a versus file in order to play a game at startup.
+ *
+ *	@property 	TBallAssets							mBallAssets				Textures used for balloons and bullets, shared by every game
+ *	@property 	std::vector<TTextureRef>			mBarrierTextures		Textures used for the barrier
+ *	@property 	TTextureRef							mCannonTexture			Texture used for the cannon
+ *	@property 	TVersusSpec							mSpec					The game being played
+ *	@property 	TRollbackSession::TRollbackStats	mStats[2]				Statistics of each player's session
+ *	@property 	uint32_t							mEndFrame				Frame the game ended at, or 0 if the sessions never finished
+ *	@property 	int32_t								mWinner					Board that won, or -1 for a draw
+ *	@property 	uint32_t							mScores[2]				Score of each board at the end
+ *	@property 	bool								mDesynced				Whether the sessions disagreed about the game
+ *	@property 	uint32_t							mPacketsSent			Number of packets sent over the link
+ *	@property 	uint32_t							mPacketsLost			Number of packets the link dropped
+ */
+class TVersusMatch
+{
+public:
+	TVersusMatch(const TBallAssets& ballAssets, const std::vector<TTextureRef>& barrierTextures,
+				 const TTextureRef& cannonTexture);
+	bool		Run(const char* filename);
+	bool		WriteResults() const;
+	bool		IsDesynced()	const	{ return mDesynced; }
+private:
+	// copying disallowed
+	TVersusMatch(const TVersusMatch &match);
+	TVersusMatch& operator=(const TVersusMatch &match);
+	void		WriteStats(FILE* file, uint32_t player, bool last) const;
+
+	TBallAssets							mBallAssets;
+	std::vector<TTextureRef>			mBarrierTextures;
+	TTextureRef							mCannonTexture;
+	TVersusSpec							mSpec;
+	TRollbackSession::TRollbackStats	mStats[2];
+	uint32_t							mEndFrame;
+	int32_t								mWinner;
+	uint32_t							mScores[2];
+	bool								mDesynced;
+	uint32_t							mPacketsSent;
+	uint32_t							mPacketsLost;
+};
+
+#endif // VERSUSMATCH_H_INCLUDED
@@ -17,6 +17,7 @@
 #include "../fxsprite.h"
 #include <pf/animtask.h>
 #include <pf/texture.h>
+#include "trace.h"
 
 PFTYPEIMPL(TFxSprite);
 
@@ -192,6 +193,7 @@ int TFxSprite::CreateFx( lua_State * L )
 
 bool TFxSpriteAnimTask::Animate()
 {
+	TRACE_SCOPE("TFxSpriteAnimTask::Animate");
 	uint32_t newms = GetTime();
 	uint32_t ms = newms-mLastMS ;
 	uint32_t times = ms / FX_PARTICLE_MS_PER_FRAME;
@@ -228,6 +230,7 @@ bool TFxSpriteAnimTask::Animate()
 	}
 
 	mLastMS=newms;
+	TRACE_COUNTER("active effects", mSpriteList.size());
 
 	if (mSpriteList.empty())
 	{
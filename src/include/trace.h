@@ -0,0 +1,66 @@
+/**
+ *	trace.h - Jan van der Kamp, 2011
+ */
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <pf/pflib.h>
+
+// Tracing is built in unless NO_TRACING is defined, and then costs a test of a flag for each event until a trace is opened
+#if !defined(NO_TRACING)
+	#define TRACING
+#endif
+
+/** @class TTrace - Records spans and counters from any thread onto one timeline, and writes them out as a Chrome trace
+ *					JSON file which loads in ui.perfetto.dev or chrome://tracing. Each thread records into a buffer of
+ *					its own, found through a thread-local pointer, so recording never locks or waits; a thread's buffer
+ *					is made the first time it records or names itself, and holds gameVars::traceEventsPerThread events,
+ *					after which that thread's events are dropped and counted. Names are kept as pointers, so they have
+ *					to last as long as the trace, which string literals do. Draw calls are counted rather than recorded,
+ *					while a trace is open or counting has been turned on for the stats table, and taken as a counter
+ *					once a frame. Set the "trace" config setting to a file to trace the game
+ *					from startup until it closes. Every thread has to have stopped recording before Close() is called.
+ *					With NO_TRACING defined the TRACE_ macros compile to nothing.
+ */
+class TTrace
+{
+public:
+	static bool				Open(const char* filename);
+	static bool				Close();
+	static bool				IsOpen();
+	static void				SetThreadName(const char* name);
+	static void				Begin(const char* name);
+	static void				End();
+	static void				Counter(const char* name, int32_t value);
+	static void				SetCountingDrawCalls(bool counting);
+	static void				CountDrawCall();
+	static int32_t			TakeDrawCalls();
+private:
+	// not constructed, everything is static
+	TTrace();
+};
+
+/** @class TTraceScope - Records a span from its construction to its destruction
+ */
+class TTraceScope
+{
+public:
+	explicit TTraceScope(const char* name)	{ TTrace::Begin(name); }
+	~TTraceScope()							{ TTrace::End(); }
+private:
+	// copying disallowed
+	TTraceScope(const TTraceScope &scope);
+	TTraceScope& operator=(const TTraceScope &scope);
+};
+
+#if defined(TRACING)
+	#define TRACE_SCOPE(name)				TTraceScope traceScope(name)
+	#define TRACE_COUNTER(name, value)		TTrace::Counter(name, int32_t(value))
+	#define TRACE_DRAW_CALL()				TTrace::CountDrawCall()
+#else
+	#define TRACE_SCOPE(name)
+	#define TRACE_COUNTER(name, value)
+	#define TRACE_DRAW_CALL()
+#endif
+
+#endif // TRACE_H_INCLUDED